@@ -0,0 +1,92 @@
+// Профили плат: параметры конвейера UART -> очереди -> BLE/WiFi
+//
+// Все различия плат по времени и ресурсам (интервалы отправки, размер порции
+// notify, стеки, приоритеты и ядра задач, интервалы advertising) собраны здесь
+// как константы времени компиляции. Конвейер (bridge_pipeline.h) и main.cpp
+// инстанцируются активным профилем BoardProfile — код каждой платы
+// специализируется компилятором, без ветвлений во время работы. Пороги и
+// порции отправки — значения по умолчанию: команды моста (bridge_control.h)
+// меняют их на ходу.
+//
+// Пины и библиотеки дисплеев остаются под #ifdef ESP32_S3 в main.cpp: это
+// разводка платы, а не параметры конвейера.
+//
+// BoardProfileHost — профиль хост-сборки (src/native/) и утилит (tools/).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLUSH_WAIT_IDLE 0xFFFFFFFFul  // Срок отправки: очереди пусты, ждать нечего
+
+// Общие значения; платы переопределяют то, чем отличаются
+struct BoardProfileBase {
+    static constexpr size_t UART_READ_CHUNK = 1024;  // Байт за одно чтение (~11 мс потока на 921600)
+    static constexpr size_t RX_READ_CHUNK = 512;     // Входящие RTCM/команды за один проход
+
+    // Отправка BLE: большие порции сразу, остаток — по интервалу
+    static constexpr size_t BLE_SEND_THRESHOLD = 400;
+    static constexpr size_t BLE_NEAR_FULL = 12288;  // Предупреждение в лог: очередь почти полна
+
+    static constexpr uint32_t DISPLAY_TASK_STACK = 6144;
+    static constexpr int DISPLAY_TASK_CORE = 0;
+
+    // Задачи конвейера (создаются только при DUAL_CORE)
+    static constexpr uint32_t BLE_TASK_STACK = 8192;
+    static constexpr unsigned BLE_TASK_PRIORITY = 2;  // Выше приёма: notify не ждёт разбора
+    static constexpr int BLE_TASK_CORE = 0;
+    static constexpr uint32_t DATA_TASK_STACK = 8192;
+    static constexpr unsigned DATA_TASK_PRIORITY = 1;
+    static constexpr int DATA_TASK_CORE = 1;
+
+    // Задачи конвейера спят до события; без событий просыпаются не чаще этого
+    static constexpr uint32_t DATA_TASK_IDLE_MS = 20;   // Таймауты, отчёты, команды профиля
+    static constexpr uint32_t BLE_TASK_IDLE_MS = 1000;  // Страховка: очереди пусты
+    static constexpr uint32_t LOOP_IDLE_MS = 10;        // loop() S3: подключения и входящие WiFi
+
+    // loop() C3 (loop_scheduler.h): проход с фоновыми стадиями не дольше интервала отправки BLE
+    static constexpr uint32_t LOOP_PASS_BUDGET_US = 3000;
+};
+
+// ESP32-C3: одно ядро, всё в loop(); TFT на Arduino_GFX
+struct BoardProfileC3 : BoardProfileBase {
+    static const char* deviceName() { return "UM980_C3_GPS"; }  // BLE
+    static const char* apName() { return "UM980_GPS_BRIDGE"; }  // WiFi AP
+
+    static constexpr bool DUAL_CORE = false;
+
+    static constexpr uint32_t BLE_FLUSH_INTERVAL_MS = 7;
+    static constexpr size_t BLE_READ_CHUNK = 480;  // Консервативно: меньше MTU-3 для целых NMEA строк
+
+    // Интервал advertising в единицах 1.25 мс
+    static constexpr uint16_t ADV_INTERVAL_MIN = 0x06;  // 7.5 мс
+    static constexpr uint16_t ADV_INTERVAL_MAX = 0x0C;  // 15 мс
+};
+
+// ESP32-S3: приём и разбор на ядре 1, отправка BLE/WiFi и дисплеи на ядре 0
+struct BoardProfileS3 : BoardProfileBase {
+    static const char* deviceName() { return "UM980_S3_GPS"; }
+    static const char* apName() { return "UM980_GPS_BRIDGE_S3"; }
+
+    static constexpr bool DUAL_CORE = true;
+
+    static constexpr uint32_t BLE_FLUSH_INTERVAL_MS = 4;  // Отдельная задача отправки — можно чаще
+    static constexpr size_t BLE_READ_CHUNK = 500;         // MTU-3 = 514
+
+    static constexpr uint16_t ADV_INTERVAL_MIN = 0x03;  // 3.75 мс
+    static constexpr uint16_t ADV_INTERVAL_MAX = 0x06;  // 7.5 мс
+};
+
+// Хост-сборка (tools/): параметры C3 — самого ограниченного по ресурсам
+struct BoardProfileHost : BoardProfileC3 {
+    static const char* deviceName() { return "UM980_HOST"; }
+    static const char* apName() { return "UM980_HOST"; }
+};
+
+#if defined(ESP32_S3)
+typedef BoardProfileS3 BoardProfile;
+#elif defined(ARDUINO)
+typedef BoardProfileC3 BoardProfile;
+#else
+typedef BoardProfileHost BoardProfile;
+#endif
@@ -0,0 +1,419 @@
+// Команды моста в канале RX: $BRIDGE,...*hh
+//
+// Строки с префиксом "$BRIDGE," в потоке от BLE клиента (характеристика RX)
+// и WiFi клиентов мост перехватывает и не передаёт приёмнику; остальные
+// байты, включая RTCM3, идут в UART без изменений. Контрольная сумма — как у
+// NMEA (XOR между '$' и '*'), без неё команда отклоняется; перевод строки
+// после суммы необязателен.
+//
+//   $BRIDGE,SET,<ключ>,<значение>*hh   применить сразу
+//   $BRIDGE,GET[,<ключ>]*hh            одна или все настройки
+//   $BRIDGE,SAVE*hh                    записать настройки в NVS
+//   $BRIDGE,DEFAULTS*hh                значения платы и стереть NVS
+//   $BRIDGE,REPLAY,<секунд>*hh         история из архива потока, затем живой
+//   $BRIDGE,REPLAY,STOP*hh             прервать повтор
+//
+// Ответ уходит в поток того же клиента: "$BRIDGE,OK,<ключ>,<значение>*hh" по
+// строке на настройку или "$BRIDGE,ERR,<причина>*hh". На REPLAY отвечает
+// ядро (bridge_core.h): "$BRIDGE,OK,REPLAY,<секунд>,<байт>*hh" — сколько
+// истории нашлось в архиве, и "$BRIDGE,OK,REPLAY,DONE*hh" на стыке с живым
+// потоком.
+//
+// Здесь — разбор потока (BridgeControlScanner), настройки и их проверка;
+// очередь команд и применение — bridge_core.h и окружение (main.cpp).
+// Разбор потока проверяет --rx-selftest хост-сборки.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board_profile.h"
+#include "stream_framer.h"  // SinkFilter: проверка спецификации фильтра
+#include "record_queue.h"  // QueueOverflowPolicy
+
+#define BRIDGE_CMD_PREFIX "$BRIDGE,"
+#define BRIDGE_CMD_PREFIX_LEN 8
+#define BRIDGE_CMD_MAX 128  // Команда целиком, с суммой
+#define BRIDGE_FILTER_LEN 64
+#define BRIDGE_SETTINGS_VERSION 3
+#define BRIDGE_REPLAY_MAX_S 7200  // Глубина REPLAY: не больше индекса архива
+
+enum BridgePhy : uint8_t { BRIDGE_PHY_ANY = 0, BRIDGE_PHY_1M, BRIDGE_PHY_2M, BRIDGE_PHY_CODED };
+static const char* const bridgePhyNames[] = {"ANY", "1M", "2M", "CODED"};
+
+// Настройки, меняемые командами; в NVS хранятся одним блоком
+struct BridgeSettings {
+    uint8_t version;  // BRIDGE_SETTINGS_VERSION
+    uint8_t phy;      // BridgePhy: предпочтение для новых соединений
+    uint8_t overflow;  // QueueOverflowPolicy очередей BLE и WiFi
+    uint8_t bleLanes;  // Полоса приоритета BLE для позиции и времени (bridge_core.h)
+    uint16_t mtu;     // Предлагается клиенту при обмене MTU
+    uint16_t bleThreshold;  // BleFlushPolicy: байт в очереди для немедленной отправки
+    uint16_t bleIntervalMs;
+    uint16_t bleChunk;  // Байт в notify, не больше BoardProfile::BLE_READ_CHUNK
+    uint16_t wifiThreshold;
+    uint16_t wifiIntervalMs;
+    uint16_t displayMs;    // Период задачи дисплея
+    uint16_t telemetryMs;  // Период порта статуса; 0 — молчит
+    char bleFilter[BRIDGE_FILTER_LEN];  // Фильтры новых подключений (stream_framer.h)
+    char wifiFilter[BRIDGE_FILTER_LEN];
+};
+
+// Значения по умолчанию: профиль платы и флаги сборки
+static inline BridgeSettings bridgeSettingsDefaults(const char* bleFilter, const char* wifiFilter) {
+    BridgeSettings s;
+    memset(&s, 0, sizeof(s));
+    s.version = BRIDGE_SETTINGS_VERSION;
+    s.phy = BRIDGE_PHY_ANY;
+    s.overflow = QUEUE_DROP_OLDEST;
+    s.bleLanes = 1;
+    s.mtu = 517;
+    s.bleThreshold = BoardProfile::BLE_SEND_THRESHOLD;
+    s.bleIntervalMs = BoardProfile::BLE_FLUSH_INTERVAL_MS;
+    s.bleChunk = BoardProfile::BLE_READ_CHUNK;
+    s.wifiThreshold = BoardProfile::BLE_SEND_THRESHOLD;
+    s.wifiIntervalMs = BoardProfile::BLE_FLUSH_INTERVAL_MS;
+    s.displayMs = 20;
+    s.telemetryMs = 1000;
+    strncpy(s.bleFilter, bleFilter, BRIDGE_FILTER_LEN - 1);
+    strncpy(s.wifiFilter, wifiFilter, BRIDGE_FILTER_LEN - 1);
+    return s;
+}
+
+// Числовые настройки: имя, поле и допустимый диапазон
+struct BridgeNumericKey {
+    const char* name;
+    uint16_t BridgeSettings::*field;
+    uint16_t minValue, maxValue;
+    bool zeroOff;  // 0 допустим и выключает
+};
+
+static const BridgeNumericKey bridgeNumericKeys[] = {
+    {"mtu", &BridgeSettings::mtu, 23, 517, false},
+    {"ble_threshold", &BridgeSettings::bleThreshold, 1, 8192, false},
+    {"ble_interval_ms", &BridgeSettings::bleIntervalMs, 0, 1000, false},
+    {"ble_chunk", &BridgeSettings::bleChunk, 20, (uint16_t)BoardProfile::BLE_READ_CHUNK, false},
+    {"wifi_threshold", &BridgeSettings::wifiThreshold, 1, 8192, false},
+    {"wifi_interval_ms", &BridgeSettings::wifiIntervalMs, 0, 1000, false},
+    {"display_ms", &BridgeSettings::displayMs, 20, 5000, false},
+    {"telemetry_ms", &BridgeSettings::telemetryMs, 100, 60000, true},
+};
+#define BRIDGE_NUMERIC_KEYS (sizeof(bridgeNumericKeys) / sizeof(bridgeNumericKeys[0]))
+
+// Текстовые настройки — после числовых: phy, overflow, ble_lanes, ble_filter, wifi_filter
+static const char* const bridgeTextKeys[] = {"phy", "overflow", "ble_lanes", "ble_filter", "wifi_filter"};
+#define BRIDGE_TEXT_KEYS 5
+
+// Значение настройки key текстом; false — нет такой
+static inline bool bridgeSettingGet(const BridgeSettings& s, const char* key, char* out, size_t cap) {
+    for (size_t k = 0; k < BRIDGE_NUMERIC_KEYS; k++) {
+        if (strcmp(key, bridgeNumericKeys[k].name) != 0) continue;
+        snprintf(out, cap, "%u", (unsigned)(s.*bridgeNumericKeys[k].field));
+        return true;
+    }
+    if (strcmp(key, "phy") == 0) {
+        snprintf(out, cap, "%s", bridgePhyNames[s.phy < 4 ? s.phy : 0]);
+    } else if (strcmp(key, "overflow") == 0) {
+        snprintf(out, cap, "%s", queuePolicyNames[s.overflow < QUEUE_POLICY_COUNT ? s.overflow : 0]);
+    } else if (strcmp(key, "ble_lanes") == 0) {
+        snprintf(out, cap, "%s", s.bleLanes ? "ON" : "OFF");
+    } else if (strcmp(key, "ble_filter") == 0) {
+        snprintf(out, cap, "%s", s.bleFilter[0] ? s.bleFilter : "ALL");
+    } else if (strcmp(key, "wifi_filter") == 0) {
+        snprintf(out, cap, "%s", s.wifiFilter[0] ? s.wifiFilter : "ALL");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Проверить и записать значение; при ошибке s не меняется, причина — в *error
+static inline bool bridgeSettingSet(BridgeSettings& s, const char* key, const char* value, const char** error) {
+    for (size_t k = 0; k < BRIDGE_NUMERIC_KEYS; k++) {
+        const BridgeNumericKey& nk = bridgeNumericKeys[k];
+        if (strcmp(key, nk.name) != 0) continue;
+        char* end = NULL;
+        unsigned long v = strtoul(value, &end, 10);
+        bool off = (v == 0 && nk.zeroOff);
+        if (!*value || *end || (!off && (v < nk.minValue || v > nk.maxValue))) {
+            *error = "range";
+            return false;
+        }
+        s.*nk.field = (uint16_t)v;
+        return true;
+    }
+    if (strcmp(key, "phy") == 0) {
+        for (uint8_t p = 0; p < 4; p++) {
+            if (strcmp(value, bridgePhyNames[p]) != 0) continue;
+            s.phy = p;
+            return true;
+        }
+        *error = "range";
+        return false;
+    }
+    if (strcmp(key, "overflow") == 0) {
+        for (uint8_t p = 0; p < QUEUE_POLICY_COUNT; p++) {
+            if (strcmp(value, queuePolicyNames[p]) != 0) continue;
+            s.overflow = p;
+            return true;
+        }
+        *error = "range";
+        return false;
+    }
+    if (strcmp(key, "ble_lanes") == 0) {
+        if (strcmp(value, "ON") != 0 && strcmp(value, "OFF") != 0) {
+            *error = "range";
+            return false;
+        }
+        s.bleLanes = (value[1] == 'N');
+        return true;
+    }
+    if (strcmp(key, "ble_filter") == 0 || strcmp(key, "wifi_filter") == 0) {
+        SinkFilter check;
+        if (strlen(value) >= BRIDGE_FILTER_LEN || !check.parse(value)) {
+            *error = "filter";
+            return false;
+        }
+        char* field = (key[0] == 'b') ? s.bleFilter : s.wifiFilter;
+        strncpy(field, strcmp(value, "ALL") == 0 ? "" : value, BRIDGE_FILTER_LEN - 1);
+        field[BRIDGE_FILTER_LEN - 1] = '\0';
+        return true;
+    }
+    *error = "key";
+    return false;
+}
+
+// Строка ответа "$<тело>*hh\r\n" в out с позиции pos; возвращает новую позицию
+static inline size_t bridgeReply(char* out, size_t pos, size_t cap, const char* fmt, ...) {
+    if (pos + 8 >= cap) return pos;
+    size_t start = pos;
+    out[pos++] = '$';
+    va_list args;
+    va_start(args, fmt);
+    int m = vsnprintf(out + pos, cap - pos - 5, fmt, args);  // Место под "*hh\r\n"
+    va_end(args);
+    if (m < 0) return start;
+    pos += ((size_t)m < cap - pos - 5) ? (size_t)m : cap - pos - 6;
+    uint8_t sum = 0;
+    for (size_t i = start + 1; i < pos; i++) sum ^= (uint8_t)out[i];
+    snprintf(out + pos, cap - pos, "*%02X\r\n", sum);
+    return pos + 5;
+}
+
+enum BridgeAction : uint8_t {
+    BRIDGE_ACTION_NONE = 0,  // Только ответ (GET или ошибка)
+    BRIDGE_ACTION_APPLY,     // Настройки изменились
+    BRIDGE_ACTION_SAVE,      // Записать в NVS
+    BRIDGE_ACTION_DEFAULTS,  // Сброшены к умолчаниям: применить и стереть NVS
+    BRIDGE_ACTION_REPLAY,    // Повтор истории на *replaySeconds (0 — стоп); ответ — за ядром
+};
+
+// Выполнить команду line (len байт, с '$' и суммой); ответ — в reply
+static inline BridgeAction bridgeExecute(BridgeSettings& s, const BridgeSettings& defaults, const char* line, size_t len,
+                                         char* reply, size_t cap, size_t* replyLen, uint32_t* replaySeconds = NULL) {
+    *replyLen = 0;
+    const char* star = (const char*)memchr(line, '*', len);
+    uint8_t sum = 0;
+    for (const char* p = line + 1; star && p < star; p++) sum ^= (uint8_t)*p;
+    char hex[3] = {0, 0, 0};
+    if (star && star + 3 == line + len) memcpy(hex, star + 1, 2);
+    char* hexEnd = NULL;
+    if (!hex[0] || strtoul(hex, &hexEnd, 16) != sum || *hexEnd) {
+        *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,ERR,checksum");
+        return BRIDGE_ACTION_NONE;
+    }
+
+    // Тело между префиксом и '*': глагол[,ключ[,значение]]; значение может содержать запятые
+    char body[BRIDGE_CMD_MAX];
+    size_t bodyLen = (size_t)(star - line) - BRIDGE_CMD_PREFIX_LEN;
+    memcpy(body, line + BRIDGE_CMD_PREFIX_LEN, bodyLen);
+    body[bodyLen] = '\0';
+    char* key = strchr(body, ',');
+    char* value = NULL;
+    if (key) {
+        *key++ = '\0';
+        value = strchr(key, ',');
+        if (value) *value++ = '\0';
+    }
+
+    char text[BRIDGE_FILTER_LEN];
+    if (strcmp(body, "SET") == 0 && key && value) {
+        const char* error = "";
+        if (!bridgeSettingSet(s, key, value, &error)) {
+            *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,ERR,%s,%s", error, key);
+            return BRIDGE_ACTION_NONE;
+        }
+        bridgeSettingGet(s, key, text, sizeof(text));
+        *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,OK,%s,%s", key, text);
+        return BRIDGE_ACTION_APPLY;
+    }
+    if (strcmp(body, "GET") == 0 && key && !value) {
+        if (!bridgeSettingGet(s, key, text, sizeof(text))) {
+            *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,ERR,key,%s", key);
+        } else {
+            *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,OK,%s,%s", key, text);
+        }
+        return BRIDGE_ACTION_NONE;
+    }
+    if (strcmp(body, "GET") == 0 && !key) {
+        size_t n = 0;
+        for (size_t k = 0; k < BRIDGE_NUMERIC_KEYS + BRIDGE_TEXT_KEYS; k++) {
+            const char* name = (k < BRIDGE_NUMERIC_KEYS) ? bridgeNumericKeys[k].name
+                                                         : bridgeTextKeys[k - BRIDGE_NUMERIC_KEYS];
+            bridgeSettingGet(s, name, text, sizeof(text));
+            n = bridgeReply(reply, n, cap, "BRIDGE,OK,%s,%s", name, text);
+        }
+        *replyLen = n;
+        return BRIDGE_ACTION_NONE;
+    }
+    if (strcmp(body, "SAVE") == 0 && !key) {
+        *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,OK,SAVE");
+        return BRIDGE_ACTION_SAVE;
+    }
+    if (strcmp(body, "DEFAULTS") == 0 && !key) {
+        s = defaults;
+        *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,OK,DEFAULTS");
+        return BRIDGE_ACTION_DEFAULTS;
+    }
+    if (strcmp(body, "REPLAY") == 0 && key && !value && replaySeconds) {
+        char* end = NULL;
+        unsigned long seconds = (strcmp(key, "STOP") == 0) ? 0 : strtoul(key, &end, 10);
+        if (end && (end == key || *end || seconds == 0 || seconds > BRIDGE_REPLAY_MAX_S)) {
+            *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,ERR,range,REPLAY");
+            return BRIDGE_ACTION_NONE;
+        }
+        *replaySeconds = (uint32_t)seconds;
+        return BRIDGE_ACTION_REPLAY;
+    }
+    *replyLen = bridgeReply(reply, 0, cap, "BRIDGE,ERR,command");
+    return BRIDGE_ACTION_NONE;
+}
+
+// Выделяет команды моста из входящего потока одного клиента. Остальные байты
+// уходят в pass(data, n) в исходном порядке. Команда начинается только с
+// начала строки: в начале потока, после '\r'/'\n', после команды или после
+// кадра RTCM3; кадры 0xD3 пропускаются по 10-битной длине, так что '$' в их
+// данных не задерживает поток. Начало префикса на границе порций удерживается
+// до следующей. Команда — в command(line, len).
+struct BridgeControlScanner {
+    char line[BRIDGE_CMD_MAX];
+    size_t len = 0;
+    int8_t sumDigits = -1;   // Символов суммы после '*'; -1 — '*' ещё не было
+    bool skipEol = false;    // Перевод строки после команды тоже её часть
+    bool lineStart = true;   // Следующий байт начинает строку
+    uint16_t rtcmSeen = 0;   // Байт текущего кадра RTCM3; 0 — вне кадра
+    uint16_t rtcmLen = 0;    // Полная длина кадра (после заголовка)
+
+    void reset() {
+        len = 0;
+        sumDigits = -1;
+        skipEol = false;
+        lineStart = true;
+        rtcmSeen = 0;
+        rtcmLen = 0;
+    }
+
+    // Поток стоит внутри кадра RTCM3
+    bool inRtcmFrame() const { return rtcmSeen > 0; }
+
+    template <typename Pass, typename Command>
+    void feed(const uint8_t* data, size_t n, Pass pass, Command command) {
+        size_t run = 0;     // Начало участка, который уйдёт в pass целиком
+        size_t heldAt = n;  // Начало удерживаемого префикса в этой порции; n — начат в прошлой
+        size_t i = 0;
+        while (i < n) {
+            uint8_t c = data[i];
+            if (len == 0) {
+                if (skipEol && (c == '\r' || c == '\n')) {
+                    if (i > run) pass(data + run, i - run);
+                    run = ++i;
+                    continue;
+                }
+                skipEol = false;
+                if (c == '$' && lineStart && rtcmSeen == 0) {
+                    line[len++] = '$';
+                    heldAt = i++;
+                    continue;
+                }
+                track(c);
+                i++;
+                continue;
+            }
+            if (len < BRIDGE_CMD_PREFIX_LEN) {
+                if (c == (uint8_t)BRIDGE_CMD_PREFIX[len]) {
+                    line[len++] = (char)c;
+                    i++;
+                    if (len == BRIDGE_CMD_PREFIX_LEN) {
+                        // Команда моста: всё до неё — приёмнику
+                        if (heldAt < n && heldAt > run) pass(data + run, heldAt - run);
+                        heldAt = n;
+                        run = i;
+                    }
+                    continue;
+                }
+                // Не команда моста: префикс из этой порции остаётся в участке,
+                // из прошлой — уходит приёмнику; байт разбирается заново
+                if (heldAt == n) {
+                    pass((const uint8_t*)line, len);
+                    run = i;
+                }
+                heldAt = n;
+                len = 0;
+                lineStart = false;
+                continue;
+            }
+            run = ++i;
+            bool eol = (c == '\r' || c == '\n');
+            if (!eol) {
+                line[len++] = (char)c;
+                if (c == '*' && sumDigits < 0) {
+                    sumDigits = 0;
+                } else if (sumDigits >= 0) {
+                    sumDigits++;
+                }
+            }
+            if (eol || sumDigits == 2 || len == BRIDGE_CMD_MAX - 1) {
+                line[len] = '\0';
+                command((const char*)line, len);
+                len = 0;
+                sumDigits = -1;
+                skipEol = true;
+                lineStart = true;
+            }
+        }
+        size_t end = (len == 0) ? n : (heldAt < n) ? heldAt : run;
+        if (end > run) pass(data + run, end - run);
+    }
+
+  private:
+    // Байт, ушедший приёмнику: границы строк и кадров RTCM3
+    void track(uint8_t c) {
+        if (rtcmSeen > 0) {
+            rtcmSeen++;
+            if (rtcmSeen == 2) {
+                if (c & 0xFC) {  // Не заголовок RTCM3: 6 старших бит длины — нули
+                    rtcmSeen = 0;
+                    lineStart = (c == '\r' || c == '\n');
+                    return;
+                }
+                rtcmLen = (uint16_t)((c & 0x03) << 8);
+            } else if (rtcmSeen == 3) {
+                rtcmLen = (uint16_t)(rtcmLen + c + 6);  // Заголовок 3 байта + данные + CRC 3 байта
+            } else if (rtcmSeen == rtcmLen) {
+                rtcmSeen = 0;
+                lineStart = true;
+            }
+            return;
+        }
+        if (c == 0xD3) {
+            rtcmSeen = 1;
+            lineStart = false;
+            return;
+        }
+        lineStart = (c == '\r' || c == '\n');
+    }
+};
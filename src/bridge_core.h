@@ -0,0 +1,620 @@
+// Ядро моста: очереди потребителей и раскладка потока приёмника по ним
+//
+// routeUartChunk() режет поток UART на предложения/кадры (StreamFramer),
+// отдаёт их парсерам (gnss_parser.h) и кладёт в очередь каждого подключенного
+// потребителя, фильтр которого принимает запись: BLE — bleRingBuffer и полоса
+// приоритета для позиции и времени, WiFi — собственная очередь на клиента. Очереди потребителей — из целых записей
+// (record_queue.h), у каждой метки задержки (latency_trace.h). Входящие от BLE клиента данные ждут в bleRxBuffer, от
+// WiFi клиентов — уходят в приёмник через forwardWiFiRx(). Отправка из очередей — BridgePipeline (bridge_pipeline.h)
+// и flushWiFiSinks(). Весь поток, кроме того, пишется в архив (stream_archive.h), из которого клиент
+// по $BRIDGE,REPLAY получает историю перед живыми данными, и с -DFLASH_LOG=1 — в запись на флеш (flash_log.h).
+//
+// Не зависит от NimBLE и WiFi: флаги подключения выставляет окружение,
+// поэтому ядро целиком собирается в хост-сборке (src/native/).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "hal.h"
+#include "board_profile.h"
+#include "ring_buffer.h"
+#include "record_queue.h"
+#include "stream_framer.h"
+#include "gnss_parser.h"
+#include "latency_trace.h"
+#include "bridge_control.h"
+#include "stream_archive.h"
+#include "flash_log.h"
+#include "uart_link.h"
+
+// ==============================================
+// BLE QUEUE
+// ==============================================
+
+#ifndef RING_BUFFER_SIZE
+#define RING_BUFFER_SIZE 16384  // Увеличен с 8192 до 16384 для NTRIP поправок
+#endif
+
+// Основной буфер (BLE) — 16 КБ под NTRIP поправки. При переполнении теряются
+// целые записи (record_queue.h); таблица записей — на среднюю запись от 32 байт
+typedef RecordQueueT<RING_BUFFER_SIZE, RING_BUFFER_SIZE / 32> RingBuffer;
+
+// Глобальный экземпляр очереди для BLE данных
+static RingBuffer bleRingBuffer;
+
+// Буфер для входящих BLE RX данных (NTRIP поправки + команды)
+#define RX_BUFFER_SIZE 4096
+static RingBufferT<RX_BUFFER_SIZE> bleRxBuffer;  // Отдельный буфер для RX
+
+// Полоса приоритета: позиция и время (BLE_PRIORITY_TYPES) идут к BLE клиенту
+// отдельной короткой очередью. Отправка берёт её первой, как только поток
+// основной очереди стоит на границе записи, — свежая позиция не ждёт
+// килобайты GSV и RTCM. Неотправленная запись того же типа заменяется новой.
+// Полосы включает настройка ble_lanes (bridge_control.h); выключенные — одна очередь.
+#ifndef BLE_PRIORITY_TYPES
+#define BLE_PRIORITY_TYPES ((1u << ST_GGA) | (1u << ST_GNS) | (1u << ST_RMC) | (1u << ST_GLL) | (1u << ST_ZDA))
+#endif
+#define BLE_PRIORITY_LANE_SIZE 1024  // Несколько эпох позиции при 10-20 Гц
+static RecordQueueT<BLE_PRIORITY_LANE_SIZE, BLE_PRIORITY_LANE_SIZE / 32> blePriorityLane;
+
+// Задержка UART→BLE notify: метки порций по позиции в очереди (latency_trace.h).
+// Позиции — счётчики байт, поставленных в очередь и забранных на отправку; у
+// полосы приоритета свои.
+static volatile uint32_t bleQueuedTotal = 0;    // Байт поставлено в очередь BLE
+static volatile uint32_t bleDequeuedTotal = 0;  // Байт забрано на отправку
+static LatencyTracer bleTrace;
+static volatile uint32_t blePriorityQueuedTotal = 0;
+static volatile uint32_t blePriorityDequeuedTotal = 0;
+static LatencyTracer blePriorityTrace;
+static volatile uint32_t bleOverflowEvents = 0;  // Чтений, обнаруживших потери
+static volatile uint32_t bleSuperseded = 0;      // Записей полосы приоритета, заменённых новыми
+static volatile uint32_t bleSession = 0;         // Сбросы очереди: повтор истории прошлого клиента не продолжается
+static volatile uint32_t bleConnects = 0;        // Подключения BLE: колбэк NimBLE только считает их (refreshBleFilter)
+
+// Вспомогательные функции для работы с кольцевым буфером
+inline size_t writeToRingBuffer(const uint8_t* data, size_t len, uint8_t type = ST_NMEA_OTHER, bool piece = false) {
+    size_t written = bleRingBuffer.write(data, len, type, piece);
+    bleQueuedTotal += written;
+    return written;
+}
+
+// Новая запись полосы приоритета заменяет неотправленную того же типа
+inline size_t writeToPriorityLane(const uint8_t* data, size_t len, uint8_t type) {
+    bleSuperseded += blePriorityLane.supersede(type);
+    size_t written = blePriorityLane.write(data, len, type);
+    blePriorityQueuedTotal += written;
+    return written;
+}
+
+// Чтение одной очереди BLE со сдвигом её позиции
+template <typename Queue>
+static size_t readBleLane(Queue& q, volatile uint32_t& queued, volatile uint32_t& dequeued, LatencyTracer& trace,
+                          uint8_t* data, size_t maxLen) {
+    bool lost = q.hasOverflowed();  // read() сбрасывает флаги
+    bool skipped = q.skipped;
+    size_t n = q.read(data, maxLen);
+    if (n == 0) return 0;
+    if (lost) bleOverflowEvents++;
+    if (skipped) {
+        // Выброшенные и заменённые записи никогда не будут отправлены — их метки без выборки
+        dequeued = queued - q.available();
+        trace.dropped(dequeued - n);
+    } else {
+        dequeued += n;
+    }
+    return n;
+}
+
+// Порция для notify из обеих полос. Начатая запись дочитывается первой, так
+// что полосы чередуются только на границах записей и поток клиента не рвётся.
+inline size_t readFromRingBuffer(uint8_t* data, size_t maxLen) {
+    size_t n = 0;
+    size_t partial = bleRingBuffer.partialRemaining();
+    if (partial > 0) {
+        n = readBleLane(bleRingBuffer, bleQueuedTotal, bleDequeuedTotal, bleTrace, data,
+                        (partial < maxLen) ? partial : maxLen);
+        if (n < partial) return n;
+    }
+    n += readBleLane(blePriorityLane, blePriorityQueuedTotal, blePriorityDequeuedTotal, blePriorityTrace, data + n,
+                     maxLen - n);
+    if (n == maxLen || blePriorityLane.partialRemaining() > 0) return n;
+    return n + readBleLane(bleRingBuffer, bleQueuedTotal, bleDequeuedTotal, bleTrace, data + n, maxLen - n);
+}
+
+// Вызывается после notify: порции, целиком забранные из очереди, отправлены
+inline void noteBleLatency() {
+    uint32_t now = micros();
+    bleTrace.sent(bleDequeuedTotal, now, LATENCY_SINK_BLE);
+    blePriorityTrace.sent(blePriorityDequeuedTotal, now, LATENCY_SINK_BLE_PRIORITY);
+}
+
+// Вызывается, когда notify сжатой порции не принята: порции, забранные из
+// очереди, клиент не получит — их метки без выборки
+inline void dropBleLatency() {
+    bleTrace.dropped(bleDequeuedTotal);
+    blePriorityTrace.dropped(blePriorityDequeuedTotal);
+}
+
+inline size_t getRingBufferAvailable() {
+    return bleRingBuffer.available() + blePriorityLane.available();
+}
+
+inline size_t getRingBufferFree() {
+    return bleRingBuffer.freeSpace();
+}
+
+inline bool getRingBufferOverflow() {
+    return bleRingBuffer.hasOverflowed() || blePriorityLane.hasOverflowed();
+}
+
+inline void clearRingBuffer() {
+    bleRingBuffer.clear();
+    bleDequeuedTotal = bleQueuedTotal;
+    bleTrace.clearMarks();
+    blePriorityLane.clear();
+    blePriorityDequeuedTotal = blePriorityQueuedTotal;
+    blePriorityTrace.clearMarks();
+    bleSession++;
+}
+
+// ==============================================
+// SENTENCE FRAMING AND PER-SINK FILTERS
+// ==============================================
+// StreamFramer/SinkFilter — см. stream_framer.h
+
+// Фильтры по умолчанию для новых подключений (задаются через build_flags)
+#ifndef BLE_SINK_FILTER
+#define BLE_SINK_FILTER ""   // Например: "GGA:1,GST:10,GSV:20,GSA:10,RTCM:1"
+#endif
+#ifndef WIFI_SINK_FILTER
+#define WIFI_SINK_FILTER ""  // WiFi логгер по умолчанию получает полный поток
+#endif
+
+static StreamFramer uartFramer;
+
+// Состояние потребителей: выставляется колбэками NimBLE и обработчиком WiFi
+static bool deviceConnected = false;
+static SinkFilter bleFilter;             // Фильтр предложений для BLE клиента
+
+#define MAX_WIFI_CLIENTS 4
+bool wifiClientConnected[MAX_WIFI_CLIENTS] = {false};
+unsigned long lastWiFiFlush[MAX_WIFI_CLIENTS] = {0};
+
+// Per-client queues and filters: each WiFi client gets its own filtered stream
+#define WIFI_RING_BUFFER_SIZE 8192
+static RecordQueueT<WIFI_RING_BUFFER_SIZE, WIFI_RING_BUFFER_SIZE / 32> wifiRingBuffers[MAX_WIFI_CLIENTS];
+static SinkFilter wifiFilters[MAX_WIFI_CLIENTS];
+static uint32_t wifiOverflowEvents = 0;  // All clients
+
+// Queue positions for latency marks, as for BLE: bytes queued / taken for write()
+static volatile uint32_t wifiQueuedTotal[MAX_WIFI_CLIENTS] = {0};
+static volatile uint32_t wifiSentTotal[MAX_WIFI_CLIENTS] = {0};
+static LatencyTracer wifiTrace[MAX_WIFI_CLIENTS];
+static volatile uint32_t wifiSession[MAX_WIFI_CLIENTS] = {0};  // Queue resets, as bleSession
+
+// Drop a client's queued data (connect/disconnect) along with its latency marks
+inline void clearWiFiQueue(int i) {
+    wifiRingBuffers[i].clear();
+    wifiSentTotal[i] = wifiQueuedTotal[i];
+    wifiTrace[i].clearMarks();
+    wifiSession[i]++;
+}
+
+// Счётчики приёма: загрузка линии и обнаружение пропавшего потока
+static volatile uint32_t uartBytesIn = 0;
+static unsigned long uartLastRxMs = 0;
+
+// ==============================================
+// TELEMETRY COUNTERS
+// ==============================================
+// Счётчики без блокировок: у каждого поля один писатель — поток приёма
+// (записи, ошибки контрольных сумм), поток отправки (байты наружу, отказы
+// notify) или своя задача (гистограмма). Читатель (bridge_telemetry.h)
+// копирует поля по одному: 32-битные слова читаются и пишутся атомарно.
+// Заполнение и потери очередей (байты, записи по типам) считают сами очереди.
+
+#define TELEMETRY_HIST_BUCKETS 12  // Время итерации: <16 мкс, <32, ..., <16384, >=16384
+
+enum TelemetryTask : uint8_t {
+    TASK_LOOP = 0,  // loop(): весь конвейер на C3, WiFi подключения на S3
+    TASK_DATA,      // dataTask S3: приём и разбор
+    TASK_BLE,       // bleTask S3: отправка BLE и WiFi
+    TELEMETRY_TASK_COUNT
+};
+
+struct BridgeCounters {
+    volatile uint32_t bleBytesOut;                   // Отдано в notify/чтение TX (после сжатия ND1)
+    volatile uint32_t wifiBytesOut[MAX_WIFI_CLIENTS];
+    volatile uint32_t notifyFailures;
+    volatile uint32_t nmeaChecksumErrors;
+    volatile uint32_t rtcmCrcErrors;
+    volatile uint32_t records[ST_COUNT];             // Записи потока UART по типам
+    volatile uint32_t verifiedRecords;               // Из них с проверенной целостностью (uartRecordVerified)
+    volatile uint32_t iterationHist[TELEMETRY_TASK_COUNT][TELEMETRY_HIST_BUCKETS];
+    volatile uint32_t busyUs[TELEMETRY_TASK_COUNT];  // Сумма времени итераций (переполняется)
+    volatile uint32_t wakeups[TELEMETRY_TASK_COUNT];  // Итераций: на S3 каждая — пробуждение задачи
+};
+
+static BridgeCounters bridgeCounters;
+
+// Одна итерация цикла задачи длительностью us
+static inline void telemetryNoteIteration(uint8_t task, uint32_t us) {
+    uint8_t bucket = 0;
+    while (bucket < TELEMETRY_HIST_BUCKETS - 1 && us >= (16u << bucket)) bucket++;
+    bridgeCounters.iterationHist[task][bucket]++;
+    bridgeCounters.busyUs[task] += us;
+    bridgeCounters.wakeups[task]++;
+}
+
+// ==============================================
+// BRIDGE CONTROL COMMANDS
+// ==============================================
+// $BRIDGE команды (bridge_control.h) выделяются из входящих BLE (конвейер) и
+// WiFi (forwardWiFiRx) и ждут в почтовом ящике: выполняет их поток приёма в
+// serviceControlCommands() — он же владеет фильтрами и очередями клиентов.
+// Применение к NimBLE, дисплею и запись в NVS — окружение
+// (applyBridgeSettings).
+
+#define CONTROL_SOURCE_BLE 0
+#define CONTROL_SOURCE_WIFI 1  // WiFi клиент i — CONTROL_SOURCE_WIFI + i
+#define CONTROL_MAILBOX 8  // Команд за одну порцию RX; лишние отбрасываются без ответа
+
+static BridgeSettings bridgeSettings = bridgeSettingsDefaults(BLE_SINK_FILTER, WIFI_SINK_FILTER);
+static BridgeControlScanner wifiControl[MAX_WIFI_CLIENTS];
+
+// Политика переполнения очередей BLE и WiFi ($BRIDGE overflow)
+inline void applyQueuePolicy() {
+    bleRingBuffer.policy = bridgeSettings.overflow;
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) wifiRingBuffers[i].policy = bridgeSettings.overflow;
+}
+
+struct PendingControl {
+    uint8_t source;
+    uint8_t len;
+    char line[BRIDGE_CMD_MAX];
+};
+static PendingControl controlMailbox[CONTROL_MAILBOX];
+static uint8_t controlHead = 0, controlCount = 0;
+static volatile uint32_t controlDropped = 0;  // Ящик полон — команда без ответа
+
+// Настройки изменились (action — BridgeAction): окружение применяет их к
+// своим частям; прошивка — к NimBLE, дисплею и NVS, хост-сборка — к конвейеру
+void applyBridgeSettings(uint8_t action);
+
+static void postControlCommand(uint8_t source, const char* line, size_t len) {
+    portENTER_CRITICAL(&ringbufMux);
+    if (controlCount == CONTROL_MAILBOX) {
+        controlDropped++;
+    } else {
+        PendingControl& p = controlMailbox[(controlHead + controlCount) % CONTROL_MAILBOX];
+        p.source = source;
+        p.len = (uint8_t)len;
+        memcpy(p.line, line, len);
+        p.line[len] = '\0';
+        controlCount++;
+    }
+    portEXIT_CRITICAL(&ringbufMux);
+}
+
+static bool takeControlCommand(PendingControl& out) {
+    portENTER_CRITICAL(&ringbufMux);
+    bool any = controlCount > 0;
+    if (any) {
+        out = controlMailbox[controlHead];
+        controlHead = (controlHead + 1) % CONTROL_MAILBOX;
+        controlCount--;
+    }
+    portEXIT_CRITICAL(&ringbufMux);
+    return any;
+}
+
+// ==============================================
+// STREAM ARCHIVE AND HISTORY REPLAY
+// ==============================================
+// Поток приёмника пишется в архив всегда; память под него выделяет окружение
+// (на S3 — PSRAM). $BRIDGE,REPLAY,<секунд> ставит клиенту курсор архива на
+// это время назад. Пока курсор не догнал архив, живые записи в очередь
+// клиента не идут, а serviceReplay() доливает её записями архива через
+// фильтр клиента, пока очередь заполнена меньше чем наполовину, — со
+// скоростью канала. Догнав архив, клиент переходит на живой поток без
+// пропусков и повторов: архив и очереди пишет один поток приёма.
+
+#define REPLAY_CHUNK_BYTES 4096  // Байт истории за один вызов serviceReplay()
+
+static StreamArchive streamArchive;
+static FlashLog flashLog;  // Запись во флеш (flash_log.h): включает окружение
+
+struct ReplayState {
+    bool active;
+    uint32_t cursor;   // Позиция в архиве
+    uint32_t session;  // bleSession / wifiSession[i] при старте
+};
+static ReplayState replayState[1 + MAX_WIFI_CLIENTS];  // Индекс — CONTROL_SOURCE_*
+static uint32_t replaysStarted = 0;
+static uint32_t replayRecords = 0;  // Записей истории поставлено в очереди
+static uint32_t replayOverrun = 0;  // Курсор обогнан записью архива
+
+static inline bool sinkConnected(uint8_t source) {
+    return (source == CONTROL_SOURCE_BLE) ? deviceConnected : wifiClientConnected[source - CONTROL_SOURCE_WIFI];
+}
+
+static inline uint32_t sinkSession(uint8_t source) {
+    return (source == CONTROL_SOURCE_BLE) ? bleSession : wifiSession[source - CONTROL_SOURCE_WIFI];
+}
+
+// Очередь клиента source (BLE — основная полоса), мимо его фильтра
+static void writeToSink(uint8_t source, const uint8_t* data, size_t len, uint8_t type = ST_NMEA_OTHER,
+                        bool piece = false) {
+    if (source == CONTROL_SOURCE_BLE) {
+        writeToRingBuffer(data, len, type, piece);
+    } else {
+        int i = source - CONTROL_SOURCE_WIFI;
+        wifiQueuedTotal[i] += wifiRingBuffers[i].write(data, len, type, piece);
+    }
+}
+
+// Клиент получает историю: живые записи ему не раскладываются
+static inline bool replayActive(uint8_t source) {
+    const ReplayState& r = replayState[source];
+    return r.active && r.session == sinkSession(source);
+}
+
+// Хоть один клиент ждёт историю: serviceReplay() нужен каждый проход
+static inline bool anyReplayActive() {
+    for (uint8_t source = 0; source < 1 + MAX_WIFI_CLIENTS; source++) {
+        if (replayActive(source)) return true;
+    }
+    return false;
+}
+
+// Повтор последних seconds секунд; возвращает, сколько секунд нашлось в архиве
+static uint32_t startReplay(uint8_t source, uint32_t seconds, uint32_t* pendingBytes) {
+    uint32_t now = millis();
+    uint32_t from = (seconds * 1000 < now) ? now - seconds * 1000 : 0;
+    ReplayState& r = replayState[source];
+    r.cursor = streamArchive.seek(from);
+    r.session = sinkSession(source);
+    r.active = true;
+    replaysStarted++;
+    *pendingBytes = streamArchive.pendingBytes(r.cursor);
+    uint32_t found = (now - streamArchive.oldestMs(now)) / 1000;
+    return (found < seconds) ? found : seconds;
+}
+
+// Долить историю в очереди клиентов, которые её ждут
+static inline void serviceReplay() {
+    static uint8_t rec[FRAMER_MAX_RECORD];
+    for (uint8_t source = 0; source < 1 + MAX_WIFI_CLIENTS; source++) {
+        ReplayState& r = replayState[source];
+        if (!r.active) continue;
+        if (!sinkConnected(source) || r.session != sinkSession(source)) {
+            r.active = false;  // Клиент, просивший повтор, отключился
+            continue;
+        }
+        bool ble = (source == CONTROL_SOURCE_BLE);
+        int i = source - CONTROL_SOURCE_WIFI;
+        SinkFilter& filter = ble ? bleFilter : wifiFilters[i];
+        size_t budget = REPLAY_CHUNK_BYTES;
+        while (budget > 0) {
+            size_t queued = ble ? bleRingBuffer.available() : wifiRingBuffers[i].available();
+            size_t capacity = ble ? bleRingBuffer.capacity() : wifiRingBuffers[i].capacity();
+            if (queued * 2 >= capacity) break;
+            uint8_t type = ST_RAW;
+            bool overrun = false, piece = false;
+            size_t len = streamArchive.next(r.cursor, rec, sizeof(rec), &type, &overrun, &piece);
+            if (overrun) replayOverrun++;
+            if (len == 0) {
+                // Архив догнан: следующая запись приёма уже пойдёт клиенту вживую
+                char done[32];
+                size_t n = bridgeReply(done, 0, sizeof(done), "BRIDGE,OK,REPLAY,DONE");
+                writeToSink(source, (const uint8_t*)done, n);
+                r.active = false;
+                break;
+            }
+            budget -= (len < budget) ? len : budget;
+            if (filter.accept(type)) {
+                writeToSink(source, rec, len, type, piece);
+                replayRecords++;
+            }
+        }
+    }
+}
+
+// ==============================================
+// ROUTING
+// ==============================================
+
+// Ответ приёмника на команду профиля вывода (output_profile.h) перехватывает
+// окружение: прошивка — отправщик профиля, хост-сборка — своя заглушка
+bool handleOutputProfileResponse(const uint8_t* rec, size_t len);
+
+// Hand a framed record to every connected sink whose filter accepts it;
+// piece — continuation of a long binary frame (StreamFramer::continued)
+static void dispatchRecord(const uint8_t* rec, size_t len, uint8_t type, bool piece) {
+    if (deviceConnected && !replayActive(CONTROL_SOURCE_BLE) && bleFilter.accept(type)) {
+        if (bridgeSettings.bleLanes && ((BLE_PRIORITY_TYPES >> type) & 1)) {
+            writeToPriorityLane(rec, len, type);
+        } else {
+            writeToRingBuffer(rec, len, type, piece);
+        }
+    }
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+        if (wifiClientConnected[i] && !replayActive(CONTROL_SOURCE_WIFI + i) && wifiFilters[i].accept(type)) {
+            wifiQueuedTotal[i] += wifiRingBuffers[i].write(rec, len, type, piece);
+        }
+    }
+}
+
+// Demultiplexed UART record: parse for the display, then fan out to sink queues
+static void onUartRecord(const uint8_t* rec, size_t len, uint8_t type) {
+    bridgeCounters.records[type]++;
+    if (uartRecordVerified(rec, len, type)) bridgeCounters.verifiedRecords++;
+    if (type <= ST_NMEA_OTHER && !nmeaChecksumOk(rec, len)) {
+        bridgeCounters.nmeaChecksumErrors++;
+    } else if (type == ST_RTCM && !rtcmFrameCrcOk(rec, len)) {
+        bridgeCounters.rtcmCrcErrors++;
+    }
+    if (type == ST_UNIBIN) {
+        parseUnicoreBinary(rec, len);
+    } else if (type == ST_NMEA_OTHER && handleOutputProfileResponse(rec, len)) {
+        return;  // Ответ на команду профиля — клиентам не нужен
+    } else if (type <= ST_NMEA_OTHER) {
+        // Позиция/точность из бинарного BESTNAV/PVTSLN дешевле разбора ASCII float
+        bool positionSentence = (type == ST_GGA || type == ST_GNS || type == ST_GST);
+        if (!(positionSentence && binaryNavIsFresh())) {
+            parseNMEA((const char*)rec);
+        }
+    }
+    streamArchive.append(rec, len, type, millis(), uartFramer.continued);
+    flashLog.record(rec, len, type);
+    dispatchRecord(rec, len, type, uartFramer.continued);
+}
+
+// Фильтр нового BLE клиента разбирается здесь, в потоке приёма, до первой его
+// порции: колбэк подключения (задача NimBLE) только увеличивает bleConnects,
+// иначе accept() видел бы фильтр посреди parse(), а bridgeSettings — посреди
+// записи командой
+static inline void refreshBleFilter() {
+    static uint32_t parsedFor = 0;
+    uint32_t connects = bleConnects;
+    if (connects == parsedFor) return;
+    parsedFor = connects;
+    bleFilter.parse(bridgeSettings.bleFilter);
+}
+
+// UART ingest: split into whole sentences/frames and fan out to sink queues
+void routeUartChunk(const uint8_t* data, size_t len) {
+    refreshBleFilter();
+    uint32_t arrivedUs = micros();
+    uint32_t bleBefore = bleQueuedTotal, priorityBefore = blePriorityQueuedTotal;
+    uint32_t wifiBefore[MAX_WIFI_CLIENTS];
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) wifiBefore[i] = wifiQueuedTotal[i];
+
+    uartBytesIn += len;
+    uartLastRxMs = millis();
+    uartFramer.feed(data, len, onUartRecord);
+
+    // One mark per sink per chunk, at the end of what this chunk queued
+    if (bleQueuedTotal != bleBefore) bleTrace.mark(bleQueuedTotal, arrivedUs);
+    if (blePriorityQueuedTotal != priorityBefore) blePriorityTrace.mark(blePriorityQueuedTotal, arrivedUs);
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+        if (wifiQueuedTotal[i] != wifiBefore[i]) wifiTrace[i].mark(wifiQueuedTotal[i], arrivedUs);
+    }
+}
+
+// WiFi data sending function: drains each client's own queue.
+// Client is WiFiClient on the device and NativeWiFiClient on the host.
+template <typename Client>
+void flushWiFiSinks(Client (&wifiClients)[MAX_WIFI_CLIENTS]) {
+    static uint8_t wifiTxBuffer[1024];
+    unsigned long now = millis();
+
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+        if (!wifiClientConnected[i] || !wifiClients[i]) continue;
+
+        size_t available = wifiRingBuffers[i].available();
+        if (available == 0) continue;
+        // Big chunks right away, small ones after the flush interval ($BRIDGE wifi_threshold/wifi_interval_ms)
+        if (available < bridgeSettings.wifiThreshold && (now - lastWiFiFlush[i] <= bridgeSettings.wifiIntervalMs)) {
+            continue;
+        }
+
+        bool overflowed = wifiRingBuffers[i].hasOverflowed();  // read() сбрасывает флаг
+        size_t length = wifiRingBuffers[i].read(wifiTxBuffer, sizeof(wifiTxBuffer));
+        if (overflowed) {
+            // Dropped records will never be sent: resync and discard their marks
+            wifiSentTotal[i] = wifiQueuedTotal[i] - wifiRingBuffers[i].available();
+            wifiTrace[i].dropped(wifiSentTotal[i] - length);
+        } else {
+            wifiSentTotal[i] += length;
+        }
+        size_t sent = wifiClients[i].write(wifiTxBuffer, length);
+        wifiTrace[i].sent(wifiSentTotal[i], micros(), LATENCY_SINK_WIFI + i);
+        bridgeCounters.wifiBytesOut[i] += sent;
+        if (sent != length) {
+            Serial.printf("WiFi client %d: only sent %u of %u bytes\n", i, (unsigned)sent, (unsigned)length);
+        }
+        lastWiFiFlush[i] = now;
+
+        if (overflowed) {
+            wifiOverflowEvents++;
+            Serial.printf("WARNING: WiFi client %d queue overflow occurred!\n", i);
+        }
+    }
+}
+
+// Milliseconds until flushWiFiSinks() has something to send without new data:
+// 0 — now, FLUSH_WAIT_IDLE — all client queues are empty.
+static inline unsigned long wifiFlushWaitMs(unsigned long now) {
+    unsigned long wait = FLUSH_WAIT_IDLE;
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+        if (!wifiClientConnected[i]) continue;
+        size_t available = wifiRingBuffers[i].available();
+        if (available == 0) continue;
+        unsigned long since = now - lastWiFiFlush[i];
+        if (available >= bridgeSettings.wifiThreshold || since > bridgeSettings.wifiIntervalMs) return 0;
+        unsigned long due = bridgeSettings.wifiIntervalMs + 1 - since;
+        if (due < wait) wait = due;
+    }
+    return wait;
+}
+
+// Data from WiFi clients (NTRIP corrections, commands) goes straight to the receiver
+template <typename Client, typename Uart>
+void forwardWiFiRx(Client (&wifiClients)[MAX_WIFI_CLIENTS], Uart& uart) {
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+        if (!wifiClientConnected[i] || !wifiClients[i].available()) continue;
+        // Читаем пакетами для эффективности
+        uint8_t wifiBuf[512];
+        size_t avail = wifiClients[i].available();
+        if (avail > sizeof(wifiBuf)) avail = sizeof(wifiBuf);
+        size_t bytesRead = wifiClients[i].read(wifiBuf, avail);
+        // Команды моста перехватываются; \r\n НЕ добавляем — RTCM3 бинарные!
+        wifiControl[i].feed(
+            wifiBuf, bytesRead, [&](const uint8_t* data, size_t len) { uart.write(data, len); },
+            [&](const char* line, size_t len) { postControlCommand(CONTROL_SOURCE_WIFI + i, line, len); });
+    }
+}
+
+// Commands are executed by the ingest thread, which owns the filters and the sink queues
+static inline void serviceControlCommands() {
+    static uint32_t droppedReported = 0;
+    if (controlDropped != droppedReported) {
+        droppedReported = controlDropped;
+        Serial.printf("WARNING: %lu bridge commands dropped, mailbox full\n", (unsigned long)droppedReported);
+    }
+    PendingControl cmd;
+    while (takeControlCommand(cmd)) {
+        static char reply[768];  // GET без ключа: строка на каждую настройку
+        size_t replyLen = 0;
+        BridgeSettings defaults = bridgeSettingsDefaults(BLE_SINK_FILTER, WIFI_SINK_FILTER);
+        uint32_t replaySeconds = 0;
+        BridgeAction action =
+            bridgeExecute(bridgeSettings, defaults, cmd.line, cmd.len, reply, sizeof(reply), &replyLen, &replaySeconds);
+        if (action == BRIDGE_ACTION_REPLAY) {
+            // Ответ — до истории: клиент видит, сколько её будет, и затем DONE на стыке
+            if (!streamArchive.enabled()) {
+                replyLen = bridgeReply(reply, 0, sizeof(reply), "BRIDGE,ERR,archive");
+            } else if (replaySeconds == 0) {
+                replayState[cmd.source].active = false;
+                replyLen = bridgeReply(reply, 0, sizeof(reply), "BRIDGE,OK,REPLAY,STOP");
+            } else {
+                uint32_t bytes = 0;
+                uint32_t found = startReplay(cmd.source, replaySeconds, &bytes);
+                replyLen = bridgeReply(reply, 0, sizeof(reply), "BRIDGE,OK,REPLAY,%lu,%lu", (unsigned long)found,
+                                       (unsigned long)bytes);
+            }
+        } else if (action != BRIDGE_ACTION_NONE) {
+            // New filters apply to connected clients right away
+            if (deviceConnected) bleFilter.parse(bridgeSettings.bleFilter);
+            for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+                if (wifiClientConnected[i]) wifiFilters[i].parse(bridgeSettings.wifiFilter);
+            }
+            applyQueuePolicy();
+            applyBridgeSettings(action);
+        }
+        // The reply goes into the sender's own stream, bypassing its filter
+        if (sinkConnected(cmd.source)) writeToSink(cmd.source, (const uint8_t*)reply, replyLen);
+    }
+}
@@ -0,0 +1,178 @@
+// Конвейер моста UART <-> BLE
+//
+// Три стадии, общие для всех плат:
+//   ingest()    — порция UART -> разбор и очереди потребителей (Hal::onUartChunk)
+//   forwardRx() — входящие по BLE RTCM поправки и команды -> приёмник; команды
+//                 моста $BRIDGE (bridge_control.h) -> Hal::onControlCommand
+//   flushBle()  — очередь BLE -> notify порциями по правилам BleFlushPolicy
+// ESP32-C3 вызывает их по очереди из loop(), ESP32-S3 — из dataTask (ingest,
+// forwardRx) и bleTask (flushBle; между порциями задача спит до срока
+// flushWaitMs()). Параметры берутся из профиля платы
+// (board_profile.h); правила отправки BLE (flushTuning) можно менять на ходу.
+// Окружение — из Hal:
+//   int    uartAvailable();
+//   size_t uartRead(uint8_t* dst, size_t n);
+//   void   uartWrite(const uint8_t* src, size_t n);
+//   void   onUartChunk(const uint8_t* data, size_t n);
+//   size_t rxAvailable();
+//   size_t rxRead(uint8_t* dst, size_t n);
+//   void   onControlCommand(const char* line, size_t len);  // $BRIDGE от BLE клиента
+//   bool   bleConnected();                 // Клиент подключен — очередь наполняется
+//   bool   bleLinkReady();                 // Соединение готово к notify
+//   size_t bleMaxPayload();                // Наибольший notify: MTU соединения - 3
+//   size_t bleQueued();
+//   bool   bleOverflowed();                // Читается до bleDequeue(): чтение сбрасывает флаг
+//   size_t bleDequeue(uint8_t* dst, size_t n);
+//   bool   bleSend(const uint8_t* data, size_t n);  // false — стек не принял notify, повторить
+//   void   log(const char* message);
+//
+// На хосте конвейер работает со своими Hal в src/native/main.cpp,
+// tools/gnss_load.cpp и tools/pipeline_bench.cpp.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "board_profile.h"
+#include "bridge_control.h"
+
+// Правила отправки BLE; по умолчанию — из профиля платы
+struct BleFlushTuning {
+    size_t sendThreshold;
+    unsigned long flushIntervalMs;
+    size_t chunk;  // Не больше Board::BLE_READ_CHUNK
+
+    template <typename Board>
+    static BleFlushTuning of() {
+        BleFlushTuning t = {Board::BLE_SEND_THRESHOLD, Board::BLE_FLUSH_INTERVAL_MS, Board::BLE_READ_CHUNK};
+        return t;
+    }
+};
+
+// Сколько байт забрать из очереди BLE сейчас; 0 — подождать накопления
+template <typename Board>
+struct BleFlushPolicy {
+    static size_t take(size_t queued, unsigned long sinceFlushMs, const BleFlushTuning& t) {
+        if (queued == 0) return 0;
+        if (queued < t.sendThreshold && sinceFlushMs <= t.flushIntervalMs) return 0;
+        const size_t chunk = (t.chunk < Board::BLE_READ_CHUNK) ? t.chunk : Board::BLE_READ_CHUNK;
+        return (queued > chunk) ? chunk : queued;
+    }
+
+    static size_t take(size_t queued, unsigned long sinceFlushMs) {
+        return take(queued, sinceFlushMs, BleFlushTuning::of<Board>());
+    }
+
+    // Через сколько мс take() станет ненулевым без новых данных; 0 — уже
+    static unsigned long waitMs(size_t queued, unsigned long sinceFlushMs, const BleFlushTuning& t) {
+        if (queued == 0) return FLUSH_WAIT_IDLE;
+        if (take(queued, sinceFlushMs, t) > 0) return 0;
+        return t.flushIntervalMs + 1 - sinceFlushMs;
+    }
+};
+
+// Команда в ASCII (начинается с '$', '#' или буквы) получает "\r\n"; RTCM3 (0xD3) — нет
+static inline bool isAsciiCommand(const uint8_t* data, size_t len) {
+    if (len == 0) return false;
+    if (len >= 3 && data[0] == 0xD3) return false;
+    uint8_t c = data[0];
+    return c == '$' || c == '#' || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+template <typename Board, typename Hal>
+class BridgePipeline {
+  public:
+    explicit BridgePipeline(Hal& h) : flushTuning(BleFlushTuning::of<Board>()), hal(h) {}
+
+    BleFlushTuning flushTuning;  // Пишет поток команд, читает flushBle(): поля по отдельности
+
+    // Одна порция из UART; возвращает число прочитанных байт
+    size_t ingest() {
+        int available = hal.uartAvailable();
+        if (available <= 0) return 0;
+        size_t toRead = ((size_t)available > Board::UART_READ_CHUNK) ? Board::UART_READ_CHUNK : (size_t)available;
+        size_t n = hal.uartRead(uartBuffer, toRead);
+        if (n > 0) hal.onUartChunk(uartBuffer, n);
+        return n;
+    }
+
+    // Входящие данные BLE клиента в приёмник; возвращает число переданных байт
+    size_t forwardRx() {
+        size_t available = hal.rxAvailable();
+        if (available == 0) return 0;
+        size_t n = hal.rxRead(rxBuffer, (available > sizeof(rxBuffer)) ? sizeof(rxBuffer) : available);
+        if (n == 0) return 0;
+        // "\r\n" решается по тому, что ушло приёмнику, а не по началу порции:
+        // команда моста в начале порции перехвачена, за ней может идти RTCM3
+        bool midFrame = rxControl.inRtcmFrame();
+        uint8_t first = 0, last = 0;
+        size_t forwarded = 0;
+        rxControl.feed(
+            rxBuffer, n,
+            [&](const uint8_t* data, size_t len) {
+                hal.uartWrite(data, len);
+                if (forwarded == 0) first = data[0];
+                last = data[len - 1];
+                forwarded += len;
+            },
+            [&](const char* line, size_t len) { hal.onControlCommand(line, len); });
+        bool ascii = forwarded && !midFrame && !rxControl.inRtcmFrame() && isAsciiCommand(&first, forwarded);
+        if (ascii && last != '\n') hal.uartWrite((const uint8_t*)"\r\n", 2);
+        return n;
+    }
+
+    // Порция очереди BLE в notify, если пора; возвращает число отправленных байт.
+    // Порцию, которую стек не принял (буферы контроллера заняты), следующий
+    // вызов повторяет раньше новых данных: очередь ждёт и при переполнении
+    // теряет целые записи, а не середину потока.
+    size_t flushBle(unsigned long now) {
+        if (!hal.bleConnected()) {
+            pendingLen = 0;
+            return 0;
+        }
+        // Handle соединения ещё не известен: данные ждут в очереди, а не теряются
+        if (!hal.bleLinkReady()) return 0;
+        if (pendingLen > 0) {
+            if (!hal.bleSend(bleBuffer, pendingLen)) return 0;
+            size_t n = pendingLen;
+            pendingLen = 0;
+            lastFlush = now;
+            return n;
+        }
+        size_t queued = hal.bleQueued();
+        size_t toRead = BleFlushPolicy<Board>::take(queued, now - lastFlush, flushTuning);
+        if (toRead == 0) return 0;
+        // Порция платы больше MTU клиента (в том числе после $BRIDGE,SET,mtu) — NimBLE обрезал бы notify
+        size_t maxPayload = hal.bleMaxPayload();
+        if (toRead > maxPayload) toRead = maxPayload;
+        if (queued >= Board::BLE_NEAR_FULL) hal.log("WARNING: Buffer near full, forcing send");
+
+        bool overflowed = hal.bleOverflowed();
+        size_t n = hal.bleDequeue(bleBuffer, toRead);
+        if (n == 0) return 0;
+        if (!hal.bleSend(bleBuffer, n)) {
+            pendingLen = n;
+            if (overflowed) hal.log("WARNING: Ring buffer overflow occurred!");
+            return 0;
+        }
+        lastFlush = now;
+        if (overflowed) hal.log("WARNING: Ring buffer overflow occurred!");
+        return n;
+    }
+
+    // Срок следующей порции flushBle() в мс (BleFlushPolicy::waitMs)
+    unsigned long flushWaitMs(unsigned long now) {
+        if (!hal.bleConnected() || !hal.bleLinkReady()) return FLUSH_WAIT_IDLE;
+        if (pendingLen > 0) return 0;
+        return BleFlushPolicy<Board>::waitMs(hal.bleQueued(), now - lastFlush, flushTuning);
+    }
+
+  private:
+    Hal& hal;
+    unsigned long lastFlush = 0;
+    size_t pendingLen = 0;  // Не принятая стеком порция в bleBuffer
+    BridgeControlScanner rxControl;
+    uint8_t uartBuffer[Board::UART_READ_CHUNK];
+    uint8_t rxBuffer[Board::RX_READ_CHUNK];
+    uint8_t bleBuffer[Board::BLE_READ_CHUNK];
+};
@@ -0,0 +1,173 @@
+// Телеметрия конвейера: снимок счётчиков в упакованную запись и в текст
+//
+// Запись TelemetryRecord — little-endian, как в памяти ESP32; её отдаёт GATT
+// характеристика статистики (чтение), текст — TCP порт статуса раз в секунду.
+// Версия и размер в начале записи позволяют клиенту проверить раскладку.
+// Источники — счётчики bridge_core.h и поля очередей; снимок собирается
+// без блокировок, поля согласованы каждое по отдельности.
+//
+// Хост-сборка печатает тот же текст по --telemetry.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "bridge_core.h"
+
+#define TELEMETRY_VERSION 4  // 2: потери записей по типам; 3: полоса приоритета BLE; 4: пробуждения задач
+#define TELEMETRY_RATE_WINDOW_MS 1000  // Частота пробуждений — за окно не короче этого
+
+struct __attribute__((packed)) TelemetryRecord {
+    uint8_t version;      // TELEMETRY_VERSION
+    uint8_t histBuckets;  // TELEMETRY_HIST_BUCKETS
+    uint16_t size;        // sizeof(TelemetryRecord)
+    uint32_t uptimeMs;
+    uint32_t uartBytesIn;
+    uint32_t bleBytesOut;
+    uint32_t wifiBytesOut[MAX_WIFI_CLIENTS];
+    uint16_t bleHighWater;  // Байт в очереди, максимум с запуска
+    uint16_t rxHighWater;
+    uint16_t wifiHighWater[MAX_WIFI_CLIENTS];
+    uint32_t bleDroppedBytes;  // Выброшено из очереди до отправки
+    uint32_t rxDroppedBytes;
+    uint32_t wifiDroppedBytes;  // Все клиенты
+    uint32_t notifyFailures;
+    uint32_t nmeaChecksumErrors;
+    uint32_t rtcmCrcErrors;
+    uint32_t records[ST_COUNT];  // Порядок — SentenceType
+    uint32_t iterationHist[TELEMETRY_TASK_COUNT][TELEMETRY_HIST_BUCKETS];
+    uint32_t bleDroppedRecords[ST_COUNT];  // Записей, потерянных при переполнении
+    uint32_t wifiDroppedRecords[ST_COUNT];  // Все клиенты
+    uint32_t blePriorityBytes;      // Поставлено в полосу приоритета
+    uint32_t bleSupersededRecords;  // Заменено более свежими до отправки
+    uint16_t blePriorityHighWater;
+    uint32_t wakeups[TELEMETRY_TASK_COUNT];           // С запуска
+    uint16_t wakeupsPerSecond[TELEMETRY_TASK_COUNT];  // За последнее окно TELEMETRY_RATE_WINDOW_MS
+};
+
+static void telemetrySnapshot(TelemetryRecord& r) {
+    r.version = TELEMETRY_VERSION;
+    r.histBuckets = TELEMETRY_HIST_BUCKETS;
+    r.size = sizeof(TelemetryRecord);
+    r.uptimeMs = millis();
+    r.uartBytesIn = uartBytesIn;
+    r.bleBytesOut = bridgeCounters.bleBytesOut;
+    r.bleHighWater = (uint16_t)bleRingBuffer.highWater;
+    r.rxHighWater = (uint16_t)bleRxBuffer.highWater;
+    r.bleDroppedBytes = bleRingBuffer.droppedBytes;
+    r.rxDroppedBytes = bleRxBuffer.droppedBytes;
+    r.blePriorityBytes = blePriorityQueuedTotal;
+    r.bleSupersededRecords = bleSuperseded;
+    r.blePriorityHighWater = (uint16_t)blePriorityLane.highWater;
+    r.wifiDroppedBytes = 0;
+    for (int t = 0; t < ST_COUNT; t++) {
+        r.bleDroppedRecords[t] = bleRingBuffer.droppedRecords[t];
+        r.wifiDroppedRecords[t] = 0;
+    }
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+        r.wifiBytesOut[i] = bridgeCounters.wifiBytesOut[i];
+        r.wifiHighWater[i] = (uint16_t)wifiRingBuffers[i].highWater;
+        r.wifiDroppedBytes += wifiRingBuffers[i].droppedBytes;
+        for (int t = 0; t < ST_COUNT; t++) r.wifiDroppedRecords[t] += wifiRingBuffers[i].droppedRecords[t];
+    }
+    r.notifyFailures = bridgeCounters.notifyFailures;
+    r.nmeaChecksumErrors = bridgeCounters.nmeaChecksumErrors;
+    r.rtcmCrcErrors = bridgeCounters.rtcmCrcErrors;
+    for (int t = 0; t < ST_COUNT; t++) r.records[t] = bridgeCounters.records[t];
+    for (int k = 0; k < TELEMETRY_TASK_COUNT; k++) {
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) r.iterationHist[k][b] = bridgeCounters.iterationHist[k][b];
+    }
+
+    // Частота пробуждений: разность счётчиков между снимками, окно не короче секунды
+    static uint32_t windowStartMs = 0;
+    static uint32_t windowWakeups[TELEMETRY_TASK_COUNT] = {0};
+    static uint16_t perSecond[TELEMETRY_TASK_COUNT] = {0};
+    uint32_t elapsed = r.uptimeMs - windowStartMs;
+    for (int k = 0; k < TELEMETRY_TASK_COUNT; k++) r.wakeups[k] = bridgeCounters.wakeups[k];
+    if (elapsed >= TELEMETRY_RATE_WINDOW_MS) {
+        for (int k = 0; k < TELEMETRY_TASK_COUNT; k++) {
+            uint32_t rate = (uint32_t)((uint64_t)(r.wakeups[k] - windowWakeups[k]) * 1000 / elapsed);
+            perSecond[k] = (uint16_t)((rate > 0xFFFF) ? 0xFFFF : rate);
+            windowWakeups[k] = r.wakeups[k];
+        }
+        windowStartMs = r.uptimeMs;
+    }
+    for (int k = 0; k < TELEMETRY_TASK_COUNT; k++) r.wakeupsPerSecond[k] = perSecond[k];
+}
+
+// printf в out с позиции pos; возвращает новую позицию (не дальше cap - 1)
+static size_t telemetryAppend(char* out, size_t pos, size_t cap, const char* fmt, ...) {
+    if (pos + 1 >= cap) return pos;
+    va_list args;
+    va_start(args, fmt);
+    int m = vsnprintf(out + pos, cap - pos, fmt, args);
+    va_end(args);
+    if (m <= 0) return pos;
+    return ((size_t)m < cap - pos) ? pos + m : cap - 1;
+}
+
+// Текст "ключ значения" по строке на показатель; out — не меньше 1536 байт
+static size_t telemetryFormatText(char* out, size_t cap, const TelemetryRecord& r) {
+    static const char* const taskNames[TELEMETRY_TASK_COUNT] = {"loop", "data", "ble"};
+    size_t n = 0;
+    n = telemetryAppend(out, n, cap, "uptime_ms %lu\r\n", (unsigned long)r.uptimeMs);
+    n = telemetryAppend(out, n, cap, "uart_bytes_in %lu\r\n", (unsigned long)r.uartBytesIn);
+    n = telemetryAppend(out, n, cap, "ble_bytes_out %lu\r\n", (unsigned long)r.bleBytesOut);
+    n = telemetryAppend(out, n, cap, "wifi_bytes_out");
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+        n = telemetryAppend(out, n, cap, " %lu", (unsigned long)r.wifiBytesOut[i]);
+    }
+    n = telemetryAppend(out, n, cap, "\r\nble_queue_high_water %u/%u\r\n", (unsigned)r.bleHighWater,
+                        (unsigned)bleRingBuffer.capacity());
+    n = telemetryAppend(out, n, cap, "ble_priority_high_water %u/%u\r\n", (unsigned)r.blePriorityHighWater,
+                        (unsigned)blePriorityLane.capacity());
+    n = telemetryAppend(out, n, cap, "ble_priority_bytes %lu superseded %lu\r\n", (unsigned long)r.blePriorityBytes,
+                        (unsigned long)r.bleSupersededRecords);
+    n = telemetryAppend(out, n, cap, "rx_queue_high_water %u/%u\r\n", (unsigned)r.rxHighWater,
+                        (unsigned)bleRxBuffer.capacity());
+    n = telemetryAppend(out, n, cap, "wifi_queue_high_water");
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) n = telemetryAppend(out, n, cap, " %u", (unsigned)r.wifiHighWater[i]);
+    n = telemetryAppend(out, n, cap, " /%u\r\n", (unsigned)wifiRingBuffers[0].capacity());
+    n = telemetryAppend(out, n, cap, "dropped_bytes ble %lu rx %lu wifi %lu\r\n", (unsigned long)r.bleDroppedBytes,
+                        (unsigned long)r.rxDroppedBytes, (unsigned long)r.wifiDroppedBytes);
+    // Потери записей по типам: только ненулевые
+    for (int q = 0; q < 2; q++) {
+        n = telemetryAppend(out, n, cap, "dropped_records %s", q == 0 ? "ble" : "wifi");
+        for (int t = 0; t < ST_COUNT; t++) {
+            uint32_t dropped = (q == 0) ? r.bleDroppedRecords[t] : r.wifiDroppedRecords[t];
+            if (dropped == 0) continue;
+            n = telemetryAppend(out, n, cap, " %s=%lu", sentenceTypeNames[t], (unsigned long)dropped);
+        }
+        n = telemetryAppend(out, n, cap, "\r\n");
+    }
+    n = telemetryAppend(out, n, cap, "notify_failures %lu\r\n", (unsigned long)r.notifyFailures);
+    n = telemetryAppend(out, n, cap, "nmea_checksum_errors %lu\r\n", (unsigned long)r.nmeaChecksumErrors);
+    n = telemetryAppend(out, n, cap, "rtcm_crc_errors %lu\r\n", (unsigned long)r.rtcmCrcErrors);
+    n = telemetryAppend(out, n, cap, "records");
+    for (int t = 0; t < ST_COUNT; t++) {
+        n = telemetryAppend(out, n, cap, " %s=%lu", sentenceTypeNames[t], (unsigned long)r.records[t]);
+    }
+    // Гистограммы: строка границ корзин, затем по строке на задачу
+    n = telemetryAppend(out, n, cap, "\r\niteration_us");
+    for (int b = 0; b < TELEMETRY_HIST_BUCKETS - 1; b++) n = telemetryAppend(out, n, cap, " <%u", 16u << b);
+    n = telemetryAppend(out, n, cap, " >=%u\r\n", 16u << (TELEMETRY_HIST_BUCKETS - 2));
+    for (int k = 0; k < TELEMETRY_TASK_COUNT; k++) {
+        n = telemetryAppend(out, n, cap, "iterations_%s", taskNames[k]);
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) {
+            n = telemetryAppend(out, n, cap, " %lu", (unsigned long)r.iterationHist[k][b]);
+        }
+        n = telemetryAppend(out, n, cap, "\r\n");
+    }
+    n = telemetryAppend(out, n, cap, "wakeups_per_s");
+    for (int k = 0; k < TELEMETRY_TASK_COUNT; k++) {
+        n = telemetryAppend(out, n, cap, " %s=%u", taskNames[k], (unsigned)r.wakeupsPerSecond[k]);
+    }
+    n = telemetryAppend(out, n, cap, "\r\nwakeups");
+    for (int k = 0; k < TELEMETRY_TASK_COUNT; k++) {
+        n = telemetryAppend(out, n, cap, " %s=%lu", taskNames[k], (unsigned long)r.wakeups[k]);
+    }
+    n = telemetryAppend(out, n, cap, "\r\n");
+    return telemetryAppend(out, n, cap, "\r\n");
+}
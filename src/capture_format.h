@@ -0,0 +1,79 @@
+// Формат записи потоков моста для воспроизведения (UMCAP1)
+//
+// Файл: сигнатура "UMCAP1\r\n", затем записи подряд:
+//   uint8  channel   — CAP_UART_RX, CAP_BLE_RX, CAP_WIFI_RX
+//   uint16 length    — длина данных (little-endian)
+//   uint32 deltaUs   — время от предыдущей записи, мкс (little-endian)
+//   данные
+// Каждая запись — одна порция в том виде, в каком её получил мост (чтение
+// UART, запись в RX характеристику, пакет от WiFi клиента), с исходными
+// интервалами. Файл без сигнатуры считается сырым потоком UART без времени.
+//
+// Пишут прошивка и генераторы (tools/), читает хост-сборка (src/native/).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define CAPTURE_MAGIC       "UMCAP1\r\n"
+#define CAPTURE_MAGIC_LEN   8
+#define CAPTURE_RECORD_HEAD 7
+
+enum CaptureChannel : uint8_t {
+    CAP_UART_RX = 0,  // Приёмник -> мост
+    CAP_BLE_RX,       // BLE клиент -> мост (поправки, команды)
+    CAP_WIFI_RX,      // WiFi клиент -> мост
+    CAP_CHANNEL_COUNT
+};
+
+static inline bool captureHasMagic(const uint8_t* data, size_t len) {
+    return len >= CAPTURE_MAGIC_LEN && memcmp(data, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) == 0;
+}
+
+// Заголовок записи в out[CAPTURE_RECORD_HEAD]
+static inline void captureWriteHead(uint8_t* out, uint8_t channel, uint16_t len, uint32_t deltaUs) {
+    out[0] = channel;
+    out[1] = (uint8_t)len;
+    out[2] = (uint8_t)(len >> 8);
+    out[3] = (uint8_t)deltaUs;
+    out[4] = (uint8_t)(deltaUs >> 8);
+    out[5] = (uint8_t)(deltaUs >> 16);
+    out[6] = (uint8_t)(deltaUs >> 24);
+}
+
+struct CaptureRecord {
+    uint8_t channel;
+    uint16_t len;
+    uint32_t deltaUs;
+    const uint8_t* data;
+};
+
+// Последовательное чтение записей из буфера с содержимым файла
+struct CaptureReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    bool truncated;  // Файл оборван посреди записи
+
+    CaptureReader(const uint8_t* d, size_t n)
+        : data(d), size(n), pos(captureHasMagic(d, n) ? CAPTURE_MAGIC_LEN : n), truncated(false) {}
+
+    bool next(CaptureRecord& rec) {
+        if (size - pos < CAPTURE_RECORD_HEAD) {
+            truncated = pos < size;
+            return false;
+        }
+        const uint8_t* h = data + pos;
+        rec.channel = h[0];
+        rec.len = (uint16_t)(h[1] | (h[2] << 8));
+        rec.deltaUs = (uint32_t)h[3] | ((uint32_t)h[4] << 8) | ((uint32_t)h[5] << 16) | ((uint32_t)h[6] << 24);
+        if (size - pos - CAPTURE_RECORD_HEAD < rec.len) {
+            truncated = true;
+            return false;
+        }
+        rec.data = h + CAPTURE_RECORD_HEAD;
+        pos += CAPTURE_RECORD_HEAD + rec.len;
+        return true;
+    }
+};
@@ -0,0 +1,283 @@
+// Форматирование строк дисплея без выделения памяти
+//
+// Все функции пишут в буфер вызывающего (cap включает завершающий ноль) и
+// возвращают длину строки. Числа с фиксированной точкой выводятся через целое
+// масштабирование за один проход — без String, printf("%f") и dtoa, которые
+// выделяют память в куче.
+//
+// Те же строки печатает хост-сборка; скорость меряет tools/display_format_bench.cpp.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#define DISPLAY_TEXT_MAX 24  // Самая длинная строка (21 символ OLED) + запас
+
+// Какие поля изменились с прошлого кадра (см. publishGpsSnapshot)
+enum DisplayDirty : uint16_t {
+    DD_FIX      = 1 << 0,  // Качество фикса, число спутников, валидность
+    DD_LAT      = 1 << 1,
+    DD_LON      = 1 << 2,
+    DD_ALT      = 1 << 3,
+    DD_TIME     = 1 << 4,
+    DD_ACCURACY = 1 << 5,  // Точность по широте/долготе
+    DD_VACC     = 1 << 6,  // Точность по высоте
+    DD_SATS     = 1 << 7,  // Спутники по системам
+    DD_ALL      = 0xFFFF
+};
+
+// Дописывает строку с позиции pos; возвращает новую длину
+static inline size_t fmtAppend(char* out, size_t pos, size_t cap, const char* s) {
+    while (*s && pos + 1 < cap) out[pos++] = *s++;
+    out[pos] = '\0';
+    return pos;
+}
+
+static inline size_t fmtAppendUnsigned(char* out, size_t pos, size_t cap, uint64_t v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n > 0 && pos + 1 < cap) out[pos++] = digits[--n];
+    out[pos] = '\0';
+    return pos;
+}
+
+static inline size_t fmtAppendInt(char* out, size_t pos, size_t cap, long v) {
+    if (v < 0) {
+        pos = fmtAppend(out, pos, cap, "-");
+        return fmtAppendUnsigned(out, pos, cap, (uint64_t)(-(int64_t)v));
+    }
+    return fmtAppendUnsigned(out, pos, cap, (uint64_t)v);
+}
+
+// Числа с фиксированной точкой хранятся целыми v*10^exp10 (exp10 0..10):
+// ширина строки считается заранее, и текст выводится за один проход.
+#define FMT_MAX_EXP10 10
+#define FMT_SCALED_INVALID INT64_MIN  // Значение вне точности double или NaN
+
+static const uint64_t fmtPow10[FMT_MAX_EXP10 + 1] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+                                                      1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+                                                      10000000000ULL};
+
+// double -> v*10^exp10 с корректным округлением, как printf("%.*f").
+// Произведение v*10^d округляется при умножении, поэтому на границе x.5 решает
+// точный остаток fma(): 0.0215 -> "0.021"/"2.1cm", как у printf.
+static inline int64_t fmtToScaled(double v, int exp10) {
+    if (exp10 < 0) exp10 = 0;
+    if (exp10 > FMT_MAX_EXP10) exp10 = FMT_MAX_EXP10;
+    bool negative = signbit(v);
+    if (negative) v = -v;
+    double scale = (double)fmtPow10[exp10];
+    double product = v * scale;
+    if (!(product < 4.0e15)) return FMT_SCALED_INVALID;
+    double whole = floor(product);
+    double remainder = product - whole;
+    int64_t scaled = (int64_t)whole;
+    if (remainder > 0.5) {
+        scaled++;
+    } else if (remainder == 0.5) {
+        double residual = fma(v, scale, -product);  // Точное v*10^d = product + residual
+        if (residual > 0 || (residual == 0 && (scaled & 1))) scaled++;  // Ровно x.5 — к чётному
+    }
+    return negative ? -scaled : scaled;
+}
+
+// Модуль значения, округлённый до decimals знаков (половина — от нуля), в единицах 10^-decimals
+static inline uint64_t fmtRoundedMagnitude(int64_t v, int exp10, int decimals) {
+    uint64_t mag = (v < 0) ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+    if (decimals >= exp10) return mag;
+    uint64_t div = fmtPow10[exp10 - decimals];
+    return (mag + div / 2) / div;
+}
+
+static inline int fmtDigitCount(uint64_t v) {
+    int n = 1;
+    while (v >= 10) {
+        v /= 10;
+        n++;
+    }
+    return n;
+}
+
+// Ширина fmtAppendScaled(v, exp10, decimals) без вывода
+static inline int fmtScaledWidth(int64_t v, int exp10, int decimals) {
+    if (v == FMT_SCALED_INVALID) return 3;
+    if (decimals > exp10) decimals = exp10;
+    uint64_t rounded = fmtRoundedMagnitude(v, exp10, decimals);
+    return (v < 0 ? 1 : 0) + fmtDigitCount(rounded / fmtPow10[decimals]) + (decimals > 0 ? decimals + 1 : 0);
+}
+
+// Значение v*10^-exp10 с decimals знаками после точки (decimals <= exp10)
+static inline size_t fmtAppendScaled(char* out, size_t pos, size_t cap, int64_t v, int exp10, int decimals) {
+    if (v == FMT_SCALED_INVALID) return fmtAppend(out, pos, cap, "ovf");
+    if (decimals > exp10) decimals = exp10;
+    if (v < 0) pos = fmtAppend(out, pos, cap, "-");
+    uint64_t rounded = fmtRoundedMagnitude(v, exp10, decimals);
+    pos = fmtAppendUnsigned(out, pos, cap, rounded / fmtPow10[decimals]);
+    if (decimals == 0) return pos;
+
+    pos = fmtAppend(out, pos, cap, ".");
+    uint64_t frac = rounded % fmtPow10[decimals];
+    for (int i = decimals - 1; i >= 0 && pos + 1 < cap; i--) {
+        out[pos++] = (char)('0' + (frac / fmtPow10[i]) % 10);
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+static inline const char* fixTypeName(int quality) {
+    switch (quality) {
+        case 0: return "NO FIX";
+        case 1: return "GPS";
+        case 2: return "DGPS";
+        case 3: return "PPS";       // GPS PPS mode - сокращено
+        case 4: return "RTK-FIX";   // RTK Int (Fixed) - сокращено
+        case 5: return "RTK-FLT";   // RTK Float - сокращено
+        case 6: return "EST";       // ESTIMATED - сокращено
+        case 7: return "MANUAL";
+        case 8: return "SIM";
+        default: return "UNKNOWN";
+    }
+}
+
+// "Sats: N Fix: X" (satellites >= 0) или "Fix: X" (satellites < 0)
+static inline size_t fmtFixLine(char* out, size_t cap, int satellites, int fixQuality) {
+    size_t n = 0;
+    out[0] = '\0';
+    if (satellites >= 0) {
+        n = fmtAppend(out, n, cap, "Sats: ");
+        n = fmtAppendInt(out, n, cap, satellites);
+        n = fmtAppend(out, n, cap, " ");
+    }
+    n = fmtAppend(out, n, cap, "Fix: ");
+    return fmtAppend(out, n, cap, fixTypeName(fixQuality));
+}
+
+// Координаты в 1e-10 градуса (fmtToScaled(deg, COORD_EXP10))
+#define COORD_EXP10 10
+
+// Координата с наибольшей точностью (4..10 знаков), помещающейся в maxChars
+static inline size_t fmtCoordLine(char* out, size_t cap, const char* label, int64_t value, int maxChars) {
+    int available = maxChars - (int)strlen(label);
+    uint64_t mag = (value < 0) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    int wholePart = (value < 0 ? 1 : 0) + fmtDigitCount(mag / fmtPow10[COORD_EXP10]);
+
+    int decimals = available - wholePart - 1;  // -1 для точки
+    if (decimals < 4) decimals = 4;    // Минимум 4 знака для базовой точности
+    if (decimals > 10) decimals = 10;  // Максимум 10 знаков (избыточная точность)
+    // Округление могло добавить разряд (99.99999 -> 100.0000) — на столько же меньше знаков
+    int excess = fmtScaledWidth(value, COORD_EXP10, decimals) - available;
+    if (excess > 0) decimals = (decimals - excess < 4) ? 4 : decimals - excess;
+
+    return fmtAppendScaled(out, fmtAppend(out, 0, cap, label), cap, value, COORD_EXP10, decimals);
+}
+
+// Локальное время HH:MM:SS; пустая строка без валидного времени
+static inline size_t fmtLocalTime(char* out, size_t cap, bool valid, int hour, int minute, int second,
+                                  int tzOffsetMinutes) {
+    out[0] = '\0';
+    if (!valid || cap < 9) return 0;
+    long sec = hour * 3600L + minute * 60L + second + (long)tzOffsetMinutes * 60L;
+    sec %= 86400L;  // Нормализация в пределах суток
+    if (sec < 0) sec += 86400L;
+    int parts[3] = {(int)(sec / 3600L), (int)((sec % 3600L) / 60L), (int)(sec % 60L)};
+    for (int i = 0; i < 3; i++) {
+        out[i * 3] = (char)('0' + parts[i] / 10);
+        out[i * 3 + 1] = (char)('0' + parts[i] % 10);
+        out[i * 3 + 2] = (i < 2) ? ':' : '\0';
+    }
+    return 8;
+}
+
+// Высота в 1e-4 м (fmtToScaled(m, ALT_EXP10)) — не грубее поля высоты GGA,
+// поэтому значение из NMEA масштабируется без потерь и округляется один раз
+#define ALT_EXP10 4
+
+// "Alt: 123.4m HH:MM:SS"; самый подробный вариант, помещающийся в maxChars
+static inline size_t fmtAltitudeLine(char* out, size_t cap, int64_t altitude, const char* timeText, int maxChars) {
+    static const int labelLen = 5;  // "Alt: "
+    int width1 = labelLen + fmtScaledWidth(altitude, ALT_EXP10, 1);  // С десятыми
+    int width0 = labelLen + fmtScaledWidth(altitude, ALT_EXP10, 0);  // Без десятых
+    int timeLen = (int)strlen(timeText);
+
+    // Варианты по убыванию подробности: десятые, единица, пробел перед временем
+    int decimals = 1;
+    const char* unit = "m";
+    const char* sep = "";
+    if (timeLen == 0) {
+        timeText = "";
+    } else if (width1 + 2 + timeLen <= maxChars) {
+        sep = " ";
+    } else if (width0 + 2 + timeLen <= maxChars) {
+        decimals = 0;
+        sep = " ";
+    } else if (width1 + 1 + timeLen <= maxChars) {
+        // Без пробела
+    } else if (width0 + 1 + timeLen <= maxChars) {
+        decimals = 0;  // Без единицы измерения
+        unit = "";
+        sep = " ";
+    } else {
+        timeText = "";  // Не помещается — только высота
+    }
+
+    size_t n = fmtAppendScaled(out, fmtAppend(out, 0, cap, "Alt: "), cap, altitude, ALT_EXP10, decimals);
+    return fmtAppend(out, fmtAppend(out, fmtAppend(out, n, cap, unit), cap, sep), cap, timeText);
+}
+
+// Точность в 1e-4 м (fmtToScaled(m, ACC_EXP10)): выводятся десятые сантиметра или десятые метра
+#define ACC_EXP10 4
+#define ACC_ONE_METER 10000
+#define ACC_NO_DATA 999000  // 99.9 м — приёмник ещё не сообщил точность
+
+// Точность: сантиметры с десятыми ниже 1 м, иначе метры
+static inline size_t fmtAppendAccuracy(char* out, size_t pos, size_t cap, int64_t acc, bool centimeters) {
+    if (centimeters) return fmtAppend(out, fmtAppendScaled(out, pos, cap, acc, ACC_EXP10 - 2, 1), cap, "cm");
+    return fmtAppend(out, fmtAppendScaled(out, pos, cap, acc, ACC_EXP10, 1), cap, "m");
+}
+
+static inline int fmtAccuracyWidth(int64_t acc, bool centimeters) {
+    return centimeters ? fmtScaledWidth(acc, ACC_EXP10 - 2, 1) + 2 : fmtScaledWidth(acc, ACC_EXP10, 1) + 1;
+}
+
+// Первая строка точности "N/S:xx.xcm E/W:yy.ycm"; пусто без данных.
+// Если строка длиннее maxChars — короткие метки "NS:"/"EW:".
+static inline size_t fmtAccuracyLine1(char* out, size_t cap, int64_t latAcc, int64_t lonAcc, int maxChars) {
+    out[0] = '\0';
+    if (latAcc >= ACC_NO_DATA && lonAcc >= ACC_NO_DATA) return 0;  // Нет данных о точности
+    bool cm = latAcc < ACC_ONE_METER && lonAcc < ACC_ONE_METER;
+    bool compact = 4 + fmtAccuracyWidth(latAcc, cm) + 5 + fmtAccuracyWidth(lonAcc, cm) > maxChars;
+    size_t n = fmtAppendAccuracy(out, fmtAppend(out, 0, cap, compact ? "NS:" : "N/S:"), cap, latAcc, cm);
+    return fmtAppendAccuracy(out, fmtAppend(out, n, cap, compact ? " EW:" : " E/W:"), cap, lonAcc, cm);
+}
+
+// Вторая строка точности "H:zz.zcm"; пусто без данных
+static inline size_t fmtAccuracyLine2(char* out, size_t cap, int64_t latAcc, int64_t lonAcc, int64_t vAcc) {
+    out[0] = '\0';
+    if (latAcc >= ACC_NO_DATA && lonAcc >= ACC_NO_DATA) return 0;
+    return fmtAppendAccuracy(out, fmtAppend(out, 0, cap, "H:"), cap, vAcc, vAcc < ACC_ONE_METER);
+}
+
+// Спутники по системам "G:9 R:5 E:3 B:2 Q:1"; длиннее 20 символов — без пробелов
+static inline size_t fmtSatelliteLine(char* out, size_t cap, int gps, int glonass, int galileo, int beidou, int qzss) {
+    static const char* const labels[5] = {"G:", "R:", "E:", "B:", "Q:"};
+    const int counts[5] = {gps, glonass, galileo, beidou, qzss};
+    int systems = (qzss > 0) ? 5 : 4;
+    size_t n = 0;
+    for (int compact = 0; compact < 2; compact++) {
+        n = 0;
+        out[0] = '\0';
+        for (int i = 0; i < systems; i++) {
+            if (i > 0 && !compact) n = fmtAppend(out, n, cap, " ");
+            n = fmtAppend(out, n, cap, labels[i]);
+            n = fmtAppendInt(out, n, cap, counts[i]);
+        }
+        if (n <= 20) break;
+    }
+    return n;
+}
@@ -0,0 +1,265 @@
+// Запись сырого потока приёмника во флеш: сегменты фиксированного размера
+//
+// Поток UART (те же записи, что идут клиентам и в архив) пишется в LittleFS
+// файлами-сегментами по FLASH_LOG_SEGMENT_BYTES. Первые FLASH_LOG_HEADER_BYTES
+// сегмента — его индекс (FlashLogHeader): номер, смещение в потоке с начала
+// записи, время UTC последнего RMC/ZDA перед сегментом и первое предложение
+// NMEA сегмента — его смещение и начало строки. Дальше — поток как есть,
+// сегменты режутся по байтам, подряд идущие склеиваются обратно в поток.
+//
+// Приём только копирует запись в промежуточное кольцо (память — от
+// окружения) и флеш не ждёт; полное кольцо теряет записи целиком, со счётом.
+// Писатель — отдельная задача с низким приоритетом — забирает порции,
+// кончающиеся на границе блока FLASH_LOG_PAGE_BYTES в файле: флеш пишется
+// целыми страницами и редко. Неполная порция уходит, только если данные
+// ждут дольше FLASH_LOG_FLUSH_MS. Запись и стирание флеш останавливают кэш
+// на обоих ядрах, поэтому время каждой записи — в гистограмме: это и есть
+// наихудшая пауза, которую запись добавляет живому потоку.
+//
+// Здесь — кольцо, нарезка порций и формат индекса; файлы, задача и порт
+// выгрузки — окружение (main.cpp; хост-сборка с --flash-log пишет сегменты
+// в каталог и сверяет их со входом).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "ring_buffer.h"
+#include "stream_framer.h"
+#include "latency_trace.h"  // LatencyHistogram
+
+#ifndef FLASH_LOG
+#define FLASH_LOG 0
+#endif
+
+#ifndef FLASH_LOG_SEGMENT_BYTES
+#define FLASH_LOG_SEGMENT_BYTES (256u << 10)
+#endif
+#define FLASH_LOG_PAGE_BYTES 4096    // Блок LittleFS на ESP32
+#define FLASH_LOG_HEADER_BYTES 64
+#define FLASH_LOG_PAYLOAD_BYTES (FLASH_LOG_SEGMENT_BYTES - FLASH_LOG_HEADER_BYTES)
+#define FLASH_LOG_STAGE_BYTES 16384  // Около 1.5 с потока 115200 бод на паузы флеш
+#define FLASH_LOG_FLUSH_MS 5000
+#define FLASH_LOG_MAGIC "UMLOG1\r\n"
+#define FLASH_LOG_MAGIC_LEN 8
+#define FLASH_LOG_NO_SENTENCE 0xFFFF
+
+static_assert(FLASH_LOG_SEGMENT_BYTES % FLASH_LOG_PAGE_BYTES == 0, "segment: whole pages");
+static_assert(FLASH_LOG_STAGE_BYTES < FLASH_LOG_PAYLOAD_BYTES, "stage: less than one segment");
+
+// Индекс сегмента; в файле — little-endian, FLASH_LOG_HEADER_BYTES байт:
+//   0  magic "UMLOG1\r\n"     8  uint32 segment        12 uint64 streamOffset
+//   20 uint32 utcDate ddmmyy  24 uint32 utcTime hhmmss 28 uint16 firstSentence
+//   30 uint16 0               32 char sentence[32]
+struct FlashLogHeader {
+    uint32_t segment;        // Номер файла
+    uint64_t streamOffset;   // Байт потока до сегмента с начала записи (запуска)
+    uint32_t utcDate;        // ddmmyy; 0 — времени ещё не было
+    uint32_t utcTime;        // hhmmss
+    uint16_t firstSentence;  // Смещение в данных сегмента; FLASH_LOG_NO_SENTENCE — нет в первой странице
+    char sentence[32];       // Начало первого предложения, с '\0'
+};
+
+static inline void flashLogPut(uint8_t* p, uint64_t v, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint64_t flashLogGet(const uint8_t* p, size_t bytes) {
+    uint64_t v = 0;
+    for (size_t i = bytes; i-- > 0;) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline void flashLogEncodeHeader(const FlashLogHeader& h, uint8_t* out) {
+    memset(out, 0, FLASH_LOG_HEADER_BYTES);
+    memcpy(out, FLASH_LOG_MAGIC, FLASH_LOG_MAGIC_LEN);
+    flashLogPut(out + 8, h.segment, 4);
+    flashLogPut(out + 12, h.streamOffset, 8);
+    flashLogPut(out + 20, h.utcDate, 4);
+    flashLogPut(out + 24, h.utcTime, 4);
+    flashLogPut(out + 28, h.firstSentence, 2);
+    memcpy(out + 32, h.sentence, sizeof(h.sentence) - 1);
+}
+
+static inline bool flashLogDecodeHeader(const uint8_t* in, size_t len, FlashLogHeader& h) {
+    if (len < FLASH_LOG_HEADER_BYTES || memcmp(in, FLASH_LOG_MAGIC, FLASH_LOG_MAGIC_LEN) != 0) return false;
+    h.segment = (uint32_t)flashLogGet(in + 8, 4);
+    h.streamOffset = flashLogGet(in + 12, 8);
+    h.utcDate = (uint32_t)flashLogGet(in + 20, 4);
+    h.utcTime = (uint32_t)flashLogGet(in + 24, 4);
+    h.firstSentence = (uint16_t)flashLogGet(in + 28, 2);
+    memcpy(h.sentence, in + 32, sizeof(h.sentence) - 1);
+    h.sentence[sizeof(h.sentence) - 1] = '\0';
+    return true;
+}
+
+// Порция для записи в файл сегмента
+struct FlashLogBatch {
+    uint32_t segment;
+    bool segmentStart;  // Первая порция: открыть новый файл; индекс — в начале порции
+    size_t len;
+};
+
+class FlashLog {
+public:
+    // mem — stageBytes (степень двойки, не меньше FLASH_LOG_PAGE_BYTES); нумерация файлов с firstSegment
+    void begin(uint8_t* mem, size_t stageBytes, uint32_t firstSegment) {
+        stage_ = mem;
+        mask_ = (uint32_t)stageBytes - 1;
+        firstSegment_ = firstSegment;
+    }
+
+    bool enabled() const { return stage_ != NULL; }
+
+    // Приём: запись целиком в кольцо или потеря со счётом; флеш не ждёт
+    void record(const uint8_t* rec, size_t len, uint8_t type) {
+        if (!stage_ || len == 0) return;
+        uint32_t startUs = micros();
+        if (type == ST_RMC || type == ST_ZDA) noteUtc((const char*)rec, len, type);
+        portENTER_CRITICAL(&ringbufMux);
+        uint32_t used = wrPos_ - rdPos_;
+        portEXIT_CRITICAL(&ringbufMux);
+        if (used + len > mask_ + 1) {
+            droppedRecords++;
+            droppedBytes += (uint32_t)len;
+            return;
+        }
+        noteSegments(len, type, rec);
+        size_t at = wrPos_ & mask_;
+        size_t first = (len < mask_ + 1 - at) ? len : mask_ + 1 - at;
+        memcpy(stage_ + at, rec, first);
+        memcpy(stage_, rec + first, len - first);
+        portENTER_CRITICAL(&ringbufMux);
+        wrPos_ += (uint32_t)len;
+        if (used + len > stageHighWater) stageHighWater = used + (uint32_t)len;
+        portEXIT_CRITICAL(&ringbufMux);
+        produced_ += len;
+        uint32_t us = micros() - startUs;
+        if (us > recordMaxUs) recordMaxUs = us;
+    }
+
+    // Писатель: порция до границы страницы файла в out (FLASH_LOG_PAGE_BYTES);
+    // неполная — если данные ждут дольше FLASH_LOG_FLUSH_MS. 0 — писать нечего.
+    size_t takeBatch(uint8_t* out, uint32_t nowMs, FlashLogBatch& b) {
+        if (!stage_) return 0;
+        portENTER_CRITICAL(&ringbufMux);
+        size_t avail = wrPos_ - rdPos_;
+        portEXIT_CRITICAL(&ringbufMux);
+        if (avail == 0) {
+            lastTakeMs_ = nowMs;
+            return 0;
+        }
+        uint32_t seg = (uint32_t)(consumed_ / FLASH_LOG_PAYLOAD_BYTES);
+        size_t inSeg = (size_t)(consumed_ % FLASH_LOG_PAYLOAD_BYTES);
+        size_t want = FLASH_LOG_PAGE_BYTES - (FLASH_LOG_HEADER_BYTES + inSeg) % FLASH_LOG_PAGE_BYTES;
+        if (avail < want && nowMs - lastTakeMs_ < FLASH_LOG_FLUSH_MS) return 0;
+        size_t n = (avail < want) ? avail : want;
+        size_t h = 0;
+        b.segment = firstSegment_ + seg;
+        b.segmentStart = (inSeg == 0);
+        if (b.segmentStart) {
+            FlashLogHeader header;
+            portENTER_CRITICAL(&ringbufMux);
+            header = desc_[seg & 1];
+            portEXIT_CRITICAL(&ringbufMux);
+            header.segment = b.segment;
+            flashLogEncodeHeader(header, out);
+            h = FLASH_LOG_HEADER_BYTES;
+        }
+        size_t at = rdPos_ & mask_;
+        size_t first = (n < mask_ + 1 - at) ? n : mask_ + 1 - at;
+        memcpy(out + h, stage_ + at, first);
+        memcpy(out + h + first, stage_, n - first);
+        portENTER_CRITICAL(&ringbufMux);
+        rdPos_ += (uint32_t)n;
+        portEXIT_CRITICAL(&ringbufMux);
+        consumed_ += n;
+        lastTakeMs_ = nowMs;
+        b.len = h + n;
+        return b.len;
+    }
+
+    // Писатель: запись порции во флеш заняла us
+    void noteWrite(uint32_t us, size_t bytes, bool ok) {
+        writeTime.add(us);
+        writes++;
+        if (ok) {
+            bytesWritten += bytes;
+        } else {
+            writeErrors++;
+        }
+    }
+
+    uint32_t pending() const { return wrPos_ - rdPos_; }
+
+    // Счётчики; writeTime — время записи порции во флеш, с запуска
+    LatencyHistogram writeTime = {};
+    uint32_t writes = 0, writeErrors = 0;
+    uint64_t bytesWritten = 0;
+    volatile uint32_t droppedRecords = 0, droppedBytes = 0;
+    volatile uint32_t stageHighWater = 0;
+    volatile uint32_t recordMaxUs = 0;  // Наибольшее время record() в потоке приёма
+    uint32_t segmentsOpened = 0, segmentsDeleted = 0;
+
+private:
+    uint8_t* stage_ = NULL;
+    uint32_t mask_ = 0;
+    volatile uint32_t wrPos_ = 0, rdPos_ = 0;
+    uint64_t produced_ = 0;  // Приём: байт принято в кольцо
+    uint64_t consumed_ = 0;  // Писатель: байт забрано
+    uint32_t lastTakeMs_ = 0;
+    uint32_t firstSegment_ = 0;
+    uint32_t utcDate_ = 0, utcTime_ = 0;
+    FlashLogHeader desc_[2] = {};  // Индексы сегментов в работе: писатель отстаёт меньше чем на сегмент
+
+    // Индексы сегментов, начинающихся в этой записи, и первое предложение сегмента
+    void noteSegments(size_t len, uint8_t type, const uint8_t* rec) {
+        uint64_t start = produced_, end = produced_ + len;
+        portENTER_CRITICAL(&ringbufMux);
+        for (uint64_t s = (start + FLASH_LOG_PAYLOAD_BYTES - 1) / FLASH_LOG_PAYLOAD_BYTES;
+             s * FLASH_LOG_PAYLOAD_BYTES < end; s++) {
+            FlashLogHeader& d = desc_[s & 1];
+            memset(&d, 0, sizeof(d));
+            d.streamOffset = s * FLASH_LOG_PAYLOAD_BYTES;
+            d.utcDate = utcDate_;
+            d.utcTime = utcTime_;
+            d.firstSentence = FLASH_LOG_NO_SENTENCE;
+        }
+        uint64_t seg = start / FLASH_LOG_PAYLOAD_BYTES;
+        FlashLogHeader& d = desc_[seg & 1];
+        uint64_t offset = start - seg * FLASH_LOG_PAYLOAD_BYTES;
+        if (type <= ST_NMEA_OTHER && d.firstSentence == FLASH_LOG_NO_SENTENCE &&
+            offset + len <= FLASH_LOG_PAGE_BYTES - FLASH_LOG_HEADER_BYTES) {
+            d.firstSentence = (uint16_t)offset;
+            size_t n = 0;
+            while (n < len && n < sizeof(d.sentence) - 1 && rec[n] >= ' ') n++;
+            memcpy(d.sentence, rec, n);
+            d.sentence[n] = '\0';
+        }
+        portEXIT_CRITICAL(&ringbufMux);
+    }
+
+    // Время из RMC (поле 1, дата — поле 9) или ZDA (поля 1-4)
+    void noteUtc(const char* s, size_t len, uint8_t type) {
+        const char* fields[10] = {};
+        size_t count = 0;
+        for (size_t i = 0; i < len && count < 10; i++) {
+            if (s[i] == ',') fields[count++] = s + i + 1;
+        }
+        if (count < 1 || *fields[0] < '0' || *fields[0] > '9') return;
+        uint32_t time = (uint32_t)strtoul(fields[0], NULL, 10);
+        uint32_t date = 0;
+        if (type == ST_RMC && count >= 9) {
+            date = (uint32_t)strtoul(fields[8], NULL, 10);
+        } else if (type == ST_ZDA && count >= 4) {
+            date = (uint32_t)strtoul(fields[1], NULL, 10) * 10000 + (uint32_t)strtoul(fields[2], NULL, 10) * 100 +
+                   (uint32_t)strtoul(fields[3], NULL, 10) % 100;
+        }
+        if (date == 0) return;
+        utcDate_ = date;
+        utcTime_ = time;
+    }
+};
@@ -0,0 +1,434 @@
+// Состояние GNSS для дисплея и разбор потока приёмника
+//
+// gpsData/satData заполняются парсерами NMEA (GSV, GSA, GST, GNS, GGA) и
+// бинарных логов Unicore (BESTNAV/PVTSLN, см. unicore_binary.h), устаревшие
+// данные сбрасываются checkSatelliteTimeouts(). Парсеры получают целые
+// предложения от StreamFramer (см. bridge_core.h).
+//
+// Время — millis() из hal.h; заголовок собирается и в хост-сборке.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "unicore_binary.h"
+
+// Информация о спутниках для каждой системы
+struct SatInfo {
+    int visible = 0;   // сколько видимых (из GSV)
+    int used    = 0;   // сколько реально участвуют в решении (из GSA)
+    unsigned long lastUpdate = 0;
+};
+
+// GPS данные
+struct GPSData {
+    double latitude = 0.0, longitude = 0.0, altitude = 0.0;
+    double latAccuracy = 999.9;  // Точность по широте
+    double lonAccuracy = 999.9;  // Точность по долготе
+    double verticalAccuracy = 999.9;
+    int satellites = 0;  // Общее количество спутников в фиксе из GNS
+    // Качество фикса из GNS (mode indicator):
+    // 0=NO FIX, 1=AUTONOMOUS, 2=DGPS, 3=HIGH PREC, 4=RTK FIXED, 5=RTK FLOAT, 6=ESTIMATED, 7=MANUAL, 8=SIMULATOR
+    int fixQuality = 0;
+    bool valid = false;
+    unsigned long lastUpdate = 0;
+    unsigned long lastGstUpdate = 0;  // Последнее обновление GST данных (точность)
+} gpsData;
+
+// Данные спутников по системам
+struct SatelliteData {
+    SatInfo gps;
+    SatInfo glonass;
+    SatInfo galileo;
+    SatInfo beidou;
+    SatInfo qzss;
+} satData;
+
+// Конвертация из DDMM.MMMM в десятичные градусы
+static double convertToDecimalDegrees(double ddmm) {
+    int degrees = (int)(ddmm / 100);
+    double minutes = ddmm - (degrees * 100);
+    return degrees + minutes / 60.0;
+}
+
+// Оптимизированная функция парсинга NMEA для получения точности и спутников
+// Использует только операции с C-строками, без объектов String
+// Единый статический буфер для парсинга NMEA (вместо локальных копий в каждом парсере)
+// Экономит стек и уменьшает нагрузку на память при интенсивной обработке
+static char nmeaParseBuffer[256];
+
+// Вспомогательная функция для разделения NMEA строки на поля
+// Модифицирует строку, заменяя запятые и звёздочки на '\0'
+// ВАЖНО: требует модифицируемую копию строки!
+static int splitFields(char *nmea, char *fields[], int maxFields) {
+    int count = 0;
+    char *p = nmea;
+    
+    while (*p && count < maxFields) {
+        fields[count++] = p;
+        
+        // Ищем запятую или звёздочку (начало checksum)
+        char *c = p;
+        while (*c && *c != ',' && *c != '*') {
+            c++;
+        }
+        
+        // Если нашли разделитель
+        if (*c) {
+            char separator = *c;
+            *c = '\0';  // Терминируем текущее поле
+            p = c + 1;  // Переходим к следующему полю
+            
+            // Если нашли звёздочку - это конец данных
+            if (separator == '*') {
+                break;
+            }
+        } else {
+            // Конец строки
+            break;
+        }
+    }
+    
+    return count;
+}
+
+// Парсер GSV (видимые спутники)
+static void parseGSV(const char *nmea) {
+    // Используем общий статический буфер (экономия стека)
+    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
+    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
+    
+    char *fields[32];
+    int n = splitFields(nmeaParseBuffer, fields, 32);
+    if (n < 4) return;
+
+    int total = atoi(fields[3]); // поле 3 = общее число видимых спутников
+    unsigned long now = millis();
+
+    if (strncmp(nmea, "$GPGSV", 6) == 0) {
+        satData.gps.visible = total;
+        satData.gps.lastUpdate = now;
+    } else if (strncmp(nmea, "$GLGSV", 6) == 0) {
+        satData.glonass.visible = total;
+        satData.glonass.lastUpdate = now;
+    } else if (strncmp(nmea, "$GAGSV", 6) == 0) {
+        satData.galileo.visible = total;
+        satData.galileo.lastUpdate = now;
+    } else if (strncmp(nmea, "$GBGSV", 6) == 0) {
+        satData.beidou.visible = total;
+        satData.beidou.lastUpdate = now;
+    } else if (strncmp(nmea, "$GQGSV", 6) == 0) {
+        satData.qzss.visible = total;
+        satData.qzss.lastUpdate = now;
+    }
+}
+
+// Парсер GSA (используемые спутники)
+static void parseGSA(const char *nmea) {
+    // Используем общий статический буфер (экономия стека)
+    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
+    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
+    
+    char *fields[32];
+    int n = splitFields(nmeaParseBuffer, fields, 32);
+    if (n < 15) return;
+
+    int count = 0;
+    // поля 3–14 = PRN используемых спутников (индексы с 0)
+    for (int i = 3; i <= 14 && i < n; i++) {
+        if (fields[i] && strlen(fields[i]) > 0) {
+            count++;
+        }
+    }
+    unsigned long now = millis();
+
+    if (strncmp(nmea, "$GPGSA", 6) == 0) {
+        satData.gps.used = count;
+        satData.gps.lastUpdate = now;
+    } else if (strncmp(nmea, "$GLGSA", 6) == 0) {
+        satData.glonass.used = count;
+        satData.glonass.lastUpdate = now;
+    } else if (strncmp(nmea, "$GAGSA", 6) == 0) {
+        satData.galileo.used = count;
+        satData.galileo.lastUpdate = now;
+    } else if (strncmp(nmea, "$BDGSA", 6) == 0) {
+        satData.beidou.used = count;
+        satData.beidou.lastUpdate = now;
+    } else if (strncmp(nmea, "$GQGSA", 6) == 0) {
+        satData.qzss.used = count;
+        satData.qzss.lastUpdate = now;
+    } else if (strncmp(nmea, "$GNGSA", 6) == 0) {
+        // Для GNGSA нужно определить System ID
+        if (n > 18) {
+            // System ID в поле 19 (индекс 18)
+            const char* sysField = fields[18];
+            if (sysField) {
+                int systemId = atoi(sysField);
+                if (systemId == 1) {
+                    satData.gps.used = count;
+                    satData.gps.lastUpdate = now;
+                } else if (systemId == 2) {
+                    satData.glonass.used = count;
+                    satData.glonass.lastUpdate = now;
+                } else if (systemId == 3) {
+                    satData.galileo.used = count;
+                    satData.galileo.lastUpdate = now;
+                } else if (systemId == 4) {
+                    satData.beidou.used = count;
+                    satData.beidou.lastUpdate = now;
+                } else if (systemId == 5) {
+                    satData.qzss.used = count;
+                    satData.qzss.lastUpdate = now;
+                }
+            }
+        }
+    }
+}
+
+// Парсер GST для точности
+static void parseGST(const char *nmea) {
+    // Используем общий статический буфер (экономия стека)
+    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
+    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
+    
+    char *fields[32];
+    int n = splitFields(nmeaParseBuffer, fields, 32);
+    if (n < 9) return;
+
+    // Field 7: Lat accuracy
+    if (fields[6] && *fields[6]) {
+        float val = atof(fields[6]);
+        if (val > 0.0 && val < 100.0) gpsData.latAccuracy = val;
+    }
+    
+    // Field 8: Lon accuracy
+    if (fields[7] && *fields[7]) {
+        float val = atof(fields[7]);
+        if (val > 0.0 && val < 100.0) gpsData.lonAccuracy = val;
+    }
+    
+    // Field 9: Alt accuracy
+    if (fields[8] && *fields[8]) {
+        float val = atof(fields[8]);
+        if (val > 0.0 && val < 100.0) gpsData.verticalAccuracy = val;
+    }
+    
+    gpsData.lastGstUpdate = millis();
+}
+
+// Парсер GNS для координат
+static void parseGNS(const char *nmea) {
+    // Используем общий статический буфер (экономия стека)
+    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
+    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
+    
+    char *fields[32];
+    int n = splitFields(nmeaParseBuffer, fields, 32);
+    if (n < 11) return;
+
+    // Field 3: Latitude
+    if (fields[2] && fields[3] && *fields[2] && *fields[3]) {
+        double lat = convertToDecimalDegrees(atof(fields[2]));
+        if (fields[3][0] == 'S') lat = -lat;
+        gpsData.latitude = lat;
+        gpsData.lastUpdate = millis();
+    }
+    
+    // Field 5: Longitude
+    if (fields[4] && fields[5] && *fields[4] && *fields[5]) {
+        double lon = convertToDecimalDegrees(atof(fields[4]));
+        if (fields[5][0] == 'W') lon = -lon;
+        gpsData.longitude = lon;
+    }
+    
+    // Field 7: Mode indicators (по 1 символу на систему: GPS, GLONASS, Galileo, BDS, QZSS, NavIC)
+    if (fields[6] && *fields[6]) {
+        auto modeRank = [](char m) -> int {
+            switch (m) {
+                case 'R': return 6; // RTK integer (fixed)
+                case 'F': return 5; // RTK float
+                case 'P': return 4; // High precision
+                case 'D': return 3; // Differential
+                case 'A': return 2; // Autonomous
+                case 'M': return 1; // Manual input
+                case 'S': return 0; // Simulator
+                default:  return -1; // N / unknown
+            }
+        };
+
+        // Определяем длину поля до запятой или '*', учитываем максимум 6 систем
+        size_t modesLen = 0;
+        while (fields[6][modesLen] && fields[6][modesLen] != ',' && fields[6][modesLen] != '*') modesLen++;
+        if (modesLen > 6) modesLen = 6;
+
+        char bestMode = 'N';
+        int bestRank = -1;
+        bool hasValidFix = false; // Валиден только для A/D/P/F/R
+
+        for (size_t i = 0; i < modesLen; i++) {
+            char mode = fields[6][i];
+            int rank = modeRank(mode);
+            if (mode == 'A' || mode == 'D' || mode == 'P' || mode == 'F' || mode == 'R') hasValidFix = true;
+            if (rank > bestRank) { bestRank = rank; bestMode = mode; }
+        }
+
+        // Устанавливаем fixQuality по лучшему режиму
+        switch (bestMode) {
+            case 'A': gpsData.fixQuality = 1; break;
+            case 'D': gpsData.fixQuality = 2; break;
+            case 'P': gpsData.fixQuality = 3; break;
+            case 'R': gpsData.fixQuality = 4; break;
+            case 'F': gpsData.fixQuality = 5; break;
+            case 'M': gpsData.fixQuality = 7; break; // MANUAL
+            case 'S': gpsData.fixQuality = 8; break; // SIMULATOR
+            default:  gpsData.fixQuality = 0; break;  // NO FIX / unknown
+        }
+
+        gpsData.valid = hasValidFix;
+    }
+    
+    // Field 8: Number of satellites
+    // ВАЖНО: парсим количество спутников ТОЛЬКО из GNGNS (комбинированное),
+    // игнорируем GPGNS/GLGNS/GAGNS/GBGNS, чтобы не перезаписать общее количество
+    if (strncmp(nmea, "$GNGNS", 6) == 0) {
+        if (fields[7] && *fields[7]) {
+            gpsData.satellites = atoi(fields[7]);
+        }
+    }
+    
+    // Field 10: Altitude
+    if (n > 9 && fields[9] && *fields[9]) {
+        gpsData.altitude = atof(fields[9]);
+    }
+}
+
+// Парсер GGA для точного определения типа фикса (приоритетнее GNS)
+static void parseGGA(const char *nmea) {
+    // GGA имеет точное поле quality indicator, которое правильно различает RTK Fixed и Float
+    // $GNGGA,hhmmss.ss,lat,N/S,lon,E/W,quality,numSV,hdop,alt,M,sep,M,age,stnID*cs
+    
+    // Парсим только GNGGA (комбинированное), игнорируем GPGGA/GLGGA и т.д.
+    if (strncmp(nmea, "$GNGGA", 6) != 0) return;
+    
+    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
+    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
+    
+    const char *fields[15];
+    int fieldIndex = 0;
+    char *token = strtok(nmeaParseBuffer, ",*");
+    
+    while (token != NULL && fieldIndex < 15) {
+        fields[fieldIndex++] = token;
+        token = strtok(NULL, ",*");
+    }
+    
+    if (fieldIndex < 7) return; // Недостаточно полей
+    
+    // Field 6: Quality indicator из GGA
+    // 0 = Fix not available or invalid
+    // 1 = Single point positioning
+    // 2 = Differential positioning
+    // 3 = GPS PPS mode
+    // 4 = RTK Int (Fixed)
+    // 5 = RTK Float
+    // 7 = Manual input mode
+    // 8 = Simulator mode
+    if (fields[6] && *fields[6]) {
+        int quality = atoi(fields[6]);
+        
+        // GGA quality напрямую соответствует fixQuality
+        if (quality >= 0 && quality <= 8) {
+            gpsData.fixQuality = quality;
+            
+            // Устанавливаем valid для качественных фиксов
+            if (quality == 1 || quality == 2 || quality == 3 || quality == 4 || quality == 5) {
+                gpsData.valid = true;
+            } else {
+                gpsData.valid = false;
+            }
+        }
+    }
+}
+
+// Универсальный диспетчер NMEA
+static void parseNMEA(const char *nmea) {
+    if (strncmp(nmea, "$GP", 3) == 0 || strncmp(nmea, "$GA", 3) == 0 ||
+        strncmp(nmea, "$GL", 3) == 0 || strncmp(nmea, "$GB", 3) == 0 ||
+        strncmp(nmea, "$GQ", 3) == 0 || strncmp(nmea, "$GN", 3) == 0) {
+        
+        if (strstr(nmea, "GSV")) parseGSV(nmea);
+        else if (strstr(nmea, "GSA")) parseGSA(nmea);
+        else if (strstr(nmea, "GST")) parseGST(nmea);
+        else if (strstr(nmea, "GGA")) parseGGA(nmea);  // GGA первым для fixQuality (приоритет!)
+        else if (strstr(nmea, "GNS")) parseGNS(nmea);  // GNS для координат и satellites
+    }
+}
+
+// Парсер бинарных логов Unicore (BESTNAV/PVTSLN) — альтернатива GNS/GGA/GST
+static unsigned long lastBinaryNavUpdate = 0;
+static uint32_t unicoreCrcErrors = 0;
+
+static inline bool binaryNavIsFresh() {
+    return lastBinaryNavUpdate != 0 && (millis() - lastBinaryNavUpdate < 2000);
+}
+
+static inline void parseUnicoreBinary(const uint8_t* frame, size_t len) {
+    UnicoreHeader hdr;
+    UnicoreNav nav;
+    if (!unicoreDecodeNav(frame, len, &hdr, &nav)) {
+        // Части длинных кадров (OBSVM) не проверяются — считаем только целые
+        if (unicoreFrameLength(frame, len) == len) {
+            UnicoreHeader tmp;
+            if (!unicoreCheckFrame(frame, len, &tmp)) unicoreCrcErrors++;
+        }
+        return;
+    }
+
+    unsigned long now = millis();
+    gpsData.fixQuality = nav.fixQuality;
+    gpsData.valid = nav.valid;
+    gpsData.satellites = nav.satellites;
+    if (nav.valid) {
+        gpsData.latitude = nav.latitude;
+        gpsData.longitude = nav.longitude;
+        gpsData.altitude = nav.altitude;
+        gpsData.lastUpdate = now;
+    }
+    // Те же пределы, что и для GST
+    if (nav.latAccuracy > 0.0f && nav.latAccuracy < 100.0f) gpsData.latAccuracy = nav.latAccuracy;
+    if (nav.lonAccuracy > 0.0f && nav.lonAccuracy < 100.0f) gpsData.lonAccuracy = nav.lonAccuracy;
+    if (nav.verticalAccuracy > 0.0f && nav.verticalAccuracy < 100.0f) gpsData.verticalAccuracy = nav.verticalAccuracy;
+    gpsData.lastGstUpdate = now;
+    lastBinaryNavUpdate = now;
+}
+
+// Проверка таймаутов для данных спутников
+static inline void checkSatelliteTimeouts() {
+    unsigned long now = millis();
+    const unsigned long timeout = 10000; // 10 секунд таймаут
+    
+    // Сбрасываем количество спутников, если данные устарели
+    if (now - satData.gps.lastUpdate > timeout) {
+        satData.gps.visible = 0;
+        satData.gps.used = 0;
+    }
+    if (now - satData.glonass.lastUpdate > timeout) {
+        satData.glonass.visible = 0;
+        satData.glonass.used = 0;
+    }
+    if (now - satData.galileo.lastUpdate > timeout) {
+        satData.galileo.visible = 0;
+        satData.galileo.used = 0;
+    }
+    if (now - satData.beidou.lastUpdate > timeout) {
+        satData.beidou.visible = 0;
+        satData.beidou.used = 0;
+    }
+    if (now - satData.qzss.lastUpdate > timeout) {
+        satData.qzss.visible = 0;
+        satData.qzss.used = 0;
+    }
+}
@@ -0,0 +1,448 @@
+// Синтетический поток приёмника для нагрузочных прогонов
+//
+// Эпоха: GGA, GNS, GST с частотой epochHz; раз в секунду — многостраничные
+// GSV и GNGSA по каждому созвездию; между ними — кадры RTCM3 MSM7 (1077,
+// 1087, 1097, 1127, 1117) с верной CRC24Q в объёме rtcmBytesPerSec. Данные
+// детерминированы (xorshift32 от seed), контрольные суммы NMEA верные —
+// поток проходит парсеры и фильтры так же, как запись с UM980.
+// unicoreBinary добавляет после GST бинарные BESTNAV и PVTSLN с верной CRC32;
+// их значения зависят только от номера эпохи (binaryNav()), по ним
+// tools/unicore_bin_bench.cpp --check проверяет разбор.
+//
+// GnssSynth отдаёт записи эпохи по одной, SynthSource выдаёт их по времени
+// как UART (эпоха целиком в свой момент, как пачка у приёмника). Используется
+// генератором tools/gnss_load.cpp и тестовым режимом прошивки
+// (-DSYNTH_LOAD_TEST=1, вместо UART1).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stream_framer.h"  // rtcmCrc24q
+#include "unicore_binary.h"
+
+#define SYNTH_MAX_CONSTELLATIONS 5
+#define SYNTH_MAX_SATS           32   // На созвездие; MSM: не больше 64 ячеек в кадре
+#define SYNTH_MAX_RECORD         1032 // RTCM3: 3 + 1023 + 3
+#define SYNTH_BESTNAV_BODY       120  // Поля после разбираемых — нули
+#define SYNTH_PVTSLN_BODY        80
+
+struct SynthConfig {
+    uint16_t epochHz = 10;                   // GGA/GNS/GST
+    uint8_t constellations = 4;              // GPS, ГЛОНАСС, Galileo, BeiDou, QZSS — первые N
+    uint8_t satsPerConstellation = 10;       // Видимых в GSV и в MSM7
+    uint32_t rtcmBytesPerSec = 0;            // MSM7 поверх NMEA
+    bool unicoreBinary = false;              // BESTNAV и PVTSLN каждую эпоху
+    uint32_t seed = 1;
+};
+
+// Решение в бинарных логах эпохи — то, что должен вернуть разбор
+struct SynthNav {
+    uint32_t posType;   // Тип решения BESTNAV; PVTSLN — следующий по кругу
+    uint32_t solStatus; // 0 — SOL_COMPUTED, 1 — INSUFFICIENT_OBS (для NONE)
+    double latitude, longitude, height;
+    float latSigma, lonSigma, heightSigma;
+    uint8_t satellites;
+};
+
+// Типы решений по кругу: все ветви unicorePosTypeToFixQuality()
+static const uint32_t synthPosTypes[] = {50, 34, 16, 17, 68, 49, 32, 1, 0, 18, 69, 48, 33, 2, 19};
+#define SYNTH_POS_TYPES (sizeof(synthPosTypes) / sizeof(synthPosTypes[0]))
+
+// Размер кадра MSM7 с nsat спутниками и nsig сигналами на спутник
+static inline size_t msm7FrameBytes(int nsat, int nsig) {
+    size_t bits = 169 + (size_t)nsat * nsig + 36 * (size_t)nsat + 80 * (size_t)nsat * nsig;
+    return 3 + (bits + 7) / 8 + 3;
+}
+
+class GnssSynth {
+  public:
+    explicit GnssSynth(const SynthConfig& c = SynthConfig()) { configure(c); }
+
+    void configure(const SynthConfig& c) {
+        cfg = c;
+        if (cfg.epochHz == 0) cfg.epochHz = 1;
+        if (cfg.constellations > SYNTH_MAX_CONSTELLATIONS) cfg.constellations = SYNTH_MAX_CONSTELLATIONS;
+        if (cfg.satsPerConstellation > SYNTH_MAX_SATS) cfg.satsPerConstellation = SYNTH_MAX_SATS;
+        rng = cfg.seed ? cfg.seed : 1;
+        epoch = 0;
+        step = STEP_GGA;
+        sub = 0;
+        rtcmBudget = 0;
+        rtcmNext = 0;
+    }
+
+    const SynthConfig& config() const { return cfg; }
+    uint32_t epochIntervalUs() const { return 1000000UL / cfg.epochHz; }
+    uint32_t epochIndex() const { return epoch; }
+
+    SynthNav binaryNav(uint32_t e) const {
+        SynthNav n;
+        n.posType = synthPosTypes[e % SYNTH_POS_TYPES];
+        n.solStatus = n.posType == 0 ? 1 : 0;
+        n.latitude = 55.7372 + (e % 1000) * 1e-7;
+        n.longitude = -37.6264 - (e % 1000) * 2e-7;
+        n.height = 150.25 + (e % 10) * 0.125;
+        n.latSigma = 0.010f + (e % 7) * 0.001f;
+        n.lonSigma = 0.012f + (e % 5) * 0.001f;
+        n.heightSigma = 0.025f + (e % 3) * 0.002f;
+        n.satellites = (uint8_t)(totalSats() > 255 ? 255 : totalSats());
+        return n;
+    }
+
+    // Следующая запись текущей эпохи в out (cap >= SYNTH_MAX_RECORD);
+    // 0 — эпоха закончилась, следующий вызов начинает новую
+    size_t nextRecord(uint8_t* out, size_t cap) {
+        if (cap < SYNTH_MAX_RECORD) return 0;
+        const bool fullSecond = (epoch % cfg.epochHz) == 0;
+        for (;;) {
+            switch (step) {
+                case STEP_GGA: step = STEP_GNS; return gga((char*)out, cap);
+                case STEP_GNS: step = STEP_GST; return gns((char*)out, cap);
+                case STEP_GST:
+                    step = cfg.unicoreBinary ? STEP_BIN : fullSecond ? STEP_GSV : STEP_RTCM;
+                    sub = 0;
+                    rtcmBudget += cfg.rtcmBytesPerSec / cfg.epochHz;
+                    return gst((char*)out, cap);
+                case STEP_BIN:
+                    if (sub == 0) {
+                        sub = 1;
+                        return bestnav(out);
+                    }
+                    step = fullSecond ? STEP_GSV : STEP_RTCM;
+                    sub = 0;
+                    return pvtsln(out);
+                case STEP_GSV: {
+                    // sub: созвездие * 8 + страница
+                    int c = sub / 8, page = sub % 8;
+                    int pages = (cfg.satsPerConstellation + 3) / 4;
+                    if (c >= cfg.constellations) {
+                        step = STEP_GSA;
+                        sub = 0;
+                        continue;
+                    }
+                    sub = (page + 1 < pages) ? sub + 1 : (c + 1) * 8;
+                    if (pages == 0) continue;
+                    return gsv((char*)out, cap, c, page, pages);
+                }
+                case STEP_GSA:
+                    if (sub >= cfg.constellations) {
+                        step = STEP_RTCM;
+                        sub = 0;
+                        continue;
+                    }
+                    return gsa((char*)out, cap, sub++);
+                case STEP_RTCM: {
+                    size_t n = msm7(out, cap);
+                    if (n) return n;
+                    step = STEP_GGA;
+                    epoch++;
+                    return 0;
+                }
+            }
+        }
+    }
+
+  private:
+    enum Step : uint8_t { STEP_GGA, STEP_GNS, STEP_GST, STEP_BIN, STEP_GSV, STEP_GSA, STEP_RTCM };
+
+    SynthConfig cfg;
+    uint32_t rng = 1;
+    uint32_t epoch = 0;
+    Step step = STEP_GGA;
+    int sub = 0;
+    uint32_t rtcmBudget = 0;  // Байт MSM7, ещё не отданных в эту и прошлые эпохи
+    int rtcmNext = 0;         // Созвездие следующего кадра
+
+    uint32_t rand32() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    }
+    uint32_t randBelow(uint32_t n) { return rand32() % n; }
+
+    // "$...*CS\r\n" из тела в out[0..len)
+    static size_t finishNmea(char* out, size_t cap, int len) {
+        if (len < 0 || (size_t)len + 6 > cap) return 0;
+        uint8_t cs = 0;
+        for (int i = 1; i < len; i++) cs ^= (uint8_t)out[i];
+        return (size_t)len + (size_t)snprintf(out + len, cap - len, "*%02X\r\n", cs);
+    }
+
+    void utc(char* t, size_t cap) const {
+        uint32_t centis = (uint32_t)((uint64_t)epoch * 100 / cfg.epochHz);
+        uint32_t s = 12 * 3600 + centis / 100;
+        snprintf(t, cap, "%02u%02u%02u.%02u", (unsigned)(s / 3600 % 24), (unsigned)(s / 60 % 60),
+                 (unsigned)(s % 60), (unsigned)(centis % 100));
+    }
+
+    // Координаты DDMM.MMMMMMM с дрожанием в пределах сантиметров
+    void position(char* lat, char* lon, size_t cap) {
+        snprintf(lat, cap, "5544.%07u", (unsigned)(1234500 + randBelow(200)));
+        snprintf(lon, cap, "03737.%07u", (unsigned)(7654300 + randBelow(200)));
+    }
+
+    int totalSats() const { return cfg.constellations * cfg.satsPerConstellation; }
+
+    size_t gga(char* out, size_t cap) {
+        char t[16], lat[20], lon[20];
+        utc(t, sizeof(t));
+        position(lat, lon, sizeof(lat));
+        int len = snprintf(out, cap, "$GNGGA,%s,%s,N,%s,E,4,%02d,0.6,%u.%03u,M,14.2,M,1.0,0000", t, lat, lon,
+                           totalSats() > 99 ? 99 : totalSats(), 150 + (unsigned)randBelow(5),
+                           (unsigned)randBelow(1000));
+        return finishNmea(out, cap, len);
+    }
+
+    size_t gns(char* out, size_t cap) {
+        static const char modes[] = "RRRRR";
+        char t[16], lat[20], lon[20];
+        utc(t, sizeof(t));
+        position(lat, lon, sizeof(lat));
+        int len = snprintf(out, cap, "$GNGNS,%s,%s,N,%s,E,%.*s,%02d,0.6,%u.%03u,14.2,1.0,0000,S", t, lat, lon,
+                           (int)cfg.constellations, modes, totalSats() > 99 ? 99 : totalSats(),
+                           150 + (unsigned)randBelow(5), (unsigned)randBelow(1000));
+        return finishNmea(out, cap, len);
+    }
+
+    size_t gst(char* out, size_t cap) {
+        char t[16];
+        utc(t, sizeof(t));
+        int len = snprintf(out, cap, "$GNGST,%s,1.2,0.012,0.010,45.1,0.0%02u,0.0%02u,0.0%02u", t,
+                           6 + (unsigned)randBelow(10), 6 + (unsigned)randBelow(10), 20 + (unsigned)randBelow(20));
+        return finishNmea(out, cap, len);
+    }
+
+    static const char* talker(int c) {
+        static const char* const t[SYNTH_MAX_CONSTELLATIONS] = {"GP", "GL", "GA", "GB", "GQ"};
+        return t[c];
+    }
+
+    size_t gsv(char* out, size_t cap, int c, int page, int pages) {
+        int len = snprintf(out, cap, "$%sGSV,%d,%d,%02d", talker(c), pages, page + 1, cfg.satsPerConstellation);
+        for (int k = page * 4; k < page * 4 + 4 && k < cfg.satsPerConstellation && len > 0; k++) {
+            len += snprintf(out + len, cap - len, ",%02d,%02u,%03u,%02u", k + 1, 10 + (unsigned)randBelow(80),
+                            (unsigned)randBelow(360), 30 + (unsigned)randBelow(20));
+        }
+        return finishNmea(out, cap, len);
+    }
+
+    size_t gsa(char* out, size_t cap, int c) {
+        int len = snprintf(out, cap, "$GNGSA,A,3");
+        int used = cfg.satsPerConstellation < 12 ? cfg.satsPerConstellation : 12;
+        for (int k = 0; k < 12 && len > 0; k++) {
+            len += (k < used) ? snprintf(out + len, cap - len, ",%02d", k + 1) : snprintf(out + len, cap - len, ",");
+        }
+        if (len > 0) len += snprintf(out + len, cap - len, ",1.1,0.6,0.9,%d", c + 1);
+        return finishNmea(out, cap, len);
+    }
+
+    // ---------------- Бинарные логи Unicore ----------------
+
+    static void putU32(uint8_t* p, uint32_t v) {
+        for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+    }
+    static void putF32(uint8_t* p, float f) {
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        putU32(p, u);
+    }
+    static void putF64(uint8_t* p, double d) {
+        uint64_t u;
+        memcpy(&u, &d, sizeof(u));
+        putU32(p, (uint32_t)u);
+        putU32(p + 4, (uint32_t)(u >> 32));
+    }
+
+    // Заголовок кадра с нулевым телом; finishUnicore() дописывает CRC32
+    uint8_t* beginUnicore(uint8_t* out, uint16_t id, size_t body) const {
+        memset(out, 0, UNICORE_HEADER_LEN + body + UNICORE_CRC_LEN);
+        out[0] = UNICORE_SYNC1;
+        out[1] = UNICORE_SYNC2;
+        out[2] = UNICORE_SYNC3;
+        out[4] = (uint8_t)id;
+        out[5] = (uint8_t)(id >> 8);
+        out[6] = (uint8_t)body;
+        out[7] = (uint8_t)(body >> 8);
+        out[9] = 180;  // Time status FINE
+        out[10] = (uint8_t)(2300 & 0xFF);
+        out[11] = (uint8_t)(2300 >> 8);
+        putU32(out + 12, (uint32_t)((uint64_t)epoch * 1000 / cfg.epochHz % 604800000UL));
+        return out + UNICORE_HEADER_LEN;
+    }
+
+    static size_t finishUnicore(uint8_t* out, size_t body) {
+        size_t len = UNICORE_HEADER_LEN + body;
+        putU32(out + len, unicoreCrc32(out, len));
+        return len + UNICORE_CRC_LEN;
+    }
+
+    size_t bestnav(uint8_t* out) const {
+        const SynthNav n = binaryNav(epoch);
+        uint8_t* b = beginUnicore(out, UNICORE_MSG_BESTNAV, SYNTH_BESTNAV_BODY);
+        putU32(b, n.solStatus);
+        putU32(b + 4, n.posType);
+        putF64(b + 8, n.latitude);
+        putF64(b + 16, n.longitude);
+        putF64(b + 24, n.height);
+        putF32(b + 32, 14.2f);  // Undulation
+        putU32(b + 36, 61);     // WGS84
+        putF32(b + 40, n.latSigma);
+        putF32(b + 44, n.lonSigma);
+        putF32(b + 48, n.heightSigma);
+        memcpy(b + 52, "0000", 4);
+        putF32(b + 56, 1.0f);   // Diff age
+        b[64] = n.satellites;
+        b[65] = n.satellites;
+        return finishUnicore(out, SYNTH_BESTNAV_BODY);
+    }
+
+    size_t pvtsln(uint8_t* out) const {
+        const SynthNav n = binaryNav(epoch + 1);  // Другой тип решения, чем в BESTNAV этой эпохи
+        uint8_t* b = beginUnicore(out, UNICORE_MSG_PVTSLN, SYNTH_PVTSLN_BODY);
+        putU32(b, n.posType);
+        putF32(b + 4, (float)n.height);
+        putF64(b + 8, n.latitude);
+        putF64(b + 16, n.longitude);
+        putF32(b + 24, n.heightSigma);
+        putF32(b + 28, n.latSigma);
+        putF32(b + 32, n.lonSigma);
+        putF32(b + 36, 1.0f);   // Diff age
+        b[68] = n.satellites;
+        b[69] = n.satellites;
+        return finishUnicore(out, SYNTH_PVTSLN_BODY);
+    }
+
+    // ---------------- RTCM3 MSM7 ----------------
+
+    struct BitWriter {
+        uint8_t* buf;
+        size_t bit;
+        void put(uint32_t v, int n) {
+            for (int i = n - 1; i >= 0; i--, bit++) {
+                uint8_t mask = (uint8_t)(0x80 >> (bit & 7));
+                if ((v >> i) & 1) {
+                    buf[bit >> 3] |= mask;
+                } else {
+                    buf[bit >> 3] &= (uint8_t)~mask;
+                }
+            }
+        }
+    };
+
+    // Кадр MSM7 следующего созвездия по оставшемуся бюджету; 0 — бюджета нет
+    size_t msm7(uint8_t* out, size_t cap) {
+        static const uint16_t msgNumbers[SYNTH_MAX_CONSTELLATIONS] = {1077, 1087, 1097, 1127, 1117};
+        if (cfg.constellations == 0 || cfg.satsPerConstellation == 0) return 0;
+        int nsat = cfg.satsPerConstellation;
+        if (rtcmBudget < msm7FrameBytes(nsat, 1)) return 0;  // Остаток — в следующую эпоху
+
+        // Сигналов на спутник — сколько позволяют бюджет, 64 ячейки и 1023 байта
+        int nsig = 1;
+        while (nsig < 32 && nsat * (nsig + 1) <= 64 && msm7FrameBytes(nsat, nsig + 1) <= rtcmBudget &&
+               msm7FrameBytes(nsat, nsig + 1) <= cap)
+            nsig++;
+        const int ncell = nsat * nsig;
+        const size_t frame = msm7FrameBytes(nsat, nsig);
+        const size_t payload = frame - 6;
+        rtcmBudget -= (uint32_t)frame;
+
+        const int c = rtcmNext;
+        rtcmNext = (rtcmNext + 1) % cfg.constellations;
+        const bool more = rtcmBudget >= msm7FrameBytes(nsat, 1);
+
+        memset(out, 0, frame);
+        out[0] = 0xD3;
+        out[1] = (uint8_t)(payload >> 8);
+        out[2] = (uint8_t)payload;
+        BitWriter w = {out + 3, 0};
+        w.put(msgNumbers[c], 12);
+        w.put(0, 12);                                                      // Reference station ID
+        w.put((uint32_t)((uint64_t)epoch * 1000 / cfg.epochHz % 604800000UL), 30);  // Epoch time
+        w.put(more ? 1 : 0, 1);                                            // Multiple message bit
+        w.put(0, 3);                                                       // IODS
+        w.put(0, 7);                                                       // Reserved
+        w.put(0, 2);                                                       // Clock steering
+        w.put(0, 2);                                                       // External clock
+        w.put(0, 1);                                                       // Divergence-free smoothing
+        w.put(0, 3);                                                       // Smoothing interval
+        for (int s = 0; s < 64; s++) w.put(s < nsat ? 1 : 0, 1);           // Satellite mask
+        for (int s = 0; s < 32; s++) w.put(s < nsig ? 1 : 0, 1);           // Signal mask
+        for (int k = 0; k < ncell; k++) w.put(1, 1);                       // Cell mask
+        for (int s = 0; s < nsat; s++) w.put(randBelow(256), 8);           // Rough range, ms
+        for (int s = 0; s < nsat; s++) w.put(0, 4);                        // Extended info
+        for (int s = 0; s < nsat; s++) w.put(randBelow(1024), 10);         // Rough range mod 1 ms
+        for (int s = 0; s < nsat; s++) w.put(randBelow(16384), 14);        // Rough phase range rate
+        for (int k = 0; k < ncell; k++) w.put(randBelow(1u << 20), 20);    // Fine pseudorange
+        for (int k = 0; k < ncell; k++) w.put(randBelow(1u << 24), 24);    // Fine phase range
+        for (int k = 0; k < ncell; k++) w.put(512, 10);                    // Lock time indicator
+        for (int k = 0; k < ncell; k++) w.put(0, 1);                       // Half-cycle ambiguity
+        for (int k = 0; k < ncell; k++) w.put(640 + randBelow(160), 10);   // CNR
+        for (int k = 0; k < ncell; k++) w.put(randBelow(1u << 15), 15);    // Fine phase range rate
+
+        uint32_t crc = rtcmCrc24q(out, 3 + payload);
+        out[3 + payload] = (uint8_t)(crc >> 16);
+        out[4 + payload] = (uint8_t)(crc >> 8);
+        out[5 + payload] = (uint8_t)crc;
+        return frame;
+    }
+};
+
+// Источник вместо UART: эпохи становятся доступны в свой момент времени и
+// отдаются как непрерывный поток байт
+class SynthSource {
+  public:
+    void begin(const SynthConfig& cfg, uint32_t nowUs) {
+        gen.configure(cfg);
+        len = pos = 0;
+        inEpoch = false;
+        nextEpochUs = nowUs;
+        produced = 0;
+    }
+
+    size_t available(uint32_t nowUs) {
+        refill(nowUs);
+        return len - pos;
+    }
+
+    size_t read(uint8_t* dst, size_t n, uint32_t nowUs) {
+        size_t total = 0;
+        while (total < n && refill(nowUs)) {
+            size_t chunk = len - pos;
+            if (chunk > n - total) chunk = n - total;
+            memcpy(dst + total, record + pos, chunk);
+            pos += chunk;
+            total += chunk;
+        }
+        produced += total;
+        return total;
+    }
+
+    const GnssSynth& generator() const { return gen; }
+    uint64_t produced = 0;  // Байт отдано
+
+  private:
+    GnssSynth gen;
+    uint8_t record[SYNTH_MAX_RECORD];
+    size_t len = 0, pos = 0;
+    bool inEpoch = false;
+    uint32_t nextEpochUs = 0;
+
+    // Есть непрочитанные байты текущей записи (при необходимости генерирует следующую)
+    bool refill(uint32_t nowUs) {
+        while (pos >= len) {
+            if (!inEpoch) {
+                if ((int32_t)(nowUs - nextEpochUs) < 0) return false;
+                inEpoch = true;
+                nextEpochUs += gen.epochIntervalUs();
+            }
+            len = gen.nextRecord(record, sizeof(record));
+            pos = 0;
+            if (len == 0) inEpoch = false;
+        }
+        return true;
+    }
+};
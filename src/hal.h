@@ -0,0 +1,15 @@
+// Тонкий слой платформы для переносимого ядра моста
+//
+// Ядро (ring_buffer.h, gnss_parser.h, bridge_core.h, bridge_pipeline.h)
+// использует только millis()/micros()/delay(), критические секции portMUX,
+// Serial для лога и UART приёмника с available()/readBytes()/write().
+// В прошивке всё это даёт Arduino-ESP32; в хост-сборке (env:native,
+// tools/) — src/native/hal_native.h с подменными часами, UART и приёмниками
+// notify/WiFiClient.
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "native/hal_native.h"
+#endif
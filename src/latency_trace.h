@@ -0,0 +1,171 @@
+// Задержка приёмник -> потребитель: метки порций и гистограммы по потребителям
+//
+// Каждая порция UART получает время чтения (micros() — esp_timer_get_time()
+// на ESP32). Метка — позиция конца порции в очереди потребителя (счётчик
+// поставленных байт) и это время; сами байты очереди не меняются, метки идут
+// рядом, в очереди из LATENCY_MARKS элементов. Когда отправка (notify,
+// WiFiClient::write) проходит позицию метки, задержка попадает в гистограмму
+// потребителя. При полной очереди меток порция присоединяется к последней
+// метке с её временем — оценка под перегрузкой консервативна. Выброшенные при
+// переполнении записи метки теряют.
+//
+// Гистограмма: до 100 мс — корзины по 1 мс, до 1 с — по 10 мс, дальше одна;
+// p50/p99 — верхняя граница корзины, max — точный. Метки и гистограммы
+// меняются под ringbufMux: приём и отправка на S3 идут в разных задачах.
+//
+// -DLATENCY_TRACE=1: каждая задержка ещё и пишется в буфер трассы, который
+// прошивка выгружает строками CSV для разбора вне платы.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "hal.h"
+#include "ring_buffer.h"
+
+#ifndef LATENCY_TRACE
+#define LATENCY_TRACE 0
+#endif
+
+#define LATENCY_MARKS          64
+#define LATENCY_FINE_BUCKETS   100  // 0..99 мс по 1 мс
+#define LATENCY_COARSE_BUCKETS 90   // 100..999 мс по 10 мс
+#define LATENCY_BUCKETS        (LATENCY_FINE_BUCKETS + LATENCY_COARSE_BUCKETS + 1)
+#define LATENCY_TRACE_SAMPLES  512
+
+#define LATENCY_SINK_BLE  0
+#define LATENCY_SINK_WIFI 1  // Клиент i — LATENCY_SINK_WIFI + i
+#define LATENCY_SINK_BLE_PRIORITY 5  // Полоса приоритета BLE, после слотов WiFi
+
+struct LatencyHistogram {
+    uint32_t counts[LATENCY_BUCKETS];
+    uint32_t samples;
+    uint32_t maxUs;
+
+    void add(uint32_t us) {
+        uint32_t ms = us / 1000;
+        size_t b = (ms < 100) ? ms : (ms < 1000) ? LATENCY_FINE_BUCKETS + (ms - 100) / 10 : LATENCY_BUCKETS - 1;
+        counts[b]++;
+        samples++;
+        if (us > maxUs) maxUs = us;
+    }
+
+    // Верхняя граница корзины, в которую попадает доля p выборок, мкс
+    uint32_t percentileUs(float p) const {
+        if (samples == 0) return 0;
+        uint32_t target = (uint32_t)(p * samples + 0.5f);
+        if (target == 0) target = 1;
+        uint32_t acc = 0;
+        for (size_t b = 0; b < LATENCY_BUCKETS; b++) {
+            acc += counts[b];
+            if (acc < target) continue;
+            uint32_t upper = (b < LATENCY_FINE_BUCKETS) ? (uint32_t)(b + 1) * 1000
+                             : (b < LATENCY_BUCKETS - 1) ? (uint32_t)(100 + (b - LATENCY_FINE_BUCKETS + 1) * 10) * 1000
+                                                         : maxUs;
+            return (upper < maxUs) ? upper : maxUs;
+        }
+        return maxUs;
+    }
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+};
+
+#if LATENCY_TRACE
+struct LatencyTraceSample {
+    uint32_t sentUs;
+    uint32_t latencyUs;
+    uint8_t sink;
+};
+static LatencyTraceSample latencyTrace[LATENCY_TRACE_SAMPLES];
+static uint16_t latencyTraceHead = 0, latencyTraceCount = 0;
+static uint32_t latencyTraceDropped = 0;  // Не поместилось до выгрузки
+
+// Забрать до max выборок трассы в out; вызывается тем, кто выгружает
+static size_t takeLatencyTrace(LatencyTraceSample* out, size_t max, uint32_t* dropped) {
+    portENTER_CRITICAL(&ringbufMux);
+    size_t n = (latencyTraceCount < max) ? latencyTraceCount : max;
+    size_t start = (latencyTraceHead + LATENCY_TRACE_SAMPLES - latencyTraceCount) % LATENCY_TRACE_SAMPLES;
+    for (size_t i = 0; i < n; i++) out[i] = latencyTrace[(start + i) % LATENCY_TRACE_SAMPLES];
+    latencyTraceCount -= (uint16_t)n;
+    *dropped = latencyTraceDropped;
+    latencyTraceDropped = 0;
+    portEXIT_CRITICAL(&ringbufMux);
+    return n;
+}
+#endif
+
+struct LatencyTracer {
+    uint32_t markEnd[LATENCY_MARKS];  // Позиция конца порции в очереди
+    uint32_t markUs[LATENCY_MARKS];   // Время чтения порции из UART
+    uint16_t markHead, markCount;
+    LatencyHistogram hist;
+
+    // Приём: байты очереди до endPos пришли в момент us. Очередь меток полна
+    // (очередь потребителя стоит) — последняя метка растягивается до endPos со
+    // своим, более ранним временем: задержка завышается, а не теряется
+    void mark(uint32_t endPos, uint32_t us) {
+        portENTER_CRITICAL(&ringbufMux);
+        if (markCount < LATENCY_MARKS) {
+            markEnd[markHead] = endPos;
+            markUs[markHead] = us;
+            markHead = (markHead + 1) % LATENCY_MARKS;
+            markCount++;
+        } else {
+            markEnd[(markHead + LATENCY_MARKS - 1) % LATENCY_MARKS] = endPos;
+        }
+        portEXIT_CRITICAL(&ringbufMux);
+    }
+
+    // Отправка: байты до sentPos ушли в момент nowUs
+    void sent(uint32_t sentPos, uint32_t nowUs, uint8_t sink) {
+        portENTER_CRITICAL(&ringbufMux);
+        while (markCount > 0) {
+            size_t tail = (markHead + LATENCY_MARKS - markCount) % LATENCY_MARKS;
+            if ((int32_t)(markEnd[tail] - sentPos) > 0) break;
+            uint32_t latency = nowUs - markUs[tail];
+            hist.add(latency);
+#if LATENCY_TRACE
+            if (latencyTraceCount == LATENCY_TRACE_SAMPLES) {
+                latencyTraceDropped++;
+            } else {
+                LatencyTraceSample& s = latencyTrace[latencyTraceHead];
+                s.sentUs = nowUs;
+                s.latencyUs = latency;
+                s.sink = sink;
+                latencyTraceHead = (latencyTraceHead + 1) % LATENCY_TRACE_SAMPLES;
+                latencyTraceCount++;
+            }
+#else
+            (void)sink;
+#endif
+            markCount--;
+        }
+        portEXIT_CRITICAL(&ringbufMux);
+    }
+
+    // Байты до pos выброшены из очереди или сброшены: их метки без выборки
+    void dropped(uint32_t pos) {
+        portENTER_CRITICAL(&ringbufMux);
+        while (markCount > 0) {
+            size_t tail = (markHead + LATENCY_MARKS - markCount) % LATENCY_MARKS;
+            if ((int32_t)(markEnd[tail] - pos) > 0) break;
+            markCount--;
+        }
+        portEXIT_CRITICAL(&ringbufMux);
+    }
+
+    void clearMarks() {
+        portENTER_CRITICAL(&ringbufMux);
+        markCount = 0;
+        portEXIT_CRITICAL(&ringbufMux);
+    }
+
+    // Копия гистограммы за окно отчёта и сброс
+    void takeHistogram(LatencyHistogram& out) {
+        portENTER_CRITICAL(&ringbufMux);
+        out = hist;
+        hist.reset();
+        portEXIT_CRITICAL(&ringbufMux);
+    }
+};
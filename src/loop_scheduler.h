@@ -0,0 +1,139 @@
+// Кооперативный планировщик прохода loop() на одноядерном ESP32-C3
+//
+// Проход начинается с приёма и отправки (ingest, forwardRx, flushBle, WiFi):
+// они идут каждый раз и не планируются. Остальные — фоновые стадии
+// (подключения WiFi, служебные проверки, порт телеметрии) — имеют период и
+// бюджет времени на запуск. Стадия, чей период истёк, запускается, если
+// остаток бюджета прохода вмещает её бюджет; иначе откладывается на
+// следующий проход, и приём снова идёт первым. Первыми рассматриваются самые
+// просроченные стадии. Стадия, не запускавшаяся два периода (срок), идёт без
+// учёта остатка: фон не голодает, но и не вытесняет приём надолго.
+//
+// Бюджет прохода (loopPassBudgetUs) прошивка считает из запаса программного
+// буфера UART на текущей скорости (uartRxBufferForBaud) — при старте и после
+// каждой повторной установки связи: пока проход укладывается в него, буфер
+// драйвера не переполняется. Счётчики стадии: запуски, превышения бюджета,
+// откладывания, запуски позже срока и наибольшее время; у приёма и отправки —
+// превышения бюджета прохода.
+//
+// Время — micros() вызывающего; хост-сборка проверяет правила на модельном
+// времени (--scheduler-selftest, src/native/scheduler_selftest.h).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bridge_telemetry.h"
+
+#define LOOP_SCHEDULER_MAX_STAGES 8  // Не больше бит в LoopScheduler::considered
+
+struct LoopStage {
+    const char* name;
+    uint32_t periodUs;  // Запуск не чаще; срок — два периода
+    uint32_t budgetUs;  // Ожидаемое время одного запуска
+    uint32_t lastRunUs;
+    uint32_t runs;
+    uint32_t overruns;   // Запуск дольше budgetUs
+    uint32_t deferrals;  // Срок периода наступил, но бюджет прохода исчерпан
+    uint32_t late;       // Запущена после срока без учёта бюджета
+    uint32_t maxUs;
+};
+
+struct LoopScheduler {
+    LoopStage stages[LOOP_SCHEDULER_MAX_STAGES];
+    uint8_t stageCount;
+    uint8_t considered;  // Битовая маска стадий, рассмотренных в этом проходе
+    static_assert(LOOP_SCHEDULER_MAX_STAGES <= 8, "considered: one bit per stage");
+    uint32_t passStartUs;
+    uint32_t passBudgetUs;
+    uint32_t foregroundMaxUs;     // Приём и отправка за проход, максимум
+    uint32_t foregroundOverruns;  // Приём и отправка сами дольше бюджета прохода
+
+    // Стадии добавляются при старте; возвращает номер стадии или
+    // LOOP_SCHEDULER_MAX_STAGES, если таблица полна и стадия не добавлена
+    size_t add(const char* name, uint32_t periodUs, uint32_t budgetUs) {
+        if (stageCount >= LOOP_SCHEDULER_MAX_STAGES) return LOOP_SCHEDULER_MAX_STAGES;
+        LoopStage& s = stages[stageCount];
+        memset(&s, 0, sizeof(s));
+        s.name = name;
+        s.periodUs = periodUs;
+        s.budgetUs = budgetUs;
+        return stageCount++;
+    }
+
+    void beginPass(uint32_t nowUs) {
+        passStartUs = nowUs;
+        considered = 0;
+    }
+
+    // Приём и отправка прохода закончены
+    void foregroundDone(uint32_t nowUs) {
+        uint32_t us = nowUs - passStartUs;
+        if (us > foregroundMaxUs) foregroundMaxUs = us;
+        if (us > passBudgetUs) foregroundOverruns++;
+    }
+
+    // Следующая фоновая стадия для запуска; -1 — в этом проходе больше ничего
+    int next(uint32_t nowUs) {
+        uint32_t elapsed = nowUs - passStartUs;
+        uint32_t remaining = (elapsed < passBudgetUs) ? passBudgetUs - elapsed : 0;
+        for (;;) {
+            int pick = -1;
+            uint32_t pickOverdue = 0;
+            for (size_t i = 0; i < stageCount; i++) {
+                const LoopStage& s = stages[i];
+                uint32_t since = nowUs - s.lastRunUs;
+                if ((considered >> i) & 1 || since < s.periodUs) continue;
+                if (pick < 0 || since - s.periodUs > pickOverdue) {
+                    pick = (int)i;
+                    pickOverdue = since - s.periodUs;
+                }
+            }
+            if (pick < 0) return -1;
+            considered |= (uint8_t)(1u << pick);
+            LoopStage& s = stages[pick];
+            if (s.budgetUs <= remaining) return pick;
+            if (pickOverdue >= s.periodUs) {
+                s.late++;
+                return pick;
+            }
+            s.deferrals++;
+        }
+    }
+
+    // Стадия id отработала от startUs до endUs
+    void finished(int id, uint32_t startUs, uint32_t endUs) {
+        LoopStage& s = stages[id];
+        uint32_t us = endUs - startUs;
+        s.lastRunUs = startUs;
+        s.runs++;
+        if (us > s.budgetUs) s.overruns++;
+        if (us > s.maxUs) s.maxUs = us;
+    }
+};
+
+// Бюджет прохода: не больше бюджета платы и четверти времени, за которое
+// заполняется программный буфер UART bufferBytes на скорости baud
+static inline uint32_t loopPassBudgetUs(size_t bufferBytes, uint32_t baud, uint32_t boardBudgetUs) {
+    uint32_t bufferUs = (uint32_t)((uint64_t)bufferBytes * 10 * 1000000 / baud);
+    return (bufferUs / 4 < boardBudgetUs) ? bufferUs / 4 : boardBudgetUs;
+}
+
+// Строка бюджета прохода и по строке на стадию; out — не меньше 512 байт
+static size_t loopSchedulerFormatText(char* out, size_t cap, const LoopScheduler& sched) {
+    size_t n = 0;
+    n = telemetryAppend(out, n, cap, "sched pass_budget_us %lu foreground_max_us %lu overruns %lu\r\n",
+                        (unsigned long)sched.passBudgetUs, (unsigned long)sched.foregroundMaxUs,
+                        (unsigned long)sched.foregroundOverruns);
+    for (size_t i = 0; i < sched.stageCount; i++) {
+        const LoopStage& s = sched.stages[i];
+        n = telemetryAppend(out, n, cap,
+                            "stage %-10s period_us %lu budget_us %lu runs %lu overruns %lu deferred %lu late %lu "
+                            "max_us %lu\r\n",
+                            s.name, (unsigned long)s.periodUs, (unsigned long)s.budgetUs, (unsigned long)s.runs,
+                            (unsigned long)s.overruns, (unsigned long)s.deferrals, (unsigned long)s.late,
+                            (unsigned long)s.maxUs);
+    }
+    return telemetryAppend(out, n, cap, "\r\n");
+}
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <NimBLEDevice.h>
 #include <HardwareSerial.h>
+#include "driver/uart.h"
 #include "esp_wifi.h" // Required for disabling power saving
 #include <WiFi.h>
 #include <WiFiClient.h>
@@ -8,6 +9,32 @@
 #include <Wire.h>
 #include <TinyGPSPlus.h>
 #include <SPI.h>
+#include <Preferences.h>
+#include "stream_framer.h"
+#include "nmea_delta.h"
+#include "unicore_binary.h"
+#include "uart_link.h"
+#include "output_profile.h"
+#include "display_format.h"
+#include "board_profile.h"
+#include "bridge_pipeline.h"
+#include "bridge_core.h"
+#include "bridge_telemetry.h"
+#include "loop_scheduler.h"
+#include "gnss_synth.h"
+#if MICRO_BENCH
+#include "esp_timer.h"
+#include "micro_bench.h"
+#endif
+#if TASK_PROFILE || defined(BOARD_HAS_PSRAM)
+#include "esp_heap_caps.h"
+#endif
+#if TASK_PROFILE
+#include "task_profile.h"
+#endif
+#if FLASH_LOG
+#include <LittleFS.h>
+#endif
 
 // Включаем библиотеки дисплеев после базовых
 #include <Adafruit_GFX.h>
@@ -54,12 +81,31 @@
 // Используем второй аппаратный UART (Serial1, т.к. Serial0 занят USB)
 HardwareSerial SerialPort(1);
 
+// Скорость UART к приёмнику: определяется при загрузке и поднимается до целевой
+#ifndef UART_TARGET_BAUD
+#define UART_TARGET_BAUD 921600   // 0 — не менять скорость приёмника
+#endif
+#define UART_DEFAULT_BAUD 460800  // Если приёмник не ответил ни на одной скорости
+static uint32_t uartLinkBaud = UART_DEFAULT_BAUD;
+
+// Профиль вывода приёмника (см. output_profile.h): rover, base, logger;
+// "none" — конфигурацию вывода UM980 не трогаем
+#ifndef UM980_OUTPUT_PROFILE
+#define UM980_OUTPUT_PROFILE "none"
+#endif
+#define UART_SILENCE_RELINK_MS 3000   // Поток пропал дольше — приёмник переподключен/перезагружен
+#define UART_GARBAGE_RELINK_MS 3000   // Столько без верных записей — приёмник на другой скорости
+
 // I2C OLED Display настройки
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
 #define OLED_RESET -1
 #define SCREEN_ADDRESS 0x78 // I2C адрес дисплея
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+// Fast-mode I2C: 400 кГц по спецификации SSD1306, большинство модулей держат до 1 МГц
+#ifndef OLED_I2C_CLOCK
+#define OLED_I2C_CLOCK 400000
+#endif
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, OLED_I2C_CLOCK, OLED_I2C_CLOCK);
 
 // Условная инициализация TFT дисплея в зависимости от чипа
 #ifdef ESP32_S3
@@ -96,7 +142,12 @@ TFT_eSPI tft = TFT_eSPI();
 #define TFT_BL     5  // Backlight pin
 
 // Arduino_GFX инициализация для ST7789V
+// -DTFT_SPI_DMA: шина с DMA-передачей (строки выводятся целыми окнами из буфера)
+#ifdef TFT_SPI_DMA
+Arduino_DataBus *bus = new Arduino_ESP32SPIDMA(TFT_DC, TFT_CS, TFT_SCLK, TFT_MOSI, -1);
+#else
 Arduino_DataBus *bus = new Arduino_ESP32SPI(TFT_DC, TFT_CS, TFT_SCLK, TFT_MOSI, -1);
+#endif
 Arduino_GFX *tft = new Arduino_ST7789(bus, TFT_RST, 1 /* rotation 90° */, true /* IPS */, 135 /* width */, 240 /* height */, 52 /* col offset 1 */, 40 /* row offset 1 */, 53 /* col offset 2 */, 40 /* row offset 2 */);
 
 // Arduino_GFX уже имеет встроенные цветовые константы
@@ -133,169 +184,12 @@ TinyGPSPlus gps;
 #define SCL_PIN SCL_PIN_C3
 #endif
 
-// Информация о спутниках для каждой системы
-struct SatInfo {
-    int visible = 0;   // сколько видимых (из GSV)
-    int used    = 0;   // сколько реально участвуют в решении (из GSA)
-    unsigned long lastUpdate = 0;
-};
-
-// GPS данные
-struct GPSData {
-    double latitude = 0.0, longitude = 0.0, altitude = 0.0;
-    double latAccuracy = 999.9;  // Точность по широте
-    double lonAccuracy = 999.9;  // Точность по долготе
-    double verticalAccuracy = 999.9;
-    int satellites = 0;  // Общее количество спутников в фиксе из GNS
-    // Качество фикса из GNS (mode indicator):
-    // 0=NO FIX, 1=AUTONOMOUS, 2=DGPS, 3=HIGH PREC, 4=RTK FIXED, 5=RTK FLOAT, 6=ESTIMATED, 7=MANUAL, 8=SIMULATOR
-    int fixQuality = 0;
-    bool valid = false;
-    unsigned long lastUpdate = 0;
-    unsigned long lastGstUpdate = 0;  // Последнее обновление GST данных (точность)
-} gpsData;
-
-// Данные спутников по системам
-struct {
-    SatInfo gps;
-    SatInfo glonass;
-    SatInfo galileo;
-    SatInfo beidou;
-    SatInfo qzss;
-} satData;
-
-// Буфер для парсинга NMEA строк
-String nmeaBuffer = "";
-
-// Объявления функций
-double convertToDecimalDegrees(double ddmm);
-
-// ==============================================
-// RING BUFFER IMPLEMENTATION FOR BLE DATA
-// ==============================================
-
-#define RING_BUFFER_SIZE 16384  // Увеличен с 8192 до 16384 для NTRIP поправок
-
-// Общий спинлок для секций кольцевого буфера
-static portMUX_TYPE ringbufMux = portMUX_INITIALIZER_UNLOCKED;
-
-struct RingBuffer {
-    uint8_t data[RING_BUFFER_SIZE];
-    volatile size_t head;      // Индекс для записи (производитель)
-    volatile size_t tail;      // Индекс для чтения (потребитель)
-    volatile bool overflow;    // Флаг переполнения буфера
-    
-    RingBuffer() : head(0), tail(0), overflow(false) {}
-    
-    // Запись данных в кольцевой буфер (thread-safe)
-    size_t write(const uint8_t* src, size_t len) {
-        if (!src || len == 0) return 0;
-        
-        size_t written = 0;
-        
-        // Критическая секция под общим спинлоком
-        portENTER_CRITICAL(&ringbufMux);
-        
-        for (size_t i = 0; i < len; i++) {
-            size_t next_head = (head + 1) % RING_BUFFER_SIZE;
-            
-            if (next_head == tail) {
-                // Буфер полон - перезаписываем самые старые данные
-                tail = (tail + 1) % RING_BUFFER_SIZE;
-                overflow = true;
-            }
-            
-            data[head] = src[i];
-            head = next_head;
-            written++;
-        }
-        
-        portEXIT_CRITICAL(&ringbufMux);
-        return written;
-    }
-    
-    // Чтение данных из кольцевого буфера (thread-safe)
-    size_t read(uint8_t* dest, size_t maxLen) {
-        if (!dest || maxLen == 0) return 0;
-        
-        size_t bytesRead = 0;
-        
-        // Критическая секция под общим спинлоком
-        portENTER_CRITICAL(&ringbufMux);
-        
-        while (tail != head && bytesRead < maxLen) {
-            dest[bytesRead] = data[tail];
-            tail = (tail + 1) % RING_BUFFER_SIZE;
-            bytesRead++;
-        }
-        
-        // Сбрасываем флаг переполнения после чтения
-        if (overflow && bytesRead > 0) {
-            overflow = false;
-        }
-        
-        portEXIT_CRITICAL(&ringbufMux);
-        return bytesRead;
-    }
-    
-    // Получить количество доступных для чтения байт
-    size_t available() const {
-        portENTER_CRITICAL(&ringbufMux);
-        
-        size_t avail;
-        if (head >= tail) {
-            avail = head - tail;
-        } else {
-            avail = RING_BUFFER_SIZE - tail + head;
-        }
-        
-        portEXIT_CRITICAL(&ringbufMux);
-        return avail;
-    }
-    
-    // Получить количество свободного места в байтах
-    size_t freeSpace() const {
-        return RING_BUFFER_SIZE - available() - 1; // -1 для различения полного/пустого буфера
-    }
-    
-    // Проверить, был ли переполнен буфер
-    bool hasOverflowed() const {
-        return overflow;
-    }
-    
-    // Очистить буфер
-    void clear() {
-        portENTER_CRITICAL(&ringbufMux);
-        
-        head = 0;
-        tail = 0;
-        overflow = false;
-        
-        portEXIT_CRITICAL(&ringbufMux);
-    }
-    
-    // Получить размер буфера
-    size_t capacity() const {
-        return RING_BUFFER_SIZE - 1; // -1 из-за алгоритма различения полный/пустой
-    }
-};
-
-// Глобальный экземпляр кольцевого буфера для BLE данных
-static RingBuffer bleRingBuffer;
-
-// Временный буфер для чтения из кольцевого буфера
-static uint8_t bleTempBuffer[480]; // Размер меньше MTU для целых NMEA строк
-static unsigned long lastBleFlush = 0;
-
-// Буфер для входящих BLE RX данных (NTRIP поправки + команды)
-#define RX_BUFFER_SIZE 4096
-static RingBuffer bleRxBuffer;  // Отдельный буфер для RX
-static uint8_t rxTempBuffer[512];
+// Буфер чтения TX-характеристики (клиенты без Notify, см. TxCallbacks)
+static uint8_t bleTempBuffer[BoardProfile::BLE_READ_CHUNK];
 
 // ==============================================
-// ESP32-S3 DUAL-CORE OPTIMIZATION
+// DUAL-CORE TASKS (BoardProfile::DUAL_CORE)
 // ==============================================
-#ifdef ESP32_S3
 // Хэндлы задач для многопоточности
 TaskHandle_t bleTaskHandle = NULL;
 TaskHandle_t dataTaskHandle = NULL;
@@ -307,7 +201,23 @@ volatile bool dataTaskRunning = false;
 // Forward declarations for tasks (functions defined after global variables)
 void bleTask(void* parameter);
 void dataTask(void* parameter);
-#endif  // ESP32_S3
+
+// Задачи конвейера спят в ulTaskNotifyTake() до события, а не опрашивают
+// очереди каждый тик. dataTask будят данные UART (задача событий
+// HardwareSerial), запись в RX-характеристику и команды WiFi клиентов;
+// bleTask — приём, когда у отправки появился срок раньше, чем она спит.
+static volatile bool bleTaskSleeping = false;
+static volatile bool bleTaskWakeAtSet = false;  // false — спит без срока
+static volatile unsigned long bleTaskWakeAt = 0;
+
+static inline void wakeDataTask() {
+    if (dataTaskHandle != NULL) xTaskNotifyGive(dataTaskHandle);
+}
+
+// Колбэк HardwareSerial::onReceive: порог FIFO или пауза в потоке
+static void onUartReceive() {
+    wakeDataTask();
+}
 
 // Функция для поиска последней границы NMEA сообщения в буфере
 size_t findLastNmeaBoundary(const uint8_t* buffer, size_t length) {
@@ -320,59 +230,53 @@ size_t findLastNmeaBoundary(const uint8_t* buffer, size_t length) {
     return 0; // Не найдено границы - отправлять не нужно
 }
 
-// Вспомогательные функции для работы с кольцевым буфером
-inline size_t writeToRingBuffer(const uint8_t* data, size_t len) {
-    return bleRingBuffer.write(data, len);
-}
-
-inline size_t readFromRingBuffer(uint8_t* data, size_t maxLen) {
-    return bleRingBuffer.read(data, maxLen);
-}
-
-inline size_t getRingBufferAvailable() {
-    return bleRingBuffer.available();
-}
-
-inline size_t getRingBufferFree() {
-    return bleRingBuffer.freeSpace();
-}
-
-inline bool getRingBufferOverflow() {
-    return bleRingBuffer.hasOverflowed();
-}
-
-inline void clearRingBuffer() {
-    bleRingBuffer.clear();
-}
-
 // UUIDs для Nordic UART Service (NUS) - стандартные UUID для совместимости с приложениями
 // Конфликты предотвращаются разными именами устройств (UM980_S3_GPS vs UM980_C3_GPS)
 #define SERVICE_UUID           "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
 #define CHARACTERISTIC_UUID_RX "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
 #define CHARACTERISTIC_UUID_TX "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+// Дополнительная характеристика: тот же поток в сжатом виде (ND1, см. nmea_delta.h)
+#define CHARACTERISTIC_UUID_TXZ "6E400004-B5A3-F393-E0A9-E50E24DCCA9E"
+// Телеметрия конвейера: упакованная TelemetryRecord по чтению (bridge_telemetry.h)
+#define CHARACTERISTIC_UUID_STATS "6E400005-B5A3-F393-E0A9-E50E24DCCA9E"
 
 static NimBLECharacteristic *pTxCharacteristic;
-static bool deviceConnected = false;
+static NimBLECharacteristic *pTxzCharacteristic;
 static bool oldDeviceConnected = false;
 static uint16_t bleConnHandle = 0xFFFF;  // Handle соединения для отслеживания
 
+// Сжатый режим: включается подпиской клиента на TXZ характеристику
+static volatile bool bleCompressed = false;
+static volatile bool bleCompressedResetPending = false;
+static StreamFramer bleZFramer;           // Выравнивание по предложениям перед сжатием
+static NmeaDeltaPacketizer blePacketizer;
+static uint32_t bleZEncodeCycles = 0;     // Такты CPU на кодирование (без notify)
+
 // WiFi variables
-#ifdef ESP32_S3
-const char* ssid = "UM980_GPS_BRIDGE_S3";  // ESP32-S3 AP name
-#else
-const char* ssid = "UM980_GPS_BRIDGE";     // ESP32-C3 AP name
-#endif
+const char* ssid = BoardProfile::apName();  // Per-board AP name (board_profile.h)
 const char* password = "123456789";        // Minimum 8 characters for WPA2
 WiFiServer wifiServer(23);              // Port 23 for telnet-like access
-WiFiClient wifiClients[4];              // Support up to 4 concurrent WiFi clients
-bool wifiClientConnected[4] = {false};
-unsigned long lastWiFiFlush = 0;
+#define TELEMETRY_PORT 2323             // Text telemetry, one snapshot per bridgeSettings.telemetryMs
+WiFiServer statusServer(TELEMETRY_PORT);
+WiFiClient statusClient;
+WiFiClient wifiClients[MAX_WIFI_CLIENTS]; // Queues and filters per client: bridge_core.h
+
+// Предпочтительный PHY соединения ($BRIDGE phy); ANY — решает клиент
+static void requestPreferredPhy(NimBLEServer* server, uint16_t connHandle) {
+    static const uint8_t masks[] = {0, BLE_GAP_LE_PHY_1M_MASK, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_MASK};
+    if (bridgeSettings.phy == BRIDGE_PHY_ANY || bridgeSettings.phy > BRIDGE_PHY_CODED) return;
+    uint8_t mask = masks[bridgeSettings.phy];
+    server->updatePhy(connHandle, mask, mask, 0);
+}
 
 // Класс для обработки событий подключения/отключения
 class ServerCallbacks: public NimBLEServerCallbacks {
     void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) {
+        // Фильтр клиента разберёт поток приёма до первой порции (refreshBleFilter)
+        bleConnects++;
         deviceConnected = true;
         bleConnHandle = connInfo.getConnHandle();
+        requestPreferredPhy(pServer, bleConnHandle);
         
         // Запрашиваем более короткий интервал для лучшей пропускной способности
         pServer->updateConnParams(bleConnHandle, 6, 12, 0, 400);  // 7.5-15ms интервал
@@ -383,6 +287,7 @@ class ServerCallbacks: public NimBLEServerCallbacks {
     void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) {
         deviceConnected = false;
         bleConnHandle = 0xFFFF;
+        bleCompressed = false;
         
         // Причины разрыва:
         // 8 = Supervision timeout (переполнение буфера)
@@ -390,21 +295,9 @@ class ServerCallbacks: public NimBLEServerCallbacks {
         // 22 = Connection timeout
         Serial.printf("BLE Client disconnected, reason: %d\n", reason);
         
-        // Очищаем кольцевой буфер при отключении, только если нет WiFi клиентов
-        bool hasWiFiConnection = false;
-        for (int i = 0; i < 4; i++) {
-            if (wifiClientConnected[i]) {
-                hasWiFiConnection = true;
-                break;
-            }
-        }
-        
-        if (!hasWiFiConnection) {
-            clearRingBuffer();
-            Serial.println("Ring buffer cleared (no WiFi clients connected)");
-        } else {
-            Serial.println("Ring buffer preserved (WiFi clients still connected)");
-        }
+        // Очищаем очередь BLE (у WiFi клиентов собственные очереди)
+        clearRingBuffer();
+        Serial.println("BLE ring buffer cleared");
         
         // Небольшая задержка перед перезапуском advertising
         delay(100);
@@ -427,8 +320,9 @@ class RxCallbacks: public NimBLECharacteristicCallbacks {
             const uint8_t* data = (const uint8_t*)rxValue.c_str();
             size_t len = rxValue.length();
             
-            // Записываем в RX буфер (thread-safe)
+            // Записываем в RX буфер (thread-safe) и будим приём на S3
             bleRxBuffer.write(data, len);
+            wakeDataTask();
         }
     }
 };
@@ -448,6 +342,7 @@ class TxCallbacks: public NimBLECharacteristicCallbacks {
         if (toRead > 0) {
             size_t n = readFromRingBuffer(bleTempBuffer, toRead);
             pCharacteristic->setValue(bleTempBuffer, n);
+            bridgeCounters.bleBytesOut += n;
         } else {
             // Нет данных — возвращаем пустое значение
             pCharacteristic->setValue((uint8_t*)"", 0);
@@ -455,6 +350,101 @@ class TxCallbacks: public NimBLECharacteristicCallbacks {
     }
 };
 
+// Подписка на сжатый поток: переключаем отправку и сбрасываем словарь кодера
+class TxzCallbacks: public NimBLECharacteristicCallbacks {
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+        bool enable = (subValue & 0x0001) != 0;
+        if (enable && !bleCompressed) {
+            bleCompressedResetPending = true;  // Сброс выполняет отправляющий поток
+        }
+        bleCompressed = enable;
+        Serial.printf("BLE compressed stream %s\n", enable ? "enabled" : "disabled");
+    }
+};
+
+// Снимок счётчиков на каждое чтение характеристики статистики
+class StatsCallbacks: public NimBLECharacteristicCallbacks {
+    void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        TelemetryRecord record;
+        telemetrySnapshot(record);
+        pCharacteristic->setValue((const uint8_t*)&record, sizeof(record));
+    }
+};
+
+// Отправленные байты и отказы notify (нет буферов стека) — в телеметрию
+static void countNotify(bool ok, size_t len) {
+    if (ok) {
+        bridgeCounters.bleBytesOut += len;
+    } else {
+        bridgeCounters.notifyFailures++;
+    }
+}
+
+// Непринятый пакет ND1 потерян, и словарь клиента отстал от кодера:
+// сбрасываем словарь, следующий пакет уйдёт с ND_FLAG_RESET
+static bool bleCompressedLost = false;  // В текущей порции sendBleData() отказ notify
+static void notifyCompressed(const uint8_t* packet, size_t len) {
+    uint32_t start = ESP.getCycleCount();
+    pTxzCharacteristic->setValue(packet, len);
+    bool ok = pTxzCharacteristic->notify();
+    countNotify(ok, len);
+    if (!ok) {
+        blePacketizer.reset();
+        bleCompressedLost = true;
+    }
+    bleZEncodeCycles -= ESP.getCycleCount() - start;  // notify не относится к кодированию
+}
+
+// Отправка порции данных BLE клиенту: обычный NUS TX или сжатый поток ND1.
+// false — notify не принята, конвейер повторит порцию. ND1 порцию уже
+// закодировал, поэтому его отказ теряет пакет и сбрасывает словарь, а
+// порция считается потерянной: задержка для неё не записывается.
+static bool sendBleData(const uint8_t* data, size_t len) {
+    if (!bleCompressed) {
+        pTxCharacteristic->setValue(data, len);
+        bool ok = pTxCharacteristic->notify();
+        countNotify(ok, len);
+        if (ok) noteBleLatency();
+        return ok;
+    }
+
+    if (bleCompressedResetPending) {
+        bleCompressedResetPending = false;
+        bleZFramer.reset();
+        blePacketizer.reset();
+        blePacketizer.rawBytes = 0;
+        blePacketizer.packedBytes = 0;
+        bleZEncodeCycles = 0;
+    }
+
+    uint16_t peerMtu = NimBLEDevice::getServer()->getPeerMTU(bleConnHandle);
+    size_t maxPayload = peerMtu > 3 ? (peerMtu - 3) : 20; // ATT header 3 байта
+
+    bleCompressedLost = false;
+    uint32_t start = ESP.getCycleCount();
+    bleZFramer.feed(data, len, [maxPayload](const uint8_t* rec, size_t n, uint8_t) {
+        blePacketizer.addRecord(rec, n, maxPayload, notifyCompressed);
+    });
+    blePacketizer.flush(notifyCompressed);
+    bleZEncodeCycles += ESP.getCycleCount() - start;
+    if (bleCompressedLost) {
+        dropBleLatency();
+    } else {
+        noteBleLatency();
+    }
+
+    // Статистика сжатия раз в 10 секунд
+    static unsigned long lastReport = 0;
+    if (millis() - lastReport > 10000 && blePacketizer.packedBytes > 0) {
+        lastReport = millis();
+        Serial.printf("BLE ND1: %u -> %u bytes, ratio %.2f, %.1f cycles/byte\n",
+                      (unsigned)blePacketizer.rawBytes, (unsigned)blePacketizer.packedBytes,
+                      (double)blePacketizer.rawBytes / blePacketizer.packedBytes,
+                      blePacketizer.rawBytes ? (double)bleZEncodeCycles / blePacketizer.rawBytes : 0.0);
+    }
+    return true;
+}
+
 // WiFi client management function
 void handleWiFiClients() {
     // Check for new client connections
@@ -464,6 +454,10 @@ void handleWiFiClients() {
             if (!wifiClientConnected[i] || !wifiClients[i]) {
                 wifiClients[i] = wifiServer.available();
                 wifiClientConnected[i] = true;
+                clearWiFiQueue(i);
+                wifiFilters[i].parse(bridgeSettings.wifiFilter);
+                wifiControl[i].reset();
+                lastWiFiFlush[i] = 0;
                 Serial.printf("New WiFi client connected on slot %d\n", i);
                 break;
             }
@@ -476,422 +470,135 @@ void handleWiFiClients() {
         }
     }
     
-    // Check for data from existing clients
+    // Forward data from WiFi clients to GPS module
+    forwardWiFiRx(wifiClients, SerialPort);
+
     for (int i = 0; i < 4; i++) {
-        if (wifiClientConnected[i] && wifiClients[i].available()) {
-            // Forward data from WiFi client to GPS module
-            // Читаем пакетами для эффективности
-            uint8_t wifiBuf[512];
-            size_t avail = wifiClients[i].available();
-            if (avail > 0) {
-                if (avail > sizeof(wifiBuf)) avail = sizeof(wifiBuf);
-                size_t bytesRead = wifiClients[i].read(wifiBuf, avail);
-                SerialPort.write(wifiBuf, bytesRead);
-                // НЕ добавляем \r\n для бинарных RTCM3 данных!
-            }
-        }
-        
         // Check if client disconnected
         if (wifiClientConnected[i] && !wifiClients[i].connected()) {
             wifiClients[i].stop();
             wifiClientConnected[i] = false;
+            clearWiFiQueue(i);
             Serial.printf("WiFi client disconnected from slot %d\n", i);
-            
-            // Check if all connections are gone, then clear the buffer
-            bool hasAnyConnection = deviceConnected; // BLE connected
-            bool hasWiFiConnection = false;
-            for (int j = 0; j < 4; j++) {
-                if (wifiClientConnected[j]) {
-                    hasWiFiConnection = true;
-                    break;
-                }
-            }
-            if (!hasAnyConnection && !hasWiFiConnection) {
-                clearRingBuffer();
-                Serial.println("Ring buffer cleared (all connections disconnected)");
-            }
         }
     }
 }
 
-// WiFi data sending function
-void sendWiFiData(const uint8_t* data, size_t length) {
-    for (int i = 0; i < 4; i++) {
-        if (wifiClientConnected[i] && wifiClients[i]) {
-            size_t sent = wifiClients[i].write(data, length);
-            if (sent != length) {
-                Serial.printf("WiFi client %d: only sent %d of %d bytes\n", i, sent, length);
-            }
-        }
-    }
-}
+#if TASK_PROFILE
+static size_t formatTaskProfile(char* out, size_t cap);  // TASK PROFILING section
+#endif
+#if FLASH_LOG
+static size_t formatFlashLog(char* out, size_t cap);  // FLASH LOG section
+#endif
+static void setupLoopScheduler();                         // LOOP SCHEDULER section
+static void updateLoopPassBudget();                       // LOOP SCHEDULER section
+static size_t formatLoopSchedule(char* out, size_t cap);  // LOOP SCHEDULER section
 
-// Оптимизированная функция парсинга NMEA для получения точности и спутников
-// Использует только операции с C-строками, без объектов String
-// Единый статический буфер для парсинга NMEA (вместо локальных копий в каждом парсере)
-// Экономит стек и уменьшает нагрузку на память при интенсивной обработке
-static char nmeaParseBuffer[256];
+// Telemetry port: one status client, a newer connection replaces the older one
+void serviceTelemetryPort() {
+    static unsigned long lastSnapshot = 0;
+    static char text[1536];
 
-// Вспомогательная функция для разделения NMEA строки на поля
-// Модифицирует строку, заменяя запятые и звёздочки на '\0'
-// ВАЖНО: требует модифицируемую копию строки!
-static int splitFields(char *nmea, char *fields[], int maxFields) {
-    int count = 0;
-    char *p = nmea;
-    
-    while (*p && count < maxFields) {
-        fields[count++] = p;
-        
-        // Ищем запятую или звёздочку (начало checksum)
-        char *c = p;
-        while (*c && *c != ',' && *c != '*') {
-            c++;
-        }
-        
-        // Если нашли разделитель
-        if (*c) {
-            char separator = *c;
-            *c = '\0';  // Терминируем текущее поле
-            p = c + 1;  // Переходим к следующему полю
-            
-            // Если нашли звёздочку - это конец данных
-            if (separator == '*') {
-                break;
-            }
-        } else {
-            // Конец строки
-            break;
-        }
+    if (statusServer.hasClient()) {
+        if (statusClient) statusClient.stop();
+        statusClient = statusServer.available();
+        lastSnapshot = 0;
     }
-    
-    return count;
-}
-
-// Парсер GSV (видимые спутники)
-void parseGSV(const char *nmea) {
-    // Используем общий статический буфер (экономия стека)
-    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
-    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
-    
-    char *fields[32];
-    int n = splitFields(nmeaParseBuffer, fields, 32);
-    if (n < 4) return;
-
-    int total = atoi(fields[3]); // поле 3 = общее число видимых спутников
-    unsigned long now = millis();
+    if (!statusClient || !statusClient.connected()) return;
 
-    if (strncmp(nmea, "$GPGSV", 6) == 0) {
-        satData.gps.visible = total;
-        satData.gps.lastUpdate = now;
-    } else if (strncmp(nmea, "$GLGSV", 6) == 0) {
-        satData.glonass.visible = total;
-        satData.glonass.lastUpdate = now;
-    } else if (strncmp(nmea, "$GAGSV", 6) == 0) {
-        satData.galileo.visible = total;
-        satData.galileo.lastUpdate = now;
-    } else if (strncmp(nmea, "$GBGSV", 6) == 0) {
-        satData.beidou.visible = total;
-        satData.beidou.lastUpdate = now;
-    } else if (strncmp(nmea, "$GQGSV", 6) == 0) {
-        satData.qzss.visible = total;
-        satData.qzss.lastUpdate = now;
-    }
-}
-
-// Парсер GSA (используемые спутники)
-void parseGSA(const char *nmea) {
-    // Используем общий статический буфер (экономия стека)
-    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
-    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
-    
-    char *fields[32];
-    int n = splitFields(nmeaParseBuffer, fields, 32);
-    if (n < 15) return;
-
-    int count = 0;
-    // поля 3–14 = PRN используемых спутников (индексы с 0)
-    for (int i = 3; i <= 14 && i < n; i++) {
-        if (fields[i] && strlen(fields[i]) > 0) {
-            count++;
-        }
-    }
     unsigned long now = millis();
-
-    if (strncmp(nmea, "$GPGSA", 6) == 0) {
-        satData.gps.used = count;
-        satData.gps.lastUpdate = now;
-    } else if (strncmp(nmea, "$GLGSA", 6) == 0) {
-        satData.glonass.used = count;
-        satData.glonass.lastUpdate = now;
-    } else if (strncmp(nmea, "$GAGSA", 6) == 0) {
-        satData.galileo.used = count;
-        satData.galileo.lastUpdate = now;
-    } else if (strncmp(nmea, "$BDGSA", 6) == 0) {
-        satData.beidou.used = count;
-        satData.beidou.lastUpdate = now;
-    } else if (strncmp(nmea, "$GQGSA", 6) == 0) {
-        satData.qzss.used = count;
-        satData.qzss.lastUpdate = now;
-    } else if (strncmp(nmea, "$GNGSA", 6) == 0) {
-        // Для GNGSA нужно определить System ID
-        if (n > 18) {
-            // System ID в поле 19 (индекс 18)
-            const char* sysField = fields[18];
-            if (sysField) {
-                int systemId = atoi(sysField);
-                if (systemId == 1) {
-                    satData.gps.used = count;
-                    satData.gps.lastUpdate = now;
-                } else if (systemId == 2) {
-                    satData.glonass.used = count;
-                    satData.glonass.lastUpdate = now;
-                } else if (systemId == 3) {
-                    satData.galileo.used = count;
-                    satData.galileo.lastUpdate = now;
-                } else if (systemId == 4) {
-                    satData.beidou.used = count;
-                    satData.beidou.lastUpdate = now;
-                } else if (systemId == 5) {
-                    satData.qzss.used = count;
-                    satData.qzss.lastUpdate = now;
-                }
-            }
-        }
-    }
-}
-
-// Парсер GST для точности
-void parseGST(const char *nmea) {
-    // Используем общий статический буфер (экономия стека)
-    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
-    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
-    
-    char *fields[32];
-    int n = splitFields(nmeaParseBuffer, fields, 32);
-    if (n < 9) return;
-
-    // Field 7: Lat accuracy
-    if (fields[6] && *fields[6]) {
-        float val = atof(fields[6]);
-        if (val > 0.0 && val < 100.0) gpsData.latAccuracy = val;
-    }
-    
-    // Field 8: Lon accuracy
-    if (fields[7] && *fields[7]) {
-        float val = atof(fields[7]);
-        if (val > 0.0 && val < 100.0) gpsData.lonAccuracy = val;
-    }
-    
-    // Field 9: Alt accuracy
-    if (fields[8] && *fields[8]) {
-        float val = atof(fields[8]);
-        if (val > 0.0 && val < 100.0) gpsData.verticalAccuracy = val;
-    }
-    
-    gpsData.lastGstUpdate = millis();
-}
-
-// Парсер GNS для координат
-void parseGNS(const char *nmea) {
-    // Используем общий статический буфер (экономия стека)
-    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
-    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
-    
-    char *fields[32];
-    int n = splitFields(nmeaParseBuffer, fields, 32);
-    if (n < 11) return;
-
-    // Field 3: Latitude
-    if (fields[2] && fields[3] && *fields[2] && *fields[3]) {
-        double lat = convertToDecimalDegrees(atof(fields[2]));
-        if (fields[3][0] == 'S') lat = -lat;
-        gpsData.latitude = lat;
-        gpsData.lastUpdate = millis();
-    }
-    
-    // Field 5: Longitude
-    if (fields[4] && fields[5] && *fields[4] && *fields[5]) {
-        double lon = convertToDecimalDegrees(atof(fields[4]));
-        if (fields[5][0] == 'W') lon = -lon;
-        gpsData.longitude = lon;
-    }
-    
-    // Field 7: Mode indicators (по 1 символу на систему: GPS, GLONASS, Galileo, BDS, QZSS, NavIC)
-    if (fields[6] && *fields[6]) {
-        auto modeRank = [](char m) -> int {
-            switch (m) {
-                case 'R': return 6; // RTK integer (fixed)
-                case 'F': return 5; // RTK float
-                case 'P': return 4; // High precision
-                case 'D': return 3; // Differential
-                case 'A': return 2; // Autonomous
-                case 'M': return 1; // Manual input
-                case 'S': return 0; // Simulator
-                default:  return -1; // N / unknown
-            }
-        };
-
-        // Определяем длину поля до запятой или '*', учитываем максимум 6 систем
-        size_t modesLen = 0;
-        while (fields[6][modesLen] && fields[6][modesLen] != ',' && fields[6][modesLen] != '*') modesLen++;
-        if (modesLen > 6) modesLen = 6;
-
-        char bestMode = 'N';
-        int bestRank = -1;
-        bool hasValidFix = false; // Валиден только для A/D/P/F/R
-
-        for (size_t i = 0; i < modesLen; i++) {
-            char mode = fields[6][i];
-            int rank = modeRank(mode);
-            if (mode == 'A' || mode == 'D' || mode == 'P' || mode == 'F' || mode == 'R') hasValidFix = true;
-            if (rank > bestRank) { bestRank = rank; bestMode = mode; }
-        }
-
-        // Устанавливаем fixQuality по лучшему режиму
-        switch (bestMode) {
-            case 'A': gpsData.fixQuality = 1; break;
-            case 'D': gpsData.fixQuality = 2; break;
-            case 'P': gpsData.fixQuality = 3; break;
-            case 'R': gpsData.fixQuality = 4; break;
-            case 'F': gpsData.fixQuality = 5; break;
-            case 'M': gpsData.fixQuality = 7; break; // MANUAL
-            case 'S': gpsData.fixQuality = 8; break; // SIMULATOR
-            default:  gpsData.fixQuality = 0; break;  // NO FIX / unknown
-        }
-
-        gpsData.valid = hasValidFix;
-    }
-    
-    // Field 8: Number of satellites
-    // ВАЖНО: парсим количество спутников ТОЛЬКО из GNGNS (комбинированное),
-    // игнорируем GPGNS/GLGNS/GAGNS/GBGNS, чтобы не перезаписать общее количество
-    if (strncmp(nmea, "$GNGNS", 6) == 0) {
-        if (fields[7] && *fields[7]) {
-            gpsData.satellites = atoi(fields[7]);
-        }
-    }
-    
-    // Field 10: Altitude
-    if (n > 9 && fields[9] && *fields[9]) {
-        gpsData.altitude = atof(fields[9]);
+    if (bridgeSettings.telemetryMs == 0) return;  // $BRIDGE,SET,telemetry_ms,0
+    if (lastSnapshot != 0 && now - lastSnapshot < bridgeSettings.telemetryMs) return;
+    lastSnapshot = now;
+    TelemetryRecord record;
+    telemetrySnapshot(record);
+    size_t n = telemetryFormatText(text, sizeof(text), record);
+    statusClient.write((const uint8_t*)text, n);
+#if TASK_PROFILE
+    static char profileText[2048];
+    n = formatTaskProfile(profileText, sizeof(profileText));
+    statusClient.write((const uint8_t*)profileText, n);
+#endif
+#if FLASH_LOG
+    n = formatFlashLog(text, sizeof(text));
+    statusClient.write((const uint8_t*)text, n);
+#endif
+    if (!BoardProfile::DUAL_CORE) {
+        n = formatLoopSchedule(text, sizeof(text));
+        statusClient.write((const uint8_t*)text, n);
     }
 }
 
-// Парсер GGA для точного определения типа фикса (приоритетнее GNS)
-void parseGGA(const char *nmea) {
-    // GGA имеет точное поле quality indicator, которое правильно различает RTK Fixed и Float
-    // $GNGGA,hhmmss.ss,lat,N/S,lon,E/W,quality,numSV,hdop,alt,M,sep,M,age,stnID*cs
-    
-    // Парсим только GNGGA (комбинированное), игнорируем GPGGA/GLGGA и т.д.
-    if (strncmp(nmea, "$GNGGA", 6) != 0) return;
-    
-    strncpy(nmeaParseBuffer, nmea, sizeof(nmeaParseBuffer) - 1);
-    nmeaParseBuffer[sizeof(nmeaParseBuffer) - 1] = '\0';
-    
-    const char *fields[15];
-    int fieldIndex = 0;
-    char *token = strtok(nmeaParseBuffer, ",*");
-    
-    while (token != NULL && fieldIndex < 15) {
-        fields[fieldIndex++] = token;
-        token = strtok(NULL, ",*");
-    }
-    
-    if (fieldIndex < 7) return; // Недостаточно полей
-    
-    // Field 6: Quality indicator из GGA
-    // 0 = Fix not available or invalid
-    // 1 = Single point positioning
-    // 2 = Differential positioning
-    // 3 = GPS PPS mode
-    // 4 = RTK Int (Fixed)
-    // 5 = RTK Float
-    // 7 = Manual input mode
-    // 8 = Simulator mode
-    if (fields[6] && *fields[6]) {
-        int quality = atoi(fields[6]);
-        
-        // GGA quality напрямую соответствует fixQuality
-        if (quality >= 0 && quality <= 8) {
-            gpsData.fixQuality = quality;
-            
-            // Устанавливаем valid для качественных фиксов
-            if (quality == 1 || quality == 2 || quality == 3 || quality == 4 || quality == 5) {
-                gpsData.valid = true;
-            } else {
-                gpsData.valid = false;
-            }
-        }
-    }
-}
+// ==============================================
+// DISPLAY TASK: снимок данных GPS и отрисовка вне приёма/передачи
+// ==============================================
 
-// Универсальный диспетчер NMEA
-void parseNMEA(const char *nmea) {
-    if (strncmp(nmea, "$GP", 3) == 0 || strncmp(nmea, "$GA", 3) == 0 ||
-        strncmp(nmea, "$GL", 3) == 0 || strncmp(nmea, "$GB", 3) == 0 ||
-        strncmp(nmea, "$GQ", 3) == 0 || strncmp(nmea, "$GN", 3) == 0) {
-        
-        if (strstr(nmea, "GSV")) parseGSV(nmea);
-        else if (strstr(nmea, "GSA")) parseGSA(nmea);
-        else if (strstr(nmea, "GST")) parseGST(nmea);
-        else if (strstr(nmea, "GGA")) parseGGA(nmea);  // GGA первым для fixQuality (приоритет!)
-        else if (strstr(nmea, "GNS")) parseGNS(nmea);  // GNS для координат и satellites
-    }
-}
+// Отрисовка идёт в собственной задаче с приоритетом ниже приёма UART и BLE;
+// -DDISPLAY_ENABLED=0 отключает её (для сравнения задержек с дисплеями и без)
+#ifndef DISPLAY_ENABLED
+#define DISPLAY_ENABLED 1
+#endif
+#define DISPLAY_TASK_PRIORITY tskIDLE_PRIORITY
 
-// Проверка таймаутов для данных спутников
-void checkSatelliteTimeouts() {
-    unsigned long now = millis();
-    const unsigned long timeout = 10000; // 10 секунд таймаут
-    
-    // Сбрасываем количество спутников, если данные устарели
-    if (now - satData.gps.lastUpdate > timeout) {
-        satData.gps.visible = 0;
-        satData.gps.used = 0;
-    }
-    if (now - satData.glonass.lastUpdate > timeout) {
-        satData.glonass.visible = 0;
-        satData.glonass.used = 0;
-    }
-    if (now - satData.galileo.lastUpdate > timeout) {
-        satData.galileo.visible = 0;
-        satData.galileo.used = 0;
-    }
-    if (now - satData.beidou.lastUpdate > timeout) {
-        satData.beidou.visible = 0;
-        satData.beidou.used = 0;
-    }
-    if (now - satData.qzss.lastUpdate > timeout) {
-        satData.qzss.visible = 0;
-        satData.qzss.used = 0;
-    }
-}
+TaskHandle_t displayTaskHandle = NULL;
 
-// Конвертация из DDMM.MMMM в десятичные градусы
-double convertToDecimalDegrees(double ddmm) {
-    int degrees = (int)(ddmm / 100);
-    double minutes = ddmm - (degrees * 100);
-    return degrees + minutes / 60.0;
+// Согласованный снимок: публикуется задачей приёма, читается задачей дисплея
+struct GpsSnapshot {
+    GPSData gps;
+    SatelliteData sat;
+    bool timeValid;
+    uint8_t hour, minute, second;
+    uint16_t changed;  // DisplayDirty: накапливается до чтения задачей дисплея
+};
+static GpsSnapshot gpsSnapshot;
+static GpsSnapshot displayData;  // Копия, с которой работает отрисовка
+static portMUX_TYPE gpsSnapshotMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Вызывается из контекста приёма после разбора данных: отмечает изменившиеся
+// поля, чтобы дисплей переформатировал только затронутые строки.
+// Поля снимка пишет только этот контекст, поэтому сравнение идёт без блокировки.
+void publishGpsSnapshot() {
+    const GPSData& prev = gpsSnapshot.gps;
+    const SatelliteData& prevSat = gpsSnapshot.sat;
+    uint16_t changed = 0;
+
+    if (gpsData.fixQuality != prev.fixQuality || gpsData.satellites != prev.satellites ||
+        gpsData.valid != prev.valid) changed |= DD_FIX;
+    if (gpsData.latitude != prev.latitude) changed |= DD_LAT;
+    if (gpsData.longitude != prev.longitude) changed |= DD_LON;
+    if (gpsData.altitude != prev.altitude) changed |= DD_ALT;
+    if (gpsData.latAccuracy != prev.latAccuracy || gpsData.lonAccuracy != prev.lonAccuracy) changed |= DD_ACCURACY;
+    if (gpsData.verticalAccuracy != prev.verticalAccuracy) changed |= DD_VACC;
+    if (satData.gps.used != prevSat.gps.used || satData.glonass.used != prevSat.glonass.used ||
+        satData.galileo.used != prevSat.galileo.used || satData.beidou.used != prevSat.beidou.used ||
+        satData.qzss.used != prevSat.qzss.used) changed |= DD_SATS;
+
+    bool timeValid = gps.time.isValid();
+    uint8_t hour = gps.time.hour(), minute = gps.time.minute(), second = gps.time.second();
+    if (timeValid != gpsSnapshot.timeValid || hour != gpsSnapshot.hour || minute != gpsSnapshot.minute ||
+        second != gpsSnapshot.second) changed |= DD_TIME;
+
+    // lastUpdate нужен дисплею для проверки свежести данных
+    if (changed == 0 && gpsData.lastUpdate == prev.lastUpdate) return;
+
+    portENTER_CRITICAL(&gpsSnapshotMux);
+    gpsSnapshot.gps = gpsData;
+    gpsSnapshot.sat = satData;
+    gpsSnapshot.timeValid = timeValid;
+    gpsSnapshot.hour = hour;
+    gpsSnapshot.minute = minute;
+    gpsSnapshot.second = second;
+    gpsSnapshot.changed |= changed;
+    portEXIT_CRITICAL(&gpsSnapshotMux);
 }
 
-String getFixTypeString(int quality) {
-    switch(quality) {
-        case 0: return "NO FIX";
-        case 1: return "GPS";
-        case 2: return "DGPS";
-        case 3: return "PPS";       // GPS PPS mode - сокращено
-        case 4: return "RTK-FIX";   // RTK Int (Fixed) - сокращено
-        case 5: return "RTK-FLT";   // RTK Float - сокращено
-        case 6: return "EST";       // ESTIMATED - сокращено
-        case 7: return "MANUAL";
-        case 8: return "SIM";
-        default: return "UNKNOWN";
-    }
-}
+// Буфер одной строки TFT: строка рисуется в памяти и уходит одним окном
+static GFXcanvas16* tftLineCanvas = nullptr;
+#define TFT_WIDTH_PX 240
 
 // Структура для хранения состояния каждой строки дисплея
 struct DisplayLineState {
-    String text;
+    char text[DISPLAY_TEXT_MAX];
     uint16_t color;    // Для TFT
     bool needsUpdate;
     int16_t x, y;      // Позиция строки
@@ -915,11 +622,103 @@ static unsigned long lastForceUpdate = 0;
 #define OLED_MAX_CHARS 21   // 128px / (6px*1)
 #define TFT_MAX_CHARS 20    // 240px / (6px*2)
 
+// Изменённая область OLED: диапазон страниц (по 8 пикселей по вертикали) и столбцов.
+// В SSD1306 отправляется только она вместо всего буфера 1024 байта.
+struct OledDirtyRect {
+    int16_t x0, x1;
+    uint8_t page0, page1;
+    bool dirty;
+
+    void add(int16_t x, int16_t y, int16_t w, int16_t h) {
+        if (w <= 0 || h <= 0) return;
+        int16_t xe = x + w - 1;
+        if (x < 0) x = 0;
+        if (xe > SCREEN_WIDTH - 1) xe = SCREEN_WIDTH - 1;
+        if (x > xe) return;
+        uint8_t p0 = y / 8;
+        uint8_t p1 = (y + h - 1) / 8;
+        if (p1 > SCREEN_HEIGHT / 8 - 1) p1 = SCREEN_HEIGHT / 8 - 1;
+        if (!dirty) {
+            x0 = x; x1 = xe; page0 = p0; page1 = p1;
+            dirty = true;
+        } else {
+            if (x < x0) x0 = x;
+            if (xe > x1) x1 = xe;
+            if (p0 < page0) page0 = p0;
+            if (p1 > page1) page1 = p1;
+        }
+    }
+};
+static OledDirtyRect oledDirty = {0, 0, 0, 0, false};
+
+// Статистика вывода на OLED
+static uint32_t oledFlushBytes = 0;
+static uint32_t oledFlushFrames = 0;
+static uint32_t oledFlushMicros = 0;
+static uint32_t oledFlushMaxMicros = 0;
+
+#define OLED_I2C_CHUNK 127  // Байт данных за транзакцию (буфер Wire 128 минус control byte)
+
+// Отправка только изменённой области буфера Adafruit_SSD1306 (горизонтальная адресация)
+void flushOledDirty() {
+    if (!oledDirty.dirty) return;
+    unsigned long start = micros();
+    uint8_t addr = SCREEN_ADDRESS >> 1;
+    uint8_t* buffer = display.getBuffer();
+
+    Wire.beginTransmission(addr);
+    Wire.write((uint8_t)0x00);  // Co = 0, D/C = 0: далее команды
+    Wire.write((uint8_t)0x21);  // COLUMNADDR
+    Wire.write((uint8_t)oledDirty.x0);
+    Wire.write((uint8_t)oledDirty.x1);
+    Wire.write((uint8_t)0x22);  // PAGEADDR
+    Wire.write(oledDirty.page0);
+    Wire.write(oledDirty.page1);
+    Wire.endTransmission();
+
+    size_t inTx = 0;
+    size_t bytes = 0;
+    for (uint8_t page = oledDirty.page0; page <= oledDirty.page1; page++) {
+        const uint8_t* row = buffer + page * SCREEN_WIDTH;
+        for (int16_t x = oledDirty.x0; x <= oledDirty.x1; x++) {
+            if (inTx == 0) {
+                Wire.beginTransmission(addr);
+                Wire.write((uint8_t)0x40);  // D/C = 1: далее данные GDDRAM
+            }
+            Wire.write(row[x]);
+            bytes++;
+            if (++inTx == OLED_I2C_CHUNK) {
+                Wire.endTransmission();
+                inTx = 0;
+            }
+        }
+    }
+    if (inTx > 0) Wire.endTransmission();
+    oledDirty.dirty = false;
+
+    uint32_t elapsed = micros() - start;
+    oledFlushBytes += bytes;
+    oledFlushFrames++;
+    oledFlushMicros += elapsed;
+    if (elapsed > oledFlushMaxMicros) oledFlushMaxMicros = elapsed;
+
+    // Отчёт раз в 10 секунд
+    static unsigned long lastReport = 0;
+    unsigned long now = millis();
+    if (now - lastReport >= 10000) {
+        Serial.printf("OLED: %lu frames, %lu bytes/frame, I/O avg %lu us, max %lu us\n",
+                      (unsigned long)oledFlushFrames, (unsigned long)(oledFlushBytes / oledFlushFrames),
+                      (unsigned long)(oledFlushMicros / oledFlushFrames), (unsigned long)oledFlushMaxMicros);
+        oledFlushBytes = oledFlushFrames = oledFlushMicros = oledFlushMaxMicros = 0;
+        lastReport = now;
+    }
+}
+
 // Вспомогательные функции для работы с дисплеями
 void initializeDisplayStates() {
     if (!oledInitialized) {
         for (int i = 0; i < MAX_OLED_LINES; i++) {
-            oledLines[i].text = "";
+            oledLines[i].text[0] = '\0';
             oledLines[i].color = SSD1306_WHITE;
             oledLines[i].needsUpdate = true;
             oledLines[i].x = 0;
@@ -932,7 +731,7 @@ void initializeDisplayStates() {
     
     if (!tftInitialized) {
         for (int i = 0; i < MAX_TFT_LINES; i++) {
-            tftLines[i].text = "";
+            tftLines[i].text[0] = '\0';
             tftLines[i].color = TFT_WHITE;
             tftLines[i].needsUpdate = true;
             tftLines[i].x = 0;
@@ -957,23 +756,38 @@ void clearDisplayLine(int lineNum, bool isOled) {
 #endif
 }
 
-bool updateDisplayLine(int lineNum, const String& newText, uint16_t newColor, bool isOled) {
+bool updateDisplayLine(int lineNum, const char* newText, uint16_t newColor, bool isOled) {
     DisplayLineState* lines = isOled ? oledLines : tftLines;
     int maxLines = isOled ? MAX_OLED_LINES : MAX_TFT_LINES;
     
     if (lineNum >= maxLines) return false;
     
     // Проверяем, нужно ли обновление
-    bool needsUpdate = (lines[lineNum].text != newText) || 
+    bool needsUpdate = (strcmp(lines[lineNum].text, newText) != 0) || 
                        (lines[lineNum].color != newColor) ||
                        lines[lineNum].needsUpdate;
     
     if (needsUpdate) {
-        // Очищаем старую строку
-        clearDisplayLine(lineNum, isOled);
+        if (isOled) {
+            // Изменилась только область старого и нового текста; принудительное
+            // обновление переотправляет строку целиком
+            int16_t charWidth = 6 * lines[lineNum].textSize;
+            size_t oldLen = strlen(lines[lineNum].text);
+            size_t newLen = strlen(newText);
+            int16_t chars = (newLen > oldLen) ? newLen : oldLen;
+            int16_t width = lines[lineNum].needsUpdate ? SCREEN_WIDTH : chars * charWidth;
+            oledDirty.add(lines[lineNum].needsUpdate ? 0 : lines[lineNum].x, lines[lineNum].y,
+                          width, OLED_LINE_HEIGHT);
+        }
+
+        // Очищаем старую строку (строка TFT из буфера перерисовывается целиком)
+        if (isOled || !tftLineCanvas) {
+            clearDisplayLine(lineNum, isOled);
+        }
         
         // Обновляем состояние
-        lines[lineNum].text = newText;
+        strncpy(lines[lineNum].text, newText, DISPLAY_TEXT_MAX - 1);
+        lines[lineNum].text[DISPLAY_TEXT_MAX - 1] = '\0';
         lines[lineNum].color = newColor;
         lines[lineNum].needsUpdate = false;
         
@@ -986,6 +800,14 @@ bool updateDisplayLine(int lineNum, const String& newText, uint16_t newColor, bo
             // display.display() вызывается в updateDisplay() после всех обновлений
         } 
 #ifndef ESP32_S3  // TFT disabled for ESP32-S3 (requires physical display)
+        else if (tftLineCanvas) {
+            tftLineCanvas->fillScreen(TFT_BLACK);
+            tftLineCanvas->setCursor(lines[lineNum].x, 0);
+            tftLineCanvas->setTextSize(lines[lineNum].textSize);
+            tftLineCanvas->setTextColor(lines[lineNum].color);
+            tftLineCanvas->print(newText);
+            tft->draw16bitRGBBitmap(0, lines[lineNum].y, tftLineCanvas->getBuffer(), TFT_WIDTH_PX, TFT_LINE_HEIGHT);
+        }
         else {
             TFT_SET_CURSOR(lines[lineNum].x, lines[lineNum].y);
             TFT_SET_TEXT_SIZE(lines[lineNum].textSize);
@@ -1000,62 +822,6 @@ bool updateDisplayLine(int lineNum, const String& newText, uint16_t newColor, bo
     return false; // Обновление не требовалось
 }
 
-String formatSatelliteString() {
-    // Сначала пробуем с пробелами для лучшей читаемости
-    String satStr = "G:" + String(satData.gps.used) +
-                   " R:" + String(satData.glonass.used) +
-                   " E:" + String(satData.galileo.used) +
-                   " B:" + String(satData.beidou.used);
-
-    if (satData.qzss.used > 0) {
-        satStr += " Q:" + String(satData.qzss.used);
-    }
-
-    // Если строка слишком длинная - переключаемся на компактный формат
-    // OLED: ~21 символов, TFT: ~20 символов при текущих размерах шрифта
-    if (satStr.length() > 20) {
-        // Компактный формат без пробелов: G:12R:8E:10B:5Q:1
-        satStr = "G:" + String(satData.gps.used) +
-                 "R:" + String(satData.glonass.used) +
-                 "E:" + String(satData.galileo.used) +
-                 "B:" + String(satData.beidou.used);
-        if (satData.qzss.used > 0) {
-            satStr += "Q:" + String(satData.qzss.used);
-        }
-    }
-
-    return satStr;
-}
-
-// Форматирование строки координаты под ограничение количества символов
-static String formatCoordLine(const char* label, double value, int maxChars) {
-    // Вычисляем сколько символов доступно для числа
-    int labelLen = strlen(label);
-    int availableForNumber = maxChars - labelLen;
-
-    // Определяем сколько знаков до запятой (включая знак минус если есть)
-    int wholePart = (value < 0) ? 1 : 0;  // Знак минус
-    wholePart += (abs(value) >= 100) ? 3 : (abs(value) >= 10) ? 2 : 1;  // Цифры до запятой
-
-    // Вычисляем максимальное количество десятичных знаков
-    int maxDecimals = availableForNumber - wholePart - 1;  // -1 для точки
-
-    // Ограничиваем разумными пределами
-    if (maxDecimals < 4) maxDecimals = 4;  // Минимум 4 знака для базовой точности
-    if (maxDecimals > 10) maxDecimals = 10;  // Максимум 10 знаков (избыточная точность)
-
-    // Формируем строку с максимально возможной точностью
-    String result = String(label) + String(value, maxDecimals);
-
-    // Если получилось слишком длинно, уменьшаем точность
-    while (result.length() > maxChars && maxDecimals > 4) {
-        maxDecimals--;
-        result = String(label) + String(value, maxDecimals);
-    }
-
-    return result;
-}
-
 // Настройки часового пояса
 #ifdef TZ_FORCE_OFFSET_MINUTES
 static volatile bool tzAuto = false;                         // ручной режим
@@ -1074,84 +840,96 @@ static int estimateOffsetMinutesFromLongitude(double lon) {
     return hours * 60;
 }
 
-// Форматирование локального времени как HH:MM:SS с учётом tzOffsetMinutes
-static String formatLocalTime() {
-    if (!gps.time.isValid()) return String("");
-    long sec = gps.time.hour() * 3600L + gps.time.minute() * 60L + gps.time.second();
-    sec += (long)tzOffsetMinutes * 60L;
-    // Нормализация в пределах суток
-    sec %= 86400L;
-    if (sec < 0) sec += 86400L;
-    int hh = (int)(sec / 3600L);
-    int mm = (int)((sec % 3600L) / 60L);
-    int ss = (int)(sec % 60L);
-    char buf[9];
-    snprintf(buf, sizeof(buf), "%02d:%02d:%02d", hh, mm, ss);
-    return String(buf);
+// Отформатированные строки: пересчитываются только при изменении своих полей.
+// Индекс [0] — OLED (21 символ), [1] — TFT (20 символов).
+static struct {
+    char fix[DISPLAY_TEXT_MAX];       // "Sats: N Fix: X" / "Fix: X" в режиме поиска
+    char lat[2][DISPLAY_TEXT_MAX];
+    char lon[2][DISPLAY_TEXT_MAX];
+    char alt[2][DISPLAY_TEXT_MAX];
+    char acc1[2][DISPLAY_TEXT_MAX];
+    char acc2[DISPLAY_TEXT_MAX];
+    char sats[DISPLAY_TEXT_MAX];      // По системам
+    char satCount[DISPLAY_TEXT_MAX];  // "Sats: N" в режиме поиска
+} displayTexts;
+
+static void formatDisplayTexts(uint16_t dirty, bool fresh) {
+    const GPSData& g = displayData.gps;
+    const SatelliteData& sat = displayData.sat;
+    const int widths[2] = {OLED_MAX_CHARS, TFT_MAX_CHARS};
+
+    if (dirty & DD_FIX) {
+        fmtFixLine(displayTexts.fix, DISPLAY_TEXT_MAX, fresh ? g.satellites : -1, g.fixQuality);
+    }
+    char timeText[9];
+    if (dirty & (DD_ALT | DD_TIME)) {
+        fmtLocalTime(timeText, sizeof(timeText), displayData.timeValid, displayData.hour, displayData.minute,
+                     displayData.second, tzOffsetMinutes);
+    }
+    // Целочисленное масштабирование один раз на поле, общее для OLED и TFT
+    const int64_t lat = fmtToScaled(g.latitude, COORD_EXP10);
+    const int64_t lon = fmtToScaled(g.longitude, COORD_EXP10);
+    const int64_t alt = fmtToScaled(g.altitude, ALT_EXP10);
+    const int64_t latAcc = fmtToScaled(g.latAccuracy, ACC_EXP10);
+    const int64_t lonAcc = fmtToScaled(g.lonAccuracy, ACC_EXP10);
+    for (int d = 0; d < 2; d++) {
+        if (dirty & DD_LAT) fmtCoordLine(displayTexts.lat[d], DISPLAY_TEXT_MAX, "Lat: ", lat, widths[d]);
+        if (dirty & DD_LON) fmtCoordLine(displayTexts.lon[d], DISPLAY_TEXT_MAX, "Lon: ", lon, widths[d]);
+        if (dirty & (DD_ALT | DD_TIME)) fmtAltitudeLine(displayTexts.alt[d], DISPLAY_TEXT_MAX, alt, timeText, widths[d]);
+        if (dirty & DD_ACCURACY) fmtAccuracyLine1(displayTexts.acc1[d], DISPLAY_TEXT_MAX, latAcc, lonAcc, widths[d]);
+    }
+    if (dirty & (DD_ACCURACY | DD_VACC)) {
+        fmtAccuracyLine2(displayTexts.acc2, DISPLAY_TEXT_MAX, latAcc, lonAcc,
+                         fmtToScaled(g.verticalAccuracy, ACC_EXP10));
+    }
+    if (dirty & DD_SATS) {
+        fmtSatelliteLine(displayTexts.sats, DISPLAY_TEXT_MAX, sat.gps.used, sat.glonass.used, sat.galileo.used,
+                         sat.beidou.used, sat.qzss.used);
+        int totalUsedSats = sat.gps.used + sat.glonass.used + sat.galileo.used + sat.beidou.used + sat.qzss.used;
+        fmtAppendInt(displayTexts.satCount, fmtAppend(displayTexts.satCount, 0, DISPLAY_TEXT_MAX, "Sats: "),
+                     DISPLAY_TEXT_MAX, totalUsedSats);
+    }
 }
 
-// Форматирование строки высоты с возможным добавлением времени при наличии места
-static String formatAltitudeLine(int maxChars) {
-    // Базовый формат с 1 знаком после запятой
-    String base = String("Alt: ") + String(gpsData.altitude, 1) + "m";
-    String t = formatLocalTime();
-    if (t.length() == 0) return base;
+// Состояние кадра: какие дисплеи можно обновлять сейчас и были ли изменения
+struct DisplayFrame {
+    bool canUpdateOled, canUpdateTft;
+    bool oledUpdated, tftUpdated;
 
-    // Предпочтительно с пробелом
-    if ((int)base.length() + 1 + (int)t.length() <= maxChars) {
-        return base + " " + t;
+    void show(int lineNum, const char* oledText, const char* tftText, uint16_t tftColor) {
+        if (canUpdateOled) oledUpdated |= updateDisplayLine(lineNum, oledText, SSD1306_WHITE, true);
+        if (canUpdateTft) tftUpdated |= updateDisplayLine(lineNum, tftText, tftColor, false);
     }
 
-    // Попробуем уменьшить точность до 0 знаков
-    String base0 = String("Alt: ") + String(gpsData.altitude, 0) + "m";
-    if ((int)base0.length() + 1 + (int)t.length() <= maxChars) {
-        return base0 + " " + t;
+    // Очищаем неиспользуемые строки
+    void clearFrom(int firstLine) {
+        for (int i = firstLine; i < MAX_OLED_LINES; i++) {
+            if (canUpdateOled && oledLines[i].text[0] != '\0') {
+                oledUpdated |= updateDisplayLine(i, "", SSD1306_WHITE, true);
+            }
+        }
+        for (int i = firstLine; i < MAX_TFT_LINES; i++) {
+            if (canUpdateTft && tftLines[i].text[0] != '\0') {
+                tftUpdated |= updateDisplayLine(i, "", TFT_WHITE, false);
+            }
+        }
     }
+};
 
-    // Попробуем без пробела
-    if ((int)base.length() + (int)t.length() <= maxChars) {
-        return base + t;
-    }
+void updateDisplay() {
+    static unsigned long lastOledUpdate = 0;
+    static unsigned long lastTftUpdate = 0;
+    static bool firstFrame = true;
+    static bool lastFresh = false;
+    static int lastTzOffset = 0;
+    
+    // Берём согласованную копию данных и накопленные признаки изменений
+    portENTER_CRITICAL(&gpsSnapshotMux);
+    displayData = gpsSnapshot;
+    gpsSnapshot.changed = 0;
+    portEXIT_CRITICAL(&gpsSnapshotMux);
+    uint16_t dirty = displayData.changed;
 
-    // Последняя попытка: убрать единицу измерения для экономии 1 символа
-    String baseNoUnit = String("Alt: ") + String(gpsData.altitude, 0);
-    if ((int)baseNoUnit.length() + 1 + (int)t.length() <= maxChars) {
-        return baseNoUnit + " " + t;
-    }
-
-    // Не помещается — оставляем только высоту
-    return base;
-}
-
-String formatAccuracyString(int lineType) {
-    if (gpsData.latAccuracy >= 99.9 && gpsData.lonAccuracy >= 99.9) {
-        return ""; // Нет данных о точности
-    }
-    
-    if (lineType == 1) { // Первая строка точности
-        // При высокой точности (< 1м) показываем в сантиметрах с десятыми
-        if (gpsData.latAccuracy < 1.0 && gpsData.lonAccuracy < 1.0) {
-            return String("N/S:") + String(gpsData.latAccuracy * 100, 1) + "cm "
-                 + "E/W:" + String(gpsData.lonAccuracy * 100, 1) + "cm";
-        } else {
-            // Метры: добавляем 'm' после обоих значений
-            return String("N/S:") + String(gpsData.latAccuracy, 1) + "m "
-                 + "E/W:" + String(gpsData.lonAccuracy, 1) + "m";
-        }
-    } else { // Вторая строка точности
-        // При высокой точности (< 1м) показываем в сантиметрах с десятыми
-        if (gpsData.verticalAccuracy < 1.0) {
-            return "H:" + String(gpsData.verticalAccuracy * 100, 1) + "cm";
-        } else {
-            return "H:" + String(gpsData.verticalAccuracy, 1) + "m";
-        }
-    }
-}
-
-void updateDisplay() {
-    static unsigned long lastOledUpdate = 0;
-    static unsigned long lastTftUpdate = 0;
-    
     // Инициализируем состояния дисплеев при первом вызове
     initializeDisplayStates();
     
@@ -1164,188 +942,741 @@ void updateDisplay() {
         for (int i = 0; i < MAX_TFT_LINES; i++) tftLines[i].needsUpdate = true;
     }
     
-    // Проверяем частоту обновления
-    bool canUpdateOled = (millis() - lastOledUpdate > 500) || forceUpdate; // OLED: 2 FPS
-    bool canUpdateTft = (millis() - lastTftUpdate > 333) || forceUpdate;   // TFT: 3 FPS
-    
-    bool oledUpdated = false;
-    bool tftUpdated = false;
+    // Смена режима экрана (фикс/поиск), часового пояса или первый кадр
+    bool fresh = displayData.gps.valid && (millis() - displayData.gps.lastUpdate < 5000);
+    int tzOffset = tzOffsetMinutes;
+    if (firstFrame || forceUpdate || fresh != lastFresh) dirty = DD_ALL;
+    if (tzOffset != lastTzOffset) dirty |= DD_TIME;
+    firstFrame = false;
+    lastFresh = fresh;
+    lastTzOffset = tzOffset;
+
+    if (dirty) {
+        formatDisplayTexts(dirty, fresh);
+    }
     
-    if (gpsData.valid && (millis() - gpsData.lastUpdate < 5000)) {
+    // Проверяем частоту обновления
+    DisplayFrame frame;
+    frame.canUpdateOled = (millis() - lastOledUpdate > 500) || forceUpdate; // OLED: 2 FPS
+    frame.canUpdateTft = (millis() - lastTftUpdate > 333) || forceUpdate;   // TFT: 3 FPS
+    frame.oledUpdated = false;
+    frame.tftUpdated = false;
+    
+    int nextLine = 0;
+    if (fresh) {
         // GPS валиден - отображаем полные данные
-        
-        // Строка 0: Спутники и тип фикса
-        String line0 = "Sats: " + String(gpsData.satellites) + " Fix: " + getFixTypeString(gpsData.fixQuality);
-        if (canUpdateOled) {
-            oledUpdated |= updateDisplayLine(0, line0, SSD1306_WHITE, true);
-        }
-        if (canUpdateTft) {
-            tftUpdated |= updateDisplayLine(0, line0, TFT_GREEN, false);
-        }
-        
-        // Строка 1: Широта (динамическая точность по оставшемуся месту)
-        String line1_oled = formatCoordLine("Lat: ", gpsData.latitude, OLED_MAX_CHARS);
-        String line1_tft  = formatCoordLine("Lat: ", gpsData.latitude, TFT_MAX_CHARS);
-        if (canUpdateOled) {
-            oledUpdated |= updateDisplayLine(1, line1_oled, SSD1306_WHITE, true);
-        }
-        if (canUpdateTft) {
-            tftUpdated |= updateDisplayLine(1, line1_tft, TFT_WHITE, false);
-        }
-        
-        // Строка 2: Долгота (динамическая точность по оставшемуся месту)
-        String line2_oled = formatCoordLine("Lon: ", gpsData.longitude, OLED_MAX_CHARS);
-        String line2_tft  = formatCoordLine("Lon: ", gpsData.longitude, TFT_MAX_CHARS);
-        if (canUpdateOled) {
-            oledUpdated |= updateDisplayLine(2, line2_oled, SSD1306_WHITE, true);
-        }
-        if (canUpdateTft) {
-            tftUpdated |= updateDisplayLine(2, line2_tft, TFT_WHITE, false);
-        }
-        
-        // Строка 3: Высота (+ время, если помещается по ширине)
-        String line3_oled = formatAltitudeLine(OLED_MAX_CHARS);
-        String line3_tft  = formatAltitudeLine(TFT_MAX_CHARS);
-        if (canUpdateOled) {
-            oledUpdated |= updateDisplayLine(3, line3_oled, SSD1306_WHITE, true);
-        }
-        if (canUpdateTft) {
-            tftUpdated |= updateDisplayLine(3, line3_tft, TFT_YELLOW, false);
-        }
+        frame.show(nextLine++, displayTexts.fix, displayTexts.fix, TFT_GREEN);              // Спутники и тип фикса
+        frame.show(nextLine++, displayTexts.lat[0], displayTexts.lat[1], TFT_WHITE);        // Широта
+        frame.show(nextLine++, displayTexts.lon[0], displayTexts.lon[1], TFT_WHITE);        // Долгота
+        frame.show(nextLine++, displayTexts.alt[0], displayTexts.alt[1], TFT_YELLOW);       // Высота (+ время)
         
         // Строки точности (если доступны)
-        int nextLine = 4;
-        String accLine1 = formatAccuracyString(1);
-        String accLine2 = formatAccuracyString(2);
-        // Подгон по ширине для TFT (240px, textSize=2 => ~20 символов)
-        String accLine1Tft = accLine1;
-        if (accLine1Tft.length() > 20) {
-            accLine1Tft.replace("N/S:", "NS:");
-            accLine1Tft.replace("E/W:", "EW:");
-        }
-        
-        if (accLine1.length() > 0) {
-            if (canUpdateOled) {
-                oledUpdated |= updateDisplayLine(nextLine, accLine1, SSD1306_WHITE, true);
-            }
-            if (canUpdateTft) {
-                tftUpdated |= updateDisplayLine(nextLine, accLine1Tft, TFT_MAGENTA, false);
-            }
-            nextLine++;
-            
-            if (accLine2.length() > 0) {
-                if (canUpdateOled) {
-                    oledUpdated |= updateDisplayLine(nextLine, accLine2, SSD1306_WHITE, true);
-                }
-                if (canUpdateTft) {
-                    tftUpdated |= updateDisplayLine(nextLine, accLine2, TFT_MAGENTA, false);
-                }
-                nextLine++;
-            }
-        }
-        
-        // Строка спутников по системам - принудительное обновление для корректного отображения
-        String satLine = formatSatelliteString();
-        if (canUpdateOled) {
-            oledLines[nextLine].needsUpdate = true; // Принудительное обновление
-            oledUpdated |= updateDisplayLine(nextLine, satLine, SSD1306_WHITE, true);
-        }
-        if (canUpdateTft) {
-            tftLines[nextLine].needsUpdate = true; // Принудительное обновление
-            tftUpdated |= updateDisplayLine(nextLine, satLine, TFT_WHITE, false);
-        }
-        nextLine++;
-        
-        // Очищаем неиспользуемые строки
-        for (int i = nextLine; i < MAX_OLED_LINES; i++) {
-            if (canUpdateOled && oledLines[i].text.length() > 0) {
-                oledUpdated |= updateDisplayLine(i, "", SSD1306_WHITE, true);
-            }
-        }
-        for (int i = nextLine; i < MAX_TFT_LINES; i++) {
-            if (canUpdateTft && tftLines[i].text.length() > 0) {
-                tftUpdated |= updateDisplayLine(i, "", TFT_WHITE, false);
+        if (displayTexts.acc1[0][0] != '\0') {
+            frame.show(nextLine++, displayTexts.acc1[0], displayTexts.acc1[1], TFT_MAGENTA);
+            if (displayTexts.acc2[0] != '\0') {
+                frame.show(nextLine++, displayTexts.acc2, displayTexts.acc2, TFT_MAGENTA);
             }
         }
         
+        // Спутники по системам
+        frame.show(nextLine++, displayTexts.sats, displayTexts.sats, TFT_WHITE);
     } else {
         // GPS не валиден - отображаем статус поиска
+        frame.show(nextLine++, displayTexts.fix, displayTexts.fix, TFT_ORANGE);
         
-        // Строка 0: Тип фикса
-        String line0 = "Fix: " + getFixTypeString(gpsData.fixQuality);
-        if (canUpdateOled) {
-            oledUpdated |= updateDisplayLine(0, line0, SSD1306_WHITE, true);
-        }
-        if (canUpdateTft) {
-            tftUpdated |= updateDisplayLine(0, line0, TFT_ORANGE, false);
-        }
-        
-        int nextLine = 1;
-        
-        int totalUsedSats = satData.gps.used + satData.glonass.used + satData.galileo.used + satData.beidou.used + satData.qzss.used;
-        if (totalUsedSats > 0) {
-            // Строка 1: Количество спутников
-            String line1 = "Sats: " + String(totalUsedSats);
-            if (canUpdateOled) {
-                oledUpdated |= updateDisplayLine(nextLine, line1, SSD1306_WHITE, true);
-            }
-            if (canUpdateTft) {
-                tftUpdated |= updateDisplayLine(nextLine, line1, TFT_GREEN, false);
-            }
-            nextLine++;
-            
-            // Строка 2: Спутники по системам - принудительное обновление для корректного отображения
-            String satLine = formatSatelliteString();
-            if (canUpdateOled) {
-                oledLines[nextLine].needsUpdate = true; // Принудительное обновление
-                oledUpdated |= updateDisplayLine(nextLine, satLine, SSD1306_WHITE, true);
-            }
-            if (canUpdateTft) {
-                tftLines[nextLine].needsUpdate = true; // Принудительное обновление
-                tftUpdated |= updateDisplayLine(nextLine, satLine, TFT_WHITE, false);
-            }
-            nextLine++;
+        if (displayData.sat.gps.used + displayData.sat.glonass.used + displayData.sat.galileo.used +
+            displayData.sat.beidou.used + displayData.sat.qzss.used > 0) {
+            frame.show(nextLine++, displayTexts.satCount, displayTexts.satCount, TFT_GREEN);
+            frame.show(nextLine++, displayTexts.sats, displayTexts.sats, TFT_WHITE);
         } else {
-            // Строка 1: Статус поиска
-            String line1 = "Searching GPS...";
-            if (canUpdateOled) {
-                oledUpdated |= updateDisplayLine(nextLine, line1, SSD1306_WHITE, true);
-            }
-            if (canUpdateTft) {
-                tftUpdated |= updateDisplayLine(nextLine, line1, TFT_BLUE, false);
-            }
-            nextLine++;
-        }
-        
-        // Очищаем неиспользуемые строки
-        for (int i = nextLine; i < MAX_OLED_LINES; i++) {
-            if (canUpdateOled && oledLines[i].text.length() > 0) {
-                oledUpdated |= updateDisplayLine(i, "", SSD1306_WHITE, true);
-            }
-        }
-        for (int i = nextLine; i < MAX_TFT_LINES; i++) {
-            if (canUpdateTft && tftLines[i].text.length() > 0) {
-                tftUpdated |= updateDisplayLine(i, "", TFT_WHITE, false);
-            }
+            frame.show(nextLine++, "Searching GPS...", "Searching GPS...", TFT_BLUE);
         }
     }
+    frame.clearFrom(nextLine);
     
-    // Обновляем дисплей если были изменения (независимо от частоты)
-    if (oledUpdated) {
-        display.display();
+    // Обновляем дисплей если были изменения (независимо от частоты): только изменённую область
+    if (frame.oledUpdated) {
+        flushOledDirty();
     }
     
     // Обновляем счетчик времени только при соблюдении интервала
-    if (canUpdateOled) {
+    if (frame.canUpdateOled) {
         lastOledUpdate = millis();
     }
     
     // TFT не требует дополнительного вызова display(), обновления происходят сразу
-    if (tftUpdated && canUpdateTft) {
+    if (frame.tftUpdated && frame.canUpdateTft) {
         lastTftUpdate = millis();
     }
 }
 
+// Задача дисплея: низкий приоритет, ввод/вывод I2C и SPI не задерживает приём и BLE
+void displayTask(void* parameter) {
+    Serial.println("Display Task started");
+    for (;;) {
+        updateDisplay();
+        vTaskDelay(pdMS_TO_TICKS(bridgeSettings.displayMs));  // $BRIDGE display_ms
+    }
+}
+
+// Задержка UART→потребитель за 10 секунд: p50/p99/max по гистограммам меток
+static void printSinkLatency(const char* sink, LatencyTracer& trace) {
+    LatencyHistogram h;
+    trace.takeHistogram(h);
+    if (h.samples == 0) return;
+    Serial.printf("LATENCY: %s p50 %lu us, p99 %lu us, max %lu us (%lu samples)\n", sink,
+                  (unsigned long)h.percentileUs(0.50f), (unsigned long)h.percentileUs(0.99f),
+                  (unsigned long)h.maxUs, (unsigned long)h.samples);
+}
+
+void reportLatency() {
+    static unsigned long lastReport = 0;
+    unsigned long now = millis();
+    if (now - lastReport < 10000) return;
+    lastReport = now;
+
+    printSinkLatency(DISPLAY_ENABLED ? "BLE (displays on)" : "BLE", bleTrace);
+    printSinkLatency("BLE position", blePriorityTrace);  // Полоса приоритета; пусто при ble_lanes OFF
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) {
+        char name[8];
+        snprintf(name, sizeof(name), "WiFi%d", i);
+        printSinkLatency(name, wifiTrace[i]);
+    }
+}
+
+#if LATENCY_TRACE
+// Трасса задержек в USB Serial: "LT,<потребитель>,<время отправки, мкс>,<задержка, мкс>";
+// потребитель 0 — BLE, 1..4 — WiFi клиенты, 5 — полоса приоритета BLE. Не больше 64 строк за вызов.
+void dumpLatencyTrace() {
+    LatencyTraceSample batch[64];
+    uint32_t dropped = 0;
+    size_t n = takeLatencyTrace(batch, 64, &dropped);
+    for (size_t i = 0; i < n; i++) {
+        Serial.printf("LT,%u,%lu,%lu\n", (unsigned)batch[i].sink, (unsigned long)batch[i].sentUs,
+                      (unsigned long)batch[i].latencyUs);
+    }
+    if (dropped > 0) Serial.printf("LT-DROPPED,%lu\n", (unsigned long)dropped);
+}
+#endif
+
+// ==============================================
+// UART LINK SETUP (auto-baud + high-speed negotiation)
+// ==============================================
+
+// Обёртка HardwareSerial для UartLinkNegotiator (см. uart_link.h)
+struct Um980SerialPort {
+    bool started = false;
+
+    void begin(uint32_t baud) {
+        if (started) SerialPort.end();
+        // Размеры буферов драйвера задаются только до begin()
+        SerialPort.setRxBufferSize(uartRxBufferForBaud(baud));
+        SerialPort.setTxBufferSize(1024);  // NTRIP поправки не блокируют цикл
+        SerialPort.begin(baud, SERIAL_8N1, UART_RX_PIN, UART_TX_PIN);
+        // На 921600 аппаратный FIFO (128 байт) заполняется за 1.4 мс — прерывание
+        // по половине FIFO оставляет запас на задержки от BLE/WiFi прерываний
+        uart_set_rx_full_threshold(UART_NUM_1, baud >= 921600 ? 64 : 112);
+        uart_set_rx_timeout(UART_NUM_1, 2);
+        // S3: те же прерывания будят dataTask вместо опроса
+        if (BoardProfile::DUAL_CORE) SerialPort.onReceive(onUartReceive);
+        started = true;
+    }
+
+    size_t read(uint8_t* buf, size_t maxLen) {
+        int avail = SerialPort.available();
+        if (avail <= 0) return 0;
+        size_t n = ((size_t)avail > maxLen) ? maxLen : (size_t)avail;
+        return SerialPort.readBytes(buf, n);
+    }
+
+    void write(const uint8_t* data, size_t len) { SerialPort.write(data, len); }
+    unsigned long millis() { return ::millis(); }
+    void delay(unsigned long ms) { ::delay(ms); }
+};
+
+static Um980SerialPort um980Port;
+static OutputProfilePusher<Um980SerialPort> profilePusher(um980Port);
+static const OutputProfile* outputProfile = nullptr;
+static UartLinkWatch uartLinkWatch(UART_SILENCE_RELINK_MS, UART_GARBAGE_RELINK_MS);
+static bool uartLinkWatched = false;  // Без SYNTH_LOAD_TEST: UART настроен в setupUartLink()
+
+// Записи потока UART: с проверенной целостностью и остальные (мусор на чужой скорости)
+static void uartRecordCounts(uint32_t& good, uint32_t& bad) {
+    uint32_t total = 0;
+    for (int t = 0; t < ST_COUNT; t++) total += bridgeCounters.records[t];
+    good = bridgeCounters.verifiedRecords;
+    bad = total - good;
+}
+
+static void startUartWatch() {
+    uint32_t good, bad;
+    uartRecordCounts(good, bad);
+    uartLastRxMs = millis();
+    uartLinkWatch.reset(uartLastRxMs, good, bad);
+    uartLinkWatched = true;
+}
+
+// Определение скорости и переход на целевую; first — проверить первой
+static void linkUart(uint32_t first) {
+    UartLinkNegotiator<Um980SerialPort> link(um980Port);
+
+    uint32_t detected = link.detect(400, first);
+    if (detected == 0) {
+        um980Port.begin(UART_DEFAULT_BAUD);
+        uartLinkBaud = UART_DEFAULT_BAUD;
+        Serial.printf("UART: receiver not detected, using %lu baud\n", (unsigned long)uartLinkBaud);
+        return;
+    }
+    Serial.printf("UART: receiver detected at %lu baud\n", (unsigned long)detected);
+
+    uint32_t baud = link.negotiate(detected, UART_TARGET_BAUD);
+    if (UART_TARGET_BAUD != 0 && baud != UART_TARGET_BAUD) {
+        Serial.printf("UART: switch to %lu baud failed, staying at %lu\n",
+                      (unsigned long)UART_TARGET_BAUD, (unsigned long)baud);
+    } else if (baud != detected) {
+        Serial.printf("UART: receiver switched to %lu baud\n", (unsigned long)baud);
+    }
+    uartLinkBaud = baud;
+    Serial.printf("UART: RX buffer %u bytes\n", (unsigned)uartRxBufferForBaud(baud));
+}
+
+void setupUartLink() {
+    linkUart(0);
+    startUartWatch();
+}
+
+void setupOutputProfile() {
+    outputProfile = findOutputProfile(UM980_OUTPUT_PROFILE);
+    if (!outputProfile) {
+        if (strcmp(UM980_OUTPUT_PROFILE, "none") != 0) {
+            Serial.printf("UART: unknown output profile '%s', receiver output unchanged\n", UM980_OUTPUT_PROFILE);
+        }
+        return;
+    }
+    Serial.printf("UART: pushing output profile '%s' (%u logs)\n",
+                  outputProfile->name, (unsigned)outputProfile->count);
+    profilePusher.start(outputProfile);
+}
+
+bool handleOutputProfileResponse(const uint8_t* rec, size_t len) {
+    return profilePusher.onResponse(rec, len);
+}
+
+// Повторная установка связи после перезагрузки приёмника: CONFIG не сохранён,
+// и приёмник вернулся на прежнюю скорость. Поиск блокирует поток приёма до
+// ~3 с — данных, кроме мусора, всё равно нет. Профиль отправляется заново
+// уже на найденной скорости.
+void serviceUartLink() {
+    if (!uartLinkWatched) return;
+    uint32_t good, bad;
+    uartRecordCounts(good, bad);
+    if (!uartLinkWatch.lost(millis(), uartLastRxMs, good, bad)) return;
+
+    Serial.printf("UART: receiver link lost at %lu baud, re-detecting\n", (unsigned long)uartLinkBaud);
+    linkUart(uartLinkBaud);
+    if (!BoardProfile::DUAL_CORE) updateLoopPassBudget();  // Скорость могла смениться
+    uartFramer.reset();
+    startUartWatch();
+    if (outputProfile) {
+        Serial.printf("UART: re-pushing profile '%s'\n", outputProfile->name);
+        profilePusher.start(outputProfile);
+    }
+}
+
+// Отправка профиля по шагам
+void serviceOutputProfile() {
+    if (!outputProfile) return;
+    static uint8_t lastStatus = OutputProfilePusher<Um980SerialPort>::IDLE;
+
+    unsigned long now = millis();
+    profilePusher.poll(now);
+
+    uint8_t status = profilePusher.status();
+    if (status != lastStatus) {
+        if (status == OutputProfilePusher<Um980SerialPort>::DONE) {
+            Serial.printf("UART: output profile '%s' applied\n", outputProfile->name);
+        } else if (status == OutputProfilePusher<Um980SerialPort>::FAILED) {
+            Serial.printf("WARNING: output profile '%s': %u commands not acknowledged\n",
+                          outputProfile->name, (unsigned)profilePusher.failedCommands());
+        }
+        lastStatus = status;
+    }
+}
+
+// Загрузка линии UART (8N1 = 10 бит на байт), раз в 10 секунд
+void reportUartUtilisation() {
+    static unsigned long lastReport = 0;
+    static uint32_t lastBytes = 0;
+
+    unsigned long now = millis();
+    if (now - lastReport < 10000) return;
+
+    uint32_t bytes = uartBytesIn;
+    float bytesPerSec = (bytes - lastBytes) * 1000.0f / (now - lastReport);
+    float utilisation = bytesPerSec * 10.0f * 100.0f / uartLinkBaud;
+    Serial.printf("UART: %.0f B/s, line utilisation %.1f%% at %lu baud\n",
+                  bytesPerSec, utilisation, (unsigned long)uartLinkBaud);
+    if (utilisation > 80.0f) {
+        Serial.println("WARNING: UART line close to saturation");
+    }
+
+    lastReport = now;
+    lastBytes = bytes;
+}
+
+// ==============================================
+// SYNTHETIC LOAD TEST
+// ==============================================
+// -DSYNTH_LOAD_TEST=1: поток приёмника заменяется генератором (gnss_synth.h),
+// UART1 не используется. Нагрузка растёт ступенями: на ступени N частота эпох
+// и объём RTCM в N раз выше базовых. Пока подключен клиент, раз в ступень
+// печатается фактический вход и отправка BLE; первая ступень с перезаписью
+// очереди BLE или WiFi — предел моста, на ней нагрузка и остаётся.
+
+#ifndef SYNTH_LOAD_TEST
+#define SYNTH_LOAD_TEST 0
+#endif
+
+#if SYNTH_LOAD_TEST
+#ifndef SYNTH_EPOCH_HZ
+#define SYNTH_EPOCH_HZ 5          // Базовая частота GGA/GNS/GST
+#endif
+#ifndef SYNTH_CONSTELLATIONS
+#define SYNTH_CONSTELLATIONS 4
+#endif
+#ifndef SYNTH_SATS
+#define SYNTH_SATS 10             // На созвездие
+#endif
+#ifndef SYNTH_RTCM_BPS
+#define SYNTH_RTCM_BPS 2000       // Базовый объём MSM7, байт/с
+#endif
+#ifndef SYNTH_STEP_MS
+#define SYNTH_STEP_MS 10000
+#endif
+#define SYNTH_MAX_LEVEL 50
+
+static SynthSource synthSource;
+static uint8_t synthLevel = 1;
+
+static SynthConfig synthConfigForLevel(uint8_t level) {
+    SynthConfig cfg;
+    cfg.epochHz = SYNTH_EPOCH_HZ * level;
+    cfg.constellations = SYNTH_CONSTELLATIONS;
+    cfg.satsPerConstellation = SYNTH_SATS;
+    cfg.rtcmBytesPerSec = (uint32_t)SYNTH_RTCM_BPS * level;
+    return cfg;
+}
+
+void synthLoadBegin() {
+    synthSource.begin(synthConfigForLevel(synthLevel), micros());
+    Serial.printf("SYNTH: load test, UART1 bypassed; %d Hz x %d constellations x %d sats + %d B/s RTCM per level\n",
+                  SYNTH_EPOCH_HZ, SYNTH_CONSTELLATIONS, SYNTH_SATS, SYNTH_RTCM_BPS);
+}
+
+// Ступени нагрузки и отчёт; без клиентов очереди не наполняются — ждём
+void serviceSynthLoad() {
+    static unsigned long stepStart = 0;
+    static uint64_t producedAtStart = 0;
+    static uint32_t bleOutAtStart = 0;
+    static uint32_t bleLostAtStart = 0, wifiLostAtStart = 0;
+    static bool saturated = false;
+
+    unsigned long now = millis();
+    bool anyClient = deviceConnected;
+    for (int i = 0; i < MAX_WIFI_CLIENTS; i++) anyClient |= wifiClientConnected[i];
+    if (!anyClient || stepStart == 0) {
+        stepStart = now;
+        producedAtStart = synthSource.produced;
+        bleOutAtStart = bleDequeuedTotal + blePriorityDequeuedTotal;
+        bleLostAtStart = bleOverflowEvents;
+        wifiLostAtStart = wifiOverflowEvents;
+        return;
+    }
+    if (now - stepStart < SYNTH_STEP_MS) return;
+
+    float secs = (now - stepStart) / 1000.0f;
+    float inRate = (synthSource.produced - producedAtStart) / secs;
+    float bleRate = (uint32_t)(bleDequeuedTotal + blePriorityDequeuedTotal - bleOutAtStart) / secs;
+    uint32_t bleLost = bleOverflowEvents - bleLostAtStart;
+    uint32_t wifiLost = wifiOverflowEvents - wifiLostAtStart;
+    Serial.printf("SYNTH: level %u (%u Hz): in %.0f B/s, BLE out %.0f B/s, overflows BLE %u WiFi %u\n",
+                  (unsigned)synthLevel, (unsigned)synthSource.generator().config().epochHz, inRate, bleRate,
+                  (unsigned)bleLost, (unsigned)wifiLost);
+
+    if (!saturated && (bleLost || wifiLost)) {
+        saturated = true;
+        Serial.printf("SYNTH: first %s queue overflow at level %u, sustained input %.0f B/s\n",
+                      bleLost ? "BLE" : "WiFi", (unsigned)synthLevel, inRate);
+    } else if (!saturated && synthLevel < SYNTH_MAX_LEVEL) {
+        synthLevel++;
+        synthSource.begin(synthConfigForLevel(synthLevel), micros());
+    }
+
+    stepStart = now;
+    producedAtStart = synthSource.produced;
+    bleOutAtStart = bleDequeuedTotal + blePriorityDequeuedTotal;
+    bleLostAtStart = bleOverflowEvents;
+    wifiLostAtStart = wifiOverflowEvents;
+}
+#endif
+
+// ==============================================
+// MICROBENCHMARKS
+// ==============================================
+// -DMICRO_BENCH=1: строка "bench [фильтр]" в USB Serial запускает набор из
+// micro_bench.h на плате (счётчик тактов ESP.getCycleCount()) и печатает JSON
+// между строками BENCH-BEGIN и BENCH-END — его сравнивает с хостом
+// tools/micro_bench.cpp --compare. Прогон идёт в потоке приёма и длится около
+// секунды: UART на это время не читается, очереди клиентов не пополняются.
+
+#if MICRO_BENCH
+#ifndef MICRO_BENCH_MIN_MS
+#define MICRO_BENCH_MIN_MS 20
+#endif
+
+struct BoardBenchClock {
+    uint32_t cycles() { return ESP.getCycleCount(); }
+    uint64_t nanos() { return (uint64_t)esp_timer_get_time() * 1000; }
+};
+
+static void runBoardMicroBench(const char* filter) {
+    static char line[512];
+    BoardBenchClock clock;
+    bool first = true;
+    Serial.println("BENCH-BEGIN");
+    microBenchJsonHeader(line, sizeof(line), BoardProfile::DUAL_CORE ? "esp32-s3" : "esp32-c3",
+                         ESP.getCpuFreqMHz());
+    Serial.print(line);
+    runMicroBenchmarks(clock, (uint64_t)MICRO_BENCH_MIN_MS * 1000000ULL, filter, [&](const MicroBenchResult& r) {
+        microBenchJson(line, sizeof(line), r, first);
+        first = false;
+        Serial.print(line);
+        delay(1);  // Отдаём процессор IDLE, иначе сработает task watchdog
+    });
+    Serial.print(microBenchJsonFooter);
+    Serial.println("BENCH-END");
+}
+#endif
+
+// ==============================================
+// FLASH LOG
+// ==============================================
+// -DFLASH_LOG=1: сырой поток UART в LittleFS (раздел spiffs) сегментами
+// FLASH_LOG_DIR/NNNNNN.uml (flash_log.h). Приём только кладёт записи в
+// кольцо; задача flashLogTask с приоритетом дисплея пишет их во флеш
+// порциями по странице и отдаёт сегменты по TCP порту FLASH_LOG_PORT:
+//   LIST\n     строка на сегмент: номер, байт, дата и время UTC, смещение в
+//              потоке, смещение и начало первого предложения; в конце END
+//   GET <n>\n  файл сегмента целиком, с индексом в начале, затем разрыв
+// Выгрузка идёт по странице между записями и запись не задерживает. Когда
+// место на разделе кончается, удаляются самые старые сегменты.
+
+TaskHandle_t flashLogTaskHandle = NULL;  // Только с -DFLASH_LOG=1
+
+#if FLASH_LOG
+#define FLASH_LOG_PORT 2324
+#define FLASH_LOG_DIR "/log"
+#define FLASH_LOG_TASK_STACK 6144
+#define FLASH_LOG_TASK_PRIORITY tskIDLE_PRIORITY  // Как дисплей: ниже приёма и BLE
+#define FLASH_LOG_RESERVE_BYTES (2 * FLASH_LOG_SEGMENT_BYTES)  // Запас LittleFS под метаданные
+
+static WiFiServer flashLogServer(FLASH_LOG_PORT);
+static WiFiClient flashLogClient;
+static File flashLogFile;      // Сегмент, который пишется
+static File flashLogDownload;  // Сегмент, который выгружается
+static uint32_t flashLogOldest = 0, flashLogNext = 0;  // Сегменты на флеш: [oldest, next)
+
+static void flashLogPath(char* out, size_t cap, uint32_t segment) {
+    snprintf(out, cap, FLASH_LOG_DIR "/%06lu.uml", (unsigned long)segment);
+}
+
+// Уже записанные сегменты: нумерация продолжается после перезапуска
+static void scanFlashLog() {
+    File dir = LittleFS.open(FLASH_LOG_DIR);
+    bool any = false;
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+        uint32_t n = (uint32_t)strtoul(f.name(), NULL, 10);
+        if (!any || n < flashLogOldest) flashLogOldest = n;
+        if (!any || n >= flashLogNext) flashLogNext = n + 1;
+        any = true;
+    }
+}
+
+// Новый файл сегмента; старые удаляются, пока ему не хватает места
+static void openFlashLogSegment(uint32_t segment) {
+    char path[24];
+    if (flashLogFile) flashLogFile.close();
+    while (flashLogOldest < segment &&
+           LittleFS.usedBytes() + FLASH_LOG_SEGMENT_BYTES + FLASH_LOG_RESERVE_BYTES > LittleFS.totalBytes()) {
+        flashLogPath(path, sizeof(path), flashLogOldest++);
+        if (LittleFS.remove(path)) flashLog.segmentsDeleted++;
+    }
+    flashLogPath(path, sizeof(path), segment);
+    flashLogFile = LittleFS.open(path, "w");
+    flashLogNext = segment + 1;
+    flashLog.segmentsOpened++;
+    if (!flashLogFile) Serial.printf("WARNING: cannot create %s\n", path);
+}
+
+static void listFlashLog(WiFiClient& client) {
+    char path[24], line[128];
+    uint8_t head[FLASH_LOG_HEADER_BYTES];
+    for (uint32_t n = flashLogOldest; n < flashLogNext; n++) {
+        flashLogPath(path, sizeof(path), n);
+        File f = LittleFS.open(path, "r");
+        FlashLogHeader h;
+        if (!f || !flashLogDecodeHeader(head, f.read(head, sizeof(head)), h)) continue;
+        int len = snprintf(line, sizeof(line), "%lu %lu %06lu %06lu %llu %u %s\r\n", (unsigned long)n,
+                           (unsigned long)f.size(), (unsigned long)h.utcDate, (unsigned long)h.utcTime,
+                           (unsigned long long)h.streamOffset, (unsigned)h.firstSentence, h.sentence);
+        client.write((const uint8_t*)line, len);
+    }
+    client.write((const uint8_t*)"END\r\n", 5);
+}
+
+// Команда клиента выгрузки или следующая страница сегмента
+static void serviceFlashLogPort(uint8_t* buf) {
+    static char cmd[32];
+    static size_t cmdLen = 0;
+    if (flashLogServer.hasClient()) {
+        if (flashLogClient) flashLogClient.stop();
+        if (flashLogDownload) flashLogDownload.close();
+        flashLogClient = flashLogServer.available();
+        cmdLen = 0;
+    }
+    if (!flashLogClient || !flashLogClient.connected()) return;
+    if (flashLogDownload) {
+        size_t n = flashLogDownload.read(buf, FLASH_LOG_PAGE_BYTES);
+        if (n > 0) flashLogClient.write(buf, n);
+        if (n < FLASH_LOG_PAGE_BYTES) {
+            flashLogDownload.close();
+            flashLogClient.stop();
+        }
+        return;
+    }
+    while (flashLogClient.available()) {
+        int c = flashLogClient.read();
+        if (c != '\n') {
+            if (c != '\r' && cmdLen < sizeof(cmd) - 1) cmd[cmdLen++] = (char)c;
+            continue;
+        }
+        cmd[cmdLen] = '\0';
+        cmdLen = 0;
+        if (strcmp(cmd, "LIST") == 0) {
+            listFlashLog(flashLogClient);
+        } else if (strncmp(cmd, "GET ", 4) == 0) {
+            char path[24];
+            uint32_t n = (uint32_t)strtoul(cmd + 4, NULL, 10);
+            if (flashLogFile && n + 1 == flashLogNext) flashLogFile.flush();  // Текущий сегмент: до последней страницы
+            flashLogPath(path, sizeof(path), n);
+            flashLogDownload = LittleFS.open(path, "r");
+            if (!flashLogDownload) flashLogClient.write((const uint8_t*)"ERR\r\n", 5);
+            return;
+        } else {
+            flashLogClient.write((const uint8_t*)"ERR\r\n", 5);
+        }
+    }
+}
+
+// Запись во флеш — первой: выгрузка уступает ей после каждой страницы
+static void flashLogTask(void* parameter) {
+    static uint8_t buf[FLASH_LOG_PAGE_BYTES];
+    for (;;) {
+        FlashLogBatch b;
+        while (flashLog.takeBatch(buf, millis(), b) > 0) {
+            if (b.segmentStart) openFlashLogSegment(b.segment);
+            uint32_t startUs = micros();
+            size_t written = flashLogFile ? flashLogFile.write(buf, b.len) : 0;
+            // Неполная страница — сброс по FLASH_LOG_FLUSH_MS: пусть переживёт отключение питания
+            if (written && flashLogFile.position() % FLASH_LOG_PAGE_BYTES != 0) flashLogFile.flush();
+            flashLog.noteWrite(micros() - startUs, b.len, written == b.len);
+        }
+        serviceFlashLogPort(buf);
+        vTaskDelay(flashLogDownload ? 1 : pdMS_TO_TICKS(20));
+    }
+}
+
+static void setupFlashLog() {
+    if (!LittleFS.begin(true)) {
+        Serial.println("WARNING: LittleFS mount failed, flash log disabled");
+        return;
+    }
+    LittleFS.mkdir(FLASH_LOG_DIR);
+    scanFlashLog();
+    uint8_t* stage = (uint8_t*)malloc(FLASH_LOG_STAGE_BYTES);
+    if (!stage) {
+        Serial.println("WARNING: no memory for flash log stage, flash log disabled");
+        return;
+    }
+    flashLog.begin(stage, FLASH_LOG_STAGE_BYTES, flashLogNext);
+    flashLogServer.begin();
+    xTaskCreatePinnedToCore(flashLogTask, "FlashLog_Task", FLASH_LOG_TASK_STACK, NULL, FLASH_LOG_TASK_PRIORITY,
+                            &flashLogTaskHandle, BoardProfile::DISPLAY_TASK_CORE);
+    Serial.printf("Flash log: %lu of %lu KB used, segments %lu.. on TCP port %d\n",
+                  (unsigned long)(LittleFS.usedBytes() / 1024), (unsigned long)(LittleFS.totalBytes() / 1024),
+                  (unsigned long)flashLogNext, FLASH_LOG_PORT);
+}
+
+// Строки для порта статуса: объём, потери кольца и время записи во флеш
+static size_t formatFlashLog(char* out, size_t cap) {
+    const LatencyHistogram& t = flashLog.writeTime;
+    size_t n = telemetryAppend(out, 0, cap, "flash_log segments %lu..%lu written %llu B writes %lu errors %lu\r\n",
+                               (unsigned long)flashLogOldest, (unsigned long)flashLogNext,
+                               (unsigned long long)flashLog.bytesWritten, (unsigned long)flashLog.writes,
+                               (unsigned long)flashLog.writeErrors);
+    n = telemetryAppend(out, n, cap, "flash_log_write_ms p50 %lu p99 %lu max %lu\r\n",
+                        (unsigned long)(t.percentileUs(0.5f) / 1000), (unsigned long)(t.percentileUs(0.99f) / 1000),
+                        (unsigned long)(t.maxUs / 1000));
+    return telemetryAppend(out, n, cap,
+                           "flash_log_stage pending %lu high_water %lu dropped_records %lu record_max_us %lu\r\n",
+                           (unsigned long)flashLog.pending(), (unsigned long)flashLog.stageHighWater,
+                           (unsigned long)flashLog.droppedRecords, (unsigned long)flashLog.recordMaxUs);
+}
+#endif
+
+// ==============================================
+// TASK PROFILING
+// ==============================================
+// -DTASK_PROFILE=1: раз в TASK_PROFILE_PERIOD_MS поток приёма снимает профиль
+// задач и кучи (task_profile.h): долю CPU, минимум свободного стека, свободную
+// кучу, наибольший блок и фрагментацию. Отчёт — команда "prof" в USB Serial и
+// TCP порт статуса вслед за телеметрией; по нему подбираются стеки и
+// приоритеты задач в board_profile.h.
+
+#ifndef TASK_PROFILE
+#define TASK_PROFILE 0
+#endif
+
+#if TASK_PROFILE
+#ifndef TASK_PROFILE_PERIOD_MS
+#define TASK_PROFILE_PERIOD_MS 5000
+#endif
+
+static TaskProfile taskProfile;  // Опубликованный профиль: копируется под profileMux
+static portMUX_TYPE profileMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t loopTaskSeen = NULL;  // loop() запоминает свою задачу
+
+// Задача конвейера с замером итераций или -1
+static int pipelineTaskOf(TaskHandle_t handle) {
+    if (handle == NULL) return -1;
+    if (handle == loopTaskSeen) return TASK_LOOP;
+    if (handle == dataTaskHandle) return TASK_DATA;
+    if (handle == bleTaskHandle) return TASK_BLE;
+    return -1;
+}
+
+static void fillTaskEntry(TaskProfileEntry& e, TaskHandle_t handle, const char* name, UBaseType_t priority,
+                          uint32_t stackFree, int core) {
+    strncpy(e.name, name, sizeof(e.name) - 1);
+    e.name[sizeof(e.name) - 1] = '\0';
+    e.stackFree = stackFree;  // ESP-IDF считает стек в байтах
+    e.priority = (uint8_t)priority;
+    e.core = (int8_t)core;
+    int task = pipelineTaskOf(handle);
+    e.hasRunTime = (task >= 0);
+    e.runTimeUs = (task >= 0) ? bridgeCounters.busyUs[task] : 0;
+}
+
+// Все задачи FreeRTOS, а без trace facility — только задачи моста
+static size_t collectTasks(TaskProfileEntry* out, bool& runTimeStats) {
+    runTimeStats = false;
+#if configUSE_TRACE_FACILITY
+    static TaskStatus_t status[TASK_PROFILE_MAX_TASKS];
+    UBaseType_t n = uxTaskGetSystemState(status, TASK_PROFILE_MAX_TASKS, NULL);  // 0, если задач больше
+    for (UBaseType_t i = 0; i < n; i++) {
+#if configTASKLIST_INCLUDE_COREID
+        int core = (status[i].xCoreID == tskNO_AFFINITY) ? -1 : (int)status[i].xCoreID;
+#else
+        int core = -1;
+#endif
+        fillTaskEntry(out[i], status[i].xHandle, status[i].pcTaskName, status[i].uxCurrentPriority,
+                      status[i].usStackHighWaterMark, core);
+#if configGENERATE_RUN_TIME_STATS
+        out[i].runTimeUs = status[i].ulRunTimeCounter;
+        out[i].hasRunTime = true;
+        runTimeStats = true;
+#endif
+    }
+    return n;
+#else
+    TaskHandle_t handles[] = {loopTaskSeen, dataTaskHandle, bleTaskHandle, displayTaskHandle, flashLogTaskHandle};
+    size_t n = 0;
+    for (size_t i = 0; i < sizeof(handles) / sizeof(handles[0]); i++) {
+        if (handles[i] == NULL) continue;
+        fillTaskEntry(out[n++], handles[i], pcTaskGetName(handles[i]), uxTaskPriorityGet(handles[i]),
+                      uxTaskGetStackHighWaterMark(handles[i]), -1);
+    }
+    return n;
+#endif
+}
+
+static void sampleTaskProfile() {
+    static unsigned long lastSample = 0;
+    static TaskProfile working;  // Считается без блокировки, публикуется копией
+    static TaskProfileEntry entries[TASK_PROFILE_MAX_TASKS];
+    unsigned long now = millis();
+    if (lastSample != 0 && now - lastSample < TASK_PROFILE_PERIOD_MS) return;
+    lastSample = now;
+
+    bool runTimeStats = false;
+    size_t n = collectTasks(entries, runTimeStats);
+    working.updateTasks(entries, n, micros(), runTimeStats);
+    const uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    working.addHeap(now, heap_caps_get_free_size(caps), heap_caps_get_largest_free_block(caps),
+                    heap_caps_get_minimum_free_size(caps));
+
+    portENTER_CRITICAL(&profileMux);
+    taskProfile = working;
+    portEXIT_CRITICAL(&profileMux);
+}
+
+// Последний профиль текстом; out — не меньше 2048 байт
+static size_t formatTaskProfile(char* out, size_t cap) {
+    static TaskProfile snapshot;  // Вызывается из одной задачи за раз: поток приёма или loop()
+    portENTER_CRITICAL(&profileMux);
+    snapshot = taskProfile;
+    portEXIT_CRITICAL(&profileMux);
+    return taskProfileFormatText(out, cap, snapshot);
+}
+#endif
+
+// ==============================================
+// USB SERIAL COMMANDS
+// ==============================================
+// Строки из USB Serial читает поток приёма:
+//   bench [фильтр] — микробенчмарки (-DMICRO_BENCH=1)
+//   prof           — профиль задач и кучи (-DTASK_PROFILE=1)
+
+#if MICRO_BENCH || TASK_PROFILE
+void serviceSerialCommands() {
+    static char line[48];
+    static size_t len = 0;
+    while (Serial.available() > 0) {
+        char c = (char)Serial.read();
+        if (c != '\r' && c != '\n') {
+            if (len < sizeof(line) - 1) line[len++] = c;
+            continue;
+        }
+        line[len] = '\0';
+        len = 0;
+#if MICRO_BENCH
+        if (strncmp(line, "bench", 5) == 0 && (line[5] == '\0' || line[5] == ' ')) {
+            runBoardMicroBench(line[5] ? line + 6 : nullptr);
+        }
+#endif
+#if TASK_PROFILE
+        if (strcmp(line, "prof") == 0) {
+            static char text[2048];
+            size_t n = formatTaskProfile(text, sizeof(text));
+            Serial.write((const uint8_t*)text, n);
+        }
+#endif
+    }
+}
+#endif
+
+static void loadBridgeSettings();  // BRIDGE SETTINGS (NVS)
+
 void setup() {
     // Запускаем основной UART для логирования
     Serial.begin(460800);
@@ -1367,9 +1698,15 @@ void setup() {
     Serial.print("IP address: ");
     Serial.println(WiFi.softAPIP());
     Serial.println("WiFi server started on port 23");
+    statusServer.begin();
+    Serial.printf("Telemetry on TCP port %d\n", TELEMETRY_PORT);
+#if FLASH_LOG
+    setupFlashLog();
+#endif
 
     // Инициализация I2C и OLED дисплея
     Wire.begin(SDA_PIN, SCL_PIN);
+    Wire.setClock(OLED_I2C_CLOCK);
     if(!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS >> 1)) { // Адрес делим на 2!
         Serial.println("ERROR: SSD1306 allocation failed!");
     } else {
@@ -1407,6 +1744,15 @@ void setup() {
     TFT_SET_TEXT_SIZE(2);
     
     Serial.println("TFT Display initialized with Arduino_GFX!");
+
+    // Буфер строки TFT (240x20, 9.6 КБ): строка уходит одной передачей вместо
+    // посимвольной отрисовки мелкими окнами
+    tftLineCanvas = new GFXcanvas16(TFT_WIDTH_PX, TFT_LINE_HEIGHT);
+    if (!tftLineCanvas->getBuffer()) {
+        delete tftLineCanvas;
+        tftLineCanvas = nullptr;
+        Serial.println("WARNING: TFT line buffer allocation failed, drawing directly");
+    }
 #endif
     
     // Инициализируем состояния дисплеев для корректной работы частичных обновлений
@@ -1419,19 +1765,40 @@ void setup() {
     Serial.println("Addressable LED initialized on GP21");
 #endif
 
-    // Запускаем UART1 для передачи данных с условными пинами
-    SerialPort.begin(460800, SERIAL_8N1, UART_RX_PIN, UART_TX_PIN);
+#ifdef BOARD_HAS_PSRAM
+    // Архив потока для $BRIDGE,REPLAY — в PSRAM и до запуска UART, чтобы писать с первой записи.
+    // PSRAM меньше архива (S3-Zero — 2 МБ): размер делится пополам, пока не поместится
+    size_t archiveBytes = STREAM_ARCHIVE_BYTES;
+    uint8_t* archiveMem = NULL;
+    for (; archiveBytes >= (256u << 10); archiveBytes /= 2) {
+        archiveMem = (uint8_t*)heap_caps_malloc(StreamArchive::footprint(archiveBytes), MALLOC_CAP_SPIRAM);
+        if (archiveMem) break;
+    }
+    if (archiveMem) {
+        streamArchive.begin(archiveMem, archiveBytes);
+        Serial.printf("Stream archive: %u KB in PSRAM\n", (unsigned)(streamArchive.capacity() / 1024));
+    } else {
+        Serial.println("WARNING: no PSRAM for stream archive, REPLAY disabled");
+    }
+#endif
 
-    // Инициализация BLE
-#ifdef ESP32_S3
-    NimBLEDevice::init("UM980_S3_GPS");
+    // Запускаем UART1: определяем скорость приёмника и поднимаем её до целевой
+#if SYNTH_LOAD_TEST
+    synthLoadBegin();
 #else
-    NimBLEDevice::init("UM980_C3_GPS");
+    setupUartLink();
+    setupOutputProfile();
 #endif
+    if (!BoardProfile::DUAL_CORE) setupLoopScheduler();
 
+    // Инициализация BLE
+    NimBLEDevice::init(BoardProfile::deviceName());
 
-    // Увеличиваем MTU для максимальной скорости
-    NimBLEDevice::setMTU(517);
+    // Настройки $BRIDGE из NVS: MTU (517 по умолчанию — максимальная скорость),
+    // правила отправки BLE; фильтры и периоды читаются из bridgeSettings на месте
+    loadBridgeSettings();
+    applyQueuePolicy();
+    applyBridgeSettings(BRIDGE_ACTION_APPLY);
 
     // NEW: Set BLE TX power to the maximum (+9 dBm)
     NimBLEDevice::setPower(9); // 9 dBm - максимальная мощность
@@ -1461,6 +1828,13 @@ void setup() {
     );
     pTxCharacteristic->setCallbacks(new TxCallbacks());
 
+    // Создание TXZ-характеристики (тот же поток в сжатом виде, по подписке)
+    pTxzCharacteristic = pService->createCharacteristic(
+        CHARACTERISTIC_UUID_TXZ,
+        BLE_GATT_CHR_PROP_NOTIFY
+    );
+    pTxzCharacteristic->setCallbacks(new TxzCallbacks());
+
     // Создание RX-характеристики (для приёма данных с телефона)
     NimBLECharacteristic *pRxCharacteristic = pService->createCharacteristic(
         CHARACTERISTIC_UUID_RX,
@@ -1468,62 +1842,75 @@ void setup() {
     );
     pRxCharacteristic->setCallbacks(new RxCallbacks());
 
+    // Создание характеристики статистики (телеметрия конвейера, только чтение)
+    NimBLECharacteristic *pStatsCharacteristic = pService->createCharacteristic(
+        CHARACTERISTIC_UUID_STATS,
+        BLE_GATT_CHR_PROP_READ
+    );
+    pStatsCharacteristic->setCallbacks(new StatsCallbacks());
+
 
     // Запуск сервиса
     pService->start();
 
     // Настройка и запуск advertising
     NimBLEAdvertising *pAdvertising = NimBLEDevice::getAdvertising();
-#ifdef ESP32_S3
-    pAdvertising->setName("UM980_S3_GPS");
-#else
-    pAdvertising->setName("UM980_C3_GPS");
-#endif
+    pAdvertising->setName(BoardProfile::deviceName());
     pAdvertising->addServiceUUID(SERVICE_UUID);
     pAdvertising->enableScanResponse(true);
-    // Оптимальные интервалы для NTRIP потока
-#ifdef ESP32_S3
-    // ESP32-S3: Более агрессивные интервалы для максимальной скорости
-    pAdvertising->setPreferredParams(0x03, 0x06); // 3.75-7.5ms интервал (двойная скорость)
-#else
-    pAdvertising->setPreferredParams(0x06, 0x0C); // 7.5-15ms интервал для ESP32-C3
-#endif
+    // Оптимальные интервалы для NTRIP потока (на S3 вдвое короче)
+    pAdvertising->setPreferredParams(BoardProfile::ADV_INTERVAL_MIN, BoardProfile::ADV_INTERVAL_MAX);
     NimBLEDevice::startAdvertising();
     Serial.println("Advertising started. Waiting for a client connection...");
     
-#ifdef ESP32_S3
-    // ESP32-S3: Запускаем многопоточность
-    Serial.println("ESP32-S3 detected: Starting dual-core tasks...");
-    
-    // КРИТИЧНО: Устанавливаем флаги перед созданием задач
-    bleTaskRunning = true;
-    dataTaskRunning = true;
-    
-    // BLE задача на ядре 0 (отправка)
-    xTaskCreatePinnedToCore(
-        bleTask,           // Функция задачи
-        "BLE_Task",        // Имя
-        8192,              // Размер стека
-        NULL,              // Параметры
-        2,                 // Приоритет (высокий для BLE)
-        &bleTaskHandle,    // Хэндл
-        0                  // Ядро 0
-    );
-    
-    // Задача обработки данных на ядре 1 (прием, парсинг)
+    if (BoardProfile::DUAL_CORE) {
+        // ESP32-S3: Запускаем многопоточность
+        Serial.println("ESP32-S3 detected: Starting dual-core tasks...");
+
+        // КРИТИЧНО: Устанавливаем флаги перед созданием задач
+        bleTaskRunning = true;
+        dataTaskRunning = true;
+
+        // BLE задача (отправка)
+        xTaskCreatePinnedToCore(
+            bleTask,                           // Функция задачи
+            "BLE_Task",                        // Имя
+            BoardProfile::BLE_TASK_STACK,      // Размер стека
+            NULL,                              // Параметры
+            BoardProfile::BLE_TASK_PRIORITY,   // Приоритет (высокий для BLE)
+            &bleTaskHandle,                    // Хэндл
+            BoardProfile::BLE_TASK_CORE        // Ядро 0
+        );
+
+        // Задача обработки данных (прием, парсинг)
+        xTaskCreatePinnedToCore(
+            dataTask,                          // Функция задачи
+            "Data_Task",                       // Имя
+            BoardProfile::DATA_TASK_STACK,     // Размер стека
+            NULL,                              // Параметры
+            BoardProfile::DATA_TASK_PRIORITY,  // Приоритет (нормальный)
+            &dataTaskHandle,                   // Хэндл
+            BoardProfile::DATA_TASK_CORE       // Ядро 1
+        );
+
+        Serial.println("Dual-core tasks started successfully!");
+    } else {
+        Serial.println("ESP32-C3: Running in single-core mode");
+    }
+
+#if DISPLAY_ENABLED
+    // Дисплеи: ядро 0 на ESP32-S3 (ядро 1 — приём), единственное ядро на C3
     xTaskCreatePinnedToCore(
-        dataTask,          // Функция задачи
-        "Data_Task",       // Имя
-        8192,              // Размер стека
-        NULL,              // Параметры
-        1,                 // Приоритет (нормальный)
-        &dataTaskHandle,   // Хэндл
-        1                  // Ядро 1
+        displayTask,                       // Функция задачи
+        "Display_Task",                    // Имя
+        BoardProfile::DISPLAY_TASK_STACK,  // Размер стека
+        NULL,                              // Параметры
+        DISPLAY_TASK_PRIORITY,             // Приоритет ниже приёма и BLE
+        &displayTaskHandle,                // Хэндл
+        BoardProfile::DISPLAY_TASK_CORE    // Ядро 0
     );
-    
-    Serial.println("Dual-core tasks started successfully!");
 #else
-    Serial.println("ESP32-C3: Running in single-core mode");
+    Serial.println("Displays disabled (DISPLAY_ENABLED=0)");
 #endif
 }
 
@@ -1546,233 +1933,152 @@ void checkDataTimeouts() {
     }
 }
 
-void loop() {
-#ifdef ESP32_S3
-    // На ESP32-S3 основная работа в отдельных задачах
-    // loop() только обрабатывает парсинг GPS, WiFi и дисплеи
-    static uint8_t uartReadBuffer[256];
-    
-    int bytesAvailable = SerialPort.available();
-    if (bytesAvailable > 0) {
-        int bytesToRead = (bytesAvailable > 256) ? 256 : bytesAvailable;
-        int bytesRead = SerialPort.readBytes(uartReadBuffer, bytesToRead);
-        
-        // Парсим GPS данные для дисплея (без записи в буфер - этим занимается dataTask)
-        for (int i = 0; i < bytesRead; i++) {
-            char c = uartReadBuffer[i];
-            
-            // Собираем NMEA строку для парсинга точности
-            nmeaBuffer += c;
-            if (c == '\n') {
-                parseNMEA(nmeaBuffer.c_str());
-                nmeaBuffer = "";
-            }
-            
-            // Парсим GPS данные через TinyGPS++
-            if (gps.encode(c)) {
-                if (gps.location.isValid()) {
-                    gpsData.latitude = gps.location.lat();
-                    gpsData.longitude = gps.location.lng();
-                    gpsData.valid = true;
-                    gpsData.lastUpdate = millis();
-                    if (tzAuto) {
-                        tzOffsetMinutes = estimateOffsetMinutesFromLongitude(gpsData.longitude);
-                    }
-                }
-            }
-        }
-    }
-    
-    // Обработка WiFi клиентов
-    handleWiFiClients();
-    
-    // Проверка таймаутов
-    checkDataTimeouts();
-    
-    // Обновление дисплеев
-    static unsigned long lastDisplayUpdate = 0;
-    if (millis() - lastDisplayUpdate > 1000) {
-        updateDisplay();
-        lastDisplayUpdate = millis();
-    }
-    
-    delay(1);  // Минимальная задержка
-    
-#else
-    // ESP32-C3: Полная обработка в одном потоке
-    // Оптимизированное чтение и обработка GPS данных
-    static uint8_t uartReadBuffer[256]; // Буфер для пакетного чтения UART
-    
-    int bytesAvailable = SerialPort.available();
-    if (bytesAvailable > 0) {
-        // Читаем данные пакетами для лучшей производительности
-        int bytesToRead = (bytesAvailable > 256) ? 256 : bytesAvailable;
-        int bytesRead = SerialPort.readBytes(uartReadBuffer, bytesToRead);
-        
-        
-        // Записываем весь пакет в кольцевой буфер одной операцией
-        // Теперь записываем, если подключен хотя бы один из интерфейсов (BLE или WiFi)
-        bool hasAnyConnection = deviceConnected; // BLE connected
-        for (int i = 0; i < 4; i++) {
-            if (wifiClientConnected[i]) {
-                hasAnyConnection = true;
-                break;
-            }
-        }
-        
-        if (hasAnyConnection && bytesRead > 0) {
-            writeToRingBuffer(uartReadBuffer, bytesRead);
-        }
-        
-        // Обрабатываем каждый байт для парсинга GPS и NMEA
-        for (int i = 0; i < bytesRead; i++) {
-            char c = uartReadBuffer[i];
-            
-            // Собираем NMEA строку для парсинга точности
-            nmeaBuffer += c;
-            if (c == '\n') {
-                parseNMEA(nmeaBuffer.c_str());
-                nmeaBuffer = "";
-            }
-            
-            // Парсим GPS данные через TinyGPS++
-            if (gps.encode(c)) {
-                if (gps.location.isValid()) {
-                    gpsData.latitude = gps.location.lat();
-                    gpsData.longitude = gps.location.lng();
-                    gpsData.valid = true;
-                    gpsData.lastUpdate = millis();
-                    // Автоматическая коррекция часового пояса по долготе
-                    if (tzAuto) {
-                        tzOffsetMinutes = estimateOffsetMinutesFromLongitude(gpsData.longitude);
-                    }
-                }
-            }
-        }
-    }
-
-    // ОБРАБОТКА ВХОДЯЩИХ BLE RX ДАННЫХ (NTRIP поправки + команды)
-    // Обрабатываем в main loop, не блокируя BLE callback
-    size_t rxAvailable = bleRxBuffer.available();
-    if (rxAvailable > 0) {
-        size_t toRead = (rxAvailable > sizeof(rxTempBuffer)) ? sizeof(rxTempBuffer) : rxAvailable;
-        size_t rxRead = bleRxBuffer.read(rxTempBuffer, toRead);
-        
-        if (rxRead > 0) {
-            // Определяем тип данных:
-            // RTCM3 начинается с 0xD3 (211 decimal)
-            // ASCII команды начинаются с букв ($, #, A-Z, a-z)
-            bool isRTCM3 = (rxRead >= 3 && rxTempBuffer[0] == 0xD3);
-            bool isASCII = (rxRead > 0 && 
-                           (rxTempBuffer[0] == '$' || rxTempBuffer[0] == '#' || 
-                            (rxTempBuffer[0] >= 'A' && rxTempBuffer[0] <= 'Z') ||
-                            (rxTempBuffer[0] >= 'a' && rxTempBuffer[0] <= 'z')));
-            
-            // Отправляем данные в UART
-            SerialPort.write(rxTempBuffer, rxRead);
-            
-            // Добавляем \r\n только для ASCII команд
-            if (isASCII && !isRTCM3) {
-                SerialPort.write("\r\n");
+// ==============================================
+// BRIDGE PIPELINE
+// ==============================================
+// Стадии конвейера — bridge_pipeline.h; здесь только связь с периферией
+
+// TinyGPS++ получает поток побайтно (NMEA и бинарные логи — в routeUartChunk())
+static void decodeTinyGps(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (gps.encode((char)data[i]) && gps.location.isValid()) {
+            gpsData.latitude = gps.location.lat();
+            gpsData.longitude = gps.location.lng();
+            gpsData.valid = true;
+            gpsData.lastUpdate = millis();
+            // Автоматическая коррекция часового пояса по долготе
+            if (tzAuto) {
+                tzOffsetMinutes = estimateOffsetMinutesFromLongitude(gpsData.longitude);
             }
         }
     }
-    
-    // Обработка WiFi клиентов (проверяем подключения и получаем команды)
-    handleWiFiClients();
-
-    // Отправляем данные из кольцевого буфера через BLE и WiFi
-    bool hasAnyConnection = deviceConnected; // BLE connected
-    for (int i = 0; i < 4; i++) {
-        if (wifiClientConnected[i]) {
-            hasAnyConnection = true;
-            break;
-        }
-    }
+}
 
-    if (hasAnyConnection) {
-        size_t available = getRingBufferAvailable();
-        
-        // АГРЕССИВНАЯ отправка для максимальной пропускной способности:
-        // 1. Буфер содержит >= 400 байт - отправляем сразу
-        // 2. Есть данные и прошло > 7мс с последней отправки
-        // 3. Принудительная отправка через 20мс если есть любые данные
-        // 4. Критическая защита: при > 12KB принудительная отправка
-        if (available > 0) {
-            bool shouldSend = false;
-            unsigned long currentTime = millis();
-
-            if (available >= 12288) {
-                shouldSend = true; // КРИТИЧНО: буфер почти полон!
-                Serial.println("WARNING: Buffer near full, forcing send");
-            } else if (available >= 400) {
-                shouldSend = true; // Отправляем большие пакеты сразу
-#ifdef ESP32_S3
-            } else if (available > 0 && (currentTime - lastBleFlush > 4)) {
-                shouldSend = true; // ESP32-S3: отправка через 4мс (быстрее)
+struct FirmwareHal {
+#if SYNTH_LOAD_TEST
+    int uartAvailable() { return (int)synthSource.available(micros()); }
+    size_t uartRead(uint8_t* dst, size_t n) { return synthSource.read(dst, n, micros()); }
+    void uartWrite(const uint8_t*, size_t) {}  // Приёмника нет — поправки и команды отбрасываются
 #else
-            } else if (available > 0 && (currentTime - lastBleFlush > 7)) {
-                shouldSend = true; // ESP32-C3: отправка через 7мс
+    int uartAvailable() { return SerialPort.available(); }
+    size_t uartRead(uint8_t* dst, size_t n) { return SerialPort.readBytes(dst, n); }
+    void uartWrite(const uint8_t* src, size_t n) { SerialPort.write(src, n); }
 #endif
-            } else if (available > 0 && (currentTime - lastBleFlush > 20)) {
-                shouldSend = true; // Принудительная отправка через 20мс
-            }
+    void onUartChunk(const uint8_t* data, size_t n) {
+        // Раскладываем пакет по очередям подключенных потребителей (BLE/WiFi)
+        // целыми предложениями с учётом фильтра каждого потребителя
+        routeUartChunk(data, n);
+        decodeTinyGps(data, n);
+    }
+    size_t rxAvailable() { return bleRxBuffer.available(); }
+    size_t rxRead(uint8_t* dst, size_t n) { return bleRxBuffer.read(dst, n); }
+    void onControlCommand(const char* line, size_t len) { postControlCommand(CONTROL_SOURCE_BLE, line, len); }
+    bool bleConnected() { return deviceConnected; }
+    bool bleLinkReady() { return bleConnHandle != 0xFFFF; }
+    size_t bleMaxPayload() {
+        uint16_t peerMtu = NimBLEDevice::getServer()->getPeerMTU(bleConnHandle);
+        return peerMtu > 3 ? (peerMtu - 3) : 20;  // ATT header 3 байта
+    }
+    size_t bleQueued() { return getRingBufferAvailable(); }
+    bool bleOverflowed() { return getRingBufferOverflow(); }
+    size_t bleDequeue(uint8_t* dst, size_t n) { return readFromRingBuffer(dst, n); }
+    bool bleSend(const uint8_t* data, size_t n) { return sendBleData(data, n); }
+    void log(const char* message) { Serial.println(message); }
+};
 
-            if (shouldSend) {
-                // Читаем максимально возможное количество данных для эффективности
-                // MTU-3 = ~514 байт, используем 500 для максимальной пропускной способности
-#ifdef ESP32_S3
-                size_t toRead = (available > 500) ? 500 : available; // ESP32-S3: больше за раз
-#else
-                size_t toRead = (available > 480) ? 480 : available; // ESP32-C3: консервативно
-#endif
-                size_t bytesRead = readFromRingBuffer(bleTempBuffer, toRead);
-
-                if (bytesRead > 0) {
-                    // УПРОЩЁННАЯ ОТПРАВКА: просто отправляем данные без возврата в буфер
-                    // Поиск границ NMEA для исходящих не нужен - данные и так построчные
-                    
-                    // Отправляем через BLE, если подключен
-                    if (deviceConnected && bleConnHandle != 0xFFFF) {
-                        pTxCharacteristic->setValue(bleTempBuffer, bytesRead);
-                        pTxCharacteristic->notify();
-                    }
-                    
-                    // Отправляем через WiFi, если есть подключенные клиенты
-                    for (int i = 0; i < 4; i++) {
-                        if (wifiClientConnected[i]) {
-                            sendWiFiData(bleTempBuffer, bytesRead);
-                        }
-                    }
-                    
-                    lastBleFlush = currentTime;
-
-                    // Логирование переполнения буфера
-                    if (getRingBufferOverflow()) {
-                        Serial.println("WARNING: Ring buffer overflow occurred!");
-                    }
-                }
+static FirmwareHal firmwareHal;
+static BridgePipeline<BoardProfile, FirmwareHal> pipeline(firmwareHal);
+
+// ==============================================
+// BRIDGE SETTINGS (NVS)
+// ==============================================
+// Настройки $BRIDGE (bridge_control.h) хранятся в NVS одним блоком и
+// читаются при старте; блок другой версии или размера игнорируется.
+
+#define BRIDGE_NVS_NAMESPACE "bridge"
+#define BRIDGE_NVS_KEY "settings"
+
+static void loadBridgeSettings() {
+    Preferences prefs;
+    if (!prefs.begin(BRIDGE_NVS_NAMESPACE, true)) return;
+    BridgeSettings stored;
+    if (prefs.getBytesLength(BRIDGE_NVS_KEY) == sizeof(stored) &&
+        prefs.getBytes(BRIDGE_NVS_KEY, &stored, sizeof(stored)) == sizeof(stored) &&
+        stored.version == BRIDGE_SETTINGS_VERSION) {
+        stored.bleFilter[BRIDGE_FILTER_LEN - 1] = '\0';
+        stored.wifiFilter[BRIDGE_FILTER_LEN - 1] = '\0';
+        bridgeSettings = stored;
+        Serial.println("Bridge settings loaded from NVS");
+    }
+    prefs.end();
+}
+
+// Вызывается потоком приёма после команды (serviceControlCommands) и из setup()
+void applyBridgeSettings(uint8_t action) {
+    pipeline.flushTuning.sendThreshold = bridgeSettings.bleThreshold;
+    pipeline.flushTuning.flushIntervalMs = bridgeSettings.bleIntervalMs;
+    pipeline.flushTuning.chunk = bridgeSettings.bleChunk;
+    // MTU — для следующего обмена, PHY — запрос для текущего соединения
+    NimBLEDevice::setMTU(bridgeSettings.mtu);
+    if (deviceConnected && bleConnHandle != 0xFFFF) requestPreferredPhy(NimBLEDevice::getServer(), bleConnHandle);
+
+    if (action == BRIDGE_ACTION_SAVE || action == BRIDGE_ACTION_DEFAULTS) {
+        Preferences prefs;
+        if (prefs.begin(BRIDGE_NVS_NAMESPACE, false)) {
+            if (action == BRIDGE_ACTION_SAVE) {
+                prefs.putBytes(BRIDGE_NVS_KEY, &bridgeSettings, sizeof(bridgeSettings));
+            } else {
+                prefs.remove(BRIDGE_NVS_KEY);
             }
+            prefs.end();
         }
+        Serial.println(action == BRIDGE_ACTION_SAVE ? "Bridge settings saved to NVS" : "Bridge settings reset to defaults");
     }
-    
-    // Проверяем устаревшие данные
+}
+
+// Периодические задачи стороны приёма
+static void serviceIngestHousekeeping() {
     checkDataTimeouts();
-    
-    // Обновляем дисплей
-    updateDisplay();
+    reportUartUtilisation();
+    serviceControlCommands();
+    serviceReplay();
+    reportLatency();
+#if LATENCY_TRACE
+    dumpLatencyTrace();
+#endif
+    serviceUartLink();
+    serviceOutputProfile();
+#if SYNTH_LOAD_TEST
+    serviceSynthLoad();
+#endif
+#if TASK_PROFILE
+    sampleTaskProfile();
+#endif
+#if MICRO_BENCH || TASK_PROFILE
+    serviceSerialCommands();
+#endif
+    // Данные для дисплея: отрисовка в displayTask
+    publishGpsSnapshot();
+}
 
-    // Обработка подключения/отключения для вывода в лог
+// Сообщения о подключении/отключении клиентов
+static void logConnectionChanges() {
+    static unsigned long bleDisconnectMs = 0;
+    if (deviceConnected) bleDisconnectMs = 0;
     if (!deviceConnected && oldDeviceConnected) {
-        delay(500); // Даем время для BLE-стека
-        oldDeviceConnected = deviceConnected;
-        Serial.println("BLE client disconnected");
+        // Даем время для BLE-стека — без delay(): на C3 этот же проход читает UART
+        if (bleDisconnectMs == 0) bleDisconnectMs = millis() | 1;
+        if (millis() - bleDisconnectMs >= 500) {
+            bleDisconnectMs = 0;
+            oldDeviceConnected = deviceConnected;
+            Serial.println("BLE client disconnected");
+        }
     }
     if (deviceConnected && !oldDeviceConnected) {
         oldDeviceConnected = deviceConnected;
         Serial.println("BLE client connected");
     }
-    
+
     // Check for changes in WiFi client connections
     static bool oldWifiConnected = false;
     bool currentWifiConnected = false;
@@ -1782,7 +2088,7 @@ void loop() {
             break;
         }
     }
-    
+
     if (!currentWifiConnected && oldWifiConnected) {
         Serial.println("All WiFi clients disconnected");
     }
@@ -1790,171 +2096,187 @@ void loop() {
         Serial.println("WiFi client connected");
     }
     oldWifiConnected = currentWifiConnected;
-#endif  // ESP32_S3
 }
 
 // ==============================================
-// ESP32-S3 DUAL-CORE TASK IMPLEMENTATIONS
+// LOOP SCHEDULER (ESP32-C3)
 // ==============================================
-#ifdef ESP32_S3
+// Приём и отправка идут в каждом проходе loop(); подключения WiFi, служебные
+// проверки и порт телеметрии — в остаток бюджета прохода (loop_scheduler.h)
+
+enum LoopStageId {
+    STAGE_WIFI_CLIENTS = 0,  // Подключения и входящие WiFi (NTRIP, команды)
+    STAGE_HOUSEKEEPING,      // serviceIngestHousekeeping()
+    STAGE_TELEMETRY,         // Порт статуса
+    STAGE_CONNECTIONS,       // Сообщения о подключениях
+    LOOP_STAGE_COUNT
+};
+
+static LoopScheduler loopScheduler;
+
+// Бюджет прохода на текущей скорости UART (loopPassBudgetUs): при старте и
+// после повторной установки связи в serviceUartLink()
+static void updateLoopPassBudget() {
+    loopScheduler.passBudgetUs =
+        loopPassBudgetUs(uartRxBufferForBaud(uartLinkBaud), uartLinkBaud, BoardProfile::LOOP_PASS_BUDGET_US);
+    Serial.printf("Loop scheduler: pass budget %lu us at %lu baud\n", (unsigned long)loopScheduler.passBudgetUs,
+                  (unsigned long)uartLinkBaud);
+}
+
+static void setupLoopScheduler() {
+    // Период и бюджет стадий, мкс — в порядке LoopStageId
+    loopScheduler.add("wifi", 2000, 500);
+    loopScheduler.add("service", 10000, 1500);
+    loopScheduler.add("telemetry", 50000, 2000);
+    loopScheduler.add("connections", 100000, 100);
+    updateLoopPassBudget();
+}
+
+static void runLoopStage(int id) {
+    switch (id) {
+        case STAGE_WIFI_CLIENTS: handleWiFiClients(); break;
+        case STAGE_HOUSEKEEPING: serviceIngestHousekeeping(); break;
+        case STAGE_TELEMETRY: serviceTelemetryPort(); break;
+        case STAGE_CONNECTIONS: logConnectionChanges(); break;
+    }
+}
+
+static size_t formatLoopSchedule(char* out, size_t cap) {
+    return loopSchedulerFormatText(out, cap, loopScheduler);
+}
+
+void loop() {
+    uint32_t iterationStart = micros();
+#if TASK_PROFILE
+    if (loopTaskSeen == NULL) loopTaskSeen = xTaskGetCurrentTaskHandle();
+#endif
+    if (BoardProfile::DUAL_CORE) {
+        // ESP32-S3: приём в dataTask, отправка в bleTask; здесь только
+        // подключения WiFi клиентов и их команды
+        handleWiFiClients();
+        if (controlCount > 0) wakeDataTask();  // Команды WiFi выполняет приём
+        serviceTelemetryPort();
+        logConnectionChanges();
+        telemetryNoteIteration(TASK_LOOP, micros() - iterationStart);
+        delay(BoardProfile::LOOP_IDLE_MS);  // 512 байт входящих на клиента за проход — с запасом для RTCM
+        return;
+    }
+
+    // ESP32-C3: Полная обработка в одном потоке; сначала приём и отправка
+    loopScheduler.beginPass(iterationStart);
+    size_t uartRead = pipeline.ingest();
+
+    // ОБРАБОТКА ВХОДЯЩИХ BLE RX ДАННЫХ (NTRIP поправки + команды)
+    // Обрабатываем в main loop, не блокируя BLE callback
+    size_t rxRead = pipeline.forwardRx();
+
+    // Отправляем данные из кольцевого буфера через BLE
+    pipeline.flushBle(millis());
+
+    // WiFi клиенты отправляются из собственных очередей
+    flushWiFiSinks(wifiClients);
+    loopScheduler.foregroundDone(micros());
+
+    // Остальное — по сроку и в пределах бюджета прохода
+    int stage;
+    while ((stage = loopScheduler.next(micros())) >= 0) {
+        uint32_t stageStart = micros();
+        runLoopStage(stage);
+        loopScheduler.finished(stage, stageStart, micros());
+    }
+    telemetryNoteIteration(TASK_LOOP, micros() - iterationStart);
+
+    // Нет входящих данных — отдаём процессор задаче дисплея (её приоритет ниже loop)
+    if (uartRead == 0 && rxRead == 0) {
+        vTaskDelay(1);
+    }
+}
+
+// ==============================================
+// DUAL-CORE TASK IMPLEMENTATIONS
+// ==============================================
+
+// Срок ближайшей отправки BLE или WiFi, мс (FLUSH_WAIT_IDLE — очереди пусты)
+static unsigned long senderWaitMs(unsigned long now) {
+    unsigned long ble = pipeline.flushWaitMs(now);
+    unsigned long wifi = wifiFlushWaitMs(now);
+    return (ble < wifi) ? ble : wifi;
+}
+
+// Вызывается приёмом после прохода: будит bleTask, если отправке пора раньше,
+// чем она проснётся сама. Уведомление запоминается, пока задача не уснула.
+static void wakeBleTaskIfDue() {
+    if (bleTaskHandle == NULL || !bleTaskSleeping) return;
+    unsigned long now = millis();
+    unsigned long wait = senderWaitMs(now);
+    if (wait == FLUSH_WAIT_IDLE) return;
+    if (bleTaskWakeAtSet && (long)(now + wait - bleTaskWakeAt) >= 0) return;
+    bleTaskSleeping = false;
+    xTaskNotifyGive(bleTaskHandle);
+}
 
 // BLE Task: Отправка данных через BLE и WiFi
 void bleTask(void* parameter) {
     Serial.println("BLE Task started on core 0");
-    
-    while (bleTaskRunning) {
-        bool hasAnyConnection = deviceConnected; // BLE connected
-        for (int i = 0; i < 4; i++) {
-            if (wifiClientConnected[i]) {
-                hasAnyConnection = true;
-                break;
-            }
-        }
 
-        if (hasAnyConnection) {
-            size_t available = getRingBufferAvailable();
-            
-            // АГРЕССИВНАЯ отправка для максимальной пропускной способности
-            if (available > 0) {
-                bool shouldSend = false;
-                unsigned long currentTime = millis();
-
-                if (available >= 12288) {
-                    shouldSend = true; // КРИТИЧЕСКО: буфер почти полон!
-                    Serial.println("WARNING: Buffer near full, forcing send");
-                } else if (available >= 400) {
-                    shouldSend = true; // Отправляем большие пакеты сразу
-                } else if (available > 0 && (currentTime - lastBleFlush > 7)) {
-                    shouldSend = true; // Быстрая отправка через 7мс
-                } else if (available > 0 && (currentTime - lastBleFlush > 20)) {
-                    shouldSend = true; // Принудительная отправка через 20мс
-                }
-
-                if (shouldSend) {
-                    size_t toRead = (available > 480) ? 480 : available;
-                    size_t bytesRead = readFromRingBuffer(bleTempBuffer, toRead);
-
-                    if (bytesRead > 0) {
-                        // Отправляем через BLE, если подключен
-                        if (deviceConnected && bleConnHandle != 0xFFFF) {
-                            pTxCharacteristic->setValue(bleTempBuffer, bytesRead);
-                            pTxCharacteristic->notify();
-                        }
-                        
-                        // Отправляем через WiFi, если есть подключенные клиенты
-                        for (int i = 0; i < 4; i++) {
-                            if (wifiClientConnected[i]) {
-                                sendWiFiData(bleTempBuffer, bytesRead);
-                            }
-                        }
-                        
-                        lastBleFlush = currentTime;
-
-                        // Логирование переполнения буфера
-                        if (getRingBufferOverflow()) {
-                            Serial.println("WARNING: Ring buffer overflow occurred!");
-                        }
-                    }
-                }
-            }
+    while (bleTaskRunning) {
+        uint32_t iterationStart = micros();
+        pipeline.flushBle(millis());
+
+        // WiFi клиенты отправляются из собственных очередей
+        flushWiFiSinks(wifiClients);
+        telemetryNoteIteration(TASK_BLE, micros() - iterationStart);
+
+        // Флаг сна — до расчёта срока: данные, поставленные после расчёта,
+        // приём увидит вместе с флагом и разбудит задачу
+        bleTaskWakeAtSet = false;
+        bleTaskSleeping = true;
+        unsigned long now = millis();
+        unsigned long wait = senderWaitMs(now);
+        if (wait == 0) {
+            // Очередь не опустела: порции notify по-прежнему не чаще раза в тик
+            bleTaskSleeping = false;
+            vTaskDelay(1);
+            continue;
         }
-        
-        // Небольшая задержка для экономии ресурсов
-        vTaskDelay(pdMS_TO_TICKS(1));
+        if (wait > BoardProfile::BLE_TASK_IDLE_MS) wait = BoardProfile::BLE_TASK_IDLE_MS;
+        bleTaskWakeAt = now + wait;
+        bleTaskWakeAtSet = true;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait) > 0 ? pdMS_TO_TICKS(wait) : 1);
+        bleTaskSleeping = false;
     }
-    
+
     Serial.println("BLE Task ended");
     vTaskDelete(NULL);
 }
 
+// Сколько спать приёму без событий: повтор истории и синтетический поток
+// событий UART не дают — им нужен каждый тик
+static TickType_t dataTaskIdleTicks() {
+    if (SYNTH_LOAD_TEST || anyReplayActive()) return 1;
+    return pdMS_TO_TICKS(BoardProfile::DATA_TASK_IDLE_MS);
+}
+
 // Data Task: Прием данных из UART, парсинг GPS, обработка RX
 void dataTask(void* parameter) {
     Serial.println("Data Task started on core 1");
-    static uint8_t uartReadBuffer[256];
-    
+
     while (dataTaskRunning) {
-        // Чтение данных из UART1
-        int bytesAvailable = SerialPort.available();
-        if (bytesAvailable > 0) {
-            int bytesToRead = (bytesAvailable > 256) ? 256 : bytesAvailable;
-            int bytesRead = SerialPort.readBytes(uartReadBuffer, bytesToRead);
-            
-            // Записываем в кольцевой буфер, если есть подключения
-            bool hasAnyConnection = deviceConnected; // BLE connected
-            for (int i = 0; i < 4; i++) {
-                if (wifiClientConnected[i]) {
-                    hasAnyConnection = true;
-                    break;
-                }
-            }
-            
-            if (hasAnyConnection && bytesRead > 0) {
-                writeToRingBuffer(uartReadBuffer, bytesRead);
-            }
-            
-            // Парсинг GPS данных
-            for (int i = 0; i < bytesRead; i++) {
-                char c = uartReadBuffer[i];
-                
-                // Собираем NMEA строку для парсинга
-                nmeaBuffer += c;
-                if (c == '\n') {
-                    parseNMEA(nmeaBuffer.c_str());
-                    nmeaBuffer = "";
-                }
-                
-                // Парсим через TinyGPS++
-                if (gps.encode(c)) {
-                    if (gps.location.isValid()) {
-                        gpsData.latitude = gps.location.lat();
-                        gpsData.longitude = gps.location.lng();
-                        gpsData.valid = true;
-                        gpsData.lastUpdate = millis();
-                        if (tzAuto) {
-                            tzOffsetMinutes = estimateOffsetMinutesFromLongitude(gpsData.longitude);
-                        }
-                    }
-                }
-            }
-        }
-        
-        // ОБРАБОТКА ВХОДЯЩИХ BLE RX ДАННЫХ
-        size_t rxAvailable = bleRxBuffer.available();
-        if (rxAvailable > 0) {
-            size_t toRead = (rxAvailable > sizeof(rxTempBuffer)) ? sizeof(rxTempBuffer) : rxAvailable;
-            size_t rxRead = bleRxBuffer.read(rxTempBuffer, toRead);
-            
-            if (rxRead > 0) {
-                // Определяем тип данных
-                bool isRTCM3 = (rxRead >= 3 && rxTempBuffer[0] == 0xD3);
-                bool isASCII = (rxRead > 0 && 
-                               (rxTempBuffer[0] == '$' || rxTempBuffer[0] == '#' || 
-                                (rxTempBuffer[0] >= 'A' && rxTempBuffer[0] <= 'Z') ||
-                                (rxTempBuffer[0] >= 'a' && rxTempBuffer[0] <= 'z')));
-                
-                // Отправляем в UART
-                SerialPort.write(rxTempBuffer, rxRead);
-                
-                // Добавляем \r\n только для ASCII команд
-                if (isASCII && !isRTCM3) {
-                    SerialPort.write("\r\n");
-                }
-            }
+        uint32_t iterationStart = micros();
+        size_t uartRead = pipeline.ingest();
+        size_t rxRead = pipeline.forwardRx();
+        serviceIngestHousekeeping();
+        wakeBleTaskIfDue();
+        telemetryNoteIteration(TASK_DATA, micros() - iterationStart);
+
+        // Всё прочитано — спим до прерывания UART, записи RX или команды
+        if (uartRead == 0 && rxRead == 0) {
+            ulTaskNotifyTake(pdTRUE, dataTaskIdleTicks());
+        } else {
+            taskYIELD();
         }
-        
-        // Проверка таймаутов данных
-        checkDataTimeouts();
-        
-        // Задержка: минимальная для ESP32-S3, 1ms для ESP32-C3
-#ifdef ESP32_S3
-        taskYIELD(); // ESP32-S3: просто отдаем управление, без задержки
-#else
-        vTaskDelay(pdMS_TO_TICKS(1)); // ESP32-C3: 1ms задержка
-#endif
     }
-    
+
     Serial.println("Data Task ended");
     vTaskDelete(NULL);
 }
-
-#endif  // ESP32_S3
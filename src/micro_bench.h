@@ -0,0 +1,299 @@
+// Микробенчмарки горячих функций моста: один набор для хоста и платы
+//
+// Кольцевой буфер (запись и чтение порциями 16..1024 байт), запись в полную
+// очередь записей с вытеснением старых (record_queue.h), splitFields(),
+// каждый parseXXX(), диспетчер parseNMEA(), fmtCoordLine(), нарезка потока
+// в StreamFramer (только RTCM3 и смешанный поток) и CRC24Q. Входные данные —
+// секундная эпоха генератора gnss_synth.h, так что хост и плата меряют одни и
+// те же байты.
+//
+// Число итераций подбирается, как в Google Benchmark: растёт, пока прогон не
+// займёт minNs. Результат — такты и наносекунды на итерацию и на байт; отчёт
+// — JSON того же вида, что у Google Benchmark, по строке на бенчмарк
+// (microBenchJson), чтобы сравнивать хост с ESP32-C3/S3 (tools/micro_bench.cpp).
+//
+// Clock: uint32_t cycles() — счётчик тактов (ESP.getCycleCount(), rdtsc),
+//        uint64_t nanos()  — время, нс.
+// Прогон не должен превышать 2^32 тактов — minNs до ~100 мс.
+// Парсеры меняют gpsData/satData — прогон сохраняет и восстанавливает их.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ring_buffer.h"
+#include "record_queue.h"
+#include "gnss_parser.h"
+#include "display_format.h"
+#include "stream_framer.h"
+#include "gnss_synth.h"
+
+#define MICRO_BENCH_RING_SIZE 16384  // Как очередь BLE
+#define MICRO_BENCH_CORPUS    8192
+#define MICRO_BENCH_NAME_MAX  40
+
+struct MicroBenchResult {
+    char name[MICRO_BENCH_NAME_MAX];
+    uint32_t iterations;
+    uint32_t bytesPerIteration;  // 0 — бенчмарк без привязки к объёму (форматтер)
+    uint32_t cycles;             // За все итерации
+    uint64_t nanos;
+};
+
+struct MicroBenchCase {
+    const char* name;
+    uint32_t arg;                            // Порция ring/* и queue/*, тип NMEA для nmea/*
+    uint32_t (*bytes)(uint32_t arg);         // Байт за итерацию
+    void (*run)(uint32_t iterations, uint32_t arg);
+};
+
+static RingBufferT<MICRO_BENCH_RING_SIZE> mbRing;
+static RecordQueueT<MICRO_BENCH_RING_SIZE, MICRO_BENCH_RING_SIZE / 32> mbQueue;
+static uint8_t mbChunk[1024];
+static uint8_t mbStream[MICRO_BENCH_CORPUS];  // Эпоха генератора целиком
+static size_t mbStreamLen = 0;
+static uint8_t mbRtcm[MICRO_BENCH_CORPUS];    // Только кадры RTCM3 той же эпохи
+static size_t mbRtcmLen = 0;
+static char mbSentences[ST_GST + 1][FRAMER_MAX_NMEA + 1];  // Образец GGA, GNS, GSA, GSV, GST
+static size_t mbSentenceLen[ST_GST + 1];
+static StreamFramer mbFramer;
+static volatile uint32_t mbSink;  // Результаты, чтобы компилятор не выбросил работу
+
+static void mbBuildCorpus() {
+    SynthConfig cfg;
+    cfg.epochHz = 1;
+    cfg.constellations = 4;
+    cfg.satsPerConstellation = 10;
+    cfg.rtcmBytesPerSec = 3000;
+    static GnssSynth gen;
+    static uint8_t record[SYNTH_MAX_RECORD];
+    gen.configure(cfg);
+    mbStreamLen = 0;
+    mbRtcmLen = 0;
+    memset(mbSentenceLen, 0, sizeof(mbSentenceLen));
+
+    size_t n;
+    while ((n = gen.nextRecord(record, sizeof(record))) > 0) {
+        if (mbStreamLen + n <= sizeof(mbStream)) {
+            memcpy(mbStream + mbStreamLen, record, n);
+            mbStreamLen += n;
+        }
+        if (record[0] == 0xD3) {
+            if (mbRtcmLen + n <= sizeof(mbRtcm)) {
+                memcpy(mbRtcm + mbRtcmLen, record, n);
+                mbRtcmLen += n;
+            }
+        } else if (record[0] == '$') {
+            uint8_t t = classifyNmeaSentence(record, n);
+            if (t <= ST_GST && mbSentenceLen[t] == 0 && n <= FRAMER_MAX_NMEA) {
+                memcpy(mbSentences[t], record, n);
+                mbSentences[t][n] = '\0';
+                mbSentenceLen[t] = n;
+            }
+        }
+    }
+}
+
+static uint32_t mbChunkBytes(uint32_t chunk) { return chunk; }
+static uint32_t mbSentenceBytes(uint32_t type) { return (uint32_t)mbSentenceLen[type]; }
+static uint32_t mbNoBytes(uint32_t) { return 0; }
+static uint32_t mbStreamBytes(uint32_t) { return (uint32_t)mbStreamLen; }
+static uint32_t mbRtcmBytes(uint32_t) { return (uint32_t)mbRtcmLen; }
+
+// Запись в незаполненный буфер; заполненный очищается (раз в 16384/chunk итераций)
+static void mbRingWrite(uint32_t iterations, uint32_t chunk) {
+    const uint32_t perFill = (MICRO_BENCH_RING_SIZE - 1) / chunk;
+    mbRing.clear();
+    for (uint32_t i = 0, k = 0; i < iterations; i++) {
+        mbSink += mbRing.write(mbChunk, chunk);
+        if (++k == perFill) {
+            mbRing.clear();
+            k = 0;
+        }
+    }
+}
+
+// Чтение из полного буфера; опустевший снова объявляется полным без копирования
+static void mbRingRead(uint32_t iterations, uint32_t chunk) {
+    const uint32_t perFill = (MICRO_BENCH_RING_SIZE - 1) / chunk;
+    mbRing.clear();
+    mbRing.tail = 1;
+    for (uint32_t i = 0, k = 0; i < iterations; i++) {
+        mbSink += mbRing.read(mbChunk, chunk);
+        if (++k == perFill) {
+            mbRing.tail = (mbRing.head + 1) % MICRO_BENCH_RING_SIZE;
+            k = 0;
+        }
+    }
+}
+
+// Запись в заполненную очередь: каждая вытесняет старейшие записи целиком
+static void mbQueueFull(uint32_t iterations, uint32_t chunk) {
+    mbQueue.clear();
+    mbQueue.policy = QUEUE_DROP_OLDEST;
+    while (mbQueue.write(mbChunk, chunk, ST_GGA) && mbQueue.freeSpace() >= chunk) {
+    }
+    for (uint32_t i = 0; i < iterations; i++) mbSink += mbQueue.write(mbChunk, chunk, ST_GGA);
+}
+
+// Копия в буфер разбора, как в парсерах, и разбиение на поля
+static void mbSplitFields(uint32_t iterations, uint32_t type) {
+    char* fields[32];
+    for (uint32_t i = 0; i < iterations; i++) {
+        memcpy(nmeaParseBuffer, mbSentences[type], mbSentenceLen[type] + 1);
+        mbSink += splitFields(nmeaParseBuffer, fields, 32);
+    }
+}
+
+static void mbParse(uint32_t iterations, uint32_t type) {
+    static void (*const parsers[ST_GST + 1])(const char*) = {parseGGA, parseGNS, parseGSA, parseGSV, parseGST};
+    for (uint32_t i = 0; i < iterations; i++) parsers[type](mbSentences[type]);
+}
+
+static void mbParseNmea(uint32_t iterations, uint32_t type) {
+    for (uint32_t i = 0; i < iterations; i++) parseNMEA(mbSentences[type]);
+}
+
+// Координаты по всему диапазону: разное число целых разрядов и знаков после точки
+static void mbCoordLine(uint32_t iterations, uint32_t) {
+    static const double degrees[8] = {55.7353911300, -37.6294241333, 0.0000012345, -179.9999999999,
+                                      9.5,           123.4567890123, -0.5,         89.9999999950};
+    int64_t values[8];
+    for (int v = 0; v < 8; v++) values[v] = fmtToScaled(degrees[v], COORD_EXP10);
+    char out[DISPLAY_TEXT_MAX];
+    for (uint32_t i = 0; i < iterations; i++) mbSink += fmtCoordLine(out, sizeof(out), "Lat:", values[i & 7], 21);
+}
+
+static void mbFrame(const uint8_t* data, size_t len, uint32_t iterations) {
+    mbFramer.reset();
+    for (uint32_t i = 0; i < iterations; i++) {
+        mbFramer.feed(data, len, [](const uint8_t*, size_t n, uint8_t type) { mbSink += n + type; });
+    }
+}
+static void mbFrameRtcm(uint32_t iterations, uint32_t) { mbFrame(mbRtcm, mbRtcmLen, iterations); }
+static void mbFrameMixed(uint32_t iterations, uint32_t) { mbFrame(mbStream, mbStreamLen, iterations); }
+
+// CRC24Q каждого кадра (заголовок + данные), как при проверке RTCM
+static void mbRtcmCrc(uint32_t iterations, uint32_t) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (size_t pos = 0; pos + 6 <= mbRtcmLen;) {
+            size_t payload = ((size_t)(mbRtcm[pos + 1] & 0x03) << 8) | mbRtcm[pos + 2];
+            mbSink += rtcmCrc24q(mbRtcm + pos, 3 + payload);
+            pos += 6 + payload;
+        }
+    }
+}
+
+static const MicroBenchCase microBenchCases[] = {
+    {"ring/write", 16, mbChunkBytes, mbRingWrite},
+    {"ring/write", 64, mbChunkBytes, mbRingWrite},
+    {"ring/write", 256, mbChunkBytes, mbRingWrite},
+    {"ring/write", 1024, mbChunkBytes, mbRingWrite},
+    {"ring/read", 16, mbChunkBytes, mbRingRead},
+    {"ring/read", 64, mbChunkBytes, mbRingRead},
+    {"ring/read", 256, mbChunkBytes, mbRingRead},
+    {"ring/read", 1024, mbChunkBytes, mbRingRead},
+    {"queue/full", 64, mbChunkBytes, mbQueueFull},
+    {"queue/full", 256, mbChunkBytes, mbQueueFull},
+    {"nmea/splitFields/GGA", ST_GGA, mbSentenceBytes, mbSplitFields},
+    {"nmea/splitFields/GSV", ST_GSV, mbSentenceBytes, mbSplitFields},
+    {"nmea/parseGGA", ST_GGA, mbSentenceBytes, mbParse},
+    {"nmea/parseGNS", ST_GNS, mbSentenceBytes, mbParse},
+    {"nmea/parseGSA", ST_GSA, mbSentenceBytes, mbParse},
+    {"nmea/parseGSV", ST_GSV, mbSentenceBytes, mbParse},
+    {"nmea/parseGST", ST_GST, mbSentenceBytes, mbParse},
+    {"nmea/parseNMEA/GGA", ST_GGA, mbSentenceBytes, mbParseNmea},
+    {"nmea/parseNMEA/GNS", ST_GNS, mbSentenceBytes, mbParseNmea},
+    {"nmea/parseNMEA/GSA", ST_GSA, mbSentenceBytes, mbParseNmea},
+    {"nmea/parseNMEA/GSV", ST_GSV, mbSentenceBytes, mbParseNmea},
+    {"nmea/parseNMEA/GST", ST_GST, mbSentenceBytes, mbParseNmea},
+    {"display/fmtCoordLine", 0, mbNoBytes, mbCoordLine},
+    {"framer/rtcm", 0, mbRtcmBytes, mbFrameRtcm},
+    {"framer/mixed", 0, mbStreamBytes, mbFrameMixed},
+    {"rtcm/crc24q", 0, mbRtcmBytes, mbRtcmCrc},
+};
+
+// Имя с аргументом для ring/* и queue/*: ring/write/64
+static void microBenchName(char* out, size_t cap, const MicroBenchCase& c) {
+    if (strncmp(c.name, "ring/", 5) == 0 || strncmp(c.name, "queue/", 6) == 0) {
+        snprintf(out, cap, "%s/%u", c.name, (unsigned)c.arg);
+    } else {
+        snprintf(out, cap, "%s", c.name);
+    }
+}
+
+// Все бенчмарки, чьё имя содержит filter (nullptr — все); report(const MicroBenchResult&)
+template <typename Clock, typename Report>
+static void runMicroBenchmarks(Clock& clock, uint64_t minNs, const char* filter, Report&& report) {
+    static GPSData savedGps;
+    static SatelliteData savedSats;
+    savedGps = gpsData;
+    savedSats = satData;
+    mbBuildCorpus();
+
+    for (size_t k = 0; k < sizeof(microBenchCases) / sizeof(microBenchCases[0]); k++) {
+        const MicroBenchCase& c = microBenchCases[k];
+        MicroBenchResult r;
+        microBenchName(r.name, sizeof(r.name), c);
+        if (filter && filter[0] && !strstr(r.name, filter)) continue;
+        r.bytesPerIteration = c.bytes(c.arg);
+
+        uint32_t iterations = 1;
+        for (;;) {
+            uint64_t t0 = clock.nanos();
+            uint32_t c0 = clock.cycles();
+            c.run(iterations, c.arg);
+            uint32_t c1 = clock.cycles();
+            uint64_t ns = clock.nanos() - t0;
+            if (ns >= minNs || iterations >= (1u << 30)) {
+                r.iterations = iterations;
+                r.cycles = c1 - c0;
+                r.nanos = ns;
+                break;
+            }
+            // Следующая попытка — на 40% дольше цели по замеру, но не больше чем в 10 раз
+            uint64_t next = (ns > 0) ? (uint64_t)iterations * minNs * 14 / (ns * 10) : (uint64_t)iterations * 10;
+            if (next > (uint64_t)iterations * 10) next = (uint64_t)iterations * 10;
+            if (next <= iterations) next = iterations + 1;
+            iterations = (next > (1u << 30)) ? (1u << 30) : (uint32_t)next;
+        }
+        report(r);
+    }
+
+    gpsData = savedGps;
+    satData = savedSats;
+}
+
+// Начало документа: {"context": {...}, "benchmarks": [
+static size_t microBenchJsonHeader(char* out, size_t cap, const char* target, uint32_t cyclesMhz) {
+    int n = snprintf(out, cap,
+                     "{\n  \"context\": {\"target\": \"%s\", \"mhz_per_cpu\": %u, \"library\": \"micro_bench.h\"},\n"
+                     "  \"benchmarks\": [",
+                     target, (unsigned)cyclesMhz);
+    return (n < 0) ? 0 : ((size_t)n < cap ? (size_t)n : cap - 1);
+}
+
+// Одна строка массива benchmarks; first — без запятой перед ней
+static size_t microBenchJson(char* out, size_t cap, const MicroBenchResult& r, bool first) {
+    const double nsPerIter = (double)r.nanos / r.iterations;
+    const double cyclesPerIter = (double)r.cycles / r.iterations;
+    int n = snprintf(out, cap,
+                     "%s\n    {\"name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %u, "
+                     "\"real_time\": %.2f, \"cpu_time\": %.2f, \"time_unit\": \"ns\", \"cycles_per_iteration\": %.1f",
+                     first ? "" : ",", r.name, (unsigned)r.iterations, nsPerIter, nsPerIter, cyclesPerIter);
+    if (n > 0 && (size_t)n < cap && r.bytesPerIteration > 0 && r.nanos > 0) {
+        int m = snprintf(out + n, cap - n, ", \"bytes_per_second\": %.0f, \"cycles_per_byte\": %.3f",
+                         (double)r.bytesPerIteration * r.iterations * 1e9 / r.nanos,
+                         cyclesPerIter / r.bytesPerIteration);
+        if (m > 0) n += m;
+    }
+    if (n > 0 && (size_t)n < cap) {
+        int m = snprintf(out + n, cap - n, "}");
+        if (m > 0) n += m;
+    }
+    return (n < 0) ? 0 : ((size_t)n < cap ? (size_t)n : cap - 1);
+}
+
+static const char* const microBenchJsonFooter = "\n  ]\n}\n";
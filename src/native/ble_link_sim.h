@@ -0,0 +1,133 @@
+// Модель канала BLE для хост-сборки: notify -> буферы контроллера -> эфир
+//
+// Дискретно-событийная модель стороны периферии: notify занимает буферы
+// контроллера по числу LL PDU (без DLE — 27 байт данных в PDU, с DLE — 251)
+// и уходит в эфир в событиях соединения с периодом connIntervalMs. За событие
+// уходит не больше packetsPerEvent PDU (лимит центрального устройства) и не
+// больше, чем помещается в интервал по времени эфира выбранного PHY
+// (PDU + IFS + пустой ответ + IFS). Без свободных буферов notify отклоняется,
+// как ошибка ble_gatts_notify_custom(): порцию обычного потока конвейер
+// повторяет, пакет ND1 теряется. Notify больше всех буферов принимается
+// только в пустую очередь.
+// Данные длиннее MTU-3 NimBLE обрезает: хвост считается потерянным.
+//
+// Доставка notify — конец её последнего PDU; done(tag, us) получает метку,
+// переданную в notify(), чтобы считать задержку до эфира.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <deque>
+
+struct BleLinkParams {
+    double connIntervalMs = 7.5;      // updateConnParams(6, 12): 7.5-15 мс, выбирает центральное устройство
+    uint16_t mtu = 247;               // ATT MTU после обмена (прошивка предлагает 517)
+    bool dle = true;                  // Data Length Extension
+    uint8_t phy = 2;                  // 1 — 1M, 2 — 2M, 3 — Coded S8
+    uint16_t packetsPerEvent = 6;     // Лимит PDU за событие у телефона
+    uint16_t controllerBuffers = 12;  // ACL буферов под исходящие PDU
+};
+
+class BleLinkSim {
+  public:
+    explicit BleLinkSim(const BleLinkParams& p) : params(p) {
+        llPayload = p.dle ? 251 : 27;
+        intervalUs = (uint64_t)(p.connIntervalMs * 1000.0 + 0.5);
+        if (intervalUs == 0) intervalUs = 1;
+        uint64_t exchange = pduExchangeUs(llPayload);
+        uint64_t fit = (intervalUs > 150) ? (intervalUs - 150) / exchange : 0;
+        pdusPerEvent = (fit < p.packetsPerEvent) ? (uint32_t)fit : p.packetsPerEvent;
+        if (pdusPerEvent == 0) pdusPerEvent = 1;
+    }
+
+    // false — буферов нет, notify отклонена целиком
+    bool notify(size_t len, uint64_t nowUs, uint64_t tag) {
+        if (nextEventUs == 0) nextEventUs = (nowUs / intervalUs + 1) * intervalUs;  // События идут по сетке интервала
+        notifies++;
+        size_t maxValue = params.mtu > 3 ? params.mtu - 3u : 20u;
+        if (len > maxValue) {
+            truncatedBytes += len - maxValue;
+            len = maxValue;
+        }
+        uint32_t pdus = (uint32_t)((len + 7 + llPayload - 1) / llPayload);  // ATT 3 + L2CAP 4 байта
+        if (buffersUsed > 0 && buffersUsed + pdus > params.controllerBuffers) {
+            failures++;
+            failedBytes += len;
+            return false;
+        }
+        buffersUsed += pdus;
+        if (buffersUsed > maxBuffersUsed) maxBuffersUsed = buffersUsed;
+        Pending n = {pdus, (uint32_t)(len + 7 - (pdus - 1) * llPayload), len, tag};
+        queue.push_back(n);
+        return true;
+    }
+
+    // События соединения до nowUs включительно
+    template <typename Done>
+    void advance(uint64_t nowUs, Done&& done) {
+        while (nextEventUs != 0 && nextEventUs <= nowUs) {
+            runEvent(nextEventUs, done);
+            nextEventUs = queue.empty() ? 0 : nextEventUs + intervalUs;
+        }
+    }
+
+    bool idle() const { return queue.empty(); }
+
+    // Предел канала: notify по MTU-3 байт, все PDU события заняты
+    double capacityBytesPerSec() const {
+        size_t maxValue = params.mtu > 3 ? params.mtu - 3u : 20u;
+        uint32_t pdusPerNotify = (uint32_t)((maxValue + 7 + llPayload - 1) / llPayload);
+        return (double)maxValue * pdusPerEvent / pdusPerNotify * 1e6 / intervalUs;
+    }
+
+    uint32_t pdusPerEventLimit() const { return pdusPerEvent; }
+
+    const BleLinkParams params;
+    uint64_t notifies = 0, failures = 0;
+    uint64_t failedBytes = 0, truncatedBytes = 0, deliveredBytes = 0;
+    uint64_t events = 0, pdusSent = 0;
+    uint32_t maxBuffersUsed = 0;
+
+  private:
+    struct Pending {
+        uint32_t pdusLeft;
+        uint32_t lastPduBytes;  // Остальные PDU — полные
+        size_t bytes;
+        uint64_t tag;
+    };
+
+    std::deque<Pending> queue;
+    uint32_t buffersUsed = 0;
+    uint32_t llPayload;
+    uint32_t pdusPerEvent;
+    uint64_t intervalUs;
+    uint64_t nextEventUs = 0;  // 0 — отправлять нечего до следующей notify
+
+    // Время PDU с n байтами данных в эфире, мкс
+    uint64_t airtimeUs(uint32_t n) const {
+        switch (params.phy) {
+            case 1: return (uint64_t)(1 + 4 + 2 + n + 3) * 8;        // 1 бит/мкс
+            case 3: return 336 + (uint64_t)(2 + n + 3) * 8 * 8 + 24;  // S8: 8 символов на бит
+            default: return (uint64_t)(2 + 4 + 2 + n + 3) * 8 / 2;    // 2M
+        }
+    }
+    uint64_t pduExchangeUs(uint32_t n) const { return airtimeUs(n) + 150 + airtimeUs(0) + 150; }
+
+    template <typename Done>
+    void runEvent(uint64_t startUs, Done& done) {
+        events++;
+        uint64_t t = startUs;
+        for (uint32_t sent = 0; sent < pdusPerEvent && !queue.empty(); sent++) {
+            Pending& head = queue.front();
+            t += pduExchangeUs(head.pdusLeft == 1 ? head.lastPduBytes : llPayload);
+            pdusSent++;
+            buffersUsed--;
+            if (--head.pdusLeft == 0) {
+                deliveredBytes += head.bytes;
+                done(head.tag, t);
+                queue.pop_front();
+            }
+        }
+    }
+};
@@ -0,0 +1,238 @@
+// Модель UM980 на UART для проверки uart_link.h в хост-сборке
+//
+// FakeReceiverPort — Port для UartLinkNegotiator: у приёмника своя скорость
+// порта, у моста — та, что задана begin(). Пока они совпадают, мост получает
+// поток приёмника (GGA раз в 100 мс, если talking), а приёмник — команды
+// моста; на чужой скорости мост видит мусор, а команды теряются. VERSION
+// подтверждается; CONFIG подтверждается и меняет скорость (CONFIG_OK), не
+// меняет её, хотя подтверждён (CONFIG_NO_SWITCH — проверка на новой скорости
+// не проходит), или отклоняется (CONFIG_NACK). Скорость не сохраняется:
+// powerCycle() возвращает приёмник на savedBaud. Время модельное, его
+// двигает delay().
+//
+// runUartLinkSelftest() (--uart-link-selftest) прогоняет detect()/negotiate()
+// и UartLinkWatch по сценариям: переход, молчащий приёмник, неудачная проверка,
+// отказ, нет приёмника, перезагрузка приёмника и пропадание потока.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "../uart_link.h"
+
+struct FakeReceiverPort {
+    enum ConfigMode : uint8_t { CONFIG_OK, CONFIG_NO_SWITCH, CONFIG_NACK };
+
+    uint32_t receiverBaud;
+    uint32_t savedBaud;
+    uint32_t hostBaud = 0;
+    bool talking = true;  // Штатный поток; иначе только ответы на команды
+    bool alive = true;    // Приёмник выключен или отключен — ни байта
+    ConfigMode configMode = CONFIG_OK;
+    unsigned long nowMs = 0;
+    unsigned long nextSentenceMs = 0;
+    std::string toHost;     // Принято мостом, ещё не прочитано
+    std::string command;    // Строка команды у приёмника
+    uint32_t noise = 0x2545F491;
+
+    explicit FakeReceiverPort(uint32_t baud) : receiverBaud(baud), savedBaud(baud) {}
+
+    void begin(uint32_t baud) {
+        hostBaud = baud;
+        toHost.clear();
+    }
+
+    size_t read(uint8_t* buf, size_t maxLen) {
+        if (alive && talking && nowMs >= nextSentenceMs) {
+            sentence("GNGGA,120000.00,5545.0000,N,03737.0000,E,1,12,0.8,150.0,M,14.0,M,,");
+            nextSentenceMs = nowMs + 100;
+        }
+        size_t n = toHost.size() < maxLen ? toHost.size() : maxLen;
+        memcpy(buf, toHost.data(), n);
+        toHost.erase(0, n);
+        return n;
+    }
+
+    void write(const uint8_t* data, size_t len) {
+        if (!alive || hostBaud != receiverBaud) return;
+        for (size_t i = 0; i < len; i++) {
+            char c = (char)data[i];
+            if (c == '\n') {
+                execute();
+                command.clear();
+            } else if (c != '\r') {
+                command += c;
+            }
+        }
+    }
+
+    unsigned long millis() { return nowMs; }
+    void delay(unsigned long ms) { nowMs += ms; }
+
+    void powerCycle() {
+        receiverBaud = savedBaud;
+        command.clear();
+    }
+
+  private:
+    // "$body*hh\r\n" на скорости приёмника; на чужой — столько же мусора
+    void sentence(const std::string& body) {
+        uint8_t cs = 0;
+        for (char c : body) cs ^= (uint8_t)c;
+        char tail[8];
+        snprintf(tail, sizeof(tail), "*%02X\r\n", cs);
+        std::string line = "$" + body + tail;
+        if (hostBaud != receiverBaud) {
+            for (char& c : line) {
+                noise ^= noise << 13;
+                noise ^= noise >> 17;
+                noise ^= noise << 5;
+                c = (char)(noise & 0xFF);
+            }
+        }
+        toHost += line;
+    }
+
+    void execute() {
+        if (command == "VERSION") {
+            sentence("command,VERSION,response: OK");
+        } else if (command.compare(0, 7, "CONFIG ") == 0) {
+            if (configMode == CONFIG_NACK) {
+                sentence("command," + command + ",response: PARSING FAILED NO MATCHING FUNC");
+                return;
+            }
+            sentence("command," + command + ",response: OK");
+            const char* baud = strrchr(command.c_str(), ' ');
+            if (configMode == CONFIG_OK && baud) receiverBaud = (uint32_t)strtoul(baud + 1, nullptr, 10);
+        }
+    }
+};
+
+// Поток с порта через framer, как routeUartChunk(): счётчики для UartLinkWatch
+struct FakeLinkMonitor {
+    StreamFramer framer;
+    uint32_t good = 0;
+    uint32_t bad = 0;
+    unsigned long lastRxMs = 0;
+
+    void poll(FakeReceiverPort& port) {
+        uint8_t buf[256];
+        size_t n;
+        while ((n = port.read(buf, sizeof(buf))) > 0) {
+            lastRxMs = port.millis();
+            framer.feed(buf, n, [this](const uint8_t* rec, size_t len, uint8_t type) {
+                (uartRecordVerified(rec, len, type) ? good : bad)++;
+            });
+        }
+    }
+};
+
+// Вести поток до потери связи, не дольше limitMs; время потери или 0
+static unsigned long fakeWatchUntilLost(FakeReceiverPort& port, FakeLinkMonitor& mon, UartLinkWatch& watch,
+                                        unsigned long limitMs) {
+    unsigned long start = port.millis();
+    while (port.millis() - start < limitMs) {
+        mon.poll(port);
+        if (watch.lost(port.millis(), mon.lastRxMs, mon.good, mon.bad)) return port.millis();
+        port.delay(10);
+    }
+    return 0;
+}
+
+static bool fakeCheck(const char* scenario, bool ok, const char* fmt, unsigned long a, unsigned long b) {
+    printf("uart-link %-12s ", scenario);
+    printf(fmt, a, b);
+    printf("  %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Сценарии uart_link.h на модели приёмника; 0 — все прошли
+static int runUartLinkSelftest() {
+    const uint32_t target = 921600;
+    bool ok = true;
+
+    {
+        FakeReceiverPort rx(115200);
+        UartLinkNegotiator<FakeReceiverPort> link(rx);
+        uint32_t detected = link.detect();
+        uint32_t baud = link.negotiate(detected, target);
+        ok &= fakeCheck("switch", detected == 115200 && baud == target && rx.receiverBaud == target,
+                        "detected %lu, final %lu", detected, baud);
+    }
+    {
+        FakeReceiverPort rx(9600);
+        rx.talking = false;
+        UartLinkNegotiator<FakeReceiverPort> link(rx);
+        uint32_t detected = link.detect();
+        uint32_t baud = link.negotiate(detected, target);
+        ok &= fakeCheck("silent", detected == 9600 && baud == target && rx.receiverBaud == target,
+                        "detected %lu, final %lu", detected, baud);
+    }
+    {
+        FakeReceiverPort rx(460800);
+        rx.configMode = FakeReceiverPort::CONFIG_NO_SWITCH;
+        UartLinkNegotiator<FakeReceiverPort> link(rx);
+        uint32_t detected = link.detect();
+        uint32_t baud = link.negotiate(detected, target);
+        ok &= fakeCheck("no-verify", detected == 460800 && baud == 460800 && rx.hostBaud == 460800,
+                        "detected %lu, final %lu", detected, baud);
+    }
+    {
+        FakeReceiverPort rx(230400);
+        rx.configMode = FakeReceiverPort::CONFIG_NACK;
+        UartLinkNegotiator<FakeReceiverPort> link(rx);
+        uint32_t detected = link.detect();
+        uint32_t baud = link.negotiate(detected, target);
+        ok &= fakeCheck("nack", detected == 230400 && baud == 230400 && link.lastProbe().nacks > 0,
+                        "detected %lu, final %lu", detected, baud);
+    }
+    {
+        FakeReceiverPort rx(115200);
+        rx.alive = false;
+        UartLinkNegotiator<FakeReceiverPort> link(rx);
+        uint32_t detected = link.detect();
+        ok &= fakeCheck("absent", detected == 0, "detected %lu, after %lu ms", detected, rx.millis());
+    }
+    {
+        // Перезагрузка: приёмник снова на 115200, мост на 921600 принимает мусор
+        FakeReceiverPort rx(115200);
+        UartLinkNegotiator<FakeReceiverPort> link(rx);
+        uint32_t baud = link.negotiate(link.detect(), target);
+        FakeLinkMonitor mon;
+        UartLinkWatch watch(3000, 3000);
+        mon.poll(rx);
+        watch.reset(rx.millis(), mon.good, mon.bad);
+        rx.powerCycle();
+        unsigned long cycledMs = rx.millis();
+        unsigned long lostMs = fakeWatchUntilLost(rx, mon, watch, 10000);
+        uint32_t relinked = lostMs ? link.negotiate(link.detect(400, baud), target) : 0;
+        ok &= fakeCheck("power-cycle", lostMs != 0 && relinked == target && rx.receiverBaud == target,
+                        "lost after %lu ms, final %lu", lostMs - cycledMs, relinked);
+    }
+    {
+        // Поток пропал и вернулся на той же скорости: поиск начинается с неё
+        FakeReceiverPort rx(target);
+        UartLinkNegotiator<FakeReceiverPort> link(rx);
+        FakeLinkMonitor mon;
+        UartLinkWatch watch(3000, 3000);
+        rx.begin(target);
+        watch.reset(rx.millis(), 0, 0);
+        rx.alive = false;
+        fakeWatchUntilLost(rx, mon, watch, 5000);
+        rx.alive = true;
+        unsigned long lostMs = fakeWatchUntilLost(rx, mon, watch, 1000);
+        unsigned long searchMs = rx.millis();
+        uint32_t detected = lostMs ? link.detect(400, target) : 0;
+        searchMs = rx.millis() - searchMs;
+        ok &= fakeCheck("reconnect", lostMs != 0 && detected == target && searchMs <= 400,
+                        "detected %lu in %lu ms", detected, searchMs);
+    }
+
+    printf("uart-link self-test %s\n", ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+// Хост-реализация слоя платформы (см. src/hal.h)
+//
+// Часы millis()/micros() — реальные или ручные (для воспроизведения записей
+// по времени и детерминированных прогонов), критические секции portMUX —
+// спинлок на std::atomic_flag, Serial — лог в stderr. NativeStream заменяет
+// UART приёмника: байты подаются inject(), записанное в сторону приёмника
+// сохраняется в tx. NativeNotifySink и NativeWiFiClient собирают то, что
+// мост отправил бы по BLE notify и в TCP сокет.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+// ==============================================
+// ЧАСЫ
+// ==============================================
+
+struct NativeClock {
+    bool manual = false;  // true — время идёт только через advanceMicros()/delay()
+    uint64_t manualMicros = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint64_t nowMicros() const {
+        if (manual) return manualMicros;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+            .count();
+    }
+    void advanceMicros(uint64_t us) { manualMicros += us; }
+};
+
+static inline NativeClock& nativeClock() {
+    static NativeClock clock;
+    return clock;
+}
+
+// 32-битное переполнение, как на ESP32
+static inline unsigned long micros() { return (uint32_t)nativeClock().nowMicros(); }
+static inline unsigned long millis() { return (uint32_t)(nativeClock().nowMicros() / 1000); }
+
+static inline void delay(unsigned long ms) {
+    if (nativeClock().manual) {
+        nativeClock().advanceMicros((uint64_t)ms * 1000);
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+// ==============================================
+// КРИТИЧЕСКИЕ СЕКЦИИ
+// ==============================================
+
+typedef std::atomic_flag portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED ATOMIC_FLAG_INIT
+#define portENTER_CRITICAL(mux) \
+    while ((mux)->test_and_set(std::memory_order_acquire)) { \
+    }
+#define portEXIT_CRITICAL(mux) (mux)->clear(std::memory_order_release)
+
+// ==============================================
+// ПОТОКИ: UART ПРИЁМНИКА И ЛОГ
+// ==============================================
+
+class NativeStream {
+  public:
+    explicit NativeStream(FILE* console = nullptr) : console(console) {}
+
+    // Сторона приёмника: байты, которые мост прочитает
+    void inject(const uint8_t* data, size_t len) { rx.insert(rx.end(), data, data + len); }
+
+    int available() { return (int)rx.size(); }
+    int read() {
+        if (rx.empty()) return -1;
+        uint8_t c = rx.front();
+        rx.pop_front();
+        return c;
+    }
+    size_t readBytes(uint8_t* dst, size_t len) {
+        size_t n = (len < rx.size()) ? len : rx.size();
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = rx.front();
+            rx.pop_front();
+        }
+        return n;
+    }
+    size_t readBytes(char* dst, size_t len) { return readBytes((uint8_t*)dst, len); }
+
+    // Сторона моста: запись в приёмник (tx) или в консоль для Serial
+    size_t write(const uint8_t* data, size_t len) {
+        if (mute) return len;
+        if (console) {
+            fwrite(data, 1, len, console);
+        } else {
+            tx.insert(tx.end(), data, data + len);
+        }
+        return len;
+    }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+    size_t print(const char* s) { return write(s); }
+    size_t println(const char* s = "") { return write(s) + write("\r\n"); }
+    __attribute__((format(printf, 2, 3))) size_t printf(const char* format, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (n < 0) return 0;
+        return write((const uint8_t*)buf, ((size_t)n < sizeof(buf)) ? (size_t)n : sizeof(buf) - 1);
+    }
+
+    std::deque<uint8_t> rx;
+    std::vector<uint8_t> tx;
+    bool mute = false;  // Лог в прогонах и бенчмарках не нужен
+
+  private:
+    FILE* console;
+};
+
+// Лог моста
+static NativeStream Serial(stderr);
+
+// ==============================================
+// ПРИЁМНИКИ ВЫХОДНЫХ ДАННЫХ
+// ==============================================
+
+// BLE notify: число и размер пакетов, при capture — сами данные
+struct NativeNotifySink {
+    bool capture = true;
+    uint64_t notifies = 0;
+    uint64_t bytes = 0;
+    size_t maxPayload = 0;
+    std::vector<uint8_t> data;
+
+    void notify(const uint8_t* payload, size_t len) {
+        notifies++;
+        bytes += len;
+        if (len > maxPayload) maxPayload = len;
+        if (capture) data.insert(data.end(), payload, payload + len);
+    }
+};
+
+// TCP клиент: подмножество WiFiClient, которое использует мост.
+// windowBytes > 0 ограничивает запись за вызов (заполненный буфер сокета).
+class NativeWiFiClient {
+  public:
+    bool open = false;
+    size_t windowBytes = 0;
+    bool capture = true;
+    uint64_t bytes = 0;
+    std::vector<uint8_t> data;
+    std::deque<uint8_t> incoming;  // Команды/поправки от клиента
+
+    explicit operator bool() const { return open; }
+    bool connected() const { return open; }
+    void stop() { open = false; }
+
+    int available() { return (int)incoming.size(); }
+    size_t read(uint8_t* dst, size_t len) {
+        size_t n = (len < incoming.size()) ? len : incoming.size();
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = incoming.front();
+            incoming.pop_front();
+        }
+        return n;
+    }
+    size_t write(const uint8_t* src, size_t len) {
+        if (!open) return 0;
+        if (windowBytes && len > windowBytes) len = windowBytes;
+        bytes += len;
+        if (capture) data.insert(data.end(), src, src + len);
+        return len;
+    }
+};
@@ -0,0 +1,1029 @@
+// Хост-сборка моста: воспроизведение записей через логику прошивки (env:native)
+//
+// Тот же путь данных, что в прошивке: BridgePipeline с профилем
+// BoardProfileHost, разбор и раскладка по очередям из bridge_core.h, отправка
+// WiFi клиентам через flushWiFiSinks(), поправки от WiFi — forwardWiFiRx().
+// Вместо периферии — hal_native.h: UART приёмника получает данные записи,
+// notify BLE и TCP клиент собирают отправленное. Время модельное.
+//
+// Источник — запись UMCAP1 (capture_format.h) с исходными интервалами или
+// сырой поток UART, подаваемый со скоростью линии; --flat подаёт всё без
+// пауз. Поправки (RTCM от NTRIP клиента) берутся из записи (каналы BLE/WiFi)
+// или подмешиваются из файлов с заданной скоростью.
+//
+// Отчёт: пропускная способность стадий на хосте, задержка приёмник ->
+// потребитель (p50/p90/p99/max на байт), переполнения очередей, сверка
+// вывода: без фильтров — побайтно со входом (BLE с полосой приоритета —
+// каждая полоса отдельно, --no-lanes — одна очередь), с --expect-* — с
+// эталонными файлами (--save-* сохраняет эталон). --archive-kb включает
+// архив потока, как PSRAM на S3: после $BRIDGE,REPLAY во входящих клиента
+// вывод сверяется как вход с повтором истории. --flash-log DIR пишет
+// сегменты записи во флеш (flash_log.h) в каталог, как задача записи
+// прошивки, и сверяет их склейку со входом.
+//
+// --ble-link пропускает notify через модель канала (ble_link_sim.h):
+// интервал соединения, MTU, DLE, PHY, PDU за событие, буферы контроллера;
+// задержка BLE тогда считается до эфира. Отклонённую notify обычного потока
+// конвейер повторяет, как прошивка; отклонённые пакеты ND1 — потери.
+// Пакеты ND1 декодируются эталонным декодером, вывод сверяется со входом.
+// --max-loss/--max-p99-ms дают код возврата 1 для проверок в CI.
+//
+// --uart-link-selftest проверяет определение скорости и переход приёмника
+// (uart_link.h) на модели UM980 (fake_receiver.h) вместо воспроизведения.
+// --queue-selftest проверяет, что очередь записей не рвёт кадры длиннее
+// записи (queue_selftest.h). --rx-selftest проверяет передачу поправок
+// клиента в UART и перехват команд $BRIDGE (rx_selftest.h).
+// --scheduler-selftest проверяет правила планировщика прохода ESP32-C3
+// (loop_scheduler.h) на модельном времени (scheduler_selftest.h).
+// --profile-selftest проверяет расчёты профиля задач (task_profile.h) на
+// заданных снимках (profile_selftest.h).
+//
+// Сборка:  pio run -e native
+//    или:  g++ -O1 -g -std=c++17 -fsanitize=address,undefined -Isrc src/native/main.cpp -o bridge_native
+// Запуск:  bridge_native [опции] capture.bin|-   (--help — список опций)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../bridge_core.h"
+#include "../bridge_pipeline.h"
+#include "../bridge_telemetry.h"
+#include "../capture_format.h"
+#include "../display_format.h"
+#include "../nmea_delta.h"
+#include "ble_link_sim.h"
+#include "fake_receiver.h"
+#include "profile_selftest.h"
+#include "queue_selftest.h"
+#include "rx_selftest.h"
+#include "scheduler_selftest.h"
+
+static NativeStream SerialPort;  // UART приёмника
+static NativeNotifySink bleTx;   // TX характеристика
+static NativeWiFiClient wifiClients[MAX_WIFI_CLIENTS];
+
+// Профиль вывода приёмника в хост-сборке не настраивается
+bool handleOutputProfileResponse(const uint8_t*, size_t) { return false; }
+
+// ==============================================
+// ИЗМЕРЕНИЯ
+// ==============================================
+
+// Задержка приёмник -> потребитель: для каждой порции UART запоминаем позицию
+// её конца в очереди потребителя и время прихода; выборка берётся, когда
+// отправка дошла до позиции, с весом в байтах порции. Потерянные при
+// переполнении порции не считаются.
+struct LatencyTrack {
+    struct Mark {
+        uint64_t start, end;  // Порция в очереди: байты (start, end]
+        uint64_t arrivedUs;
+    };
+    std::deque<Mark> marks;
+    std::vector<std::pair<uint32_t, uint32_t>> samples;  // Задержка, мкс -> байт
+    uint64_t queued = 0;  // Байт поставлено в очередь
+    uint64_t sent = 0;    // Байт забрано из очереди (отправлено или потеряно)
+    uint64_t weight = 0;  // Байт в выборках
+    bool sorted = false;
+
+    void enqueue(size_t n, uint64_t arrivedUs) {
+        if (n == 0) return;
+        marks.push_back({queued, queued + n, arrivedUs});
+        queued += n;
+    }
+    // Порции, закончившиеся в (from, upTo], потеряны; более ранние могут быть ещё в пути
+    void lose(uint64_t from, uint64_t upTo) {
+        auto first = marks.begin();
+        while (first != marks.end() && first->end <= from) ++first;
+        auto last = first;
+        while (last != marks.end() && last->end <= upTo) ++last;
+        marks.erase(first, last);
+    }
+    void deliver(uint64_t upTo, uint64_t nowUs) {
+        while (!marks.empty() && marks.front().end <= upTo) {
+            uint32_t bytes = (uint32_t)(marks.front().end - marks.front().start);
+            samples.emplace_back((uint32_t)(nowUs - marks.front().arrivedUs), bytes);
+            weight += bytes;
+            marks.pop_front();
+        }
+    }
+    // Задержка, которую не превышает доля p переданных байт
+    uint32_t percentile(double p) {
+        if (samples.empty()) return 0;
+        if (!sorted) {
+            std::sort(samples.begin(), samples.end());
+            sorted = true;
+        }
+        uint64_t target = (uint64_t)(p * weight), acc = 0;
+        for (const auto& s : samples) {
+            acc += s.second;
+            if (acc >= target && acc > 0) return s.first;
+        }
+        return samples.back().first;
+    }
+};
+
+// Процессорное время стадии на хосте и обработанные байты
+struct StageStat {
+    const char* name;
+    uint64_t ns = 0;
+    uint64_t calls = 0;
+    uint64_t bytes = 0;
+};
+
+enum { STAGE_INGEST, STAGE_FORWARD_RX, STAGE_FLUSH_BLE, STAGE_FLUSH_WIFI, STAGE_COUNT };
+static StageStat stages[STAGE_COUNT] = {{"ingest"}, {"forwardRx"}, {"flushBle"}, {"flushWiFi"}};
+
+static inline uint64_t hostNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static LatencyTrack bleLatency;
+static LatencyTrack wifiLatency;  // Клиент в слоте 0
+static uint64_t bleOverflows = 0, wifiOverflows = 0, rxOverflows = 0;
+
+// Секунды модельного времени, в которые BLE терял данные (очередь или канал)
+static std::vector<uint8_t> bleLossSeconds;
+static void noteBleLoss() {
+    size_t second = (size_t)(nativeClock().nowMicros() / 1000000);
+    if (bleLossSeconds.size() <= second) bleLossSeconds.resize(second + 1, 0);
+    bleLossSeconds[second] = 1;
+}
+
+// Модель канала BLE (--ble-link) и сжатый поток ND1 (--nd1), как sendBleData()
+static BleLinkSim* bleLink = nullptr;
+static bool bleCompressed = false;
+static StreamFramer bleZFramer;
+static NmeaDeltaPacketizer blePacketizer;
+// Клиент ND1: эталонный декодер над принятыми каналом пакетами
+static NmeaDeltaDecoder bleZDecoder;
+static std::vector<uint8_t> bleZDecoded;
+static uint64_t bleZRejected = 0;
+
+static void decodeBleZ(const uint8_t* packet, size_t len) {
+    if (!bleZDecoder.decodePacket(packet, len, [](const uint8_t* data, size_t n) {
+            bleZDecoded.insert(bleZDecoded.end(), data, data + n);
+        })) {
+        bleZRejected++;
+    }
+}
+
+static void deliverBle(uint64_t tag, uint64_t atUs) { bleLatency.deliver(tag, atUs); }
+
+// Одна notify в канал: несёт байты очереди BLE (from, upTo]; доставка последней notify порции
+// завершает их, отказ любой — теряет
+// retry — отказ не теряет данные: конвейер повторит порцию (обычный поток)
+static bool notifyBle(const uint8_t* data, size_t n, uint64_t from, uint64_t upTo, bool last = true,
+                      bool retry = false) {
+    const uint64_t tag = last ? upTo : 0;
+    if (!bleLink) {
+        bleTx.notify(data, n);
+        bridgeCounters.bleBytesOut += n;
+        bleLatency.deliver(tag, nativeClock().nowMicros());
+        return true;
+    }
+    uint64_t truncated = bleLink->truncatedBytes;
+    if (!bleLink->notify(n, nativeClock().nowMicros(), tag)) {
+        bridgeCounters.notifyFailures++;
+        if (retry) return false;
+        bleLatency.lose(from, upTo);
+        noteBleLoss();
+        return false;
+    }
+    if (bleLink->truncatedBytes != truncated) noteBleLoss();
+    bridgeCounters.bleBytesOut += n;
+    bleTx.notify(data, n);
+    return true;
+}
+
+// Время прихода байт UART: конец порции в потоке -> модельное время подачи
+static std::deque<std::pair<uint64_t, uint64_t>> uartArrivals;
+static uint64_t uartInjected = 0, uartConsumed = 0;
+static size_t uartMaxBacklog = 0;
+
+static void injectUart(const uint8_t* data, size_t len) {
+    SerialPort.inject(data, len);
+    uartInjected += len;
+    uartArrivals.emplace_back(uartInjected, nativeClock().nowMicros());
+    if ((size_t)SerialPort.available() > uartMaxBacklog) uartMaxBacklog = SerialPort.available();
+}
+
+// Время прихода последнего байта прочитанной порции
+static uint64_t consumeUart(size_t n) {
+    uartConsumed += n;
+    while (uartArrivals.size() > 1 && uartArrivals.front().first < uartConsumed) uartArrivals.pop_front();
+    return uartArrivals.empty() ? nativeClock().nowMicros() : uartArrivals.front().second;
+}
+
+// ==============================================
+// ОКРУЖЕНИЕ КОНВЕЙЕРА
+// ==============================================
+
+struct NativeHal {
+    bool lossPending = false;
+    uint64_t linkReadyUs = 0;  // --link-delay-ms: handle соединения приходит позже onConnect
+
+    int uartAvailable() { return SerialPort.available(); }
+    size_t uartRead(uint8_t* dst, size_t n) { return SerialPort.readBytes(dst, n); }
+    void uartWrite(const uint8_t* src, size_t n) { SerialPort.write(src, n); }
+    void onUartChunk(const uint8_t* data, size_t n) {
+        uint64_t arrived = consumeUart(n);
+        uint32_t bleBefore = bleQueuedTotal;
+        uint32_t wifiBefore = wifiQueuedTotal[0];
+        routeUartChunk(data, n);
+        bleLatency.enqueue(bleQueuedTotal - bleBefore, arrived);
+        wifiLatency.enqueue(wifiQueuedTotal[0] - wifiBefore, arrived);
+    }
+    size_t rxAvailable() {
+        if (bleRxBuffer.hasOverflowed()) rxOverflows++;
+        return bleRxBuffer.available();
+    }
+    size_t rxRead(uint8_t* dst, size_t n) { return bleRxBuffer.read(dst, n); }
+    void onControlCommand(const char* line, size_t len) { postControlCommand(CONTROL_SOURCE_BLE, line, len); }
+    bool bleConnected() { return deviceConnected; }
+    bool bleLinkReady() { return nativeClock().nowMicros() >= linkReadyUs; }
+    size_t bleMaxPayload() { return (bleLink ? bleLink->params.mtu : 517) - 3; }
+    size_t bleQueued() { return getRingBufferAvailable(); }
+    bool bleOverflowed() {
+        lossPending = getRingBufferOverflow();
+        if (lossPending) {
+            bleOverflows++;
+            noteBleLoss();
+        }
+        return lossPending;
+    }
+    size_t bleDequeue(uint8_t* dst, size_t n) {
+        uint64_t before = bleLatency.sent;
+        n = readFromRingBuffer(dst, n);
+        bleLatency.sent = bleLatency.queued - bleRingBuffer.available();  // Модель — только основная очередь
+        if (lossPending) bleLatency.lose(before, bleLatency.sent - n);
+        lossPending = false;
+        return n;
+    }
+    bool bleSend(const uint8_t* data, size_t n) {
+        if (!bleCompressed) {
+            if (!notifyBle(data, n, bleLatency.sent - n, bleLatency.sent, true, true)) return false;
+            noteBleLatency();
+            return true;
+        }
+        // Сжатые пакеты: данные доставлены, когда ушёл последний; неполная запись ждёт в bleZFramer.
+        // Отказ теряет пакет и сбивает словарь клиента: остаток пакетов закодирован по сбитому
+        // словарю и тоже теряется, кодер сбрасывается, как в notifyCompressed() прошивки
+        size_t maxPayload = (bleLink ? bleLink->params.mtu : 517) - 3;
+        std::vector<uint8_t> packets;
+        std::vector<size_t> ends;
+        auto collect = [&](const uint8_t* packet, size_t len) {
+            packets.insert(packets.end(), packet, packet + len);
+            ends.push_back(packets.size());
+        };
+        bleZFramer.feed(data, n, [&](const uint8_t* rec, size_t len, uint8_t) {
+            blePacketizer.addRecord(rec, len, maxPayload, collect);
+        });
+        blePacketizer.flush(collect);
+        static uint64_t packedUpTo = 0;
+        const uint64_t upTo = bleLatency.sent - bleZFramer.len;
+        bool lost = false;
+        for (size_t k = 0, start = 0; k < ends.size(); start = ends[k++]) {
+            if (!notifyBle(packets.data() + start, ends[k] - start, packedUpTo, upTo, k + 1 == ends.size())) {
+                blePacketizer.reset();
+                lost = true;
+                break;
+            }
+            decodeBleZ(packets.data() + start, ends[k] - start);
+        }
+        if (!ends.empty()) packedUpTo = upTo;
+        if (lost) {
+            dropBleLatency();
+        } else {
+            noteBleLatency();
+        }
+        return true;
+    }
+    void log(const char*) {}  // Предупреждения считаются в отчёте
+};
+
+static NativeHal nativeHal;
+static BridgePipeline<BoardProfileHost, NativeHal> pipeline(nativeHal);
+
+// Команды $BRIDGE во вставленных потоках: правила отправки BLE меняются, NVS нет
+void applyBridgeSettings(uint8_t action) {
+    pipeline.flushTuning.sendThreshold = bridgeSettings.bleThreshold;
+    pipeline.flushTuning.flushIntervalMs = bridgeSettings.bleIntervalMs;
+    pipeline.flushTuning.chunk = bridgeSettings.bleChunk;
+    if (action == BRIDGE_ACTION_SAVE) printf("$BRIDGE SAVE: no NVS in the host build\n");
+}
+
+// Запись во флеш (--flash-log DIR): задача записи прошивки — на каждом шаге моста, сегменты — файлы в DIR
+static const char* flashLogDir = nullptr;
+
+static void flashLogSegmentPath(char* out, size_t cap, uint32_t segment) {
+    snprintf(out, cap, "%s/%06u.uml", flashLogDir, (unsigned)segment);
+}
+
+// drain — дописать и неполную страницу, как по FLASH_LOG_FLUSH_MS
+static void serviceFlashLog(bool drain) {
+    static FILE* file = nullptr;
+    static uint8_t buf[FLASH_LOG_PAGE_BYTES];
+    FlashLogBatch b;
+    while (flashLog.takeBatch(buf, millis() + (drain ? FLASH_LOG_FLUSH_MS : 0), b) > 0) {
+        if (b.segmentStart) {
+            char path[512];
+            flashLogSegmentPath(path, sizeof(path), b.segment);
+            if (file) fclose(file);
+            file = fopen(path, "wb");
+            flashLog.segmentsOpened++;
+        }
+        uint64_t t0 = hostNs();
+        size_t written = file ? fwrite(buf, 1, b.len, file) : 0;
+        flashLog.noteWrite((uint32_t)((hostNs() - t0) / 1000), b.len, written == b.len);
+    }
+    if (drain && file) fflush(file);
+}
+
+// Один проход цикла C3: приём, входящие, отправка BLE и WiFi; false — работы нет
+static bool stepBridge() {
+    uint64_t t0 = hostNs();
+    size_t in = pipeline.ingest();
+    uint64_t t1 = hostNs();
+    size_t rx = pipeline.forwardRx();
+    uint64_t t2 = hostNs();
+    size_t out = 0, sent;
+    while ((sent = pipeline.flushBle(millis())) > 0) out += sent;
+    if (bleLink) bleLink->advance(nativeClock().nowMicros(), deliverBle);
+    uint64_t t3 = hostNs();
+
+    size_t wifiBefore = wifiRingBuffers[0].available();
+    bool wifiLost = wifiRingBuffers[0].hasOverflowed();
+    uint64_t wifiBytes = wifiClients[0].bytes;
+    forwardWiFiRx(wifiClients, SerialPort);
+    serviceControlCommands();
+    serviceReplay();
+    wifiLatency.queued += wifiRingBuffers[0].available() - wifiBefore;  // История и ответы — без меток времени
+    wifiBefore = wifiRingBuffers[0].available();
+    flushWiFiSinks(wifiClients);
+    uint64_t t4 = hostNs();
+    size_t wifiRead = wifiBefore - wifiRingBuffers[0].available();
+    if (wifiRead > 0) {
+        wifiLatency.sent = wifiLatency.queued - wifiRingBuffers[0].available();
+        if (wifiLost) {
+            wifiOverflows++;
+            wifiLatency.lose(0, wifiLatency.sent - wifiRead);
+        }
+        wifiLatency.deliver(wifiLatency.sent, nativeClock().nowMicros());
+    }
+    serviceFlashLog(false);
+
+    const uint64_t ns[STAGE_COUNT] = {t1 - t0, t2 - t1, t3 - t2, t4 - t3};
+    const uint64_t bytes[STAGE_COUNT] = {in, rx, out, wifiClients[0].bytes - wifiBytes};
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        stages[s].ns += ns[s];
+        stages[s].calls++;
+        stages[s].bytes += bytes[s];
+    }
+    return in || rx || out || wifiRead;
+}
+
+static void runUntilIdle() {
+    while (stepBridge()) {
+    }
+}
+
+// ==============================================
+// ИСТОЧНИКИ ДАННЫХ
+// ==============================================
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (!f) return false;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) out.insert(out.end(), chunk, chunk + n);
+    if (f != stdin) fclose(f);
+    return true;
+}
+
+static bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+// Поправки из файла: порциями chunk байт со средней скоростью rate байт/с
+struct CorrectionFeed {
+    uint8_t channel;
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+    size_t chunk;
+    double rate = 0;
+    double credit = 0;
+
+    // Подача за прошедшие elapsedUs; при flat — одна порция за вызов
+    void service(uint64_t elapsedUs, bool flat);
+};
+
+static uint64_t injected[CAP_CHANNEL_COUNT];
+
+static void injectRecord(uint8_t channel, const uint8_t* data, size_t len) {
+    injected[channel < CAP_CHANNEL_COUNT ? channel : CAP_UART_RX] += len;
+    switch (channel) {
+        case CAP_BLE_RX:
+            bleRxBuffer.write(data, len);  // Как RxCallbacks::onWrite
+            break;
+        case CAP_WIFI_RX:
+            wifiClients[0].incoming.insert(wifiClients[0].incoming.end(), data, data + len);
+            break;
+        default:
+            injectUart(data, len);
+            break;
+    }
+}
+
+void CorrectionFeed::service(uint64_t elapsedUs, bool flat) {
+    if (pos >= data.size()) return;
+    credit = flat ? (double)chunk : credit + rate * elapsedUs / 1e6;
+    while (credit >= 1 && pos < data.size()) {
+        size_t n = std::min(std::min(chunk, data.size() - pos), (size_t)credit);
+        if (n < chunk && pos + n < data.size()) break;  // Копим до целой порции
+        injectRecord(channel, data.data() + pos, n);
+        pos += n;
+        credit -= n;
+    }
+}
+
+// ==============================================
+// СВЕРКА ВЫВОДА
+// ==============================================
+
+static bool compareBytes(const char* what, const std::vector<uint8_t>& got, const uint8_t* want, size_t wantLen) {
+    size_t common = std::min(got.size(), wantLen);
+    size_t i = 0;
+    while (i < common && got[i] == want[i]) i++;
+    if (i == common && got.size() == wantLen) {
+        printf("  %-12s byte-exact (%zu B)\n", what, wantLen);
+        return true;
+    }
+    printf("  %-12s MISMATCH: got %zu B, expected %zu B, first difference at offset %zu\n", what, got.size(),
+           wantLen, i);
+    size_t from = (i > 16) ? i - 16 : 0;
+    for (int side = 0; side < 2; side++) {
+        const uint8_t* p = side ? want : got.data();
+        size_t len = side ? wantLen : got.size();
+        printf("    %s:", side ? "expected" : "got     ");
+        for (size_t k = from; k < from + 40 && k < len; k++) printf("%s%02X", k == i ? " [" : " ", p[k]);
+        printf("\n");
+    }
+    return false;
+}
+
+// Вывод с потерями: очереди теряют только целые записи, поэтому поток
+// потребителя режется на кадры без сырых байт и с верными суммами
+static bool checkFramed(const char* what, const std::vector<uint8_t>& got) {
+    static StreamFramer framer;
+    size_t records = 0, broken = 0;
+    framer.reset();
+    framer.feed(got.data(), got.size(), [&](const uint8_t* rec, size_t len, uint8_t type) {
+        records++;
+        if (type == ST_RAW || (type <= ST_NMEA_OTHER && !nmeaChecksumOk(rec, len)) ||
+            (type == ST_RTCM && !rtcmFrameCrcOk(rec, len))) {
+            broken++;
+        }
+    });
+    if (broken == 0 && framer.len == 0) {
+        printf("  %-12s frame-aligned (%zu records)\n", what, records);
+        return true;
+    }
+    printf("  %-12s BROKEN: %zu of %zu records, %zu B unframed at the end\n", what, broken, records, framer.len);
+    return false;
+}
+
+// Полосы BLE меняют порядок записей только между полосами: основная полоса
+// совпадает со входом побайтно, полоса приоритета — вход без заменённых записей
+static bool compareLanes(const std::vector<uint8_t>& got, const uint8_t* want, size_t wantLen, size_t superseded) {
+    std::vector<uint8_t> bulk[2];              // [вход/выход]
+    std::vector<std::string> priority[2];
+    static StreamFramer framer;
+    for (int side = 0; side < 2; side++) {
+        framer.reset();
+        framer.feed(side ? got.data() : want, side ? got.size() : wantLen,
+                    [&](const uint8_t* rec, size_t len, uint8_t type) {
+                        if ((BLE_PRIORITY_TYPES >> type) & 1) {
+                            priority[side].emplace_back((const char*)rec, len);
+                        } else {
+                            bulk[side].insert(bulk[side].end(), rec, rec + len);
+                        }
+                    });
+    }
+    bool ok = compareBytes("BLE bulk", bulk[1], bulk[0].data(), bulk[0].size());
+    size_t matched = 0;
+    for (size_t k = 0; k < priority[0].size() && matched < priority[1].size(); k++) {
+        if (priority[0][k] == priority[1][matched]) matched++;
+    }
+    if (matched == priority[1].size() && matched + superseded == priority[0].size()) {
+        printf("  %-12s in order (%zu records, %zu superseded)\n", "BLE position", matched, superseded);
+        return ok;
+    }
+    printf("  %-12s MISMATCH: %zu of %zu records in input order, %zu input records, %zu superseded\n",
+           "BLE position", matched, priority[1].size(), priority[0].size(), superseded);
+    return false;
+}
+
+// Повтор истории: без ответов $BRIDGE вывод — начало входа, затем хвост
+// входа с точки повтора до конца, без пропусков
+static bool compareReplay(const char* what, const std::vector<uint8_t>& got, const uint8_t* want, size_t wantLen) {
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; i < got.size();) {
+        const uint8_t* eol = (const uint8_t*)memchr(got.data() + i, '\n', got.size() - i);
+        size_t end = eol ? (size_t)(eol - got.data()) + 1 : got.size();
+        if (end - i < BRIDGE_CMD_PREFIX_LEN || memcmp(got.data() + i, BRIDGE_CMD_PREFIX, BRIDGE_CMD_PREFIX_LEN) != 0) {
+            stream.insert(stream.end(), got.begin() + i, got.begin() + end);
+        }
+        i = end;
+    }
+    size_t live = 0;
+    while (live < stream.size() && live < wantLen && stream[live] == want[live]) live++;
+    size_t rest = stream.size() - live;
+    if (rest <= wantLen && wantLen - rest <= live &&
+        memcmp(stream.data() + live, want + wantLen - rest, rest) == 0) {
+        printf("  %-12s byte-exact with history (%zu B live, then %zu B from offset %zu)\n", what, live, rest,
+               wantLen - rest);
+        return true;
+    }
+    printf("  %-12s MISMATCH: %zu B match the input, then %zu B are not its tail\n", what, live, rest);
+    return false;
+}
+
+// Сегменты записи во флеш подряд: индекс каждого на месте, данные склеиваются во вход
+static bool compareFlashLog(const uint8_t* want, size_t wantLen) {
+    std::vector<uint8_t> stream, file;
+    size_t segments = 0, sentences = 0;
+    for (uint32_t n = 0; n < flashLog.segmentsOpened; n++, file.clear()) {
+        char path[512];
+        flashLogSegmentPath(path, sizeof(path), n);
+        FlashLogHeader h;
+        if (!readFile(path, file) || !flashLogDecodeHeader(file.data(), file.size(), h) || h.segment != n ||
+            h.streamOffset != stream.size()) {
+            printf("  %-12s BAD SEGMENT %s\n", "Flash log", path);
+            return false;
+        }
+        if (h.firstSentence != FLASH_LOG_NO_SENTENCE) {
+            size_t at = FLASH_LOG_HEADER_BYTES + h.firstSentence;
+            size_t len = strlen(h.sentence);
+            if (at + len > file.size() || memcmp(file.data() + at, h.sentence, len) != 0) {
+                printf("  %-12s BAD INDEX %s: first sentence at %u\n", "Flash log", path, (unsigned)h.firstSentence);
+                return false;
+            }
+            sentences++;
+        }
+        stream.insert(stream.end(), file.begin() + FLASH_LOG_HEADER_BYTES, file.end());
+        segments++;
+    }
+    printf("  %-12s %zu segments, %zu with the first sentence indexed\n", "Flash log", segments, sentences);
+    return compareBytes("Flash = input", stream, want, wantLen);
+}
+
+static bool compareWithFile(const char* what, const std::vector<uint8_t>& got, const char* path) {
+    std::vector<uint8_t> want;
+    if (!readFile(path, want)) {
+        printf("  %-12s cannot read %s\n", what, path);
+        return false;
+    }
+    return compareBytes(what, got, want.data(), want.size());
+}
+
+// ==============================================
+// ОТЧЁТ
+// ==============================================
+
+static void printLatency(const char* name, LatencyTrack& t) {
+    if (t.samples.empty()) {
+        printf("  %-5s no samples\n", name);
+        return;
+    }
+    printf("  %-5s per byte: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms (%zu chunks)\n", name,
+           t.percentile(0.50) / 1000.0, t.percentile(0.90) / 1000.0, t.percentile(0.99) / 1000.0,
+           t.percentile(1.0) / 1000.0, t.samples.size());
+}
+
+// Гистограмма прошивки (latency_trace.h): время чтения порции -> notify/write()
+static void printTracer(const char* name, LatencyTracer& trace) {
+    LatencyHistogram h;
+    trace.takeHistogram(h);
+    if (h.samples == 0) {
+        printf("  %-5s tracer: no samples\n", name);
+        return;
+    }
+    printf("  %-5s tracer: p50 %.0f ms, p99 %.0f ms, max %.2f ms (%u marks)\n", name, h.percentileUs(0.50f) / 1000.0,
+           h.percentileUs(0.99f) / 1000.0, h.maxUs / 1000.0, (unsigned)h.samples);
+}
+
+static void printGnssState() {
+    char line[48];
+    printf("GNSS state:\n");
+    fmtFixLine(line, sizeof(line), gpsData.satellites, gpsData.fixQuality);
+    printf("  %s\n", line);
+    fmtCoordLine(line, sizeof(line), "Lat:", fmtToScaled(gpsData.latitude, COORD_EXP10), 21);
+    printf("  %s\n", line);
+    fmtCoordLine(line, sizeof(line), "Lon:", fmtToScaled(gpsData.longitude, COORD_EXP10), 21);
+    printf("  %s\n", line);
+    fmtAltitudeLine(line, sizeof(line), fmtToScaled(gpsData.altitude, ALT_EXP10), "", 21);
+    printf("  %s\n", line);
+    fmtAccuracyLine2(line, sizeof(line), fmtToScaled(gpsData.latAccuracy, ACC_EXP10),
+                     fmtToScaled(gpsData.lonAccuracy, ACC_EXP10), fmtToScaled(gpsData.verticalAccuracy, ACC_EXP10));
+    printf("  %s\n", line);
+    fmtSatelliteLine(line, sizeof(line), satData.gps.visible, satData.glonass.visible, satData.galileo.visible,
+                     satData.beidou.visible, satData.qzss.visible);
+    printf("  %s\n", line);
+}
+
+static void usage() {
+    fprintf(stderr,
+            "Usage: bridge_native [options] capture.bin|-\n"
+            "       bridge_native --uart-link-selftest\n"
+            "       bridge_native --queue-selftest\n"
+            "       bridge_native --rx-selftest\n"
+            "       bridge_native --scheduler-selftest\n"
+            "       bridge_native --profile-selftest\n"
+            "  --baud N             pace a raw capture at N baud (default 921600)\n"
+            "  --speed X            replay UMCAP1 timing X times faster\n"
+            "  --flat               no pacing: feed everything as fast as the bridge takes it\n"
+            "  --ble-filter SPEC    BLE sink filter (stream_framer.h syntax)\n"
+            "  --wifi-filter SPEC   WiFi client filter\n"
+            "  --no-lanes           one BLE queue: no priority lane for position/time sentences\n"
+            "  --archive-kb N       stream archive for $BRIDGE,REPLAY, as PSRAM on the S3 (default off)\n"
+            "  --flash-log DIR      record the UART stream as flash log segments into DIR and check them\n"
+            "  --inject-ble FILE    correction stream written to the BLE RX characteristic\n"
+            "  --inject-wifi FILE   correction stream sent by the WiFi client\n"
+            "  --inject-rate B/S    correction rate (default 2000)\n"
+            "  --save-ble|--save-wifi|--save-uart FILE      write sink / receiver-bound output\n"
+            "  --expect-ble|--expect-wifi|--expect-uart FILE compare with a golden file\n"
+            "  --ble-link           send notifies through the BLE link model:\n"
+            "    --ci-ms X (7.5)  --mtu N (247)  --no-dle  --phy 1|2|coded (2)  --ppe N (6)  --ctrl-bufs N (12)\n"
+            "  --link-delay-ms X    the connection handle arrives X ms after the client connects\n"
+            "  --nd1                compressed TXZ stream (nmea_delta.h) instead of plain notifies\n"
+            "  --max-loss F         exit 1 if more than fraction F of BLE-bound bytes is lost\n"
+            "  --max-p99-ms X       exit 1 if BLE p99 latency exceeds X ms\n"
+            "  --telemetry          print the telemetry block as served on the status port\n");
+}
+
+int main(int argc, char** argv) {
+    uint32_t baud = 921600;
+    double speed = 1.0;
+    bool flat = false;
+    const char* bleSpec = BLE_SINK_FILTER;
+    const char* wifiSpec = WIFI_SINK_FILTER;
+    const char* path = nullptr;
+    const char* injectPath[CAP_CHANNEL_COUNT] = {nullptr, nullptr, nullptr};
+    double injectRate = 2000;
+    const char* savePath[3] = {nullptr, nullptr, nullptr};    // BLE, WiFi, UART
+    const char* expectPath[3] = {nullptr, nullptr, nullptr};  // BLE, WiFi, UART
+    static const char* outputNames[3] = {"ble", "wifi", "uart"};
+    bool useLink = false;
+    BleLinkParams linkParams;
+    double maxLoss = -1, maxP99Ms = -1;
+    bool showTelemetry = false;
+    size_t archiveKb = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool matched = false;
+        for (int k = 0; k < 3 && hasValue; k++) {
+            if (strncmp(a, "--save-", 7) == 0 && strcmp(a + 7, outputNames[k]) == 0) {
+                savePath[k] = argv[++i];
+                matched = true;
+            } else if (strncmp(a, "--expect-", 9) == 0 && strcmp(a + 9, outputNames[k]) == 0) {
+                expectPath[k] = argv[++i];
+                matched = true;
+            }
+        }
+        if (matched) continue;
+        if (strcmp(a, "--uart-link-selftest") == 0) {
+            return runUartLinkSelftest();
+        } else if (strcmp(a, "--queue-selftest") == 0) {
+            return runQueueSelftest();
+        } else if (strcmp(a, "--rx-selftest") == 0) {
+            return runRxSelftest();
+        } else if (strcmp(a, "--scheduler-selftest") == 0) {
+            return runSchedulerSelftest();
+        } else if (strcmp(a, "--profile-selftest") == 0) {
+            return runProfileSelftest();
+        } else if (strcmp(a, "--flat") == 0) {
+            flat = true;
+        } else if (strcmp(a, "--baud") == 0 && hasValue) {
+            baud = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(a, "--speed") == 0 && hasValue) {
+            speed = atof(argv[++i]);
+        } else if (strcmp(a, "--ble-filter") == 0 && hasValue) {
+            bleSpec = argv[++i];
+        } else if (strcmp(a, "--wifi-filter") == 0 && hasValue) {
+            wifiSpec = argv[++i];
+        } else if (strcmp(a, "--no-lanes") == 0) {
+            bridgeSettings.bleLanes = 0;
+        } else if (strcmp(a, "--archive-kb") == 0 && hasValue) {
+            archiveKb = (size_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(a, "--flash-log") == 0 && hasValue) {
+            flashLogDir = argv[++i];
+        } else if (strcmp(a, "--inject-ble") == 0 && hasValue) {
+            injectPath[CAP_BLE_RX] = argv[++i];
+        } else if (strcmp(a, "--inject-wifi") == 0 && hasValue) {
+            injectPath[CAP_WIFI_RX] = argv[++i];
+        } else if (strcmp(a, "--inject-rate") == 0 && hasValue) {
+            injectRate = atof(argv[++i]);
+        } else if (strcmp(a, "--ble-link") == 0) {
+            useLink = true;
+        } else if (strcmp(a, "--ci-ms") == 0 && hasValue) {
+            linkParams.connIntervalMs = atof(argv[++i]);
+        } else if (strcmp(a, "--mtu") == 0 && hasValue) {
+            linkParams.mtu = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--no-dle") == 0) {
+            linkParams.dle = false;
+        } else if (strcmp(a, "--phy") == 0 && hasValue) {
+            const char* phy = argv[++i];
+            linkParams.phy = (strcmp(phy, "coded") == 0) ? 3 : (uint8_t)atoi(phy);
+        } else if (strcmp(a, "--ppe") == 0 && hasValue) {
+            linkParams.packetsPerEvent = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--ctrl-bufs") == 0 && hasValue) {
+            linkParams.controllerBuffers = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--telemetry") == 0) {
+            showTelemetry = true;
+        } else if (strcmp(a, "--link-delay-ms") == 0 && hasValue) {
+            nativeHal.linkReadyUs = (uint64_t)(atof(argv[++i]) * 1000);
+        } else if (strcmp(a, "--nd1") == 0) {
+            bleCompressed = true;
+        } else if (strcmp(a, "--max-loss") == 0 && hasValue) {
+            maxLoss = atof(argv[++i]);
+        } else if (strcmp(a, "--max-p99-ms") == 0 && hasValue) {
+            maxP99Ms = atof(argv[++i]);
+        } else if (a[0] == '-' && a[1] != '\0') {
+            usage();
+            return 2;
+        } else {
+            path = a;
+        }
+    }
+    if (!path || baud == 0 || speed <= 0) {
+        usage();
+        return 2;
+    }
+
+    std::vector<uint8_t> capture;
+    if (!readFile(path, capture)) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return 2;
+    }
+    std::vector<CorrectionFeed> feeds;
+    for (uint8_t ch = CAP_BLE_RX; ch < CAP_CHANNEL_COUNT; ch++) {
+        if (!injectPath[ch]) continue;
+        CorrectionFeed feed;
+        feed.channel = ch;
+        feed.chunk = (ch == CAP_BLE_RX) ? 244 : 1460;  // Запись в характеристику (MTU 247) / сегмент TCP
+        feed.rate = injectRate;
+        if (!readFile(injectPath[ch], feed.data)) {
+            fprintf(stderr, "Cannot read %s\n", injectPath[ch]);
+            return 2;
+        }
+        feeds.push_back(feed);
+    }
+
+    nativeClock().manual = true;
+    static std::vector<uint8_t> archiveMem;
+    if (archiveKb > 0) {
+        archiveMem.resize(StreamArchive::footprint(archiveKb * 1024));
+        streamArchive.begin(archiveMem.data(), archiveKb * 1024);
+    }
+    static uint8_t flashLogStage[FLASH_LOG_STAGE_BYTES];
+    if (flashLogDir) flashLog.begin(flashLogStage, sizeof(flashLogStage), 0);
+    static BleLinkSim link(linkParams);
+    if (useLink) bleLink = &link;
+    if (!bleFilter.parse(bleSpec)) fprintf(stderr, "Bad BLE filter: %s\n", bleSpec);
+    if (!wifiFilters[0].parse(wifiSpec)) fprintf(stderr, "Bad WiFi filter: %s\n", wifiSpec);
+    // Подключение BLE как в прошивке: фильтр разбирает поток приёма из настроек
+    snprintf(bridgeSettings.bleFilter, sizeof(bridgeSettings.bleFilter), "%s", bleSpec);
+    bleConnects++;
+    deviceConnected = true;
+    wifiClients[0].open = true;
+    wifiClientConnected[0] = true;
+
+    // Модельное время идёт шагами не длиннее 1 мс, как тики loop()
+    auto advanceTo = [&](uint64_t targetUs) {
+        while (nativeClock().nowMicros() < targetUs) {
+            uint64_t step = std::min<uint64_t>(1000, targetUs - nativeClock().nowMicros());
+            nativeClock().advanceMicros(step);
+            for (auto& feed : feeds) feed.service(step, false);
+            runUntilIdle();
+        }
+    };
+
+    const bool timed = captureHasMagic(capture.data(), capture.size());
+    CaptureReader reader(capture.data(), capture.size());
+    std::vector<uint8_t> uartStream;  // Поток приёмника для побайтной сверки
+    uint64_t recordUs = 0;
+    if (timed) {
+        CaptureRecord rec;
+        while (reader.next(rec)) {
+            recordUs += (uint64_t)(rec.deltaUs / speed);
+            if (!flat) advanceTo(recordUs);
+            injectRecord(rec.channel, rec.data, rec.len);
+            if (rec.channel == CAP_UART_RX || rec.channel >= CAP_CHANNEL_COUNT) {
+                uartStream.insert(uartStream.end(), rec.data, rec.data + rec.len);
+            }
+            if (flat) {
+                for (auto& feed : feeds) feed.service(0, true);
+            }
+            runUntilIdle();
+        }
+        if (reader.truncated) fprintf(stderr, "Capture truncated at offset %zu\n", reader.pos);
+    } else {
+        // Сырой поток: порция на каждую миллисекунду линии
+        uartStream.swap(capture);
+        const double bytesPerMs = baud / 10.0 / 1000.0 * speed;
+        double credit = 0;
+        for (size_t fed = 0; fed < uartStream.size();) {
+            size_t n = std::min<size_t>(flat ? BoardProfileHost::UART_READ_CHUNK : (size_t)(credit += bytesPerMs),
+                                        uartStream.size() - fed);
+            if (!flat) {
+                credit -= n;
+                advanceTo(nativeClock().nowMicros() + 1000);
+            } else {
+                for (auto& feed : feeds) feed.service(0, true);
+            }
+            injectRecord(CAP_UART_RX, uartStream.data() + fed, n);
+            fed += n;
+            runUntilIdle();
+        }
+    }
+    // Остаток поправок и хвосты очередей уходят по интервалу отправки
+    for (bool pending = true; pending;) {
+        pending = false;
+        for (auto& feed : feeds) {
+            if (feed.pos < feed.data.size()) pending = true;
+        }
+        if (pending && flat) {
+            for (auto& feed : feeds) feed.service(0, true);
+            runUntilIdle();
+        } else if (pending) {
+            advanceTo(nativeClock().nowMicros() + 1000);
+        }
+    }
+    advanceTo(nativeClock().nowMicros() + 3 * (BoardProfileHost::BLE_FLUSH_INTERVAL_MS + 1) * 1000);
+    while (bleLink && !bleLink->idle()) advanceTo(nativeClock().nowMicros() + 1000);
+    checkSatelliteTimeouts();
+    serviceFlashLog(true);
+
+    // ---------------- Отчёт ----------------
+    const double modelSecs = nativeClock().nowMicros() / 1e6;
+    printf("Input: %s, %llu B UART, %llu B BLE RX, %llu B WiFi RX in %.3f s model time (%s)\n",
+           timed ? "UMCAP1" : "raw", (unsigned long long)injected[CAP_UART_RX],
+           (unsigned long long)injected[CAP_BLE_RX], (unsigned long long)injected[CAP_WIFI_RX], modelSecs,
+           flat ? "flat-out" : timed ? "recorded timing" : "paced");
+
+    printf("Stages (host CPU):\n");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const StageStat& st = stages[s];
+        printf("  %-10s %12llu B  %8.1f MB/s  %7.0f ns/call\n", st.name, (unsigned long long)st.bytes,
+               st.ns ? st.bytes * 1e3 / st.ns : 0.0, st.calls ? (double)st.ns / st.calls : 0.0);
+    }
+
+    printf("Sinks:\n");
+    printf("  BLE   %llu B in %llu notifies (max %zu B), %.0f B/s\n", (unsigned long long)bleTx.bytes,
+           (unsigned long long)bleTx.notifies, bleTx.maxPayload, modelSecs > 0 ? bleTx.bytes / modelSecs : 0.0);
+    printf("  WiFi  %llu B, %.0f B/s\n", (unsigned long long)wifiClients[0].bytes,
+           modelSecs > 0 ? wifiClients[0].bytes / modelSecs : 0.0);
+    printf("  UART  %zu B to receiver, max RX backlog %zu B\n", SerialPort.tx.size(), uartMaxBacklog);
+
+    printf("Latency receiver -> sink:\n");
+    printLatency("BLE", bleLatency);
+    printLatency("WiFi", wifiLatency);
+    printTracer("BLE", bleTrace);
+    if (bridgeSettings.bleLanes) printTracer("BLE pos", blePriorityTrace);
+    printTracer("WiFi", wifiTrace[0]);
+
+    printf("Overflows: BLE queue %llu, WiFi queue %llu, BLE RX %llu\n", (unsigned long long)bleOverflows,
+           (unsigned long long)wifiOverflows, (unsigned long long)rxOverflows);
+    if (bridgeSettings.bleLanes) {
+        printf("BLE priority lane: %u B, %u records (%u B) superseded\n", (unsigned)blePriorityQueuedTotal,
+               (unsigned)bleSuperseded, (unsigned)blePriorityLane.supersededBytes);
+    }
+
+    // Потери BLE: всё, что ушло в очередь BLE, но не дошло до эфира
+    const uint32_t bleQueuedAll = bleQueuedTotal + blePriorityQueuedTotal;
+    // Заменённые в полосе приоритета записи — не потери: их место заняли более свежие
+    // ND1: доставленное — вывод декодера клиента, неполная запись ждёт в bleZFramer
+    const uint64_t bleDelivered =
+        bleCompressed ? bleZDecoded.size() + bleZFramer.len : bleLink ? bleLink->deliveredBytes : bleTx.bytes;
+    const uint64_t bleLost =
+        bleQueuedAll - bleDelivered - getRingBufferAvailable() - blePriorityLane.supersededBytes;
+    const double lossFraction = bleQueuedAll ? (double)bleLost / bleQueuedAll : 0.0;
+    size_t lossSeconds = 0;
+    for (uint8_t lost : bleLossSeconds) lossSeconds += lost;
+    const size_t totalSeconds = (size_t)modelSecs + 1;
+    if (bleLink) {
+        const BleLinkSim& l = *bleLink;
+        printf("BLE link: CI %.2f ms, MTU %u, %s, PHY %s, %u PDU/event (limit %u), %u controller buffers\n",
+               l.params.connIntervalMs, (unsigned)l.params.mtu, l.params.dle ? "DLE" : "no DLE",
+               l.params.phy == 1 ? "1M" : l.params.phy == 3 ? "Coded S8" : "2M", (unsigned)l.pdusPerEventLimit(),
+               (unsigned)l.params.packetsPerEvent, (unsigned)l.params.controllerBuffers);
+        printf("  capacity %.0f B/s, delivered %.0f B/s, %llu events, %.2f PDU/event, max %u buffers in use\n",
+               l.capacityBytesPerSec(), modelSecs > 0 ? l.deliveredBytes / modelSecs : 0.0,
+               (unsigned long long)l.events, l.events ? (double)l.pdusSent / l.events : 0.0,
+               (unsigned)l.maxBuffersUsed);
+        printf("  notifies %llu, rejected %llu (%llu B), truncated to MTU-3: %llu B\n",
+               (unsigned long long)l.notifies, (unsigned long long)l.failures, (unsigned long long)l.failedBytes,
+               (unsigned long long)l.truncatedBytes);
+    }
+    if (bleCompressed) {
+        printf("BLE ND1: %u -> %u B, ratio %.2f, %llu packets rejected by the decoder\n",
+               (unsigned)blePacketizer.rawBytes, (unsigned)blePacketizer.packedBytes,
+               blePacketizer.packedBytes ? (double)blePacketizer.rawBytes / blePacketizer.packedBytes : 0.0,
+               (unsigned long long)bleZRejected);
+    }
+    printf("BLE loss: %llu of %u B (%.4f%%)", (unsigned long long)bleLost, (unsigned)bleQueuedAll,
+           lossFraction * 100);
+    printf(", loss in %zu of %zu s (p = %.3f)\n", lossSeconds, totalSeconds, (double)lossSeconds / totalSeconds);
+    printf("Pending in framer: %zu B\n", uartFramer.len);
+    if (streamArchive.enabled()) {
+        printf("Archive: %u of %u KB, %u records evicted; %u replays, %u records replayed, %u overruns\n",
+               (unsigned)(streamArchive.usedBytes() / 1024), (unsigned)(streamArchive.capacity() / 1024),
+               (unsigned)streamArchive.evictedRecords, (unsigned)replaysStarted, (unsigned)replayRecords,
+               (unsigned)replayOverrun);
+    }
+    if (flashLog.enabled()) {
+        const LatencyHistogram& t = flashLog.writeTime;
+        printf("Flash log: %u segments, %llu B in %u writes (max %u us, host), stage high water %u B, "
+               "%u records dropped\n",
+               (unsigned)flashLog.segmentsOpened, (unsigned long long)flashLog.bytesWritten, (unsigned)flashLog.writes,
+               (unsigned)t.maxUs, (unsigned)flashLog.stageHighWater, (unsigned)flashLog.droppedRecords);
+    }
+
+    const std::vector<uint8_t>* outputs[3] = {&bleTx.data, &wifiClients[0].data, &SerialPort.tx};
+    for (int k = 0; k < 3; k++) {
+        if (savePath[k] && !writeFile(savePath[k], *outputs[k])) fprintf(stderr, "Cannot write %s\n", savePath[k]);
+    }
+
+    bool ok = true;
+    printf("Output check:\n");
+    const size_t framed = uartStream.size() - uartFramer.len;
+    // Один повтор истории за прогон — сверка с ним; полосы BLE с историей не сверяются
+    const bool replayed = replaysStarted == 1;
+    // ND1 сверяется по выводу декодера; незакодированный хвост bleZFramer ещё не отправлен
+    const std::vector<uint8_t>& bleStream = bleCompressed ? bleZDecoded : bleTx.data;
+    const size_t bleFramed = framed - (bleCompressed ? bleZFramer.len : 0);
+    const char* bleWhat = bleCompressed ? "BLE ND1" : "BLE = input";
+    if (bleFilter.passAll && lossSeconds == 0 && !bridgeSettings.bleLanes) {
+        ok &= replayed ? compareReplay(bleWhat, bleStream, uartStream.data(), bleFramed)
+                       : compareBytes(bleWhat, bleStream, uartStream.data(), bleFramed);
+    } else if (bleFilter.passAll && lossSeconds == 0 && !replaysStarted) {
+        ok &= compareLanes(bleStream, uartStream.data(), bleFramed, bleSuperseded);
+    }
+    if (bleZRejected) {
+        printf("  FAIL: %llu ND1 packets rejected by the decoder\n", (unsigned long long)bleZRejected);
+        ok = false;
+    }
+    if (wifiFilters[0].passAll && !wifiOverflows) {
+        ok &= replayed ? compareReplay("WiFi = input", wifiClients[0].data, uartStream.data(), framed)
+                       : compareBytes("WiFi = input", wifiClients[0].data, uartStream.data(), framed);
+    }
+    // Переполнение очередей не рвёт кадры; отказы notify в модели канала — рвут
+    if (!bleCompressed && bleRingBuffer.droppedRecordsTotal() > 0 && !(bleLink && bleLink->failures)) {
+        ok &= checkFramed("BLE stream", bleTx.data);
+    }
+    if (wifiOverflows) ok &= checkFramed("WiFi stream", wifiClients[0].data);
+    if (flashLog.enabled() && !flashLog.droppedRecords) ok &= compareFlashLog(uartStream.data(), framed);
+    // Единственный источник поправок — файл для WiFi или BLE: приёмник получает его как есть
+    if (injectPath[CAP_WIFI_RX] && !injected[CAP_BLE_RX] && injected[CAP_WIFI_RX] == feeds.back().data.size()) {
+        ok &= compareBytes("UART = WiFi", SerialPort.tx, feeds.back().data.data(), feeds.back().data.size());
+    }
+    if (injectPath[CAP_BLE_RX] && !injected[CAP_WIFI_RX] && injected[CAP_BLE_RX] == feeds.back().data.size()) {
+        ok &= compareBytes("UART = BLE", SerialPort.tx, feeds.back().data.data(), feeds.back().data.size());
+    }
+    for (int k = 0; k < 3; k++) {
+        if (!expectPath[k]) continue;
+        std::string what = std::string(outputNames[k]) + " golden";
+        ok &= compareWithFile(what.c_str(), *outputs[k], expectPath[k]);
+    }
+    if (maxLoss >= 0 && lossFraction > maxLoss) {
+        printf("  FAIL: BLE loss %.4f%% above %.4f%%\n", lossFraction * 100, maxLoss * 100);
+        ok = false;
+    }
+    if (maxP99Ms >= 0 && bleLatency.percentile(0.99) / 1000.0 > maxP99Ms) {
+        printf("  FAIL: BLE p99 %.2f ms above %.2f ms\n", bleLatency.percentile(0.99) / 1000.0, maxP99Ms);
+        ok = false;
+    }
+    printGnssState();
+    if (showTelemetry) {
+        static char text[1536];
+        TelemetryRecord record;
+        telemetrySnapshot(record);
+        printf("Telemetry (%u-byte record):\n", (unsigned)sizeof(record));
+        fwrite(text, 1, telemetryFormatText(text, sizeof(text), record), stdout);
+    }
+    return ok ? 0 : 1;
+}
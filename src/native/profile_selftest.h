@@ -0,0 +1,116 @@
+// Проверка расчётов профиля задач (task_profile.h) на заданных снимках
+//
+// Снимки задач и кучи задаёт сценарий, как их собрал бы main.cpp с
+// -DTASK_PROFILE=1: время выполнения задач, время снимка и свободная куча.
+//
+// runProfileSelftest() (--profile-selftest): доля CPU по разнице снимков
+// задачи с тем же именем при другом порядке задач, новая задача и задача без
+// времени выполнения, предел 100 %, переполнение счётчиков времени, тренд и
+// фрагментация кучи по кольцу истории, текстовый отчёт.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../task_profile.h"
+
+static TaskProfileEntry profileTask(const char* name, uint32_t runTimeUs, bool hasRunTime = true) {
+    TaskProfileEntry t;
+    memset(&t, 0, sizeof(t));
+    snprintf(t.name, sizeof(t.name), "%s", name);
+    t.runTimeUs = runTimeUs;
+    t.hasRunTime = hasRunTime;
+    t.core = -1;
+    return t;
+}
+
+static uint16_t profileCpu(const TaskProfile& p, const char* name) {
+    for (size_t i = 0; i < p.taskCount; i++) {
+        if (strcmp(p.tasks[i].name, name) == 0) return p.tasks[i].cpuPermille;
+    }
+    return 0xFFFF;
+}
+
+static bool profileCheck(const char* scenario, bool ok, const char* detail) {
+    printf("profile %-12s %-56s %s\n", scenario, detail, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Сценарии профиля; 0 — все прошли
+static int runProfileSelftest() {
+    bool ok = true;
+    char detail[96];
+    {
+        // Второй снимок в другом порядке: доли по именам, новая задача и задача без времени — 0
+        static TaskProfile p;
+        TaskProfileEntry first[] = {profileTask("dataTask", 1000), profileTask("bleTask", 5000),
+                                    profileTask("loopTask", 0, false)};
+        p.updateTasks(first, 3, 100000, true);
+        bool firstZero = p.periodUs == 0 && profileCpu(p, "dataTask") == 0 && profileCpu(p, "bleTask") == 0;
+        TaskProfileEntry second[] = {profileTask("bleTask", 5000 + 40000), profileTask("wifiTask", 7000),
+                                     profileTask("loopTask", 0, false), profileTask("dataTask", 1000 + 25000)};
+        p.updateTasks(second, 4, 200000, true);
+        snprintf(detail, sizeof(detail), "data %u ble %u wifi %u loop %u permille, period %lu us",
+                 profileCpu(p, "dataTask"), profileCpu(p, "bleTask"), profileCpu(p, "wifiTask"),
+                 profileCpu(p, "loopTask"), (unsigned long)p.periodUs);
+        ok &= profileCheck("cpu-share", firstZero && p.periodUs == 100000 && profileCpu(p, "dataTask") == 250 &&
+                                            profileCpu(p, "bleTask") == 400 && profileCpu(p, "wifiTask") == 0 &&
+                                            profileCpu(p, "loopTask") == 0 && p.taskCount == 4,
+                           detail);
+    }
+    {
+        // Счётчики времени задач и снимка переполняются; доля выше периода — 100 %
+        static TaskProfile p;
+        TaskProfileEntry first[] = {profileTask("dataTask", 0xFFFFF000u), profileTask("IDLE0", 0xFFFF0000u)};
+        p.updateTasks(first, 2, 0xFFFF0000u, true);
+        TaskProfileEntry second[] = {profileTask("dataTask", 0x00000F00u), profileTask("IDLE0", 0x00030000u)};
+        p.updateTasks(second, 2, 0x00010000u, true);  // Период 0x20000 мкс
+        snprintf(detail, sizeof(detail), "data %u idle %u permille, period %lu us", profileCpu(p, "dataTask"),
+                 profileCpu(p, "IDLE0"), (unsigned long)p.periodUs);
+        const uint16_t dataShare = 0x1F00 * 1000 / 0x20000;
+        ok &= profileCheck("wrap-clamp", p.periodUs == 0x20000 && profileCpu(p, "dataTask") == dataShare &&
+                                             profileCpu(p, "IDLE0") == 1000,
+                           detail);
+    }
+    {
+        // 30 снимков раз в минуту, куча теряет 1200 байт в минуту: тренд по
+        // последним TASK_PROFILE_HEAP_HISTORY, фрагментация — по последнему
+        static TaskProfile p;
+        for (uint32_t k = 0; k < 30; k++) {
+            uint32_t freeBytes = 200000 - 1200 * k - (k >= 20 ? 3000 : 0);  // Скачок в окне истории
+            p.addHeap(60000 * k, freeBytes, freeBytes * 3 / 4, 150000);
+        }
+        const int32_t spanMin = TASK_PROFILE_HEAP_HISTORY - 1;
+        int32_t expect = -(1200 * spanMin + 3000) / spanMin;
+        uint32_t frag = TaskProfile::fragmentationPct(p.heapAt(0));
+        static TaskProfile empty;
+        snprintf(detail, sizeof(detail), "trend %ld B/min (expect %ld), frag %lu%%, %u samples",
+                 (long)p.heapTrendPerMin(), (long)expect, (unsigned long)frag, (unsigned)p.heapCount);
+        ok &= profileCheck("heap-trend", p.heapTrendPerMin() == expect && frag == 25 &&
+                                             p.heapCount == TASK_PROFILE_HEAP_HISTORY && empty.heapTrendPerMin() == 0,
+                           detail);
+    }
+    {
+        // Отчёт: строка задачи с долей CPU и строка кучи с трендом
+        static TaskProfile p;
+        TaskProfileEntry first[] = {profileTask("dataTask", 0)};
+        p.updateTasks(first, 1, 1000000, false);
+        TaskProfileEntry second[] = {profileTask("dataTask", 123400)};
+        p.updateTasks(second, 1, 2000000, false);
+        p.addHeap(0, 100000, 80000, 90000);
+        p.addHeap(120000, 98000, 80000, 90000);
+        static char text[2048];
+        taskProfileFormatText(text, sizeof(text), p);
+        bool cpuLine = strstr(text, "task dataTask         cpu  12.3%") != nullptr;
+        bool heapLine =
+            strstr(text, "heap free 98000 largest 80000 frag 19% min_free 90000 trend -1000 B/min") != nullptr;
+        snprintf(detail, sizeof(detail), "task line %s, heap line %s", cpuLine ? "found" : "missing",
+                 heapLine ? "found" : "missing");
+        ok &= profileCheck("report", cpuLine && heapLine && strstr(text, "pipeline_only") != nullptr, detail);
+    }
+
+    printf("profile self-test %s\n", ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
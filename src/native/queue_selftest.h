@@ -0,0 +1,271 @@
+// Проверка очереди записей (record_queue.h) на длинных бинарных кадрах
+//
+// Кадр Unicore длиннее FRAMER_MAX_RECORD StreamFramer отдаёт частями; очередь
+// должна отдать клиенту либо кадр целиком, либо ничего из него. Каждый
+// сценарий режет поток framer'ом, как routeUartChunk(), пишет записи в
+// маленькую очередь с пометкой continued и забирает вывод порциями, как
+// отправка BLE. Вывод разбирается заново: строки NMEA с верной суммой и
+// кадры Unicore с верной CRC32 целиком, иначе — разрыв.
+//
+// runQueueSelftest() (--queue-selftest): вытеснение кадра целиком, сохранение
+// кадра за счёт старых записей, отказ QUEUE_DROP_NEWEST посреди кадра, кадр
+// длиннее очереди при быстром чтении, хвост кадра после clear(), полоса
+// приоритета не вклинивается в начатый кадр, уплотнение вокруг начатых
+// записей через границу буфера, начатый кадр длиннее RECORD_SHIFT_MAX.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "../record_queue.h"
+#include "../stream_framer.h"
+#include "../unicore_binary.h"
+
+typedef RecordQueueT<4096, 128> SelftestQueue;
+
+static void selftestNmea(std::vector<uint8_t>& out, unsigned k) {
+    char line[96];
+    int len = snprintf(line, sizeof(line), "$GPTXT,01,01,02,queue selftest sentence %05u", k);
+    uint8_t cs = 0;
+    for (int i = 1; i < len; i++) cs ^= (uint8_t)line[i];
+    len += snprintf(line + len, sizeof(line) - len, "*%02X\r\n", cs);
+    out.insert(out.end(), line, line + len);
+}
+
+// OBSVM с телом body байт и верной CRC32
+static void selftestFrame(std::vector<uint8_t>& out, size_t body) {
+    size_t at = out.size();
+    out.resize(at + UNICORE_HEADER_LEN + body + UNICORE_CRC_LEN, 0);
+    uint8_t* f = out.data() + at;
+    f[0] = UNICORE_SYNC1;
+    f[1] = UNICORE_SYNC2;
+    f[2] = UNICORE_SYNC3;
+    f[4] = (uint8_t)UNICORE_MSG_OBSVM;
+    f[5] = (uint8_t)(UNICORE_MSG_OBSVM >> 8);
+    f[6] = (uint8_t)body;
+    f[7] = (uint8_t)(body >> 8);
+    for (size_t i = 0; i < body; i++) f[UNICORE_HEADER_LEN + i] = (uint8_t)(i * 7 + 3);
+    uint32_t crc = unicoreCrc32(f, UNICORE_HEADER_LEN + body);
+    for (int i = 0; i < 4; i++) f[UNICORE_HEADER_LEN + body + i] = (uint8_t)(crc >> (8 * i));
+}
+
+struct QueueStreamCheck {
+    size_t sentences = 0, frames = 0, broken = 0;
+};
+
+// Вывод очереди: только целые строки NMEA и целые кадры Unicore
+static QueueStreamCheck selftestParse(const std::vector<uint8_t>& got) {
+    QueueStreamCheck c;
+    for (size_t i = 0; i < got.size();) {
+        const uint8_t* p = got.data() + i;
+        size_t rest = got.size() - i;
+        if (p[0] == '$') {
+            const uint8_t* eol = (const uint8_t*)memchr(p, '\n', rest);
+            size_t len = eol ? (size_t)(eol - p) + 1 : rest;
+            (eol && nmeaChecksumOk(p, len) ? c.sentences : c.broken)++;
+            i += len;
+            continue;
+        }
+        size_t len = unicoreFrameLength(p, rest);
+        UnicoreHeader hdr;
+        if (p[0] == UNICORE_SYNC1 && len > 0 && len <= rest && unicoreCheckFrame(p, len, &hdr)) {
+            c.frames++;
+            i += len;
+            continue;
+        }
+        // Разрыв: до следующего '$'
+        c.broken++;
+        const uint8_t* next = (const uint8_t*)memchr(p + 1, '$', rest - 1);
+        i = next ? (size_t)(next - got.data()) : got.size();
+    }
+    return c;
+}
+
+// Поток через framer в очередь порциями chunk; после каждой порции
+// потребитель забирает до drain байт (0 — не читает)
+static void selftestFeed(SelftestQueue& q, StreamFramer& framer, const std::vector<uint8_t>& in, size_t chunk,
+                         size_t drain, std::vector<uint8_t>& out) {
+    uint8_t buf[4096];
+    for (size_t pos = 0; pos < in.size(); pos += chunk) {
+        size_t n = (in.size() - pos < chunk) ? in.size() - pos : chunk;
+        framer.feed(in.data() + pos, n, [&](const uint8_t* rec, size_t len, uint8_t type) {
+            q.write(rec, len, type, framer.continued);
+        });
+        if (drain) out.insert(out.end(), buf, buf + q.read(buf, drain));
+    }
+}
+
+static void selftestDrain(SelftestQueue& q, std::vector<uint8_t>& out) {
+    uint8_t buf[512];
+    size_t n;
+    while ((n = q.read(buf, sizeof(buf))) > 0) out.insert(out.end(), buf, buf + n);
+}
+
+// Номер следующей строки с позиции i; ordered сбрасывается, если номера не растут
+static size_t selftestNextNumber(const std::vector<uint8_t>& out, size_t i, unsigned* prev, bool* ordered) {
+    static const char tag[] = "sentence ";
+    for (; i + sizeof(tag) < out.size(); i++) {
+        if (memcmp(out.data() + i, tag, sizeof(tag) - 1) != 0) continue;
+        unsigned k = (unsigned)strtoul((const char*)out.data() + i + sizeof(tag) - 1, nullptr, 10);
+        k %= 100000;
+        if (k < *prev) *ordered = false;
+        *prev = k;
+        return i + sizeof(tag);
+    }
+    return out.size();
+}
+
+static bool queueCheck(const char* scenario, bool ok, const QueueStreamCheck& c, uint32_t droppedFrames) {
+    printf("queue %-14s %3zu sentences, %zu frames, %zu broken, %u frames dropped  %s\n", scenario, c.sentences,
+           c.frames, c.broken, (unsigned)droppedFrames, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Сценарии очереди с кадрами длиннее записи; 0 — все прошли
+static int runQueueSelftest() {
+    bool ok = true;
+    {
+        // Кадр 3 КБ за ним строки: старейшие — кадр — вытесняется целиком
+        static SelftestQueue q;
+        StreamFramer framer;
+        std::vector<uint8_t> in, out;
+        selftestFrame(in, 3000);
+        for (unsigned k = 0; k < 40; k++) selftestNmea(in, k);
+        selftestFeed(q, framer, in, 256, 0, out);
+        selftestDrain(q, out);
+        QueueStreamCheck c = selftestParse(out);
+        ok &= queueCheck("evict-frame", c.broken == 0 && c.frames == 0 && q.droppedRecords[ST_UNIBIN] == 1, c,
+                         q.droppedRecords[ST_UNIBIN]);
+    }
+    {
+        // Строки, затем кадр: место кадру дают старые строки, кадр доходит целиком
+        static SelftestQueue q;
+        StreamFramer framer;
+        std::vector<uint8_t> in, out;
+        for (unsigned k = 0; k < 40; k++) selftestNmea(in, k);
+        selftestFrame(in, 3000);
+        selftestFeed(q, framer, in, 100, 0, out);
+        selftestDrain(q, out);
+        QueueStreamCheck c = selftestParse(out);
+        ok &= queueCheck("keep-frame", c.broken == 0 && c.frames == 1 && q.droppedRecords[ST_UNIBIN] == 0, c,
+                         q.droppedRecords[ST_UNIBIN]);
+    }
+    {
+        // QUEUE_DROP_NEWEST: голова и первая часть встают, следующая — нет;
+        // поставленные части убираются, строки после кадра проходят
+        static SelftestQueue q;
+        q.policy = QUEUE_DROP_NEWEST;
+        StreamFramer framer;
+        std::vector<uint8_t> in, out;
+        for (unsigned k = 0; k < 30; k++) selftestNmea(in, k);
+        selftestFrame(in, 3000);
+        std::vector<uint8_t> tail;
+        for (unsigned k = 30; k < 32; k++) selftestNmea(tail, k);
+        selftestFeed(q, framer, in, 512, 0, out);
+        uint8_t buf[2048];
+        out.insert(out.end(), buf, buf + q.read(buf, sizeof(buf)));  // Место под строки после кадра
+        selftestFeed(q, framer, tail, 512, 0, out);
+        selftestDrain(q, out);
+        QueueStreamCheck c = selftestParse(out);
+        ok &= queueCheck("drop-newest", c.broken == 0 && c.frames == 0 && c.sentences == 32 &&
+                                            q.droppedRecords[ST_UNIBIN] == 1,
+                         c, q.droppedRecords[ST_UNIBIN]);
+    }
+    {
+        // Кадр 6 КБ — больше очереди: при быстром чтении проходит частями целиком
+        static SelftestQueue q;
+        StreamFramer framer;
+        std::vector<uint8_t> in, out;
+        selftestNmea(in, 0);
+        selftestFrame(in, 6000);
+        selftestNmea(in, 1);
+        selftestFeed(q, framer, in, 244, 512, out);
+        selftestDrain(q, out);
+        QueueStreamCheck c = selftestParse(out);
+        ok &= queueCheck("stream-frame", c.broken == 0 && c.frames == 1 && c.sentences == 2, c,
+                         q.droppedRecords[ST_UNIBIN]);
+    }
+    {
+        // clear() посреди кадра (отключение клиента): хвост кадра не принимается
+        static SelftestQueue q;
+        StreamFramer framer;
+        std::vector<uint8_t> head, rest, out;
+        selftestFrame(head, 3000);
+        rest.assign(head.begin() + 1500, head.end());
+        head.resize(1500);
+        for (unsigned k = 0; k < 3; k++) selftestNmea(rest, k);
+        selftestFeed(q, framer, head, 500, 0, out);
+        q.clear();
+        selftestFeed(q, framer, rest, 500, 0, out);
+        selftestDrain(q, out);
+        QueueStreamCheck c = selftestParse(out);
+        ok &= queueCheck("orphan-tail", c.broken == 0 && c.frames == 0 && c.sentences == 3, c,
+                         q.droppedRecords[ST_UNIBIN]);
+    }
+    {
+        // Голова отдана, части ещё не пришли: partialRemaining() держит остаток кадра,
+        // чтобы полоса приоритета не вклинилась в него
+        static SelftestQueue q;
+        StreamFramer framer;
+        std::vector<uint8_t> in, rest, out;
+        selftestFrame(in, 3000);
+        rest.assign(in.begin() + 600, in.end());
+        in.resize(600);
+        selftestFeed(q, framer, in, 600, 4096, out);
+        bool held = out.size() == 600 && q.partialRemaining() == rest.size();
+        selftestFeed(q, framer, rest, 600, 0, out);
+        selftestDrain(q, out);
+        QueueStreamCheck c = selftestParse(out);
+        ok &= queueCheck("hold-lane", held && c.broken == 0 && c.frames == 1, c, q.droppedRecords[ST_UNIBIN]);
+    }
+
+    {
+        // Медленное чтение посреди записей: вытеснение уплотняет недоотданный
+        // остаток через границу буфера, строки доходят целыми и по порядку
+        static SelftestQueue q;
+        StreamFramer framer;
+        std::vector<uint8_t> in, out;
+        for (unsigned k = 0; k < 3000; k++) {
+            selftestNmea(in, k);
+            if (k % 7 == 0) selftestNmea(in, k + 100000);  // Строки разной длины
+        }
+        selftestFeed(q, framer, in, 300, 97, out);
+        selftestDrain(q, out);
+        QueueStreamCheck c = selftestParse(out);
+        bool ordered = true;
+        unsigned prev = 0;
+        for (size_t i = 0; (i = selftestNextNumber(out, i, &prev, &ordered)) < out.size();) {
+        }
+        ok &= queueCheck("compact-wrap", c.broken == 0 && ordered && c.sentences > 100 && q.droppedRecordsTotal() > 0,
+                         c, q.droppedRecords[ST_UNIBIN]);
+    }
+    {
+        // Начатый кадр длиннее RECORD_SHIFT_MAX не сдвигается: новые строки не
+        // берутся, пока он не отдан; кадр и первые строки доходят целыми
+        static SelftestQueue q;
+        StreamFramer framer;
+        std::vector<uint8_t> frame, lines, out;
+        selftestFrame(frame, 3000);
+        for (unsigned k = 0; k < 60; k++) selftestNmea(lines, k);
+        selftestFeed(q, framer, frame, 1024, 0, out);
+        uint8_t buf[100];
+        out.insert(out.end(), buf, buf + q.read(buf, sizeof(buf)));
+        selftestFeed(q, framer, lines, 1024, 0, out);
+        selftestDrain(q, out);
+        QueueStreamCheck c = selftestParse(out);
+        unsigned first = 0;
+        bool ordered = true;
+        selftestNextNumber(out, 0, &first, &ordered);
+        ok &= queueCheck("long-started", c.broken == 0 && c.frames == 1 && c.sentences > 0 && c.sentences < 60 &&
+                                             first == 0,
+                         c, q.droppedRecords[ST_UNIBIN]);
+    }
+
+    printf("queue self-test %s\n", ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
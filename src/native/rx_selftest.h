@@ -0,0 +1,192 @@
+// Проверка входящего потока клиента: BridgePipeline::forwardRx() и
+// BridgeControlScanner (bridge_control.h)
+//
+// Поправки NTRIP — двоичный RTCM3, в котором байт 0x24 ('$') встречается
+// как угодно часто. Приёмник должен получать их без задержки и без вставок,
+// а команды моста $BRIDGE — перехватываться только с начала строки. Каждый
+// сценарий подаёт порции в RX, как запись в характеристику, и сверяет байты,
+// ушедшие в UART после каждой порции, число записей в UART и команды.
+//
+// runRxSelftest() (--rx-selftest): порция кончается на 0x24 внутри кадра
+// RTCM3, "$BRIDGE," в данных кадра, команда сразу после кадра, префикс на
+// границе порций, '$' в середине строки; "\r\n" после команды приёмнику —
+// только ASCII без перевода строки, не после перехваченной команды с RTCM3.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "../board_profile.h"
+#include "../bridge_pipeline.h"
+#include "../stream_framer.h"
+
+// Окружение forwardRx(): RX из порции, UART и команды — в векторы
+struct RxSelftestHal {
+    std::vector<uint8_t> rx;
+    size_t rxPos = 0;
+    std::vector<uint8_t> uart;
+    size_t uartWrites = 0;
+    std::vector<std::string> commands;
+
+    size_t rxAvailable() { return rx.size() - rxPos; }
+    size_t rxRead(uint8_t* dst, size_t n) {
+        if (n > rx.size() - rxPos) n = rx.size() - rxPos;
+        memcpy(dst, rx.data() + rxPos, n);
+        rxPos += n;
+        return n;
+    }
+    void uartWrite(const uint8_t* src, size_t n) {
+        uart.insert(uart.end(), src, src + n);
+        uartWrites++;
+    }
+    void onControlCommand(const char* line, size_t len) { commands.emplace_back(line, len); }
+};
+
+// Кадр RTCM3 с данными payload и верной CRC-24Q
+static void rxSelftestRtcm(std::vector<uint8_t>& out, const std::vector<uint8_t>& payload) {
+    size_t at = out.size();
+    out.push_back(0xD3);
+    out.push_back((uint8_t)((payload.size() >> 8) & 0x03));
+    out.push_back((uint8_t)payload.size());
+    out.insert(out.end(), payload.begin(), payload.end());
+    uint32_t crc = rtcmCrc24q(out.data() + at, out.size() - at);
+    out.push_back((uint8_t)(crc >> 16));
+    out.push_back((uint8_t)(crc >> 8));
+    out.push_back((uint8_t)crc);
+}
+
+// "$BRIDGE,<body>*hh\r\n"
+static void rxSelftestCommand(std::vector<uint8_t>& out, const char* body) {
+    char line[BRIDGE_CMD_MAX];
+    int len = snprintf(line, sizeof(line), "%s%s", BRIDGE_CMD_PREFIX, body);
+    uint8_t cs = 0;
+    for (int i = 1; i < len; i++) cs ^= (uint8_t)line[i];
+    len += snprintf(line + len, sizeof(line) - len, "*%02X\r\n", cs);
+    out.insert(out.end(), line, line + len);
+}
+
+static void rxSelftestText(std::vector<uint8_t>& out, const char* text) { out.insert(out.end(), text, text + strlen(text)); }
+
+struct RxSelftestRun {
+    std::vector<uint8_t> uart;
+    size_t uartWrites = 0;
+    std::vector<std::string> commands;
+    std::vector<size_t> uartAfter;  // Байт в UART после каждой порции
+};
+
+// Порции по одной за проход forwardRx()
+static RxSelftestRun rxSelftestFeed(const std::vector<std::vector<uint8_t>>& chunks) {
+    static RxSelftestHal hal;
+    hal = RxSelftestHal();
+    BridgePipeline<BoardProfileHost, RxSelftestHal> pipeline(hal);
+    RxSelftestRun r;
+    for (const std::vector<uint8_t>& chunk : chunks) {
+        hal.rx = chunk;
+        hal.rxPos = 0;
+        while (pipeline.forwardRx() > 0) {
+        }
+        r.uartAfter.push_back(hal.uart.size());
+    }
+    r.uart = hal.uart;
+    r.uartWrites = hal.uartWrites;
+    r.commands = hal.commands;
+    return r;
+}
+
+static bool rxCheck(const char* scenario, bool ok, const RxSelftestRun& r) {
+    printf("rx %-16s %4zu B to UART in %zu writes, %zu commands  %s\n", scenario, r.uart.size(), r.uartWrites,
+           r.commands.size(), ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Сценарии входящего потока; 0 — все прошли
+static int runRxSelftest() {
+    bool ok = true;
+    std::vector<uint8_t> payload(200);
+    for (size_t i = 0; i < payload.size(); i++) payload[i] = (uint8_t)(i * 37 + 11);
+    payload[60] = '\n';
+    payload[61] = '$';
+    payload[120] = '$';
+    {
+        // Порция кончается на 0x24 в данных кадра: приёмник получает её сразу целиком
+        std::vector<uint8_t> frame;
+        rxSelftestRtcm(frame, payload);
+        size_t cut = 3 + 120 + 1;
+        std::vector<std::vector<uint8_t>> chunks = {{frame.begin(), frame.begin() + cut},
+                                                    {frame.begin() + cut, frame.end()}};
+        RxSelftestRun r = rxSelftestFeed(chunks);
+        ok &= rxCheck("rtcm-tail-24", r.uart == frame && r.uartAfter[0] == cut && r.uartWrites == 2 &&
+                                          r.commands.empty(),
+                      r);
+    }
+    {
+        // "\n$BRIDGE," в данных кадра — не команда, кадр уходит одной записью
+        std::vector<uint8_t> inner = payload, frame;
+        static const char fake[] = "$BRIDGE,GET*1B";
+        memcpy(inner.data() + 61, fake, sizeof(fake) - 1);
+        rxSelftestRtcm(frame, inner);
+        RxSelftestRun r = rxSelftestFeed({frame});
+        ok &= rxCheck("rtcm-inner", r.uart == frame && r.uartWrites == 1 && r.commands.empty(), r);
+    }
+    {
+        // Команда сразу после кадра, без перевода строки
+        std::vector<uint8_t> frame, in;
+        rxSelftestRtcm(frame, payload);
+        in = frame;
+        rxSelftestCommand(in, "GET,baud");
+        RxSelftestRun r = rxSelftestFeed({in});
+        ok &= rxCheck("rtcm-command", r.uart == frame && r.commands.size() == 1 &&
+                                          r.commands[0].compare(0, 16, "$BRIDGE,GET,baud") == 0,
+                      r);
+    }
+    {
+        // Префикс команды на границе порций
+        std::vector<uint8_t> cmd;
+        rxSelftestCommand(cmd, "GET");
+        std::vector<std::vector<uint8_t>> chunks = {{cmd.begin(), cmd.begin() + 4}, {cmd.begin() + 4, cmd.end()}};
+        RxSelftestRun r = rxSelftestFeed(chunks);
+        ok &= rxCheck("split-prefix", r.uart.empty() && r.commands.size() == 1, r);
+    }
+    {
+        // '$' в середине строки — не начало команды, строка уходит одной записью
+        std::vector<uint8_t> in;
+        rxSelftestText(in, "CONFIG COM1 $BRIDGE,GET*1B\r\n");
+        RxSelftestRun r = rxSelftestFeed({in});
+        ok &= rxCheck("inline-dollar", r.uart == in && r.uartWrites == 1 && r.commands.empty(), r);
+    }
+    {
+        // Команда моста, за ней RTCM3 в той же порции: в поток поправок "\r\n" не вставляется
+        std::vector<uint8_t> frame, in;
+        rxSelftestRtcm(frame, payload);
+        rxSelftestCommand(in, "GET");
+        in.insert(in.end(), frame.begin(), frame.end());
+        RxSelftestRun r = rxSelftestFeed({in});
+        ok &= rxCheck("command-rtcm", r.uart == frame && r.commands.size() == 1, r);
+    }
+    {
+        // Команда приёмнику без перевода строки получает "\r\n", с ним — нет
+        std::vector<uint8_t> bare, eol, expect;
+        rxSelftestText(bare, "MODE ROVER");
+        rxSelftestText(eol, "MODE ROVER\r\n");
+        rxSelftestText(expect, "MODE ROVER\r\nMODE ROVER\r\n");
+        RxSelftestRun r = rxSelftestFeed({bare, eol});
+        ok &= rxCheck("ascii-eol", r.uart == expect, r);
+    }
+    {
+        // Не команда моста на границе порций: удержанный префикс и хвост строки без лишнего "\r\n"
+        std::vector<uint8_t> head, tail, expect;
+        rxSelftestText(head, "$BR");
+        rxSelftestText(tail, "X,1\r\n");
+        rxSelftestText(expect, "$BRX,1\r\n");
+        RxSelftestRun r = rxSelftestFeed({head, tail});
+        ok &= rxCheck("split-other", r.uart == expect && r.uartAfter[0] == 0 && r.commands.empty(), r);
+    }
+
+    printf("rx self-test %s\n", ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+// Проверка планировщика прохода loop() (loop_scheduler.h) на модельном времени
+//
+// Время — счётчик мкс, как micros() прошивки, начинается у переполнения 2^32.
+// Стадии не выполняют работы: их длительность задаёт сценарий.
+//
+// runSchedulerSelftest() (--scheduler-selftest): самая просроченная стадия
+// первой, откладывание при исчерпанном бюджете прохода, запуск без учёта
+// бюджета после двух периодов, предел числа стадий и бюджет прохода по
+// буферу UART.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../loop_scheduler.h"
+#include "../uart_link.h"
+
+static bool schedulerCheck(const char* scenario, bool ok, const char* detail) {
+    printf("sched %-14s %-52s %s\n", scenario, detail, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Проход: приём и отправка длятся foregroundUs, затем фоновые стадии по
+// next() по runUs[стадия] мкс; order — номера запущенных стадий по порядку
+static uint32_t schedulerPass(LoopScheduler& sched, uint32_t now, uint32_t foregroundUs, const uint32_t* runUs,
+                              int* order, size_t orderCap, size_t* orderLen) {
+    sched.beginPass(now);
+    now += foregroundUs;
+    sched.foregroundDone(now);
+    int stage;
+    *orderLen = 0;
+    while ((stage = sched.next(now)) >= 0) {
+        if (*orderLen < orderCap) order[(*orderLen)++] = stage;
+        uint32_t start = now;
+        now += runUs[stage];
+        sched.finished(stage, start, now);
+    }
+    return now;
+}
+
+// Сценарии планировщика; 0 — все прошли
+static int runSchedulerSelftest() {
+    bool ok = true;
+    char detail[96];
+    const uint32_t t0 = 0xFFFFF000u;  // micros() переполняется в первых проходах
+    {
+        // Обе стадии просрочены: первой идёт та, чей срок прошёл раньше
+        static LoopScheduler sched;
+        sched.passBudgetUs = 3000;
+        sched.add("fast", 1000, 100);
+        sched.add("slow", 5000, 100);
+        const uint32_t runUs[] = {100, 100};
+        int order[4];
+        size_t n;
+        uint32_t now = schedulerPass(sched, t0, 50, runUs, order, 4, &n);  // Первый проход: обе давно не шли
+        sched.stages[0].lastRunUs = now - 1500;  // fast просрочена на 500 мкс
+        sched.stages[1].lastRunUs = now - 7000;  // slow — на 2000 мкс
+        schedulerPass(sched, now, 50, runUs, order, 4, &n);
+        snprintf(detail, sizeof(detail), "order %d,%d of %zu", n > 0 ? order[0] : -1, n > 1 ? order[1] : -1, n);
+        ok &= schedulerCheck("overdue-first", n == 2 && order[0] == 1 && order[1] == 0, detail);
+    }
+    {
+        // Остаток бюджета 300 мкс: стадия на 400 откладывается, на 200 — идёт
+        static LoopScheduler sched;
+        sched.passBudgetUs = 1000;
+        sched.add("big", 1000, 400);
+        sched.add("small", 1000, 200);
+        const uint32_t runUs[] = {400, 200};
+        int order[4];
+        size_t n;
+        uint32_t now = schedulerPass(sched, t0, 0, runUs, order, 4, &n);
+        // К концу приёма (700 мкс) big просрочена сильнее small, но меньше чем на период
+        sched.stages[0].lastRunUs = now + 700 - 1400;
+        sched.stages[1].lastRunUs = now + 700 - 1100;
+        schedulerPass(sched, now, 700, runUs, order, 4, &n);
+        snprintf(detail, sizeof(detail), "ran %zu (first %d), big deferred %lu", n, n > 0 ? order[0] : -1,
+                 (unsigned long)sched.stages[0].deferrals);
+        ok &= schedulerCheck("deferral", n == 1 && order[0] == 1 && sched.stages[0].deferrals == 1 &&
+                                             sched.stages[0].late == 0,
+                             detail);
+    }
+    {
+        // Стадия не помещается ни в один проход: идёт без учёта бюджета, как
+        // только не запускалась два периода, и не раньше
+        static LoopScheduler sched;
+        sched.passBudgetUs = 1000;
+        sched.add("heavy", 2000, 1500);
+        const uint32_t runUs[] = {1500};
+        int order[4];
+        size_t n;
+        uint32_t now = t0, lastStart = 0, maxGap = 0, minGap = UINT32_MAX;
+        bool seen = false;
+        for (int pass = 0; pass < 2000; pass++) {
+            uint32_t start = now + 200;  // Начало стадии в проходе — после приёма
+            now = schedulerPass(sched, now, 200, runUs, order, 4, &n);
+            if (n == 0) continue;
+            if (seen) {
+                uint32_t gap = start - lastStart;
+                if (gap > maxGap) maxGap = gap;
+                if (gap < minGap) minGap = gap;
+            }
+            seen = true;
+            lastStart = start;
+        }
+        const LoopStage& s = sched.stages[0];
+        static char text[512];
+        loopSchedulerFormatText(text, sizeof(text), sched);
+        snprintf(detail, sizeof(detail), "runs %lu late %lu deferred %lu gap %lu..%lu us", (unsigned long)s.runs,
+                 (unsigned long)s.late, (unsigned long)s.deferrals, (unsigned long)minGap, (unsigned long)maxGap);
+        // Первый запуск — сразу (стадия давно не шла), дальше — по сроку в два периода
+        ok &= schedulerCheck("late", s.runs > 10 && s.late == s.runs && s.deferrals > 0 && minGap >= 4000 &&
+                                         maxGap < 4000 + 200 && strstr(text, "stage heavy") != nullptr,
+                             detail);
+    }
+    {
+        // Таблица стадий полна: лишняя не добавляется и не портит маску considered
+        static LoopScheduler sched;
+        size_t id = 0;
+        for (int i = 0; i <= LOOP_SCHEDULER_MAX_STAGES; i++) id = sched.add("stage", 1000, 10);
+        snprintf(detail, sizeof(detail), "%u stages, extra add -> %zu", (unsigned)sched.stageCount, id);
+        ok &= schedulerCheck("add-bound",
+                             sched.stageCount == LOOP_SCHEDULER_MAX_STAGES && id == LOOP_SCHEDULER_MAX_STAGES, detail);
+    }
+    {
+        // Бюджет прохода: бюджет платы, пока четверть буфера UART больше него
+        uint32_t at115 = loopPassBudgetUs(uartRxBufferForBaud(115200), 115200, 3000);
+        uint32_t at921 = loopPassBudgetUs(uartRxBufferForBaud(921600), 921600, 3000);
+        uint32_t small = loopPassBudgetUs(256, 921600, 3000);
+        snprintf(detail, sizeof(detail), "115200 %lu us, 921600 %lu us, 256 B %lu us", (unsigned long)at115,
+                 (unsigned long)at921, (unsigned long)small);
+        ok &= schedulerCheck("pass-budget", at115 == 3000 && at921 == 3000 && small == 694, detail);
+    }
+
+    printf("scheduler self-test %s\n", ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,428 @@
+// Сжатие NMEA потока для BLE (формат ND1)
+//
+// Каждое предложение кодируется относительно предыдущего предложения с тем же
+// адресом ($GNGGA, $GPGSV, ...) и тем же номером в пачке одинаковых предложений
+// (страницы GSV, строки GNGSA по системам). Поле либо совпадает целиком
+// (серия совпавших полей — один байт), либо передаётся как длина общего префикса
+// плюс отличающийся хвост. Контрольная сумма и "\r\n" не передаются —
+// декодер восстанавливает их сам. Всё, что не является корректным NMEA
+// (RTCM, Unicore, битые строки), идёт как есть.
+//
+// Кодер работает в прошивке; эталонный декодер проверяет его вывод в
+// хост-сборке (--nd1) и tools/nmea_delta_bench.cpp.
+//
+// Формат пакета (одно BLE уведомление):
+//   [header] [record] [record] ...
+//   header = (ND_VERSION << 4) | flags;  ND_FLAG_RESET — очистить словарь
+// Запись:
+//   slot (0..ND_SLOTS-1) ops... ND_OP_END      — дельта к записи словаря
+//   ND_TAG_NEW slot body... ND_OP_END          — новая запись словаря целиком
+//   ND_TAG_LITERAL lenLo lenHi bytes...        — сырые байты без изменений
+// Операции дельты (поля после адреса):
+//   0x80 + (n - 1)          — n полей совпадают с опорными (n = 1..32)
+//   0xA0 + p, suffix...     — общий префикс p символов, затем хвост (байты < 0x80)
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ND_VERSION          1
+#define ND_SLOTS            48
+#define ND_MAX_BODY         127   // Тело: от '$' до '*' (без контрольной суммы)
+
+#define ND_FLAG_RESET       0x01
+
+#define ND_OP_COPY_BASE     0x80
+#define ND_OP_COPY_MAX      32
+#define ND_OP_PREFIX_BASE   0xA0
+#define ND_OP_PREFIX_MAX    79
+#define ND_OP_END           0xF0
+#define ND_TAG_NEW          0xFD
+#define ND_TAG_LITERAL      0xFF
+
+struct NdSlot {
+    uint8_t len = 0;       // 0 = слот свободен
+    uint8_t burst = 0;     // Номер в пачке одинаковых адресов
+    uint16_t lastUse = 0;  // Для вытеснения (LRU)
+    char body[ND_MAX_BODY];
+};
+
+static inline uint8_t ndChecksum(const char* body, size_t len) {
+    uint8_t cs = 0;
+    for (size_t i = 1; i < len; i++) cs ^= (uint8_t)body[i];  // Без ведущего '$'
+    return cs;
+}
+
+static inline size_t ndAddressLen(const char* body, size_t len) {
+    size_t n = 0;
+    while (n < len && body[n] != ',') n++;
+    return n;
+}
+
+// Поле i тела (0 = адрес); возвращает false, если полей меньше
+static inline bool ndField(const char* body, size_t len, size_t index, size_t* start, size_t* flen) {
+    size_t pos = 0;
+    for (size_t i = 0; i < index; i++) {
+        while (pos < len && body[pos] != ',') pos++;
+        if (pos >= len) return false;
+        pos++;
+    }
+    size_t end = pos;
+    while (end < len && body[end] != ',') end++;
+    *start = pos;
+    *flen = end - pos;
+    return true;
+}
+
+class NmeaDeltaEncoder {
+  public:
+    NmeaDeltaEncoder() { reset(); }
+
+    void reset() {
+        for (int i = 0; i < ND_SLOTS; i++) slots[i].len = 0;
+        clock = 0;
+        prevAddrLen = 0;
+        burst = 0;
+        resetPending = true;
+    }
+
+    // Сброс словаря ещё не передан пакетом
+    bool resetQueued() const { return resetPending; }
+
+    // Флаг сброса словаря для следующего пакета (выдаётся один раз)
+    bool takeReset() {
+        bool r = resetPending;
+        resetPending = false;
+        return r;
+    }
+
+    // Кодирует одно NMEA предложение как дельту или новую запись словаря.
+    // Возвращает 0 (без изменения состояния), если запись не NMEA или не влезает
+    // в cap — тогда вызывающий отправляет её через encodeLiteral().
+    size_t encode(const uint8_t* rec, size_t len, uint8_t* out, size_t cap) {
+        const char* s = (const char*)rec;
+        if (len < 8 || s[0] != '$' || s[len - 2] != '\r' || s[len - 1] != '\n' || s[len - 5] != '*') return 0;
+        size_t bodyLen = len - 5;
+        if (bodyLen > ND_MAX_BODY) return 0;
+        for (size_t i = 0; i < bodyLen; i++) {
+            if ((uint8_t)s[i] >= 0x80 || s[i] == '*') return 0;
+        }
+        // Контрольная сумма должна совпадать в точности (включая регистр),
+        // иначе декодер не восстановит байты один в один
+        static const char hex[] = "0123456789ABCDEF";
+        uint8_t cs = ndChecksum(s, bodyLen);
+        if (s[len - 4] != hex[cs >> 4] || s[len - 3] != hex[cs & 0x0F]) return 0;
+
+        size_t addrLen = ndAddressLen(s, bodyLen);
+        uint8_t recBurst = (addrLen == prevAddrLen && memcmp(s, prevAddr, addrLen) == 0) ? (uint8_t)(burst + 1) : 0;
+
+        int slot = findSlot(s, addrLen, recBurst);
+        size_t n;
+        if (slot >= 0) {
+            n = encodeDelta(slots[slot], (uint8_t)slot, s, bodyLen, out, cap);
+        } else {
+            slot = victimSlot();
+            n = encodeNew((uint8_t)slot, s, bodyLen, out, cap);
+        }
+        if (n == 0) return 0;
+
+        // Фиксируем состояние только после успешного кодирования
+        NdSlot& sl = slots[slot];
+        memcpy(sl.body, s, bodyLen);
+        sl.len = (uint8_t)bodyLen;
+        sl.burst = recBurst;
+        sl.lastUse = ++clock;
+        memcpy(prevAddr, s, addrLen < sizeof(prevAddr) ? addrLen : sizeof(prevAddr));
+        prevAddrLen = addrLen < sizeof(prevAddr) ? addrLen : sizeof(prevAddr);
+        burst = recBurst;
+        return n;
+    }
+
+    // Сырые байты; длинные данные режутся вызывающим на несколько записей
+    static size_t encodeLiteral(const uint8_t* data, size_t len, uint8_t* out, size_t cap) {
+        if (cap < 4) return 0;
+        if (len > cap - 3) len = cap - 3;
+        out[0] = ND_TAG_LITERAL;
+        out[1] = (uint8_t)(len & 0xFF);
+        out[2] = (uint8_t)(len >> 8);
+        memcpy(out + 3, data, len);
+        return len + 3;
+    }
+
+  private:
+    NdSlot slots[ND_SLOTS];
+    uint16_t clock;
+    char prevAddr[8];
+    size_t prevAddrLen;
+    uint8_t burst;
+    bool resetPending;
+
+    int findSlot(const char* s, size_t addrLen, uint8_t recBurst) const {
+        for (int i = 0; i < ND_SLOTS; i++) {
+            const NdSlot& sl = slots[i];
+            if (sl.len > addrLen && sl.burst == recBurst && sl.body[addrLen] == ',' &&
+                memcmp(sl.body, s, addrLen) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    int victimSlot() const {
+        int best = 0;
+        for (int i = 0; i < ND_SLOTS; i++) {
+            if (slots[i].len == 0) return i;
+            if ((uint16_t)(clock - slots[i].lastUse) > (uint16_t)(clock - slots[best].lastUse)) best = i;
+        }
+        return best;
+    }
+
+    static size_t encodeNew(uint8_t slot, const char* s, size_t bodyLen, uint8_t* out, size_t cap) {
+        if (bodyLen + 3 > cap) return 0;
+        out[0] = ND_TAG_NEW;
+        out[1] = slot;
+        memcpy(out + 2, s, bodyLen);
+        out[bodyLen + 2] = ND_OP_END;
+        return bodyLen + 3;
+    }
+
+    static size_t encodeDelta(const NdSlot& ref, uint8_t slot, const char* s, size_t bodyLen,
+                              uint8_t* out, size_t cap) {
+        size_t o = 0;
+        if (cap < 2) return 0;
+        out[o++] = slot;
+
+        // Курсоры по полям нового и опорного предложений (поле 0 — адрес, совпадает)
+        size_t np = ndAddressLen(s, bodyLen);
+        size_t rp = ndAddressLen(ref.body, ref.len);
+        uint8_t copyRun = 0;
+
+        while (np < bodyLen) {
+            np++;  // Пропускаем ','
+            size_t nStart = np;
+            while (np < bodyLen && s[np] != ',') np++;
+            size_t nLen = np - nStart;
+
+            const char* rField = nullptr;
+            size_t rLen = 0;
+            if (rp < ref.len) {
+                rp++;
+                size_t rStart = rp;
+                while (rp < ref.len && ref.body[rp] != ',') rp++;
+                rField = ref.body + rStart;
+                rLen = rp - rStart;
+            }
+
+            if (rField && rLen == nLen && memcmp(rField, s + nStart, nLen) == 0) {
+                if (++copyRun == ND_OP_COPY_MAX) {
+                    if (o >= cap) return 0;
+                    out[o++] = (uint8_t)(ND_OP_COPY_BASE + copyRun - 1);
+                    copyRun = 0;
+                }
+                continue;
+            }
+
+            if (copyRun) {
+                if (o >= cap) return 0;
+                out[o++] = (uint8_t)(ND_OP_COPY_BASE + copyRun - 1);
+                copyRun = 0;
+            }
+
+            size_t p = 0;
+            if (rField) {
+                size_t maxP = (rLen < nLen) ? rLen : nLen;
+                if (maxP > ND_OP_PREFIX_MAX) maxP = ND_OP_PREFIX_MAX;
+                while (p < maxP && rField[p] == s[nStart + p]) p++;
+            }
+            size_t suffix = nLen - p;
+            if (o + 1 + suffix > cap) return 0;
+            out[o++] = (uint8_t)(ND_OP_PREFIX_BASE + p);
+            memcpy(out + o, s + nStart + p, suffix);
+            o += suffix;
+        }
+
+        if (copyRun) {
+            if (o >= cap) return 0;
+            out[o++] = (uint8_t)(ND_OP_COPY_BASE + copyRun - 1);
+        }
+        if (o >= cap) return 0;
+        out[o++] = ND_OP_END;
+        return o;
+    }
+};
+
+// Упаковка закодированных записей в пакеты не длиннее maxPayload.
+// Дельта-записи никогда не делятся между пакетами; сырые данные режутся.
+// Пакет, который не удалось отправить, сбивает словарь декодера: emit
+// в этом случае вызывает reset(), и следующий пакет несёт ND_FLAG_RESET.
+class NmeaDeltaPacketizer {
+  public:
+    NmeaDeltaEncoder encoder;
+    uint32_t rawBytes = 0;      // Байт на входе
+    uint32_t packedBytes = 0;   // Байт в отправленных пакетах
+
+    void reset() {
+        encoder.reset();
+        len = 0;
+    }
+
+    // emit(const uint8_t* packet, size_t len)
+    template <typename Emit>
+    void addRecord(const uint8_t* rec, size_t recLen, size_t maxPayload, Emit&& emit) {
+        if (maxPayload > sizeof(packet)) maxPayload = sizeof(packet);
+        rawBytes += recLen;
+
+        uint8_t tmp[ND_MAX_BODY * 2 + 8];
+        size_t n = 0;
+        size_t cap = maxPayload > 1 ? maxPayload - 1 : 0;
+        if (cap > sizeof(tmp)) cap = sizeof(tmp);
+        if (cap > 0) n = encoder.encode(rec, recLen, tmp, cap);
+        if (n > 0 && len + n > maxPayload) {
+            flush(emit);
+            // emit сбросил словарь (пакет не отправлен) — tmp ссылается на старый
+            if (encoder.resetQueued()) n = encoder.encode(rec, recLen, tmp, cap);
+        }
+        if (n > 0) {
+            begin();
+            memcpy(packet + len, tmp, n);
+            len += n;
+            return;
+        }
+
+        // Сырые байты — режем по свободному месту пакета
+        while (recLen > 0) {
+            if (len + 4 > maxPayload) flush(emit);
+            begin();
+            size_t used = NmeaDeltaEncoder::encodeLiteral(rec, recLen, packet + len, maxPayload - len);
+            size_t dataLen = used - 3;
+            len += used;
+            rec += dataLen;
+            recLen -= dataLen;
+        }
+    }
+
+    template <typename Emit>
+    void flush(Emit&& emit) {
+        if (len > 1) {
+            emit(packet, len);
+            packedBytes += len;
+        }
+        len = 0;
+    }
+
+    size_t pending() const { return len; }
+
+  private:
+    uint8_t packet[512];
+    size_t len = 0;
+
+    void begin() {
+        if (len == 0) {
+            packet[0] = (uint8_t)((ND_VERSION << 4) | (encoder.takeReset() ? ND_FLAG_RESET : 0));
+            len = 1;
+        }
+    }
+};
+
+// Эталонный декодер: восстанавливает исходный поток байт из пакетов
+class NmeaDeltaDecoder {
+  public:
+    NmeaDeltaDecoder() { reset(); }
+
+    void reset() {
+        for (int i = 0; i < ND_SLOTS; i++) slots[i].len = 0;
+    }
+
+    // emit(const uint8_t* data, size_t len); false — повреждённый пакет
+    template <typename Emit>
+    bool decodePacket(const uint8_t* pkt, size_t len, Emit&& emit) {
+        if (len < 1 || (pkt[0] >> 4) != ND_VERSION) return false;
+        if (pkt[0] & ND_FLAG_RESET) reset();
+
+        size_t i = 1;
+        while (i < len) {
+            uint8_t tag = pkt[i++];
+            if (tag == ND_TAG_LITERAL) {
+                if (i + 2 > len) return false;
+                size_t n = pkt[i] | ((size_t)pkt[i + 1] << 8);
+                i += 2;
+                if (i + n > len) return false;
+                emit(pkt + i, n);
+                i += n;
+            } else if (tag == ND_TAG_NEW) {
+                if (i >= len || pkt[i] >= ND_SLOTS) return false;
+                NdSlot& sl = slots[pkt[i++]];
+                size_t n = 0;
+                while (i < len && pkt[i] != ND_OP_END) {
+                    if (n >= ND_MAX_BODY) return false;
+                    sl.body[n++] = (char)pkt[i++];
+                }
+                if (i >= len) return false;
+                i++;
+                sl.len = (uint8_t)n;
+                emitSentence(sl.body, n, emit);
+            } else if (tag < ND_SLOTS) {
+                NdSlot& ref = slots[tag];
+                if (ref.len == 0) return false;
+                char body[ND_MAX_BODY];
+                size_t n = ndAddressLen(ref.body, ref.len);
+                memcpy(body, ref.body, n);
+                size_t field = 1;
+
+                while (i < len && pkt[i] != ND_OP_END) {
+                    uint8_t op = pkt[i++];
+                    if (op >= ND_OP_COPY_BASE && op < ND_OP_PREFIX_BASE) {
+                        for (int k = 0; k <= op - ND_OP_COPY_BASE; k++, field++) {
+                            size_t fs, fl;
+                            if (!ndField(ref.body, ref.len, field, &fs, &fl) || n + 1 + fl > ND_MAX_BODY) return false;
+                            body[n++] = ',';
+                            memcpy(body + n, ref.body + fs, fl);
+                            n += fl;
+                        }
+                    } else if (op >= ND_OP_PREFIX_BASE && op <= ND_OP_PREFIX_BASE + ND_OP_PREFIX_MAX) {
+                        size_t p = op - ND_OP_PREFIX_BASE;
+                        size_t fs = 0, fl = 0;
+                        if (p > 0 && (!ndField(ref.body, ref.len, field, &fs, &fl) || fl < p)) return false;
+                        if (n + 1 + p > ND_MAX_BODY) return false;
+                        body[n++] = ',';
+                        memcpy(body + n, ref.body + fs, p);
+                        n += p;
+                        while (i < len && pkt[i] < 0x80) {
+                            if (n >= ND_MAX_BODY) return false;
+                            body[n++] = (char)pkt[i++];
+                        }
+                        field++;
+                    } else {
+                        return false;
+                    }
+                }
+                if (i >= len) return false;
+                i++;
+                memcpy(ref.body, body, n);
+                ref.len = (uint8_t)n;
+                emitSentence(ref.body, n, emit);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+  private:
+    NdSlot slots[ND_SLOTS];
+
+    template <typename Emit>
+    static void emitSentence(const char* body, size_t n, Emit& emit) {
+        static const char hex[] = "0123456789ABCDEF";
+        char line[ND_MAX_BODY + 5];
+        memcpy(line, body, n);
+        uint8_t cs = ndChecksum(body, n);
+        line[n] = '*';
+        line[n + 1] = hex[cs >> 4];
+        line[n + 2] = hex[cs & 0x0F];
+        line[n + 3] = '\r';
+        line[n + 4] = '\n';
+        emit((const uint8_t*)line, n + 5);
+    }
+};
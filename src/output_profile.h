@@ -0,0 +1,195 @@
+// Профили вывода приёмника UM980
+//
+// Профиль — декларативный список сообщений с периодом выдачи для порта UM980,
+// к которому подключен мост. При загрузке и после пропадания потока от приёмника
+// профиль отправляется командами Unicore ("UNLOG COM1", затем "GNGGA COM1 0.1" ...)
+// с ожиданием подтверждения на каждую команду. Приёмник отвечает строкой
+//   $command,GNGGA COM1 0.1,response: OK*hh
+// ответ принимается только при верной контрольной сумме и точном совпадении
+// эха команды — так искажение на линии TX не останется незамеченным.
+//
+// Логика не зависит от Arduino: Port — тип с методом write(const uint8_t*, size_t)
+// (тот же, что для UartLinkNegotiator в uart_link.h).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifndef UM980_UART_PORT
+#define UM980_UART_PORT "COM1"
+#endif
+
+struct OutputLog {
+    const char* message;  // Имя сообщения Unicore (GNGGA, GPGSV, RTCM1074, BESTNAVB, ...)
+    float period;         // Период выдачи в секундах (0.05 = 20 Гц)
+};
+
+struct OutputProfile {
+    const char* name;
+    const OutputLog* logs;
+    size_t count;
+};
+
+// Ровер: позиция 10 Гц, точность и спутники 1 Гц — всё, что показывает дисплей
+static const OutputLog roverLogs[] = {
+    {"GNGGA", 0.1f},
+    {"GNGST", 1.0f},
+    {"GNGSA", 1.0f},
+    {"GPGSV", 1.0f},
+    {"GNRMC", 1.0f},
+};
+
+// База: MSM4 всех систем 1 Гц, координаты базы и антенна раз в 10 с
+static const OutputLog baseLogs[] = {
+    {"RTCM1006", 10.0f},
+    {"RTCM1033", 10.0f},
+    {"RTCM1074", 1.0f},
+    {"RTCM1084", 1.0f},
+    {"RTCM1094", 1.0f},
+    {"RTCM1124", 1.0f},
+    {"GNGGA", 1.0f},
+};
+
+// Логгер: сырые измерения и бинарное решение для постобработки
+static const OutputLog loggerLogs[] = {
+    {"OBSVMB", 1.0f},
+    {"BESTNAVB", 0.2f},
+    {"GNGGA", 1.0f},
+    {"GNGST", 1.0f},
+};
+
+static const OutputProfile outputProfiles[] = {
+    {"rover", roverLogs, sizeof(roverLogs) / sizeof(roverLogs[0])},
+    {"base", baseLogs, sizeof(baseLogs) / sizeof(baseLogs[0])},
+    {"logger", loggerLogs, sizeof(loggerLogs) / sizeof(loggerLogs[0])},
+};
+
+// nullptr для "none" и неизвестных имён — конфигурацию приёмника не трогаем
+static inline const OutputProfile* findOutputProfile(const char* name) {
+    for (size_t i = 0; i < sizeof(outputProfiles) / sizeof(outputProfiles[0]); i++) {
+        if (strcmp(outputProfiles[i].name, name) == 0) return &outputProfiles[i];
+    }
+    return nullptr;
+}
+
+// Текст команды без "\r\n"; индекс 0 — UNLOG, далее сообщения профиля
+static inline size_t formatProfileCommand(const OutputProfile* profile, size_t index, char* out, size_t cap) {
+    int n;
+    if (index == 0) {
+        n = snprintf(out, cap, "UNLOG %s", UM980_UART_PORT);
+    } else {
+        const OutputLog& log = profile->logs[index - 1];
+        // Период без лишних нулей: 0.05, 0.1, 1, 10
+        char period[12];
+        snprintf(period, sizeof(period), "%.2f", (double)log.period);
+        char* end = period + strlen(period) - 1;
+        while (*end == '0') *end-- = '\0';
+        if (*end == '.') *end = '\0';
+        n = snprintf(out, cap, "%s %s %s", log.message, UM980_UART_PORT, period);
+    }
+    return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+// Разбор ответа "$command,<эхо>,response: <текст>*hh".
+// Возвращает 1 — OK, -1 — ошибка, 0 — не ответ на команду expected.
+static inline int parseCommandResponse(const uint8_t* rec, size_t len, const char* expected) {
+    static const char prefix[] = "$command,";
+    const size_t prefixLen = sizeof(prefix) - 1;
+    while (len > 0 && (rec[len - 1] == '\r' || rec[len - 1] == '\n')) len--;
+    if (len < prefixLen + 4 || memcmp(rec, prefix, prefixLen) != 0 || rec[len - 3] != '*') return 0;
+
+    uint8_t cs = 0;
+    for (size_t i = 1; i < len - 3; i++) cs ^= rec[i];
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02X", cs);
+    if (rec[len - 2] != (uint8_t)hex[0] || rec[len - 1] != (uint8_t)hex[1]) return 0;
+
+    size_t echoLen = strlen(expected);
+    const char* echo = (const char*)rec + prefixLen;
+    if (prefixLen + echoLen + 1 > len || memcmp(echo, expected, echoLen) != 0 || echo[echoLen] != ',') return 0;
+
+    static const char okText[] = "response: OK";
+    const char* resp = echo + echoLen + 1;
+    size_t respLen = (const char*)rec + len - 3 - resp;
+    if (respLen == sizeof(okText) - 1 && memcmp(resp, okText, respLen) == 0) return 1;
+    return -1;
+}
+
+// Неблокирующая отправка профиля: одна команда в полёте, ожидание ответа с таймаутом
+template <typename Port>
+class OutputProfilePusher {
+  public:
+    enum State : uint8_t { IDLE, SEND, WAIT_ACK, DONE, FAILED };
+
+    static const uint32_t ACK_TIMEOUT_MS = 400;
+    static const uint8_t MAX_ATTEMPTS = 3;
+
+    explicit OutputProfilePusher(Port& p) : port(p) {}
+
+    void start(const OutputProfile* p) {
+        profile = p;
+        index = 0;
+        attempts = 0;
+        failures = 0;
+        state = p ? SEND : IDLE;
+    }
+
+    bool busy() const { return state == SEND || state == WAIT_ACK; }
+    State status() const { return state; }
+    const OutputProfile* current() const { return profile; }
+    uint8_t failedCommands() const { return failures; }
+
+    void poll(unsigned long now) {
+        if (state == WAIT_ACK && now - sentAt > ACK_TIMEOUT_MS) {
+            state = SEND;  // Повтор той же команды
+        }
+        if (state != SEND) return;
+
+        if (attempts >= MAX_ATTEMPTS) {
+            failures++;
+            next();
+            if (state != SEND) return;
+        }
+        if (formatProfileCommand(profile, index, command, sizeof(command)) == 0) {
+            failures++;
+            next();
+            return;
+        }
+        port.write((const uint8_t*)command, strlen(command));
+        port.write((const uint8_t*)"\r\n", 2);
+        attempts++;
+        sentAt = now;
+        state = WAIT_ACK;
+    }
+
+    // Запись из потока приёмника; true — это ответ на нашу команду (не пересылать)
+    bool onResponse(const uint8_t* rec, size_t len) {
+        if (state != WAIT_ACK) return false;
+        int r = parseCommandResponse(rec, len, command);
+        if (r == 0) return false;
+        if (r < 0) failures++;
+        next();
+        return true;
+    }
+
+  private:
+    Port& port;
+    const OutputProfile* profile = nullptr;
+    size_t index = 0;
+    uint8_t attempts = 0;
+    uint8_t failures = 0;
+    unsigned long sentAt = 0;
+    State state = IDLE;
+    char command[48];
+
+    void next() {
+        attempts = 0;
+        if (++index > profile->count) {
+            state = failures ? FAILED : DONE;
+        } else {
+            state = SEND;
+        }
+    }
+};
@@ -0,0 +1,321 @@
+// Очередь потребителя из целых записей: переполнение без разрыва кадров
+//
+// Байты лежат подряд, как в RingBufferT, и забираются порциями любой длины;
+// рядом хранятся начала и типы записей (SentenceType). Если новой записи не
+// хватает места или строки в таблице записей, очередь по своей политике либо
+// выбрасывает самые старые записи целиком (QUEUE_DROP_OLDEST), либо не берёт
+// новую (QUEUE_DROP_NEWEST). Старейшую запись, уже отданную частично, очередь
+// не трогает: выбрасывается следующая за ней, а недоотданный остаток
+// сдвигается на её место. Поток потребителя поэтому остаётся выровненным по
+// предложениям и кадрам RTCM3, а потери считаются записями по типам.
+// Сдвиг идёт под ringbufMux, поэтому он ограничен RECORD_SHIFT_MAX байт и
+// делается memmove участками: остаток длиннее — начатая группа частей
+// длинного кадра, и тогда очередь не берёт новую запись.
+//
+// Бинарный лог Unicore длиннее FRAMER_MAX_RECORD StreamFramer отдаёт частями
+// ST_UNIBIN: заголовок кадра, затем продолжения (StreamFramer::continued).
+// Очередь держит части кадра группой: вытесняет группу целиком, не берёт
+// продолжения кадра, голова или часть которого потеряна, а не поместившаяся
+// часть убирает и уже поставленные, если кадр ещё не начат. Разрезан может
+// быть только кадр, который уже частично отдан и один занимает всю очередь.
+// partialRemaining() считает начатый кадр до конца, включая не пришедшие части.
+//
+// Для очереди последних значений supersede(type) убирает ещё не начатые
+// записи того же типа перед записью новой. Вытесненные и заменённые записи
+// выставляют флаг skipped: потребитель пересчитывает по нему свою позицию.
+//
+// Позиции — счётчики байт по модулю 2^16, индекс в data — младшие биты:
+// N — степень двойки не больше 32768. Запись, чтение и флаг overflow — под
+// ringbufMux, как у RingBufferT; highWater и droppedBytes — те же поля
+// телеметрии, clear() их не сбрасывает.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "hal.h"
+#include "ring_buffer.h"
+#include "stream_framer.h"
+
+#define RECORD_PIECE 0x80  // В recType: продолжение длинного бинарного кадра
+#ifndef RECORD_SHIFT_MAX
+#define RECORD_SHIFT_MAX FRAMER_MAX_RECORD  // Наибольший сдвиг при уплотнении, байт: любая одиночная запись
+#endif
+
+enum QueueOverflowPolicy : uint8_t {
+    QUEUE_DROP_OLDEST = 0,  // Место новой записи — за счёт самых старых
+    QUEUE_DROP_NEWEST,      // Полная очередь не берёт новую запись
+    QUEUE_POLICY_COUNT
+};
+
+static const char* const queuePolicyNames[QUEUE_POLICY_COUNT] = {"OLDEST", "NEWEST"};
+
+template <size_t N, size_t MaxRecords>
+struct RecordQueueT {
+    static_assert((N & (N - 1)) == 0 && N <= 32768, "N: power of two up to 32768");
+
+    uint8_t data[N];
+    uint16_t recStart[MaxRecords];  // Позиция начала записи
+    uint8_t recType[MaxRecords];
+    uint16_t recHead, recCount;     // recHead — следующая свободная строка
+    volatile uint16_t wrPos;        // Производитель
+    volatile uint16_t rdPos;        // Потребитель
+    volatile uint8_t policy;        // QueueOverflowPolicy
+    volatile bool overflow;         // Были потери; сбрасывается первым чтением
+    volatile bool skipped;          // Записи ушли мимо чтения; сбрасывается первым чтением
+    volatile size_t highWater;
+    volatile uint32_t droppedBytes;
+    volatile uint32_t droppedRecords[ST_COUNT];
+    volatile uint32_t supersededBytes;  // Убрано supersede()
+    size_t frameLeft;               // Байт поставленного длинного кадра, ещё не пришедших частями
+
+    RecordQueueT()
+        : recHead(0), recCount(0), wrPos(0), rdPos(0), policy(QUEUE_DROP_OLDEST), overflow(false), skipped(false),
+          highWater(0), droppedBytes(0), supersededBytes(0), frameLeft(0) {
+        memset((void*)droppedRecords, 0, sizeof(droppedRecords));
+    }
+
+    // Запись целиком или ничего (thread-safe); type — SentenceType для счёта потерь,
+    // piece — продолжение длинного бинарного кадра (StreamFramer::continued)
+    size_t write(const uint8_t* src, size_t len, uint8_t type = ST_NMEA_OTHER, bool piece = false) {
+        if (!src || len == 0) return 0;
+        portENTER_CRITICAL(&ringbufMux);
+        releaseConsumed();
+        if (piece && frameLeft == 0) {
+            // Голова кадра или его часть не попала в очередь — остаток клиенту не нужен
+            overflow = true;
+            droppedBytes += (uint32_t)len;
+            portEXIT_CRITICAL(&ringbufMux);
+            return 0;
+        }
+        size_t left = 0;  // frameLeft после этой записи
+        if (piece) {
+            left = (len < frameLeft) ? frameLeft - len : 0;
+        } else if (type == ST_UNIBIN && len >= 8) {
+            size_t frame = FRAMER_UNIBIN_HEADER + (src[6] | ((size_t)src[7] << 8)) + 4;
+            if (frame > len) left = frame - len;
+        }
+        if (!fits(len)) {
+            overflow = true;
+            if (len > N || policy != QUEUE_DROP_OLDEST || !dropOldest(len) || (piece && frameLeft == 0)) {
+                if (!piece) {
+                    droppedRecords[type < ST_COUNT ? type : ST_RAW]++;
+                } else if (frameLeft > 0) {
+                    dropOpenFrame();
+                }
+                droppedBytes += (uint32_t)len;
+                frameLeft = 0;
+                portEXIT_CRITICAL(&ringbufMux);
+                return 0;
+            }
+        }
+        size_t at = wrPos & (N - 1);
+        size_t first = (len < N - at) ? len : N - at;
+        memcpy(data + at, src, first);
+        memcpy(data, src + first, len - first);
+        recStart[recHead] = wrPos;
+        recType[recHead] = piece ? (uint8_t)(type | RECORD_PIECE) : type;
+        recHead = (uint16_t)((recHead + 1) % MaxRecords);
+        recCount++;
+        wrPos = (uint16_t)(wrPos + len);
+        frameLeft = left;
+        size_t used = (uint16_t)(wrPos - rdPos);
+        if (used > highWater) highWater = used;
+        portEXIT_CRITICAL(&ringbufMux);
+        return len;
+    }
+
+    // Чтение порцией любой длины, в том числе посреди записи (thread-safe)
+    size_t read(uint8_t* dest, size_t maxLen) {
+        if (!dest || maxLen == 0) return 0;
+        portENTER_CRITICAL(&ringbufMux);
+        size_t n = (uint16_t)(wrPos - rdPos);
+        if (n > maxLen) n = maxLen;
+        size_t at = rdPos & (N - 1);
+        size_t first = (n < N - at) ? n : N - at;
+        memcpy(dest, data + at, first);
+        memcpy(dest + first, data, n - first);
+        rdPos = (uint16_t)(rdPos + n);
+        if (n > 0) overflow = skipped = false;
+        portEXIT_CRITICAL(&ringbufMux);
+        return n;
+    }
+
+    size_t available() const {
+        portENTER_CRITICAL(&ringbufMux);
+        size_t avail = (uint16_t)(wrPos - rdPos);
+        portEXIT_CRITICAL(&ringbufMux);
+        return avail;
+    }
+
+    size_t freeSpace() const { return N - available(); }
+
+    bool hasOverflowed() const { return overflow; }
+
+    void clear() {
+        portENTER_CRITICAL(&ringbufMux);
+        rdPos = wrPos;
+        recCount = 0;
+        frameLeft = 0;  // Голова кадра ушла вместе с очередью
+        overflow = skipped = false;
+        portEXIT_CRITICAL(&ringbufMux);
+    }
+
+    size_t capacity() const { return N; }
+
+    // Байт до конца начатой старейшей записи (длинного кадра — со всеми частями,
+    // в том числе ещё не пришедшими); 0 — чтение стоит на границе записей
+    size_t partialRemaining() {
+        portENTER_CRITICAL(&ringbufMux);
+        releaseConsumed();
+        size_t left = frameLeft;  // Очередь отдана вся: начат разве что недописанный кадр
+        if (recCount > 0) {
+            size_t s = slot(0);
+            size_t g = groupLength(0);
+            bool started = recStart[s] != rdPos || (recType[s] & RECORD_PIECE);
+            left = started ? (uint16_t)(recordEnd(g - 1) - rdPos) + (g == recCount ? frameLeft : 0) : 0;
+        }
+        portEXIT_CRITICAL(&ringbufMux);
+        return left;
+    }
+
+    // Убрать не начатые записи типа type (их заменит новая); возвращает число убранных
+    size_t supersede(uint8_t type) {
+        size_t removed = 0;
+        portENTER_CRITICAL(&ringbufMux);
+        releaseConsumed();
+        for (size_t age = 0; age < recCount;) {
+            size_t s = slot(age);
+            bool started = (age == 0 && recStart[s] != rdPos);
+            uint16_t older = (uint16_t)(recStart[s] - rdPos);
+            if ((recType[s] & ~RECORD_PIECE) != type || started || older > RECORD_SHIFT_MAX) {
+                age++;
+                continue;
+            }
+            // Более старые байты сдвигаются вплотную к следующей записи, как в dropOldest()
+            uint16_t len = (uint16_t)(recordEnd(age) - recStart[s]);
+            shiftForward(rdPos, older, len);
+            rdPos = (uint16_t)(rdPos + len);
+            for (size_t k = age; k > 0; k--) {
+                recStart[slot(k)] = (uint16_t)(recStart[slot(k - 1)] + len);
+                recType[slot(k)] = recType[slot(k - 1)];
+            }
+            recCount--;
+            removed++;
+            supersededBytes += len;
+            skipped = true;
+        }
+        portEXIT_CRITICAL(&ringbufMux);
+        return removed;
+    }
+
+    // Потеряно записей всех типов
+    uint32_t droppedRecordsTotal() const {
+        uint32_t sum = 0;
+        for (size_t t = 0; t < ST_COUNT; t++) sum += droppedRecords[t];
+        return sum;
+    }
+
+private:
+    // Расстояние от позиции до конца записанного: у всех живых позиций 0..N
+    uint16_t back(uint16_t pos) const { return (uint16_t)(wrPos - pos); }
+
+    size_t slot(size_t age) const { return (recHead + MaxRecords - recCount + age) % MaxRecords; }
+
+    // Конец записи с возрастом age (0 — старейшая): начало следующей или wrPos
+    uint16_t recordEnd(size_t age) const { return (age + 1 < recCount) ? recStart[slot(age + 1)] : wrPos; }
+
+    bool fits(size_t len) const { return (uint16_t)(wrPos - rdPos) + len <= N && recCount < MaxRecords; }
+
+    // Строки записей, целиком отданных потребителю, освобождаются лениво — под записью
+    void releaseConsumed() {
+        while (recCount > 0 && back(recordEnd(0)) >= back(rdPos)) recCount--;
+    }
+
+    void noteDropped(size_t s, uint16_t bytes) {
+        uint8_t type = recType[s] & ~RECORD_PIECE;
+        droppedRecords[type < ST_COUNT ? type : ST_RAW]++;
+        droppedBytes += bytes;
+    }
+
+    // count байт с позиции from сдвигаются на by вперёд (области перекрываются):
+    // с конца, участками, непрерывными и в источнике, и в приёмнике — не больше трёх memmove
+    void shiftForward(uint16_t from, size_t count, uint16_t by) {
+        while (count > 0) {
+            size_t srcEnd = (size_t)((from + count - 1) & (N - 1)) + 1;
+            size_t dstEnd = (size_t)((from + by + count - 1) & (N - 1)) + 1;
+            size_t n = count;
+            if (n > srcEnd) n = srcEnd;
+            if (n > dstEnd) n = dstEnd;
+            memmove(data + dstEnd - n, data + srcEnd - n, n);
+            count -= n;
+        }
+    }
+
+    // Записей в группе с возраста age: запись и следующие за ней продолжения
+    size_t groupLength(size_t age) const {
+        size_t n = 1;
+        while (age + n < recCount && (recType[slot(age + n)] & RECORD_PIECE)) n++;
+        return n;
+    }
+
+    // Освободить место под len байт, выбрасывая старые группы; false — нельзя,
+    // осталась только частично отданная группа. Выброшенный недописанный
+    // кадр закрывается: frameLeft = 0, его остаток не принимается
+    bool dropOldest(size_t len) {
+        while (!fits(len)) {
+            size_t oldest = slot(0);
+            size_t g = groupLength(0);
+            if (recStart[oldest] == rdPos && !(recType[oldest] & RECORD_PIECE)) {
+                // Не начата — выбрасывается целиком
+                uint16_t end = recordEnd(g - 1);
+                noteDropped(oldest, (uint16_t)(end - rdPos));
+                if (g == recCount) frameLeft = 0;
+                skipped = true;
+                rdPos = end;
+                recCount = (uint16_t)(recCount - g);
+                continue;
+            }
+            if (g >= recCount) return false;
+            // Начата: выбрасывается следующая группа, остаток старейшей сдвигается вплотную к третьей.
+            // Остаток длиннее RECORD_SHIFT_MAX (начатый длинный кадр) не двигается — новая запись не берётся
+            size_t next = slot(g);
+            uint16_t rest = (uint16_t)(recStart[next] - rdPos);
+            if (rest > RECORD_SHIFT_MAX) return false;
+            size_t d = groupLength(g);
+            uint16_t gap = (uint16_t)(recordEnd(g + d - 1) - recStart[next]);
+            noteDropped(next, gap);
+            if (g + d == recCount) frameLeft = 0;
+            skipped = true;
+            shiftForward(rdPos, rest, gap);
+            rdPos = (uint16_t)(rdPos + gap);
+            for (size_t k = g; k-- > 0;) {  // Строки старейшей группы — на место выброшенной
+                recStart[slot(k + d)] = (uint16_t)(recStart[slot(k)] + gap);
+                recType[slot(k + d)] = recType[slot(k)];
+            }
+            recCount = (uint16_t)(recCount - d);
+        }
+        return true;
+    }
+
+    // Часть кадра не поместилась: уже поставленные части убираются, если кадр
+    // ещё не начат; начатый остаётся разрезанным
+    void dropOpenFrame() {
+        if (recCount == 0) {
+            droppedRecords[ST_UNIBIN]++;
+            return;
+        }
+        size_t head = recCount - 1;
+        while (head > 0 && (recType[slot(head)] & RECORD_PIECE)) head--;
+        size_t s = slot(head);
+        if ((recType[s] & RECORD_PIECE) || (head == 0 && recStart[s] != rdPos)) {
+            droppedRecords[ST_UNIBIN]++;
+            return;
+        }
+        noteDropped(s, (uint16_t)(wrPos - recStart[s]));
+        wrPos = recStart[s];
+        recHead = (uint16_t)s;
+        recCount = (uint16_t)head;
+    }
+};
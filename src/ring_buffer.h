@@ -0,0 +1,129 @@
+// Кольцевой буфер байтов: входящие RX; очереди потребителей BLE и WiFi —
+// из целых записей (record_queue.h)
+//
+// Один производитель и один потребитель; индексы и флаг переполнения меняются
+// под общим спинлоком ringbufMux. При заполнении перезаписываются самые старые
+// байты, флаг overflow сбрасывается первым успешным чтением. Для телеметрии
+// запись ведёт максимум заполнения (highWater) и число перезаписанных байт
+// (droppedBytes) с момента запуска; clear() их не сбрасывает.
+//
+// Критические секции — из hal.h: portMUX на ESP32, спинлок в хост-сборке.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "hal.h"
+
+// Общий спинлок для секций кольцевого буфера
+static portMUX_TYPE ringbufMux = portMUX_INITIALIZER_UNLOCKED;
+
+template <size_t N>
+struct RingBufferT {
+    uint8_t data[N];
+    volatile size_t head;      // Индекс для записи (производитель)
+    volatile size_t tail;      // Индекс для чтения (потребитель)
+    volatile bool overflow;    // Флаг переполнения буфера
+    volatile size_t highWater;         // Максимум байт в буфере
+    volatile uint32_t droppedBytes;    // Перезаписано до чтения
+    
+    RingBufferT() : head(0), tail(0), overflow(false), highWater(0), droppedBytes(0) {}
+    
+    // Запись данных в кольцевой буфер (thread-safe)
+    size_t write(const uint8_t* src, size_t len) {
+        if (!src || len == 0) return 0;
+        
+        size_t written = 0;
+        uint32_t dropped = 0;
+        
+        // Критическая секция под общим спинлоком
+        portENTER_CRITICAL(&ringbufMux);
+        
+        for (size_t i = 0; i < len; i++) {
+            size_t next_head = (head + 1) % N;
+            
+            if (next_head == tail) {
+                // Буфер полон - перезаписываем самые старые данные
+                tail = (tail + 1) % N;
+                overflow = true;
+                dropped++;
+            }
+            
+            data[head] = src[i];
+            head = next_head;
+            written++;
+        }
+        
+        size_t used = (head + N - tail) % N;
+        if (used > highWater) highWater = used;
+        if (dropped) droppedBytes += dropped;
+        
+        portEXIT_CRITICAL(&ringbufMux);
+        return written;
+    }
+    
+    // Чтение данных из кольцевого буфера (thread-safe)
+    size_t read(uint8_t* dest, size_t maxLen) {
+        if (!dest || maxLen == 0) return 0;
+        
+        size_t bytesRead = 0;
+        
+        // Критическая секция под общим спинлоком
+        portENTER_CRITICAL(&ringbufMux);
+        
+        while (tail != head && bytesRead < maxLen) {
+            dest[bytesRead] = data[tail];
+            tail = (tail + 1) % N;
+            bytesRead++;
+        }
+        
+        // Сбрасываем флаг переполнения после чтения
+        if (overflow && bytesRead > 0) {
+            overflow = false;
+        }
+        
+        portEXIT_CRITICAL(&ringbufMux);
+        return bytesRead;
+    }
+    
+    // Получить количество доступных для чтения байт
+    size_t available() const {
+        portENTER_CRITICAL(&ringbufMux);
+        
+        size_t avail;
+        if (head >= tail) {
+            avail = head - tail;
+        } else {
+            avail = N - tail + head;
+        }
+        
+        portEXIT_CRITICAL(&ringbufMux);
+        return avail;
+    }
+    
+    // Получить количество свободного места в байтах
+    size_t freeSpace() const {
+        return N - available() - 1; // -1 для различения полного/пустого буфера
+    }
+    
+    // Проверить, был ли переполнен буфер
+    bool hasOverflowed() const {
+        return overflow;
+    }
+    
+    // Очистить буфер
+    void clear() {
+        portENTER_CRITICAL(&ringbufMux);
+        
+        head = 0;
+        tail = 0;
+        overflow = false;
+        
+        portEXIT_CRITICAL(&ringbufMux);
+    }
+    
+    // Получить размер буфера
+    size_t capacity() const {
+        return N - 1; // -1 из-за алгоритма различения полный/пустой
+    }
+};
@@ -0,0 +1,164 @@
+// Архив потока приёмника для повтора истории подключившимся позже клиентам
+//
+// Кольцо в PSRAM (S3 с BOARD_HAS_PSRAM) хранит поток UART всегда, есть
+// клиенты или нет, теми же записями, что режет StreamFramer: перед каждой —
+// заголовок с временем прихода (millis), длиной, типом и пометкой продолжения
+// длинного бинарного кадра (StreamFramer::continued). Новые записи
+// вытесняют самые старые целиком, так что архив всегда начинается с границы
+// записи. Индекс времени — позиция первой записи каждой секунды; поиск
+// момента идёт по индексу, дальше по заголовкам до нужной миллисекунды.
+//
+// Чтение — курсором (абсолютной позицией в архиве) по записи за раз. Курсор,
+// который писатель обогнал на круг, переносится на старейшую запись. Пишет и
+// читает один поток (приём), поэтому без блокировок.
+//
+// Память выделяет окружение: прошивка — heap_caps_malloc(MALLOC_CAP_SPIRAM),
+// хост-сборка — malloc. Без неё archive.enabled() ложно и запись ничего не
+// делает. Хост-сборка проверяет повтор по --archive-kb.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef STREAM_ARCHIVE_BYTES
+#define STREAM_ARCHIVE_BYTES (4u << 20)  // Не меньше 6 минут: 115200 бод без пауз — 11.5 кБ/с
+#endif
+
+#define ARCHIVE_HEADER_BYTES 8
+#define ARCHIVE_INDEX_SECONDS 8192  // Больше двух часов: от 512 Б/с индекс не короче кольца
+
+struct ArchiveIndexEntry {
+    uint32_t second;  // ms / 1000 первой записи секунды
+    uint32_t pos;
+};
+
+class StreamArchive {
+public:
+    // Размер памяти под кольцо dataBytes (степень двойки) вместе с индексом
+    static size_t footprint(size_t dataBytes) {
+        return dataBytes + ARCHIVE_INDEX_SECONDS * sizeof(ArchiveIndexEntry);
+    }
+
+    // mem — footprint(dataBytes) байт; dataBytes округляется вниз до степени двойки
+    void begin(uint8_t* mem, size_t dataBytes) {
+        size_t size = 1;
+        while (size * 2 <= dataBytes && size < 0x80000000u) size *= 2;
+        index_ = (ArchiveIndexEntry*)(void*)(mem + dataBytes);
+        data_ = mem;
+        mask_ = (uint32_t)size - 1;
+        head_ = tail_ = 0;
+        indexHead_ = indexCount_ = 0;
+        evictedRecords = 0;
+    }
+
+    bool enabled() const { return data_ != NULL; }
+
+    // Запись целиком; ms — время прихода (millis), не убывает; piece — продолжение длинного кадра
+    void append(const uint8_t* rec, size_t len, uint8_t type, uint32_t ms, bool piece = false) {
+        uint32_t need = ARCHIVE_HEADER_BYTES + (uint32_t)len;
+        if (!data_ || len == 0 || len > 0xFFFF || need > mask_ + 1) return;
+        while (head_ + need - tail_ > mask_ + 1) {
+            tail_ += ARCHIVE_HEADER_BYTES + recordLength(tail_);
+            evictedRecords++;
+        }
+        uint8_t header[ARCHIVE_HEADER_BYTES] = {(uint8_t)ms, (uint8_t)(ms >> 8), (uint8_t)(ms >> 16),
+                                                (uint8_t)(ms >> 24), (uint8_t)len, (uint8_t)(len >> 8), type, piece};
+        uint32_t second = ms / 1000;
+        if (indexCount_ == 0 || indexAt(0).second != second) {
+            ArchiveIndexEntry& e = index_[indexHead_];
+            e.second = second;
+            e.pos = head_;
+            indexHead_ = (indexHead_ + 1) % ARCHIVE_INDEX_SECONDS;
+            if (indexCount_ < ARCHIVE_INDEX_SECONDS) indexCount_++;
+        }
+        copyIn(head_, header, ARCHIVE_HEADER_BYTES);
+        copyIn(head_ + ARCHIVE_HEADER_BYTES, rec, len);
+        head_ += need;
+    }
+
+    // Курсор на первую запись, пришедшую не раньше fromMs (или на старейшую)
+    uint32_t seek(uint32_t fromMs) const {
+        uint32_t pos = tail_;
+        for (size_t age = 0; age < indexCount_; age++) {
+            const ArchiveIndexEntry& e = indexAt(age);
+            if ((int32_t)(e.pos - tail_) < 0) break;  // Дальше — уже вытесненные
+            if ((int32_t)(e.second - fromMs / 1000) <= 0) {
+                pos = e.pos;
+                break;
+            }
+        }
+        while (pos != head_ && (int32_t)(recordMs(pos) - fromMs) < 0) {
+            pos += ARCHIVE_HEADER_BYTES + recordLength(pos);
+        }
+        return pos;
+    }
+
+    // Следующая запись курсора в out (cap байт; более длинная пропускается);
+    // 0 — курсор догнал запись. lost — курсор обогнан и перенесён на старейшую.
+    // piece — запись продолжает длинный кадр: без его головы очередь её не возьмёт.
+    size_t next(uint32_t& cursor, uint8_t* out, size_t cap, uint8_t* type, bool* lost, bool* piece) {
+        *lost = (int32_t)(cursor - tail_) < 0;
+        if (*lost) cursor = tail_;
+        while (cursor != head_) {
+            size_t len = recordLength(cursor);
+            uint32_t at = cursor;
+            cursor += ARCHIVE_HEADER_BYTES + (uint32_t)len;
+            if (len > cap) continue;
+            *type = byteAt(at + 6);
+            *piece = byteAt(at + 7) != 0;
+            copyOut(at + ARCHIVE_HEADER_BYTES, out, len);
+            return len;
+        }
+        return 0;
+    }
+
+    // Байт записей от курсора до конца архива, с заголовками
+    uint32_t pendingBytes(uint32_t cursor) const {
+        return ((int32_t)(cursor - tail_) < 0) ? head_ - tail_ : head_ - cursor;
+    }
+
+    uint32_t head() const { return head_; }
+    uint32_t usedBytes() const { return head_ - tail_; }
+    uint32_t capacity() const { return data_ ? mask_ + 1 : 0; }
+
+    // Время старейшей записи; архив пуст — now
+    uint32_t oldestMs(uint32_t now) const { return (head_ == tail_) ? now : recordMs(tail_); }
+
+    uint32_t evictedRecords = 0;  // Вытеснено новыми записями с запуска
+
+private:
+    uint8_t* data_ = NULL;
+    ArchiveIndexEntry* index_ = NULL;
+    uint32_t mask_ = 0;
+    uint32_t head_ = 0;  // Абсолютные позиции, по модулю 2^32
+    uint32_t tail_ = 0;  // Начало старейшей записи
+    size_t indexHead_ = 0, indexCount_ = 0;
+
+    const ArchiveIndexEntry& indexAt(size_t age) const {  // 0 — последняя секунда
+        return index_[(indexHead_ + ARCHIVE_INDEX_SECONDS - 1 - age) % ARCHIVE_INDEX_SECONDS];
+    }
+
+    uint8_t byteAt(uint32_t pos) const { return data_[pos & mask_]; }
+
+    uint32_t recordMs(uint32_t pos) const {
+        return (uint32_t)byteAt(pos) | (uint32_t)byteAt(pos + 1) << 8 | (uint32_t)byteAt(pos + 2) << 16 |
+               (uint32_t)byteAt(pos + 3) << 24;
+    }
+
+    uint16_t recordLength(uint32_t pos) const { return (uint16_t)(byteAt(pos + 4) | byteAt(pos + 5) << 8); }
+
+    void copyIn(uint32_t pos, const uint8_t* src, size_t len) {
+        size_t at = pos & mask_;
+        size_t first = (len < mask_ + 1 - at) ? len : mask_ + 1 - at;
+        memcpy(data_ + at, src, first);
+        memcpy(data_, src + first, len - first);
+    }
+
+    void copyOut(uint32_t pos, uint8_t* dest, size_t len) const {
+        size_t at = pos & mask_;
+        size_t first = (len < mask_ + 1 - at) ? len : mask_ + 1 - at;
+        memcpy(dest, data_ + at, first);
+        memcpy(dest + first, data_, len - first);
+    }
+};
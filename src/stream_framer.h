@@ -0,0 +1,349 @@
+// Нарезка потока UART на записи и фильтры потребителей
+//
+// Поток UART режется на целые записи (NMEA строки, RTCM3 кадры, бинарные
+// логи Unicore, прочие байты),
+// и каждая запись независимо проходит фильтр каждого потребителя (BLE, WiFi клиенты)
+// до попадания в его очередь. Так телефон может получать только GGA/GST,
+// а WiFi логгер — полный поток.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+// Типы записей для фильтрации
+enum SentenceType : uint8_t {
+    ST_GGA = 0,
+    ST_GNS,
+    ST_GSA,
+    ST_GSV,
+    ST_GST,
+    ST_RMC,
+    ST_VTG,
+    ST_GLL,
+    ST_ZDA,
+    ST_NMEA_OTHER,  // Прочие NMEA ($....) включая ответы $command
+    ST_RTCM,        // RTCM3 кадры (0xD3)
+    ST_UNICORE,     // ASCII логи Unicore (#....)
+    ST_UNIBIN,      // Бинарные логи Unicore (0xAA 0x44 0xB5)
+    ST_RAW,         // Байты вне известных кадров
+    ST_COUNT
+};
+
+static const char* const sentenceTypeNames[ST_COUNT] = {
+    "GGA", "GNS", "GSA", "GSV", "GST", "RMC", "VTG", "GLL", "ZDA", "NMEA", "RTCM", "UNI", "UBIN", "RAW"
+};
+
+// Определение типа NMEA по полю адреса ($ttSSS,...)
+static uint8_t classifyNmeaSentence(const uint8_t* rec, size_t len) {
+    if (len < 7 || rec[6] != ',') return ST_NMEA_OTHER;
+    const char* s = (const char*)rec + 3;
+    for (uint8_t t = ST_GGA; t <= ST_ZDA; t++) {
+        if (memcmp(s, sentenceTypeNames[t], 3) == 0) return t;
+    }
+    return ST_NMEA_OTHER;
+}
+
+// Контрольная сумма NMEA ($...*hh): false — сумма есть и не совпала.
+// Строки без '*' не проверяются.
+static inline bool nmeaChecksumOk(const uint8_t* rec, size_t len) {
+    uint8_t sum = 0;
+    for (size_t i = 1; i < len; i++) {
+        if (rec[i] != '*') {
+            sum ^= rec[i];
+            continue;
+        }
+        if (i + 2 >= len) return false;
+        uint8_t expected = 0;
+        for (size_t k = i + 1; k <= i + 2; k++) {
+            uint8_t c = rec[k];
+            uint8_t v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : 0xFF;
+            if (v == 0xFF) return false;
+            expected = (uint8_t)(expected << 4 | v);
+        }
+        return expected == sum;
+    }
+    return true;
+}
+
+// CRC-24Q кадра RTCM3 (полином 0x1864CFB)
+static inline uint32_t rtcmCrc24q(const uint8_t* data, size_t len) {
+    uint32_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint32_t)data[i] << 16;
+        for (int b = 0; b < 8; b++) {
+            crc <<= 1;
+            if (crc & 0x1000000) crc ^= 0x1864CFB;
+        }
+    }
+    return crc & 0xFFFFFF;
+}
+
+// Целый кадр RTCM3 (0xD3, длина, данные, CRC) с верной CRC-24Q
+static inline bool rtcmFrameCrcOk(const uint8_t* rec, size_t len) {
+    if (len < 6) return false;
+    uint32_t crc = ((uint32_t)rec[len - 3] << 16) | ((uint32_t)rec[len - 2] << 8) | rec[len - 1];
+    return rtcmCrc24q(rec, len - 3) == crc;
+}
+
+// Нарезка байтового потока на записи. Незавершённая запись хранится до следующего
+// вызова feed(), поэтому потребители всегда получают целые предложения/кадры.
+#define FRAMER_MAX_NMEA  255    // Максимальная длина строки NMEA/Unicore ASCII
+#define FRAMER_MAX_RECORD 1029  // RTCM3: 3 байта заголовка + 1023 данных + 3 CRC
+#define FRAMER_UNIBIN_HEADER 24 // Заголовок бинарного лога Unicore
+#define FRAMER_UNIBIN_MAX_BODY 8192  // Больше — считаем ложной синхронизацией
+
+// Бинарный лог длиннее буфера (например, OBSVM на многих спутниках) пересылается
+// частями типа ST_UNIBIN; разбираются только кадры, целиком поместившиеся в буфер.
+// Первая часть — заголовок кадра, у остальных на время emit выставлен continued:
+// очереди потребителей (record_queue.h) держат части одного кадра вместе.
+
+struct StreamFramer {
+    enum State : uint8_t { IDLE, LINE, RTCM, UNIBIN, RAW };
+
+    uint8_t buf[FRAMER_MAX_RECORD + 1];  // +1 под завершающий '\0' для парсеров NMEA
+    size_t len = 0;
+    size_t expected = 0;  // Полная длина кадра RTCM/Unicore (после получения заголовка)
+    size_t remaining = 0; // Остаток длинного бинарного кадра, пересылаемого частями
+    State state = IDLE;
+    bool continued = false;  // Отдаваемая запись — продолжение длинного бинарного кадра
+
+    void reset() {
+        len = 0;
+        expected = 0;
+        remaining = 0;
+        state = IDLE;
+        continued = false;
+        inLongFrame = false;
+    }
+
+    static bool isRecordStart(uint8_t c) {
+        return c == '$' || c == '#' || c == 0xD3 || c == 0xAA;
+    }
+
+    // emit(const uint8_t* rec, size_t len, uint8_t type)
+    template <typename Emit>
+    void feed(const uint8_t* data, size_t n, Emit&& emit) {
+        for (size_t i = 0; i < n; i++) {
+            uint8_t c = data[i];
+
+            // Продолжение длинного бинарного кадра
+            if (remaining > 0) {
+                buf[len++] = c;
+                if (--remaining == 0 || len >= FRAMER_MAX_RECORD) {
+                    emitRecord(emit, ST_UNIBIN);
+                }
+                continue;
+            }
+
+            if (state == RAW && isRecordStart(c)) {
+                emitRecord(emit);
+            }
+
+            if (state == IDLE) {
+                if (c == '$' || c == '#') {
+                    state = LINE;
+                } else if (c == 0xD3) {
+                    state = RTCM;
+                    expected = 0;
+                } else if (c == 0xAA) {
+                    state = UNIBIN;
+                    expected = 0;
+                } else {
+                    state = RAW;
+                }
+            }
+
+            buf[len++] = c;
+
+            switch (state) {
+                case LINE:
+                    if (c == '\n') {
+                        emitRecord(emit);
+                    } else if (len >= FRAMER_MAX_NMEA) {
+                        // Слишком длинная строка — отдаём как есть, без фильтрации по типу
+                        state = RAW;
+                        emitRecord(emit);
+                    }
+                    break;
+                case RTCM:
+                    if (len == 2 && (buf[1] & 0xFC)) {
+                        // 6 зарезервированных бит должны быть нулями, иначе это не RTCM3
+                        demote(emit, c);
+                    } else if (len == 3) {
+                        expected = 3 + (((size_t)(buf[1] & 0x03) << 8) | buf[2]) + 3;
+                    }
+                    if (expected > 0 && len >= expected) {
+                        emitRecord(emit);
+                    }
+                    break;
+                case UNIBIN:
+                    if ((len == 2 && c != 0x44) || (len == 3 && c != 0xB5)) {
+                        demote(emit, c);
+                    } else if (len == 8) {
+                        size_t body = buf[6] | ((size_t)buf[7] << 8);
+                        if (body > FRAMER_UNIBIN_MAX_BODY) {
+                            demote(emit, c);
+                        } else {
+                            expected = FRAMER_UNIBIN_HEADER + body + 4;
+                        }
+                    }
+                    if (expected > 0 && len >= expected) {
+                        emitRecord(emit);
+                    } else if (expected > FRAMER_MAX_RECORD && len == FRAMER_UNIBIN_HEADER) {
+                        // Не помещается — пересылаем частями без разбора
+                        remaining = expected - len;
+                        emitRecord(emit);
+                    }
+                    break;
+                case RAW:
+                    if (len >= FRAMER_MAX_NMEA) emitRecord(emit);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Произвольные байты и части длинных кадров не держим до следующего пакета
+        if ((state == RAW || remaining > 0) && len > 0) {
+            emitRecord(emit, (remaining > 0) ? (uint8_t)ST_UNIBIN : (uint8_t)ST_RAW);
+        }
+    }
+
+  private:
+    bool inLongFrame = false;  // Заголовок длинного кадра уже отдан
+
+    template <typename Emit>
+    void emitRecord(Emit& emit, uint8_t type = ST_COUNT) {
+        if (type == ST_COUNT) {
+            switch (state) {
+                case LINE:   type = (buf[0] == '#') ? ST_UNICORE : classifyNmeaSentence(buf, len); break;
+                case RTCM:   type = ST_RTCM; break;
+                case UNIBIN: type = ST_UNIBIN; break;
+                default:     type = ST_RAW; break;
+            }
+        }
+        buf[len] = '\0';
+        continued = inLongFrame;
+        emit(buf, len, type);
+        continued = false;
+        inLongFrame = remaining > 0;
+        len = 0;
+        expected = 0;
+        if (remaining == 0) state = IDLE;
+    }
+
+    // Ложная синхронизация: всё до текущего байта уходит как RAW,
+    // а сам байт может начинать новую запись
+    template <typename Emit>
+    void demote(Emit& emit, uint8_t c) {
+        len--;
+        state = RAW;
+        emitRecord(emit);
+        if (isRecordStart(c)) {
+            state = (c == 0xD3) ? RTCM : (c == 0xAA) ? UNIBIN : LINE;
+        } else {
+            state = RAW;
+        }
+        buf[len++] = c;
+    }
+};
+
+// Фильтр потребителя: allowlist типов + прореживание (каждая N-я запись типа).
+// divisor: 0 = тип отключён, 1 = все записи, N = каждая N-я.
+// Многостраничные GSV/GSA решаются целой пачкой: решение принимается на первой
+// записи пачки и действует до смены типа, чтобы не рвать группы страниц.
+struct SinkFilter {
+    uint8_t divisor[ST_COUNT];
+    uint8_t counter[ST_COUNT];
+    uint8_t lastType = ST_COUNT;
+    bool lastAccepted = true;
+    bool passAll = true;
+
+    SinkFilter() { reset(); }
+
+    void reset() {
+        for (int t = 0; t < ST_COUNT; t++) {
+            divisor[t] = 1;
+            counter[t] = 0;
+        }
+        lastType = ST_COUNT;
+        lastAccepted = true;
+        passAll = true;
+    }
+
+    bool accept(uint8_t type) {
+        if (passAll) return true;
+        if (type >= ST_COUNT || divisor[type] == 0) {
+            lastType = type;
+            return false;
+        }
+
+        bool grouped = (type == ST_GSV || type == ST_GSA);
+        if (grouped && type == lastType) return lastAccepted;
+
+        lastType = type;
+        lastAccepted = (counter[type] == 0);
+        if (++counter[type] >= divisor[type]) counter[type] = 0;
+        return lastAccepted;
+    }
+
+    // Разбор спецификации вида "GGA:1,GSV:10,GST:10,RTCM:1".
+    // Неперечисленные типы отключаются; "*:N" задаёт значение по умолчанию.
+    // Пустая строка или "ALL" — полный поток без фильтрации.
+    bool parse(const char* spec) {
+        reset();
+        if (!spec || !*spec || strcmp(spec, "ALL") == 0) return true;
+
+        bool listed[ST_COUNT];
+        memset(listed, 0, sizeof(listed));
+        bool hasDefault = false;
+        uint8_t defaultDivisor = 0;
+
+        const char* p = spec;
+        while (*p) {
+            const char* colon = p;
+            while (*colon && *colon != ':' && *colon != ',') colon++;
+            size_t nameLen = colon - p;
+            uint8_t div = 1;
+            const char* next = colon;
+            if (*colon == ':') {
+                // Делитель — только цифры 0..255: "GGA:", "GGA:x", "GGA:300" отвергаются
+                char* end = NULL;
+                unsigned long value = strtoul(colon + 1, &end, 10);
+                if (colon[1] < '0' || colon[1] > '9' || (*end && *end != ',') || value > 255) {
+                    reset();
+                    return false;
+                }
+                div = (uint8_t)value;
+                next = end;
+            }
+
+            if (nameLen == 1 && *p == '*') {
+                hasDefault = true;
+                defaultDivisor = div;
+            } else {
+                int t = 0;
+                for (; t < ST_COUNT; t++) {
+                    if (strlen(sentenceTypeNames[t]) == nameLen &&
+                        strncmp(p, sentenceTypeNames[t], nameLen) == 0) break;
+                }
+                if (t == ST_COUNT) {
+                    reset();
+                    return false;  // Неизвестный тип — остаёмся без фильтра
+                }
+                listed[t] = true;
+                divisor[t] = div;
+            }
+
+            p = (*next == ',') ? next + 1 : next;
+        }
+
+        for (int t = 0; t < ST_COUNT; t++) {
+            if (!listed[t]) divisor[t] = hasDefault ? defaultDivisor : 0;
+        }
+        passAll = false;
+        return true;
+    }
+};
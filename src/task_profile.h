@@ -0,0 +1,136 @@
+// Профиль задач: доля CPU, запас стека и куча
+//
+// Прошивка с -DTASK_PROFILE=1 раз в TASK_PROFILE_PERIOD_MS снимает по каждой
+// задаче FreeRTOS накопленное время выполнения и минимум свободного стека,
+// а также свободную кучу и наибольший свободный блок. Здесь — хранение
+// снимков, доли CPU за период, тренд кучи и текстовый отчёт; сбор через API
+// FreeRTOS и heap_caps — в main.cpp.
+//
+// Доля CPU считается от одного ядра: на S3 сумма по задачам до 200 %. Если
+// ядро собрано без configGENERATE_RUN_TIME_STATS, время выполнения известно
+// только задачам конвейера (замеры итераций, bridge_core.h).
+//
+// Сбор — только на плате; доли CPU и тренд кучи проверяет --profile-selftest
+// хост-сборки на заданных снимках.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bridge_telemetry.h"
+
+#define TASK_PROFILE_MAX_TASKS 24     // Задач в системе: S3 с WiFi и BLE — около 18
+#define TASK_PROFILE_HEAP_HISTORY 24  // Снимков кучи для тренда
+
+struct TaskProfileEntry {
+    char name[16];
+    uint32_t runTimeUs;  // Накопленное время выполнения (переполняется)
+    uint32_t stackFree;  // Минимум свободного стека с запуска, байт
+    uint8_t priority;
+    int8_t core;         // -1 — без привязки или неизвестно
+    bool hasRunTime;
+    uint16_t cpuPermille;  // Доля одного ядра за последний период
+};
+
+struct HeapSample {
+    uint32_t ms;
+    uint32_t freeBytes;
+    uint32_t largestBlock;
+};
+
+struct TaskProfile {
+    TaskProfileEntry tasks[TASK_PROFILE_MAX_TASKS];
+    uint8_t taskCount;
+    bool runTimeStats;  // Время выполнения от FreeRTOS, а не только конвейера
+    uint32_t periodUs;  // Длина последнего периода
+    uint32_t sampledUs;
+    uint32_t minFreeHeap;  // С запуска
+    HeapSample heap[TASK_PROFILE_HEAP_HISTORY];
+    uint8_t heapHead, heapCount;
+
+    // Новый снимок задач; доля CPU — по разнице с прошлым снимком задачи с тем же именем
+    void updateTasks(const TaskProfileEntry* cur, size_t n, uint32_t nowUs, bool fromRunTimeStats) {
+        uint32_t period = nowUs - sampledUs;
+        bool first = (sampledUs == 0);
+        if (n > TASK_PROFILE_MAX_TASKS) n = TASK_PROFILE_MAX_TASKS;
+        TaskProfileEntry next[TASK_PROFILE_MAX_TASKS];
+        for (size_t i = 0; i < n; i++) {
+            next[i] = cur[i];
+            next[i].cpuPermille = 0;
+            if (first || !cur[i].hasRunTime || period == 0) continue;
+            for (size_t j = 0; j < taskCount; j++) {
+                if (!tasks[j].hasRunTime || strcmp(tasks[j].name, cur[i].name) != 0) continue;
+                uint64_t permille = (uint64_t)(cur[i].runTimeUs - tasks[j].runTimeUs) * 1000 / period;
+                next[i].cpuPermille = (uint16_t)(permille > 1000 ? 1000 : permille);
+                break;
+            }
+        }
+        memcpy(tasks, next, n * sizeof(TaskProfileEntry));
+        taskCount = (uint8_t)n;
+        runTimeStats = fromRunTimeStats;
+        periodUs = first ? 0 : period;
+        sampledUs = nowUs ? nowUs : 1;
+    }
+
+    void addHeap(uint32_t ms, uint32_t freeBytes, uint32_t largestBlock, uint32_t minFree) {
+        HeapSample& s = heap[heapHead];
+        s.ms = ms;
+        s.freeBytes = freeBytes;
+        s.largestBlock = largestBlock;
+        heapHead = (heapHead + 1) % TASK_PROFILE_HEAP_HISTORY;
+        if (heapCount < TASK_PROFILE_HEAP_HISTORY) heapCount++;
+        minFreeHeap = minFree;
+    }
+
+    const HeapSample& heapAt(size_t age) const {  // 0 — последний
+        return heap[(heapHead + TASK_PROFILE_HEAP_HISTORY - 1 - age) % TASK_PROFILE_HEAP_HISTORY];
+    }
+
+    // Фрагментация: доля свободной памяти вне наибольшего блока, %
+    static uint32_t fragmentationPct(const HeapSample& s) {
+        return s.freeBytes ? 100 - (uint32_t)((uint64_t)s.largestBlock * 100 / s.freeBytes) : 0;
+    }
+
+    // Изменение свободной кучи по всей истории, байт в минуту
+    int32_t heapTrendPerMin() const {
+        if (heapCount < 2) return 0;
+        const HeapSample& newest = heapAt(0);
+        const HeapSample& oldest = heapAt(heapCount - 1);
+        uint32_t spanMs = newest.ms - oldest.ms;
+        if (spanMs == 0) return 0;
+        return (int32_t)((int64_t)((int32_t)newest.freeBytes - (int32_t)oldest.freeBytes) * 60000 / spanMs);
+    }
+};
+
+// Отчёт по строке на задачу и строка кучи; out — не меньше 2048 байт
+static size_t taskProfileFormatText(char* out, size_t cap, const TaskProfile& p) {
+    size_t n = 0;
+    n = telemetryAppend(out, n, cap, "profile period_ms %lu cpu %s\r\n", (unsigned long)(p.periodUs / 1000),
+                        p.runTimeStats ? "runtime_stats" : "pipeline_only");
+    for (size_t i = 0; i < p.taskCount; i++) {
+        const TaskProfileEntry& t = p.tasks[i];
+        n = telemetryAppend(out, n, cap, "task %-16s", t.name);
+        if (t.hasRunTime && p.periodUs > 0) {
+            n = telemetryAppend(out, n, cap, " cpu %3u.%u%%", t.cpuPermille / 10, t.cpuPermille % 10);
+        } else {
+            n = telemetryAppend(out, n, cap, " cpu     -");
+        }
+        n = telemetryAppend(out, n, cap, " stack_free %5lu prio %2u core %d\r\n", (unsigned long)t.stackFree,
+                            (unsigned)t.priority, (int)t.core);
+    }
+    if (p.heapCount > 0) {
+        const HeapSample& s = p.heapAt(0);
+        n = telemetryAppend(out, n, cap, "heap free %lu largest %lu frag %lu%% min_free %lu trend %ld B/min\r\n",
+                            (unsigned long)s.freeBytes, (unsigned long)s.largestBlock,
+                            (unsigned long)TaskProfile::fragmentationPct(s), (unsigned long)p.minFreeHeap,
+                            (long)p.heapTrendPerMin());
+        // Фрагментация по истории, от старых к новым
+        n = telemetryAppend(out, n, cap, "heap_frag_history");
+        for (size_t age = p.heapCount; age-- > 0;) {
+            n = telemetryAppend(out, n, cap, " %lu", (unsigned long)TaskProfile::fragmentationPct(p.heapAt(age)));
+        }
+        n = telemetryAppend(out, n, cap, "\r\n");
+    }
+    return telemetryAppend(out, n, cap, "\r\n");
+}
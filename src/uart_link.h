@@ -0,0 +1,257 @@
+// Определение скорости UART приёмника и переход на высокую скорость
+//
+// При загрузке перебираем типичные скорости UM980 и ищем NMEA строки с верной
+// контрольной суммой или ответ "$command,...,response: OK" на безобидный
+// запрос VERSION. Затем командой CONFIG переводим порт приёмника на целевую
+// скорость и проверяем связь; при неудаче возвращаемся на найденную.
+//
+// CONFIG без SAVECONFIG: после перезагрузки приёмник снова на сохранённой
+// скорости, а мост остаётся на целевой и принимает мусор. UartLinkWatch
+// замечает это по тишине или потоку без верных записей, и прошивка заново
+// определяет скорость и переводит приёмник.
+//
+// Логика не зависит от Arduino: Port — любой тип с методами
+//   void begin(uint32_t baud);
+//   size_t read(uint8_t* buf, size_t maxLen);      // неблокирующее чтение
+//   void write(const uint8_t* data, size_t len);
+//   unsigned long millis();
+//   void delay(unsigned long ms);
+// В прошивке это обёртка над HardwareSerial, на хосте — модель приёмника
+// (src/native/fake_receiver.h, bridge_native --uart-link-selftest).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "stream_framer.h"
+#include "unicore_binary.h"
+
+#ifndef UM980_UART_PORT
+#define UM980_UART_PORT "COM1"     // Порт UM980, к которому подключен мост
+#endif
+
+// Порядок перебора: сначала вероятные (прошлая прошивка, целевая, заводская)
+static const uint32_t uartCandidateBauds[] = {460800, 921600, 115200, 230400, 9600, 38400, 57600};
+
+// Признаки живого приёмника в потоке байт
+struct LinkProbe {
+    char line[128];
+    size_t len = 0;
+    uint16_t validSentences = 0;   // NMEA/ответы с верной контрольной суммой
+    uint16_t acks = 0;             // "response: OK"
+    uint16_t nacks = 0;            // Прочие "response: ..."
+    uint16_t binaryFrames = 0;     // Синхронизация бинарного лога Unicore
+    uint8_t sync = 0;
+
+    void reset() {
+        len = 0;
+        validSentences = acks = nacks = binaryFrames = 0;
+        sync = 0;
+    }
+
+    bool alive() const { return validSentences >= 2 || acks > 0 || binaryFrames >= 2; }
+
+    void feed(const uint8_t* data, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            uint8_t c = data[i];
+
+            // AA 44 B5
+            sync = (c == 0xAA) ? 1 : (sync == 1 && c == 0x44) ? 2 : (sync == 2 && c == 0xB5) ? 3 : 0;
+            if (sync == 3) {
+                binaryFrames++;
+                sync = 0;
+            }
+
+            if (c == '$') {
+                len = 0;
+            } else if (len == 0) {
+                continue;  // Ждём начала строки
+            }
+            if (c == '\r' || c == '\n') {
+                checkLine();
+                len = 0;
+                continue;
+            }
+            if (len < sizeof(line) - 1) {
+                line[len++] = (char)c;
+            } else {
+                len = 0;
+            }
+        }
+    }
+
+  private:
+    static int hexValue(char h) {
+        if (h >= '0' && h <= '9') return h - '0';
+        if (h >= 'A' && h <= 'F') return h - 'A' + 10;
+        if (h >= 'a' && h <= 'f') return h - 'a' + 10;
+        return -1;
+    }
+
+    void checkLine() {
+        if (len < 4 || line[len - 3] != '*') return;
+        uint8_t cs = 0;
+        for (size_t i = 1; i < len - 3; i++) cs ^= (uint8_t)line[i];
+        int hi = hexValue(line[len - 2]);
+        int lo = hexValue(line[len - 1]);
+        if (hi < 0 || lo < 0 || cs != (uint8_t)((hi << 4) | lo)) return;
+
+        validSentences++;
+        line[len] = '\0';
+        const char* resp = strstr(line, "response:");
+        if (resp) {
+            if (strncmp(resp + 9, " OK", 3) == 0) acks++;
+            else nacks++;
+        }
+    }
+};
+
+template <typename Port>
+class UartLinkNegotiator {
+  public:
+    explicit UartLinkNegotiator(Port& p) : port(p) {}
+
+    // Поиск текущей скорости приёмника; 0 — не найдена. first — проверить
+    // раньше списка (скорость, на которой связь была до потери)
+    uint32_t detect(uint32_t windowMs = 400, uint32_t first = 0) {
+        if (first != 0 && probe(first, windowMs)) return first;
+        for (size_t i = 0; i < sizeof(uartCandidateBauds) / sizeof(uartCandidateBauds[0]); i++) {
+            if (uartCandidateBauds[i] == first) continue;
+            if (probe(uartCandidateBauds[i], windowMs)) return uartCandidateBauds[i];
+        }
+        return 0;
+    }
+
+    // Перевод порта приёмника с current на target; возвращает итоговую скорость
+    uint32_t negotiate(uint32_t current, uint32_t target) {
+        if (current == 0 || target == 0 || current == target) return current;
+
+        char cmd[48];
+        snprintf(cmd, sizeof(cmd), "CONFIG %s %lu\r\n", UM980_UART_PORT, (unsigned long)target);
+
+        port.begin(current);
+        drain();
+        probeState.reset();
+        port.write((const uint8_t*)cmd, strlen(cmd));
+        // Ответ приходит ещё на старой скорости; сразу после него порт переключается
+        waitFor(300, true);
+        if (probeState.nacks > 0) return current;
+
+        if (probe(target, 600)) return target;
+
+        // Связь не поднялась — возвращаемся
+        probe(current, 300);
+        return current;
+    }
+
+    const LinkProbe& lastProbe() const { return probeState; }
+
+  private:
+    Port& port;
+    LinkProbe probeState;
+
+    void drain() {
+        uint8_t tmp[64];
+        while (port.read(tmp, sizeof(tmp)) > 0) {}
+    }
+
+    bool waitFor(uint32_t windowMs, bool untilAck) {
+        uint8_t buf[128];
+        unsigned long start = port.millis();
+        while (port.millis() - start < windowMs) {
+            size_t n = port.read(buf, sizeof(buf));
+            if (n > 0) {
+                probeState.feed(buf, n);
+                if (untilAck ? (probeState.acks > 0 || probeState.nacks > 0) : probeState.alive()) return true;
+            } else {
+                port.delay(2);
+            }
+        }
+        return untilAck ? false : probeState.alive();
+    }
+
+    bool probe(uint32_t baud, uint32_t windowMs) {
+        port.begin(baud);
+        port.delay(20);
+        drain();
+        probeState.reset();
+        // Ждём штатный поток; если приёмник молчит — спрашиваем версию
+        if (waitFor(windowMs / 2, false)) return true;
+        static const char query[] = "VERSION\r\n";
+        port.write((const uint8_t*)query, sizeof(query) - 1);
+        return waitFor(windowMs - windowMs / 2, false);
+    }
+};
+
+// Запись потока с проверенной целостностью: NMEA с верной суммой (строки без
+// '*' не в счёт — на чужой скорости из мусора их нарезается много), RTCM с
+// верной CRC-24Q, ASCII лог Unicore с верной CRC32, бинарный лог Unicore
+// (его ложная синхронизация AA 44 B5 в мусоре редка)
+static inline bool uartRecordVerified(const uint8_t* rec, size_t len, uint8_t type) {
+    if (type <= ST_NMEA_OTHER) return memchr(rec, '*', len) != nullptr && nmeaChecksumOk(rec, len);
+    if (type == ST_RTCM) return rtcmFrameCrcOk(rec, len);
+    if (type == ST_UNIBIN) return true;
+    if (type != ST_UNICORE) return false;
+
+    // #HEADER;BODY*xxxxxxxx — CRC32 между '#' и '*'
+    const uint8_t* star = (const uint8_t*)memchr(rec, '*', len);
+    if (!star || (size_t)(rec + len - star) < 9) return false;
+    uint32_t crc = 0;
+    for (int i = 1; i <= 8; i++) {
+        uint8_t c = star[i];
+        uint8_t v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                  : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : 0xFF;
+        if (v == 0xFF) return false;
+        crc = crc << 4 | v;
+    }
+    return unicoreCrc32(rec + 1, (size_t)(star - rec - 1)) == crc;
+}
+
+// Слежение за связью после загрузки. Связь потеряна, если поток молчал
+// дольше silenceMs и снова пошёл (приёмник перезагружен или переподключен) или
+// если garbageMs подряд приходят только записи без проверенной целостности
+// (приёмник на другой скорости). good/bad — накопительные счётчики записей
+// с проверкой (uartRecordVerified) и без, lastRxMs — время последнего приёма.
+struct UartLinkWatch {
+    uint32_t silenceMs;
+    uint32_t garbageMs;
+    unsigned long lastGoodMs = 0;
+    uint32_t lastGood = 0;
+    uint32_t lastBad = 0;
+    bool silent = false;
+
+    UartLinkWatch(uint32_t silence, uint32_t garbage) : silenceMs(silence), garbageMs(garbage) {}
+
+    // После (пере)установки связи
+    void reset(unsigned long now, uint32_t good, uint32_t bad) {
+        lastGoodMs = now;
+        lastGood = good;
+        lastBad = bad;
+        silent = false;
+    }
+
+    // true — связь надо устанавливать заново
+    bool lost(unsigned long now, unsigned long lastRxMs, uint32_t good, uint32_t bad) {
+        if (good != lastGood) lastGoodMs = now;
+        bool garbage = bad != lastBad;
+        lastGood = good;
+        lastBad = bad;
+
+        if (now - lastRxMs > silenceMs) {
+            silent = true;
+            return false;  // Проверять нечего, пока поток не пошёл снова
+        }
+        if (silent) return true;
+        return garbage && now - lastGoodMs > garbageMs;
+    }
+};
+
+// Размер программного буфера приёма: ~60 мс потока на данной скорости
+static inline size_t uartRxBufferForBaud(uint32_t baud) {
+    size_t need = (size_t)(baud / 10) * 60 / 1000;
+    size_t size = 1024;
+    while (size < need && size < 16384) size <<= 1;
+    return size;
+}
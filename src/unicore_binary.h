@@ -0,0 +1,157 @@
+// Разбор бинарных логов Unicore (UM980, команды N4)
+//
+// Кадр: 0xAA 0x44 0xB5, заголовок 24 байта, тело, CRC32 (4 байта).
+// CRC32 — тот же, что у NovAtel: полином 0xEDB88320, начальное значение 0.
+// Из BESTNAV/PVTSLN берём те же данные, что прошивка получает из GNS/GGA/GST:
+// координаты, высоту, СКО и число спутников — без разбора ASCII float.
+//
+// Разбор проверяет tools/unicore_bin_bench.cpp --check на кадрах gnss_synth.h.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define UNICORE_SYNC1        0xAA
+#define UNICORE_SYNC2        0x44
+#define UNICORE_SYNC3        0xB5
+#define UNICORE_HEADER_LEN   24
+#define UNICORE_CRC_LEN      4
+
+// Идентификаторы сообщений
+#define UNICORE_MSG_OBSVM    12
+#define UNICORE_MSG_PVTSLN   1021
+#define UNICORE_MSG_BESTNAV  2118
+
+struct UnicoreHeader {
+    uint16_t messageId;
+    uint16_t messageLength;  // Длина тела без заголовка и CRC
+    uint16_t week;
+    uint32_t towMs;
+};
+
+// Решение в терминах прошивки (см. GPSData)
+struct UnicoreNav {
+    double latitude;
+    double longitude;
+    double altitude;          // Над уровнем моря
+    float latAccuracy;
+    float lonAccuracy;
+    float verticalAccuracy;
+    int satellites;           // Спутников в решении
+    int fixQuality;           // Шкала GGA: 0 нет, 1 GPS, 2 DGPS, 3 PPP, 4 RTK FIX, 5 RTK FLT, 7 MANUAL
+    bool valid;
+};
+
+static inline uint32_t unicoreCrc32(const uint8_t* data, size_t len) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : (c >> 1);
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    uint32_t crc = 0;
+    for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static inline uint16_t unicoreU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline uint32_t unicoreU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static inline float unicoreF32(const uint8_t* p) {
+    uint32_t u = unicoreU32(p);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+static inline double unicoreF64(const uint8_t* p) {
+    uint64_t u = (uint64_t)unicoreU32(p) | ((uint64_t)unicoreU32(p + 4) << 32);
+    double d;
+    memcpy(&d, &u, sizeof(d));
+    return d;
+}
+
+// Полная длина кадра по первым байтам заголовка (0 — ещё неизвестна)
+static inline size_t unicoreFrameLength(const uint8_t* frame, size_t have) {
+    if (have < 8) return 0;
+    return UNICORE_HEADER_LEN + unicoreU16(frame + 6) + UNICORE_CRC_LEN;
+}
+
+// Проверка синхронизации, длины и CRC32
+static inline bool unicoreCheckFrame(const uint8_t* frame, size_t len, UnicoreHeader* hdr) {
+    if (len < UNICORE_HEADER_LEN + UNICORE_CRC_LEN) return false;
+    if (frame[0] != UNICORE_SYNC1 || frame[1] != UNICORE_SYNC2 || frame[2] != UNICORE_SYNC3) return false;
+    if (unicoreFrameLength(frame, len) != len) return false;
+    if (unicoreCrc32(frame, len - UNICORE_CRC_LEN) != unicoreU32(frame + len - UNICORE_CRC_LEN)) return false;
+    hdr->messageId = unicoreU16(frame + 4);
+    hdr->messageLength = unicoreU16(frame + 6);
+    hdr->week = unicoreU16(frame + 10);
+    hdr->towMs = unicoreU32(frame + 12);
+    return true;
+}
+
+// Тип решения (pos type) в шкалу качества GGA
+static inline int unicorePosTypeToFixQuality(uint32_t posType) {
+    switch (posType) {
+        case 16: return 1;            // SINGLE
+        case 17: case 18: return 2;   // PSRDIFF, SBAS
+        case 68: case 69: return 3;   // PPP_CONVERGING, PPP
+        case 48: case 49: case 50: return 4;  // L1_INT, WIDE_INT, NARROW_INT
+        case 32: case 33: case 34: return 5;  // L1_FLOAT, IONOFREE_FLOAT, NARROW_FLOAT
+        case 1: case 2: return 7;     // FIXEDPOS, FIXEDHEIGHT
+        default: return 0;            // NONE и прочие
+    }
+}
+
+// BESTNAV: позиционная часть совпадает с BESTPOS
+//   0 sol status, 4 pos type, 8 lat, 16 lon, 24 hgt, 32 undulation, 36 datum,
+//   40 lat σ, 44 lon σ, 48 hgt σ, 52 stn id, 56 diff age, 60 sol age, 64 #SVs, 65 #solnSVs
+static inline bool unicoreDecodeBestnav(const uint8_t* body, size_t len, UnicoreNav* nav) {
+    if (len < 66) return false;
+    uint32_t solStatus = unicoreU32(body);
+    uint32_t posType = unicoreU32(body + 4);
+    nav->latitude = unicoreF64(body + 8);
+    nav->longitude = unicoreF64(body + 16);
+    nav->altitude = unicoreF64(body + 24);
+    nav->latAccuracy = unicoreF32(body + 40);
+    nav->lonAccuracy = unicoreF32(body + 44);
+    nav->verticalAccuracy = unicoreF32(body + 48);
+    nav->satellites = body[65];
+    nav->fixQuality = unicorePosTypeToFixQuality(posType);
+    nav->valid = (solStatus == 0) && nav->fixQuality >= 1 && nav->fixQuality <= 5;
+    return true;
+}
+
+// PVTSLN: лучшая позиция в начале тела
+//   0 bestpos type, 4 bestpos hgt (float), 8 lat, 16 lon, 24 hgt σ, 28 lat σ, 32 lon σ,
+//   36 diff age, ..., 68 bestpos #SVs, 69 bestpos #solnSVs
+static inline bool unicoreDecodePvtsln(const uint8_t* body, size_t len, UnicoreNav* nav) {
+    if (len < 70) return false;
+    uint32_t posType = unicoreU32(body);
+    nav->altitude = unicoreF32(body + 4);
+    nav->latitude = unicoreF64(body + 8);
+    nav->longitude = unicoreF64(body + 16);
+    nav->verticalAccuracy = unicoreF32(body + 24);
+    nav->latAccuracy = unicoreF32(body + 28);
+    nav->lonAccuracy = unicoreF32(body + 32);
+    nav->satellites = body[69];
+    nav->fixQuality = unicorePosTypeToFixQuality(posType);
+    nav->valid = nav->fixQuality >= 1 && nav->fixQuality <= 5;
+    return true;
+}
+
+// Разбор кадра целиком: true, если получено решение
+static inline bool unicoreDecodeNav(const uint8_t* frame, size_t len, UnicoreHeader* hdr, UnicoreNav* nav) {
+    if (!unicoreCheckFrame(frame, len, hdr)) return false;
+    const uint8_t* body = frame + UNICORE_HEADER_LEN;
+    switch (hdr->messageId) {
+        case UNICORE_MSG_BESTNAV: return unicoreDecodeBestnav(body, hdr->messageLength, nav);
+        case UNICORE_MSG_PVTSLN:  return unicoreDecodePvtsln(body, hdr->messageLength, nav);
+        default: return false;  // OBSVM и прочие только пересылаются
+    }
+}
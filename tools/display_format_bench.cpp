@@ -0,0 +1,527 @@
+// Хост-утилита для форматирования строк дисплея (см. src/display_format.h)
+//
+// Моделирует поток данных UM980 (позиция 10 Гц, точность/спутники/время 1 Гц)
+// и кадры задачи дисплея (50 кадров/с). Сравнивает прежнюю схему — каждая
+// строка каждый кадр собирается конкатенацией String — с новой: пересчёт только
+// изменившихся строк в буферы фиксированного размера. Печатает стоимость
+// форматирования на кадр, число выделений памяти и проверяет совпадение текста.
+//
+// Затем полный перебор: все целые градусы -180..180 с граничными хвостами дробной
+// части (...9999, ...5000, ...4999) и случайными дробями, высоты и точности по
+// всему рабочему диапазону. Однопроходный целочисленный форматтер сравнивается
+// с прежним многопроходным (printf-округление double, перебор числа знаков).
+// Для координат в раскладках OLED (21) и TFT (20) текст обязан совпасть полностью;
+// в остальных случаях допустимы только расхождения на точной десятичной половине
+// (x.x5 округляется от нуля, printf — по двоичному представлению). Печатает
+// такты на вызов для обоих вариантов.
+//
+// Сборка:  g++ -O2 -std=c++17 -I../src display_format_bench.cpp -o display_format_bench
+// Запуск:  ./display_format_bench [seconds]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "display_format.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+#else
+static inline uint64_t cycles() { return 0; }
+#endif
+
+// Счётчик выделений памяти (glibc)
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+static size_t allocations = 0;
+extern "C" void* malloc(size_t n) {
+    allocations++;
+    return __libc_malloc(n);
+}
+extern "C" void* realloc(void* p, size_t n) {
+    allocations++;
+    return __libc_realloc(p, n);
+}
+
+// Минимальная модель Arduino String: буфер всегда в куче, конкатенация через realloc
+class AString {
+  public:
+    AString(const char* s = "") { assign(s, strlen(s)); }
+    AString(const AString& o) { assign(o.buf, o.len); }
+    AString(long v) {
+        char tmp[24];
+        snprintf(tmp, sizeof(tmp), "%ld", v);
+        assign(tmp, strlen(tmp));
+    }
+    AString(double v, int decimals) {  // dtostrf
+        char tmp[40];
+        snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+        assign(tmp, strlen(tmp));
+    }
+    ~AString() { free(buf); }
+    AString& operator=(const AString& o) {
+        if (this != &o) {
+            free(buf);
+            buf = nullptr;
+            assign(o.buf, o.len);
+        }
+        return *this;
+    }
+    AString& operator+=(const AString& o) { return append(o.buf, o.len); }
+    AString& operator+=(const char* s) { return append(s, strlen(s)); }
+    friend AString operator+(AString a, const AString& b) { return a += b; }
+    friend AString operator+(AString a, const char* b) { return a += b; }
+    friend AString operator+(const char* a, const AString& b) { return AString(a) += b; }
+    bool operator!=(const AString& o) const { return len != o.len || memcmp(buf, o.buf, len) != 0; }
+    size_t length() const { return len; }
+    const char* c_str() const { return buf; }
+    void replace(const char* from, const char* to) {
+        std::string s(buf);
+        size_t at = s.find(from);
+        if (at == std::string::npos) return;
+        s.replace(at, strlen(from), to);
+        free(buf);
+        buf = nullptr;
+        assign(s.c_str(), s.size());
+    }
+
+  private:
+    char* buf = nullptr;
+    size_t len = 0;
+    void assign(const char* s, size_t n) {
+        buf = (char*)malloc(n + 1);
+        memcpy(buf, s, n);
+        buf[n] = '\0';
+        len = n;
+    }
+    AString& append(const char* s, size_t n) {
+        buf = (char*)realloc(buf, len + n + 1);
+        memcpy(buf + len, s, n);
+        len += n;
+        buf[len] = '\0';
+        return *this;
+    }
+};
+
+struct Model {
+    double lat, lon, alt, latAcc, lonAcc, vAcc;
+    int sats, fix, used[5];
+    int hh, mm, ss;
+};
+
+// Прежние функции прошивки (на String)
+static AString oldCoordLine(const char* label, double value, int maxChars) {
+    int availableForNumber = maxChars - (int)strlen(label);
+    int wholePart = (value < 0) ? 1 : 0;
+    wholePart += (fabs(value) >= 100) ? 3 : (fabs(value) >= 10) ? 2 : 1;
+    int maxDecimals = availableForNumber - wholePart - 1;
+    if (maxDecimals < 4) maxDecimals = 4;
+    if (maxDecimals > 10) maxDecimals = 10;
+    AString result = AString(label) + AString(value, maxDecimals);
+    while ((int)result.length() > maxChars && maxDecimals > 4) {
+        maxDecimals--;
+        result = AString(label) + AString(value, maxDecimals);
+    }
+    return result;
+}
+
+static AString oldLocalTime(const Model& m) {
+    char buf[9];
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d", m.hh, m.mm, m.ss);
+    return AString(buf);
+}
+
+static AString oldAltitudeLine(const Model& m, int maxChars) {
+    AString base = AString("Alt: ") + AString(m.alt, 1) + "m";
+    AString t = oldLocalTime(m);
+    if ((int)base.length() + 1 + (int)t.length() <= maxChars) return base + " " + t;
+    AString base0 = AString("Alt: ") + AString(m.alt, 0) + "m";
+    if ((int)base0.length() + 1 + (int)t.length() <= maxChars) return base0 + " " + t;
+    if ((int)base.length() + (int)t.length() <= maxChars) return base + t;
+    AString baseNoUnit = AString("Alt: ") + AString(m.alt, 0);
+    if ((int)baseNoUnit.length() + 1 + (int)t.length() <= maxChars) return baseNoUnit + " " + t;
+    return base;
+}
+
+static AString oldAccuracy(const Model& m, int lineType) {
+    if (lineType == 1) {
+        if (m.latAcc < 1.0 && m.lonAcc < 1.0) {
+            return AString("N/S:") + AString(m.latAcc * 100, 1) + "cm " + "E/W:" + AString(m.lonAcc * 100, 1) + "cm";
+        }
+        return AString("N/S:") + AString(m.latAcc, 1) + "m " + "E/W:" + AString(m.lonAcc, 1) + "m";
+    }
+    if (m.vAcc < 1.0) return "H:" + AString(m.vAcc * 100, 1) + "cm";
+    return "H:" + AString(m.vAcc, 1) + "m";
+}
+
+static AString oldSatellites(const Model& m) {
+    AString s = "G:" + AString((long)m.used[0]) + " R:" + AString((long)m.used[1]) + " E:" + AString((long)m.used[2]) +
+                " B:" + AString((long)m.used[3]);
+    if (m.used[4] > 0) s += " Q:" + AString((long)m.used[4]);
+    if (s.length() > 20) {
+        s = "G:" + AString((long)m.used[0]) + "R:" + AString((long)m.used[1]) + "E:" + AString((long)m.used[2]) +
+            "B:" + AString((long)m.used[3]);
+        if (m.used[4] > 0) s += "Q:" + AString((long)m.used[4]);
+    }
+    return s;
+}
+
+static const int kLines = 11;  // fix, lat x2, lon x2, alt x2, acc1 x2, acc2, sats
+static AString oldLines[kLines];
+
+static void oldFrame(const Model& m) {
+    oldLines[0] = "Sats: " + AString((long)m.sats) + " Fix: " + fixTypeName(m.fix);
+    oldLines[1] = oldCoordLine("Lat: ", m.lat, 21);
+    oldLines[2] = oldCoordLine("Lat: ", m.lat, 20);
+    oldLines[3] = oldCoordLine("Lon: ", m.lon, 21);
+    oldLines[4] = oldCoordLine("Lon: ", m.lon, 20);
+    oldLines[5] = oldAltitudeLine(m, 21);
+    oldLines[6] = oldAltitudeLine(m, 20);
+    oldLines[7] = oldAccuracy(m, 1);
+    AString tft = oldLines[7];
+    if (tft.length() > 20) {
+        tft.replace("N/S:", "NS:");
+        tft.replace("E/W:", "EW:");
+    }
+    oldLines[8] = tft;
+    oldLines[9] = oldAccuracy(m, 2);
+    oldLines[10] = oldSatellites(m);
+}
+
+static char newLines[kLines][DISPLAY_TEXT_MAX];
+
+static void newFrame(const Model& m, uint16_t dirty) {
+    if (dirty & DD_FIX) fmtFixLine(newLines[0], DISPLAY_TEXT_MAX, m.sats, m.fix);
+    if (dirty & DD_LAT) {
+        int64_t lat = fmtToScaled(m.lat, COORD_EXP10);
+        fmtCoordLine(newLines[1], DISPLAY_TEXT_MAX, "Lat: ", lat, 21);
+        fmtCoordLine(newLines[2], DISPLAY_TEXT_MAX, "Lat: ", lat, 20);
+    }
+    if (dirty & DD_LON) {
+        int64_t lon = fmtToScaled(m.lon, COORD_EXP10);
+        fmtCoordLine(newLines[3], DISPLAY_TEXT_MAX, "Lon: ", lon, 21);
+        fmtCoordLine(newLines[4], DISPLAY_TEXT_MAX, "Lon: ", lon, 20);
+    }
+    if (dirty & (DD_ALT | DD_TIME)) {
+        char t[9];
+        int64_t alt = fmtToScaled(m.alt, ALT_EXP10);
+        fmtLocalTime(t, sizeof(t), true, m.hh, m.mm, m.ss, 0);
+        fmtAltitudeLine(newLines[5], DISPLAY_TEXT_MAX, alt, t, 21);
+        fmtAltitudeLine(newLines[6], DISPLAY_TEXT_MAX, alt, t, 20);
+    }
+    int64_t latAcc = fmtToScaled(m.latAcc, ACC_EXP10);
+    int64_t lonAcc = fmtToScaled(m.lonAcc, ACC_EXP10);
+    if (dirty & DD_ACCURACY) {
+        // Прежняя прошивка не сокращала метки на OLED — для сравнения ширина не ограничена
+        fmtAccuracyLine1(newLines[7], DISPLAY_TEXT_MAX, latAcc, lonAcc, DISPLAY_TEXT_MAX);
+        fmtAccuracyLine1(newLines[8], DISPLAY_TEXT_MAX, latAcc, lonAcc, 20);
+    }
+    if (dirty & (DD_ACCURACY | DD_VACC)) {
+        fmtAccuracyLine2(newLines[9], DISPLAY_TEXT_MAX, latAcc, lonAcc, fmtToScaled(m.vAcc, ACC_EXP10));
+    }
+    if (dirty & DD_SATS) {
+        fmtSatelliteLine(newLines[10], DISPLAY_TEXT_MAX, m.used[0], m.used[1], m.used[2], m.used[3], m.used[4]);
+    }
+}
+
+static double jitter(double scale) { return ((double)rand() / RAND_MAX - 0.5) * scale; }
+
+// Значение, как его даёт разбор NMEA: decimals знаков после запятой
+static double quantize(double v, int decimals) { return round(v * (double)fmtPow10[decimals]) / fmtPow10[decimals]; }
+
+// Точная десятичная половина: v*10^-exp10 лежит ровно посередине между соседними значениями с decimals знаками
+static bool isDecimalTie(int64_t v, int exp10, int decimals) {
+    if (decimals >= exp10) return false;
+    uint64_t mag = (v < 0) ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+    uint64_t div = fmtPow10[exp10 - decimals];
+    return mag % div == div / 2;
+}
+
+static bool modelHasTie(const Model& m) {
+    int64_t alt = fmtToScaled(m.alt, ALT_EXP10);
+    const double acc[3] = {m.latAcc, m.lonAcc, m.vAcc};
+    if (isDecimalTie(alt, ALT_EXP10, 1) || isDecimalTie(alt, ALT_EXP10, 0)) return true;
+    for (double a : acc) {
+        int64_t v = fmtToScaled(a, ACC_EXP10);
+        if (isDecimalTie(v, ACC_EXP10 - 2, 1) || isDecimalTie(v, ACC_EXP10, 1)) return true;
+    }
+    return false;
+}
+
+// Кадры задачи дисплея: String на каждый кадр против пересчёта изменившихся строк
+static int runFrames(int seconds) {
+    const int framesPerSecond = 50;  // DISPLAY_TASK_PERIOD_MS = 20
+    const int epochsPerSecond = 10;
+
+    Model m = {55.7512345678, 37.6184567890, 156.3, 0.012, 0.015, 0.031, 24, 4, {9, 6, 5, 8, 1}, 12, 0, 0};
+    srand(1);
+
+    uint64_t oldCycles = 0, newCycles = 0;
+    size_t oldAllocs = 0, newAllocs = 0;
+    size_t frames = 0, mismatches = 0, ties = 0;
+    uint16_t pending = DD_ALL;
+
+    for (int sec = 0; sec < seconds; sec++) {
+        for (int f = 0; f < framesPerSecond; f++) {
+            // Новая эпоха позиции каждые 5 кадров; точность, время, спутники — раз в секунду.
+            // Высота и точность с разрешением полей GGA/GST (1e-4 м).
+            if (f % (framesPerSecond / epochsPerSecond) == 0) {
+                m.lat += jitter(2e-7);
+                m.lon += jitter(2e-7);
+                m.alt = quantize(m.alt + jitter(0.02), 4);
+                pending |= DD_LAT | DD_LON | DD_ALT;
+            }
+            if (f == 0) {
+                m.latAcc = 0.01 + (rand() % 200) / 10000.0;
+                m.lonAcc = 0.01 + (rand() % 200) / 10000.0;
+                m.vAcc = 0.02 + (rand() % 300) / 10000.0;
+                m.ss = (m.ss + 1) % 60;
+                if (rand() % 10 == 0) m.used[rand() % 5] = rand() % 14;
+                pending |= DD_ACCURACY | DD_VACC | DD_TIME | DD_SATS | DD_FIX;
+            }
+
+            size_t a0 = allocations;
+            uint64_t c0 = cycles();
+            oldFrame(m);
+            oldCycles += cycles() - c0;
+            oldAllocs += allocations - a0;
+
+            a0 = allocations;
+            c0 = cycles();
+            newFrame(m, pending);
+            newCycles += cycles() - c0;
+            newAllocs += allocations - a0;
+            pending = 0;
+
+            for (int i = 0; i < kLines; i++) {
+                if (strcmp(oldLines[i].c_str(), newLines[i]) == 0) continue;
+                if (i >= 5 && modelHasTie(m)) {
+                    ties++;
+                    continue;
+                }
+                if (mismatches < 10) fprintf(stderr, "line %d: '%s' vs '%s'\n", i, oldLines[i].c_str(), newLines[i]);
+                mismatches++;
+            }
+            frames++;
+        }
+    }
+
+    printf("frames:            %zu\n", frames);
+    printf("String per frame:  %.0f cycles, %.1f allocations\n", (double)oldCycles / frames, (double)oldAllocs / frames);
+    printf("buffers per frame: %.0f cycles, %.1f allocations\n", (double)newCycles / frames, (double)newAllocs / frames);
+    printf("text mismatches:   %zu (decimal ties: %zu)\n", mismatches, ties);
+    return mismatches ? 1 : 0;
+}
+
+// Прежний многопроходный форматтер (double, округление как printf, перебор вариантов)
+static size_t prevAppendFixed(char* out, size_t pos, size_t cap, double v, int decimals) {
+    int n = snprintf(out + pos, cap - pos, "%.*f", decimals, v);
+    return (n < 0 || (size_t)n >= cap - pos) ? cap - 1 : pos + n;
+}
+
+static size_t prevCoordLine(char* out, size_t cap, const char* label, double value, int maxChars) {
+    int wholePart = (value < 0) ? 1 : 0;
+    wholePart += (fabs(value) >= 100) ? 3 : (fabs(value) >= 10) ? 2 : 1;
+    int maxDecimals = maxChars - (int)strlen(label) - wholePart - 1;
+    if (maxDecimals < 4) maxDecimals = 4;
+    if (maxDecimals > 10) maxDecimals = 10;
+    size_t n = prevAppendFixed(out, fmtAppend(out, 0, cap, label), cap, value, maxDecimals);
+    while ((int)n > maxChars && maxDecimals > 4) {
+        maxDecimals--;
+        n = prevAppendFixed(out, fmtAppend(out, 0, cap, label), cap, value, maxDecimals);
+    }
+    return n;
+}
+
+static size_t prevAltitudeLine(char* out, size_t cap, double altitude, const char* timeText, int maxChars) {
+    char base[DISPLAY_TEXT_MAX], base0[DISPLAY_TEXT_MAX];
+    size_t baseLen = fmtAppend(base, prevAppendFixed(base, fmtAppend(base, 0, sizeof(base), "Alt: "), sizeof(base),
+                                                     altitude, 1), sizeof(base), "m");
+    int timeLen = (int)strlen(timeText);
+    if (timeLen == 0) return fmtAppend(out, 0, cap, base);
+    if ((int)baseLen + 1 + timeLen <= maxChars) {
+        return fmtAppend(out, fmtAppend(out, fmtAppend(out, 0, cap, base), cap, " "), cap, timeText);
+    }
+    size_t base0Len = prevAppendFixed(base0, fmtAppend(base0, 0, sizeof(base0), "Alt: "), sizeof(base0), altitude, 0);
+    if ((int)base0Len + 2 + timeLen <= maxChars) {
+        return fmtAppend(out, fmtAppend(out, fmtAppend(out, 0, cap, base0), cap, "m "), cap, timeText);
+    }
+    if ((int)baseLen + timeLen <= maxChars) return fmtAppend(out, fmtAppend(out, 0, cap, base), cap, timeText);
+    if ((int)base0Len + 1 + timeLen <= maxChars) {
+        return fmtAppend(out, fmtAppend(out, fmtAppend(out, 0, cap, base0), cap, " "), cap, timeText);
+    }
+    return fmtAppend(out, 0, cap, base);
+}
+
+static size_t prevAppendAccuracy(char* out, size_t pos, size_t cap, double meters, bool cm) {
+    if (cm) return fmtAppend(out, prevAppendFixed(out, pos, cap, meters * 100, 1), cap, "cm");
+    return fmtAppend(out, prevAppendFixed(out, pos, cap, meters, 1), cap, "m");
+}
+
+static size_t prevAccuracyLine1(char* out, size_t cap, double latAcc, double lonAcc, int maxChars) {
+    out[0] = '\0';
+    if (latAcc >= 99.9 && lonAcc >= 99.9) return 0;
+    bool cm = latAcc < 1.0 && lonAcc < 1.0;
+    for (int compact = 0; compact < 2; compact++) {
+        size_t n = prevAppendAccuracy(out, fmtAppend(out, 0, cap, compact ? "NS:" : "N/S:"), cap, latAcc, cm);
+        n = prevAppendAccuracy(out, fmtAppend(out, n, cap, compact ? " EW:" : " E/W:"), cap, lonAcc, cm);
+        if ((int)n <= maxChars || compact) return n;
+    }
+    return 0;
+}
+
+// Итоги перебора одного вида строк
+struct SweepStats {
+    const char* name;
+    size_t calls = 0, ties = 0, failures = 0;
+    uint64_t prevCycles = 0, newCycles = 0;
+
+    void compare(const char* prev, const char* next, bool tie, bool strict) {
+        calls++;
+        if (strcmp(prev, next) == 0) return;
+        if (tie && !strict) {
+            ties++;
+            return;
+        }
+        if (failures < 10) fprintf(stderr, "%s: '%s' vs '%s'\n", name, prev, next);
+        failures++;
+    }
+    void print() const {
+        printf("%-22s %10zu calls  prev %5.0f  new %5.0f cycles/call  ties %zu  failures %zu\n", name, calls,
+               (double)prevCycles / calls, (double)newCycles / calls, ties, failures);
+    }
+};
+
+// Знаков после точки в строке (для классификации расхождений)
+static int decimalsIn(const char* s) {
+    const char* dot = strchr(s, '.');
+    if (!dot) return 0;
+    int n = 0;
+    while (dot[1 + n] >= '0' && dot[1 + n] <= '9') n++;
+    return n;
+}
+
+// Координаты: каждый целый градус с граничными и случайными дробями, обе метки
+static void sweepCoordinates(SweepStats& strict, SweepStats& narrow) {
+    std::vector<uint64_t> fractions;
+    const uint64_t one = fmtPow10[COORD_EXP10];
+    for (int t = 0; t <= COORD_EXP10; t++) {
+        uint64_t a = fmtPow10[t];
+        const uint64_t tails[] = {a - 1, a / 2, a / 2 - 1, a / 2 + 1, one - a, one - a / 2, one - a / 2 - 1,
+                                  one - 1 - (a - 1) / 2};
+        for (uint64_t f : tails) {
+            if (f < one) fractions.push_back(f);
+        }
+    }
+    for (int i = 0; i < 4000; i++) fractions.push_back(((uint64_t)rand() * RAND_MAX + rand()) % one);
+
+    static const int strictWidths[] = {21, 20};  // OLED и TFT
+    static const int narrowWidths[] = {19, 17, 15, 13, 11};
+    char prev[64], next[64];
+    for (int deg = -180; deg <= 180; deg++) {
+        for (uint64_t f : fractions) {
+            // Дробь с тем же знаком, что и целая часть; у нуля — оба знака
+            for (int sign = (deg > 0) ? 1 : -1; sign <= ((deg < 0) ? -1 : 1); sign += 2) {
+                int64_t scaled = (int64_t)deg * (int64_t)one + sign * (int64_t)f;
+                if (scaled == 0 && sign < 0) continue;
+                if (scaled > 180 * (int64_t)one || scaled < -180 * (int64_t)one) continue;
+                double value = (double)scaled / (double)one;
+
+                for (int w : strictWidths) {
+                    for (const char* label : {"Lat: ", "Lon: "}) {
+                        uint64_t c0 = cycles();
+                        prevCoordLine(prev, sizeof(prev), label, value, w);
+                        strict.prevCycles += cycles() - c0;
+                        c0 = cycles();
+                        fmtCoordLine(next, DISPLAY_TEXT_MAX, label, fmtToScaled(value, COORD_EXP10), w);
+                        strict.newCycles += cycles() - c0;
+                        strict.compare(prev, next, false, true);
+                    }
+                }
+                for (int w : narrowWidths) {
+                    uint64_t c0 = cycles();
+                    prevCoordLine(prev, sizeof(prev), "Lat: ", value, w);
+                    narrow.prevCycles += cycles() - c0;
+                    int64_t v = fmtToScaled(value, COORD_EXP10);
+                    c0 = cycles();
+                    fmtCoordLine(next, DISPLAY_TEXT_MAX, "Lat: ", v, w);
+                    narrow.newCycles += cycles() - c0;
+                    // На половине перенос разряда может сменить и число знаков
+                    bool tie = isDecimalTie(v, COORD_EXP10, decimalsIn(next)) ||
+                               isDecimalTie(v, COORD_EXP10, decimalsIn(prev));
+                    narrow.compare(prev, next, tie, false);
+                }
+            }
+        }
+    }
+}
+
+// Высота -1000..10000 м с шагом 0.0037 м (все остатки по модулю 10) и плотно у переходов разрядов
+static void sweepAltitude(SweepStats& stats) {
+    std::vector<int64_t> values;
+    for (int64_t v = -10000000; v <= 100000000; v += 37) values.push_back(v);
+    const int64_t edges[] = {0, 10000, 100000, 1000000, 10000000, 100000000};
+    for (int64_t e : edges) {
+        for (int64_t d = -2000; d <= 2000; d++) {
+            values.push_back(e + d);
+            values.push_back(-e + d);
+        }
+    }
+    static const int widths[] = {21, 20, 18, 16};
+    char prev[64], next[64];
+    for (int64_t scaled : values) {
+        double value = (double)scaled / (double)fmtPow10[ALT_EXP10];
+        bool tie = isDecimalTie(scaled, ALT_EXP10, 1) || isDecimalTie(scaled, ALT_EXP10, 0);
+        for (int w : widths) {
+            for (const char* t : {"12:34:56", ""}) {
+                uint64_t c0 = cycles();
+                prevAltitudeLine(prev, sizeof(prev), value, t, w);
+                stats.prevCycles += cycles() - c0;
+                c0 = cycles();
+                fmtAltitudeLine(next, DISPLAY_TEXT_MAX, fmtToScaled(value, ALT_EXP10), t, w);
+                stats.newCycles += cycles() - c0;
+                stats.compare(prev, next, tie, false);
+            }
+        }
+    }
+}
+
+// Точность 0..120 м с шагом 1e-4 м, вторая координата — сдвиг по псевдослучайной таблице
+static void sweepAccuracy(SweepStats& stats) {
+    static const int widths[] = {DISPLAY_TEXT_MAX, 21, 20};
+    char prev[64], next[64];
+    for (int64_t lat = 0; lat <= 1200000; lat++) {
+        int64_t lon = (lat * 7919) % 1200000;
+        double latM = (double)lat / ACC_ONE_METER, lonM = (double)lon / ACC_ONE_METER;
+        bool tie = false;
+        for (int64_t v : {lat, lon}) tie = tie || isDecimalTie(v, ACC_EXP10 - 2, 1) || isDecimalTie(v, ACC_EXP10, 1);
+        for (int w : widths) {
+            uint64_t c0 = cycles();
+            prevAccuracyLine1(prev, sizeof(prev), latM, lonM, w);
+            stats.prevCycles += cycles() - c0;
+            c0 = cycles();
+            fmtAccuracyLine1(next, DISPLAY_TEXT_MAX, fmtToScaled(latM, ACC_EXP10), fmtToScaled(lonM, ACC_EXP10), w);
+            stats.newCycles += cycles() - c0;
+            stats.compare(prev, next, tie, false);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int seconds = (argc > 1) ? atoi(argv[1]) : 600;
+    int rc = runFrames(seconds);
+
+    SweepStats coords{"coord 21/20 (exact)"}, narrow{"coord narrow"}, alt{"altitude"}, acc{"accuracy"};
+    sweepCoordinates(coords, narrow);
+    sweepAltitude(alt);
+    sweepAccuracy(acc);
+    printf("\n");
+    for (const SweepStats* s : {&coords, &narrow, &alt, &acc}) {
+        s->print();
+        if (s->failures) rc = 1;
+    }
+    return rc;
+}
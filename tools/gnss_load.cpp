@@ -0,0 +1,232 @@
+// Синтетическая нагрузка на мост (см. src/gnss_synth.h)
+//
+// emit: пишет поток генератора в запись UMCAP1 с временем эпох — её
+// воспроизводит хост-сборка (src/native/, env:native) или сырым потоком.
+// ramp: прогоняет поток через ядро прошивки (bridge_core.h + BridgePipeline
+// с профилем C3 или S3) и поднимает нагрузку ступенями, пока очередь BLE или
+// WiFi не начнёт терять записи. Отправка ограничена пропускной способностью
+// канала (--ble-capacity, --wifi-capacity): порция уходит, когда у канала есть
+// место, как notify при занятых буферах стека. Печатает вход и выход по
+// ступеням, p99 задержки BLE для основного потока и для позиции (полоса
+// приоритета; --no-lanes — одна очередь) и устойчивую скорость, на которой
+// случилось первое переполнение.
+//
+// Сборка:  g++ -O2 -std=c++17 -I../src gnss_load.cpp -o gnss_load
+// Запуск:  ./gnss_load emit [опции] out.umcap
+//          ./gnss_load ramp [опции]
+// Опции:   --hz N --const N --sats N --rtcm B/S --unicore-bin --seconds S --raw
+//          --ble-capacity B/S --wifi-capacity B/S --step S --max-level N --board c3|s3 --no-lanes
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "bridge_core.h"
+#include "bridge_pipeline.h"
+#include "capture_format.h"
+#include "gnss_synth.h"
+
+static NativeWiFiClient wifiClients[MAX_WIFI_CLIENTS];
+static SynthSource source;
+static uint64_t bleSent = 0;
+
+bool handleOutputProfileResponse(const uint8_t*, size_t) { return false; }
+void applyBridgeSettings(uint8_t) {}
+
+// Синтетический источник вместо UART, модельные notify
+struct LoadHal {
+    int uartAvailable() { return (int)source.available(micros()); }
+    size_t uartRead(uint8_t* dst, size_t n) { return source.read(dst, n, micros()); }
+    void uartWrite(const uint8_t*, size_t) {}
+    void onUartChunk(const uint8_t* data, size_t n) { routeUartChunk(data, n); }
+    size_t rxAvailable() { return 0; }
+    size_t rxRead(uint8_t*, size_t) { return 0; }
+    void onControlCommand(const char*, size_t) {}
+    bool bleConnected() { return deviceConnected; }
+    bool bleLinkReady() { return true; }
+    size_t bleMaxPayload() { return 514; }  // MTU 517
+    size_t bleQueued() { return getRingBufferAvailable(); }
+    bool bleOverflowed() { return getRingBufferOverflow(); }
+    size_t bleDequeue(uint8_t* dst, size_t n) { return readFromRingBuffer(dst, n); }
+    bool bleSend(const uint8_t*, size_t n) {
+        bleSent += n;
+        noteBleLatency();
+        return true;
+    }
+    void log(const char*) {}
+};
+
+struct Options {
+    SynthConfig synth;
+    double seconds = 60;
+    bool raw = false;
+    double bleCapacity = 100000;   // Телефон с 2M PHY и DLE: ~4 пакета по 244 Б за интервал 7.5 мс
+    double wifiCapacity = 1000000;
+    double stepSeconds = 10;
+    int maxLevel = 50;
+    bool s3 = false;
+    bool lanes = true;
+};
+
+static SynthConfig configForLevel(const SynthConfig& base, int level) {
+    SynthConfig cfg = base;
+    cfg.epochHz = (uint16_t)(base.epochHz * level);
+    cfg.rtcmBytesPerSec = base.rtcmBytesPerSec * level;
+    return cfg;
+}
+
+static int emit(const Options& opt, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return 2;
+    }
+    if (!opt.raw) fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, f);
+
+    GnssSynth gen(opt.synth);
+    const uint32_t epochs = (uint32_t)(opt.seconds * gen.config().epochHz);
+    uint8_t record[SYNTH_MAX_RECORD];
+    uint8_t head[CAPTURE_RECORD_HEAD];
+    uint64_t bytes = 0;
+    for (uint32_t e = 0; e < epochs; e++) {
+        uint32_t delta = (e == 0) ? 0 : gen.epochIntervalUs();  // Эпоха — пачкой в свой момент
+        size_t n;
+        while ((n = gen.nextRecord(record, sizeof(record))) > 0) {
+            if (!opt.raw) {
+                captureWriteHead(head, CAP_UART_RX, (uint16_t)n, delta);
+                fwrite(head, 1, sizeof(head), f);
+                delta = 0;
+            }
+            fwrite(record, 1, n, f);
+            bytes += n;
+        }
+    }
+    fclose(f);
+    printf("%s: %u epochs, %llu B, %.0f B/s\n", path, (unsigned)epochs, (unsigned long long)bytes,
+           bytes / opt.seconds);
+    return 0;
+}
+
+template <typename Board>
+static int ramp(const Options& opt) {
+    static LoadHal hal;
+    static BridgePipeline<Board, LoadHal> pipeline(hal);
+
+    nativeClock().manual = true;
+    Serial.mute = true;
+    deviceConnected = true;
+    bridgeSettings.bleLanes = opt.lanes;
+    wifiClients[0].open = true;
+    wifiClients[0].capture = false;
+    wifiClientConnected[0] = true;
+
+    printf("%s, BLE capacity %.0f B/s, WiFi capacity %.0f B/s, %.0f s per level, %s\n",
+           Board::DUAL_CORE ? "ESP32-S3 profile" : "ESP32-C3 profile", opt.bleCapacity, opt.wifiCapacity,
+           opt.stepSeconds, opt.lanes ? "BLE priority lane" : "one BLE queue");
+    printf("level  epoch Hz   in B/s  BLE out B/s  WiFi out B/s  overflows BLE/WiFi  BLE p99 ms  position p99 ms\n");
+
+    double bleCredit = 0, wifiCredit = 0;
+    for (int level = 1; level <= opt.maxLevel; level++) {
+        source.begin(configForLevel(opt.synth, level), micros());
+        const uint64_t in0 = source.produced, ble0 = bleSent, wifi0 = wifiClients[0].bytes;
+        const uint32_t bleLost0 = bleOverflowEvents, wifiLost0 = wifiOverflowEvents;
+        const uint64_t steps = (uint64_t)(opt.stepSeconds * 1000);
+
+        for (uint64_t ms = 0; ms < steps; ms++) {
+            nativeClock().advanceMicros(1000);
+            bleCredit += opt.bleCapacity / 1000;
+            wifiCredit += opt.wifiCapacity / 1000;
+            while (pipeline.ingest() > 0) {
+            }
+            // Канал принимает порцию, только если в нём есть место
+            while (bleCredit >= Board::BLE_READ_CHUNK) {
+                size_t n = pipeline.flushBle(millis());
+                if (n == 0) break;
+                bleCredit -= n;
+            }
+            if (bleCredit > 2.0 * Board::BLE_READ_CHUNK) bleCredit = 2.0 * Board::BLE_READ_CHUNK;
+            while (wifiCredit >= 1024) {
+                uint64_t before = wifiClients[0].bytes;
+                flushWiFiSinks(wifiClients);
+                if (wifiClients[0].bytes == before) break;
+                wifiCredit -= (double)(wifiClients[0].bytes - before);
+            }
+            if (wifiCredit > 2048) wifiCredit = 2048;
+        }
+
+        const double inRate = (source.produced - in0) / opt.stepSeconds;
+        const uint32_t bleLost = bleOverflowEvents - bleLost0, wifiLost = wifiOverflowEvents - wifiLost0;
+        // Без полос позиция идёт основной очередью: её задержка — задержка всего потока
+        LatencyHistogram bleHist, positionHist;
+        bleTrace.takeHistogram(bleHist);
+        blePriorityTrace.takeHistogram(positionHist);
+        const LatencyHistogram& position = opt.lanes ? positionHist : bleHist;
+        printf("%5d  %8u  %7.0f  %11.0f  %12.0f  %8u/%-9u  %10.1f  %15.1f\n", level,
+               (unsigned)(opt.synth.epochHz * level), inRate, (bleSent - ble0) / opt.stepSeconds,
+               (wifiClients[0].bytes - wifi0) / opt.stepSeconds, (unsigned)bleLost, (unsigned)wifiLost,
+               bleHist.percentileUs(0.99f) / 1000.0, position.percentileUs(0.99f) / 1000.0);
+        if (bleLost || wifiLost) {
+            printf("First %s queue overflow at level %d, sustained input %.0f B/s\n", bleLost ? "BLE" : "WiFi",
+                   level, inRate);
+            return 0;
+        }
+    }
+    printf("No overflow up to level %d\n", opt.maxLevel);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || (strcmp(argv[1], "emit") != 0 && strcmp(argv[1], "ramp") != 0)) {
+        fprintf(stderr, "Usage: gnss_load emit|ramp [options] [out.umcap]\n");
+        return 2;
+    }
+    Options opt;
+    opt.synth.rtcmBytesPerSec = 2000;
+    const char* path = nullptr;
+    for (int i = 2; i < argc; i++) {
+        const char* a = argv[i];
+        bool v = i + 1 < argc;
+        if (strcmp(a, "--hz") == 0 && v) {
+            opt.synth.epochHz = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--const") == 0 && v) {
+            opt.synth.constellations = (uint8_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--sats") == 0 && v) {
+            opt.synth.satsPerConstellation = (uint8_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--rtcm") == 0 && v) {
+            opt.synth.rtcmBytesPerSec = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--unicore-bin") == 0) {
+            opt.synth.unicoreBinary = true;
+        } else if (strcmp(a, "--seconds") == 0 && v) {
+            opt.seconds = atof(argv[++i]);
+        } else if (strcmp(a, "--raw") == 0) {
+            opt.raw = true;
+        } else if (strcmp(a, "--ble-capacity") == 0 && v) {
+            opt.bleCapacity = atof(argv[++i]);
+        } else if (strcmp(a, "--wifi-capacity") == 0 && v) {
+            opt.wifiCapacity = atof(argv[++i]);
+        } else if (strcmp(a, "--step") == 0 && v) {
+            opt.stepSeconds = atof(argv[++i]);
+        } else if (strcmp(a, "--max-level") == 0 && v) {
+            opt.maxLevel = atoi(argv[++i]);
+        } else if (strcmp(a, "--no-lanes") == 0) {
+            opt.lanes = false;
+        } else if (strcmp(a, "--board") == 0 && v) {
+            opt.s3 = strcmp(argv[++i], "s3") == 0;
+        } else {
+            path = a;
+        }
+    }
+    if (opt.synth.epochHz == 0 || opt.seconds <= 0 || opt.stepSeconds <= 0) {
+        fprintf(stderr, "Bad options\n");
+        return 2;
+    }
+
+    if (strcmp(argv[1], "emit") == 0) {
+        if (!path) {
+            fprintf(stderr, "emit needs an output file\n");
+            return 2;
+        }
+        return emit(opt, path);
+    }
+    return opt.s3 ? ramp<BoardProfileS3>(opt) : ramp<BoardProfileC3>(opt);
+}
@@ -0,0 +1,155 @@
+// Хост-прогон микробенчмарков моста (см. src/micro_bench.h)
+//
+// Печатает JSON в формате Google Benchmark: наносекунды и такты TSC на
+// итерацию, байт/с и такты на байт. С --compare читает JSON, снятый с платы
+// (прошивка с -DMICRO_BENCH=1, команда "bench" в USB Serial, текст между
+// BENCH-BEGIN и BENCH-END), и печатает таблицу: хост нс/итер, плата
+// такты/итер и такты/байт, во сколько раз плата медленнее по времени.
+//
+// Сборка:  g++ -O2 -std=c++17 -I../src micro_bench.cpp -o micro_bench
+// Запуск:  ./micro_bench [--min-time MS] [--filter S] [--out host.json] [--compare board.json]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "micro_bench.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint32_t tsc() { return (uint32_t)__rdtsc(); }
+#else
+static inline uint32_t tsc() { return 0; }
+#endif
+
+struct HostClock {
+    uint32_t cycles() { return tsc(); }
+    uint64_t nanos() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+};
+
+// Частота TSC: такты за 50 мс
+static uint32_t tscMhz() {
+    HostClock clock;
+    uint64_t t0 = clock.nanos();
+    uint32_t c0 = clock.cycles();
+    while (clock.nanos() - t0 < 50000000ULL) {
+    }
+    uint32_t c1 = clock.cycles();
+    return (uint32_t)((uint64_t)(c1 - c0) * 1000 / (clock.nanos() - t0));
+}
+
+// Результат платы из строки JSON (по строке на бенчмарк, как пишет microBenchJson)
+struct BoardResult {
+    std::string name;
+    double nsPerIter = 0, cyclesPerIter = 0, cyclesPerByte = 0;
+};
+
+static double jsonNumber(const std::string& line, const char* key) {
+    std::string k = std::string("\"") + key + "\": ";
+    size_t p = line.find(k);
+    return (p == std::string::npos) ? 0.0 : atof(line.c_str() + p + k.size());
+}
+
+static bool loadBoard(const char* path, std::vector<BoardResult>& out, std::string& target) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), f)) {
+        std::string line(buf);
+        size_t p = line.find("\"target\": \"");
+        if (p != std::string::npos) target = line.substr(p + 11, line.find('"', p + 11) - p - 11);
+        p = line.find("\"name\": \"");
+        if (p == std::string::npos) continue;
+        BoardResult r;
+        r.name = line.substr(p + 9, line.find('"', p + 9) - p - 9);
+        r.nsPerIter = jsonNumber(line, "real_time");
+        r.cyclesPerIter = jsonNumber(line, "cycles_per_iteration");
+        r.cyclesPerByte = jsonNumber(line, "cycles_per_byte");
+        out.push_back(r);
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    double minMs = 50;
+    const char* filter = nullptr;
+    const char* outPath = nullptr;
+    const char* comparePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        bool v = i + 1 < argc;
+        if (strcmp(argv[i], "--min-time") == 0 && v) {
+            minMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && v) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && v) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0 && v) {
+            comparePath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--min-time MS] [--filter S] [--out host.json] [--compare board.json]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (minMs <= 0 || minMs > 100) {
+        fprintf(stderr, "--min-time must be in (0, 100] ms: the cycle counter is 32-bit\n");
+        return 2;
+    }
+
+    std::vector<BoardResult> board;
+    std::string boardTarget = "board";
+    if (comparePath && !loadBoard(comparePath, board, boardTarget)) {
+        fprintf(stderr, "Cannot read %s\n", comparePath);
+        return 2;
+    }
+
+    HostClock clock;
+    std::vector<MicroBenchResult> results;
+    runMicroBenchmarks(clock, (uint64_t)(minMs * 1e6), filter,
+                       [&](const MicroBenchResult& r) { results.push_back(r); });
+
+    char line[512];
+    std::string json(line, microBenchJsonHeader(line, sizeof(line), "host", tscMhz()));
+    for (size_t i = 0; i < results.size(); i++) json.append(line, microBenchJson(line, sizeof(line), results[i], i == 0));
+    json += microBenchJsonFooter;
+
+    if (outPath) {
+        FILE* f = fopen(outPath, "w");
+        if (!f || fwrite(json.data(), 1, json.size(), f) != json.size()) {
+            fprintf(stderr, "Cannot write %s\n", outPath);
+            if (f) fclose(f);
+            return 1;
+        }
+        fclose(f);
+    }
+    if (!comparePath) {
+        if (!outPath) fputs(json.c_str(), stdout);
+        return 0;
+    }
+
+    printf("%-24s %12s %14s %14s %12s %10s\n", "benchmark", "host ns/it", (boardTarget + " cyc/it").c_str(),
+           "cyc/byte", "board ns/it", "slowdown");
+    for (const MicroBenchResult& r : results) {
+        const BoardResult* b = nullptr;
+        for (const BoardResult& x : board) {
+            if (x.name == r.name) b = &x;
+        }
+        double hostNs = (double)r.nanos / r.iterations;
+        if (!b) {
+            printf("%-24s %12.1f %14s\n", r.name, hostNs, "-");
+            continue;
+        }
+        char perByte[16] = "-";
+        if (b->cyclesPerByte > 0) snprintf(perByte, sizeof(perByte), "%.2f", b->cyclesPerByte);
+        printf("%-24s %12.1f %14.0f %14s %12.0f %9.1fx\n", r.name, hostNs, b->cyclesPerIter, perByte, b->nsPerIter,
+               hostNs > 0 ? b->nsPerIter / hostNs : 0.0);
+    }
+    return 0;
+}
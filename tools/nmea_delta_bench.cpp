@@ -0,0 +1,85 @@
+// Хост-утилита для сжатия ND1 (см. src/nmea_delta.h)
+//
+// Прогоняет записанный лог UM980 через тот же кодер, что и прошивка,
+// декодирует эталонным декодером, проверяет побайтовое совпадение и
+// печатает степень сжатия и стоимость кодирования.
+//
+// Сборка:  g++ -O2 -std=c++17 -I../src nmea_delta_bench.cpp -o nmea_delta_bench
+// Запуск:  ./nmea_delta_bench capture.nmea [mtu]
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "stream_framer.h"
+#include "nmea_delta.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+#else
+static inline uint64_t cycles() { return 0; }
+#endif
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s capture.nmea [mtu]\n", argv[0]);
+        return 2;
+    }
+    size_t mtu = (argc > 2) ? (size_t)atoi(argv[2]) : 517;
+    size_t maxPayload = mtu > 3 ? mtu - 3 : 20;
+
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 2;
+    }
+    std::vector<uint8_t> input;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) input.insert(input.end(), chunk, chunk + n);
+    fclose(f);
+
+    // Кодирование: порции по 480 байт, как читает прошивка из кольцевого буфера
+    StreamFramer framer;
+    NmeaDeltaPacketizer packetizer;
+    std::vector<std::vector<uint8_t>> packets;
+    auto emit = [&](const uint8_t* p, size_t len) { packets.emplace_back(p, p + len); };
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = cycles();
+    for (size_t pos = 0; pos < input.size(); pos += 480) {
+        size_t len = std::min<size_t>(480, input.size() - pos);
+        framer.feed(input.data() + pos, len, [&](const uint8_t* rec, size_t rlen, uint8_t) {
+            packetizer.addRecord(rec, rlen, maxPayload, emit);
+        });
+        packetizer.flush(emit);
+    }
+    uint64_t c1 = cycles();
+    auto t1 = std::chrono::steady_clock::now();
+
+    // Декодирование и сверка
+    NmeaDeltaDecoder decoder;
+    std::vector<uint8_t> output;
+    for (const auto& p : packets) {
+        if (!decoder.decodePacket(p.data(), p.size(), [&](const uint8_t* d, size_t len) {
+                output.insert(output.end(), d, d + len);
+            })) {
+            fprintf(stderr, "decode error in packet %zu\n", (size_t)(&p - packets.data()));
+            return 1;
+        }
+    }
+
+    size_t packed = 0;
+    for (const auto& p : packets) packed += p.size();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+    printf("input:      %zu bytes\n", input.size());
+    printf("output:     %zu bytes in %zu packets (MTU %zu)\n", packed, packets.size(), mtu);
+    printf("ratio:      %.2f\n", packed ? (double)input.size() / packed : 0.0);
+    printf("encode:     %.2f ns/byte, %.1f cycles/byte (host)\n",
+           input.empty() ? 0.0 : ns / input.size(),
+           input.empty() ? 0.0 : (double)(c1 - c0) / input.size());
+    printf("roundtrip:  %s\n", output == input ? "OK" : "MISMATCH");
+    return output == input ? 0 : 1;
+}
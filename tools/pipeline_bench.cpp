@@ -0,0 +1,175 @@
+// Хост-утилита для конвейера моста (см. src/bridge_pipeline.h)
+//
+// Инстанцирует тот же BridgePipeline, что и прошивка, с профилями ESP32-C3 и
+// ESP32-S3 и моделью окружения: UART отдаёт поток NMEA с заданной скоростью,
+// очередь BLE — кольцевой буфер прошивки по размеру, notify мгновенный.
+// Время модельное (1 мс на шаг), в каждом шаге конвейер прокручивается, пока
+// есть работа, — как loop() C3 или пара задач S3. Печатает частоту и размер
+// notify, задержку очереди BLE и стоимость вызовов стадий в тактах.
+//
+// Сборка:  g++ -O2 -std=c++17 -I../src pipeline_bench.cpp -o pipeline_bench
+// Запуск:  ./pipeline_bench [seconds] [baud]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "bridge_pipeline.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+#else
+static inline uint64_t cycles() { return 0; }
+#endif
+
+static const size_t kBleQueueSize = 16384;  // RING_BUFFER_SIZE прошивки
+
+// Поток приёмника: GGA 10 Гц, GST/GSA/RMC 1 Гц и GSV пачкой раз в секунду
+static std::string makeSecondOfNmea() {
+    std::string s;
+    char line[128];
+    for (int epoch = 0; epoch < 10; epoch++) {
+        snprintf(line, sizeof(line), "$GNGGA,120000.%d0,5545.07407,N,03737.10741,E,4,24,0.6,156.3,M,14.4,M,1.0,0000*5A\r\n",
+                 epoch);
+        s += line;
+    }
+    s += "$GNGST,120000.00,0.8,0.012,0.010,45.0,0.012,0.015,0.031*4C\r\n";
+    s += "$GNGSA,A,3,01,03,06,09,12,17,19,22,,,,,1.1,0.6,0.9,1*0F\r\n";
+    s += "$GNRMC,120000.00,A,5545.07407,N,03737.10741,E,0.01,0.00,010125,,,D*70\r\n";
+    for (int page = 1; page <= 4; page++) {
+        snprintf(line, sizeof(line), "$GPGSV,4,%d,14,01,45,120,42,03,30,060,40,06,60,250,45,09,12,310,33*7%d\r\n",
+                 page, page);
+        s += line;
+    }
+    return s;
+}
+
+struct BenchHal {
+    // UART: байты приходят с темпом линии
+    std::string stream;
+    size_t streamPos = 0;
+    double uartCredit = 0;
+    double bytesPerMs = 0;
+    size_t uartPending = 0;
+
+    // Очередь BLE с перезаписью самых старых данных, как RingBufferT
+    std::deque<uint8_t> queue;
+    bool overflow = false;
+    uint64_t queuedTotal = 0, dequeuedTotal = 0, droppedTotal = 0;
+    std::deque<std::pair<uint64_t, unsigned long>> marks;  // Конец порции -> время постановки
+
+    unsigned long now = 0;
+    uint64_t notifies = 0, notifiedBytes = 0;
+    uint64_t latencySum = 0, latencySamples = 0;
+    unsigned long latencyMax = 0;
+
+    void tick() {
+        uartCredit += bytesPerMs;
+        size_t whole = (size_t)uartCredit;
+        uartCredit -= whole;
+        uartPending += whole;
+    }
+
+    int uartAvailable() { return (int)uartPending; }
+    size_t uartRead(uint8_t* dst, size_t n) {
+        if (n > uartPending) n = uartPending;
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = (uint8_t)stream[streamPos];
+            streamPos = (streamPos + 1) % stream.size();
+        }
+        uartPending -= n;
+        return n;
+    }
+    void uartWrite(const uint8_t*, size_t) {}
+    void onUartChunk(const uint8_t* data, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            if (queue.size() == kBleQueueSize - 1) {
+                queue.pop_front();
+                overflow = true;
+                droppedTotal++;
+            }
+            queue.push_back(data[i]);
+        }
+        queuedTotal += n;
+        marks.emplace_back(queuedTotal, now);
+    }
+    size_t rxAvailable() { return 0; }
+    size_t rxRead(uint8_t*, size_t) { return 0; }
+    void onControlCommand(const char*, size_t) {}
+    bool bleConnected() { return true; }
+    bool bleLinkReady() { return true; }
+    size_t bleMaxPayload() { return 514; }  // MTU 517
+    size_t bleQueued() { return queue.size(); }
+    bool bleOverflowed() { return overflow; }
+    size_t bleDequeue(uint8_t* dst, size_t n) {
+        if (n > queue.size()) n = queue.size();
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = queue.front();
+            queue.pop_front();
+        }
+        overflow = false;
+        dequeuedTotal += n;
+        return n;
+    }
+    bool bleSend(const uint8_t*, size_t n) {
+        notifies++;
+        notifiedBytes += n;
+        // Задержка порций, целиком ушедших в эфир (с учётом перезаписанных байт)
+        while (!marks.empty() && marks.front().first <= dequeuedTotal + droppedTotal) {
+            unsigned long latency = now - marks.front().second;
+            latencySum += latency;
+            latencySamples++;
+            if (latency > latencyMax) latencyMax = latency;
+            marks.pop_front();
+        }
+        return true;
+    }
+    void log(const char*) {}
+};
+
+template <typename Board>
+static void run(const char* name, int seconds, uint32_t baud) {
+    BenchHal hal;
+    hal.stream = makeSecondOfNmea();
+    hal.bytesPerMs = baud / 10.0 / 1000.0;
+    BridgePipeline<Board, BenchHal> pipeline(hal);
+
+    uint64_t ingestCycles = 0, flushCycles = 0, ingestCalls = 0, flushCalls = 0;
+    for (hal.now = 0; hal.now < (unsigned long)seconds * 1000; hal.now++) {
+        hal.tick();
+        for (;;) {
+            uint64_t c0 = cycles();
+            size_t in = pipeline.ingest();
+            ingestCycles += cycles() - c0;
+            ingestCalls++;
+
+            c0 = cycles();
+            size_t out = pipeline.flushBle(hal.now);
+            flushCycles += cycles() - c0;
+            flushCalls++;
+            if (in == 0 && out == 0) break;
+        }
+    }
+
+    double secs = seconds;
+    printf("%s: BLE chunk %zu B, flush interval %u ms\n", name, (size_t)Board::BLE_READ_CHUNK,
+           (unsigned)Board::BLE_FLUSH_INTERVAL_MS);
+    printf("  notify:   %.0f/s, avg %.0f B, %.0f B/s\n", hal.notifies / secs,
+           hal.notifies ? (double)hal.notifiedBytes / hal.notifies : 0.0, hal.notifiedBytes / secs);
+    printf("  queue:    latency avg %.2f ms, max %lu ms, dropped %llu B\n",
+           hal.latencySamples ? (double)hal.latencySum / hal.latencySamples : 0.0, hal.latencyMax,
+           (unsigned long long)hal.droppedTotal);
+    printf("  cycles:   ingest %.0f/call, flushBle %.0f/call\n", (double)ingestCycles / ingestCalls,
+           (double)flushCycles / flushCalls);
+}
+
+int main(int argc, char** argv) {
+    int seconds = (argc > 1) ? atoi(argv[1]) : 60;
+    uint32_t baud = (argc > 2) ? (uint32_t)atoi(argv[2]) : 921600;
+    run<BoardProfileC3>("ESP32-C3", seconds, baud);
+    run<BoardProfileS3>("ESP32-S3", seconds, baud);
+    return 0;
+}
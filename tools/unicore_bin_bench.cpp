@@ -0,0 +1,203 @@
+// Хост-утилита для бинарных логов Unicore (см. src/unicore_binary.h)
+//
+// Прогоняет записанный поток UM980 (NMEA + RTCM + бинарные логи вперемешку)
+// через тот же демультиплексор и парсер, что и прошивка, и печатает
+// статистику по типам записей, ошибки CRC и пропускную способность.
+//
+// --check: поток gnss_synth.h с BESTNAV/PVTSLN среди NMEA и RTCM подаётся
+// порциями разной длины, так что кадры режутся между чтениями; каждое
+// решение сверяется со значениями генератора. Код возврата 1 при расхождении.
+//
+// Сборка:  g++ -O2 -std=c++17 -I../src unicore_bin_bench.cpp -o unicore_bin_bench
+// Запуск:  ./unicore_bin_bench capture.bin [repeat]
+//          ./unicore_bin_bench --check
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "gnss_synth.h"
+#include "stream_framer.h"
+#include "unicore_binary.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what, uint32_t epoch) {
+    if (!ok) {
+        printf("  FAIL epoch %u: %s\n", (unsigned)epoch, what);
+        failures++;
+    }
+}
+
+// Шкала GGA по таблице типов решений Unicore, независимо от unicorePosTypeToFixQuality()
+static int expectedFixQuality(uint32_t posType) {
+    static const struct {
+        uint32_t posType;
+        int quality;
+    } table[] = {{0, 0},  {1, 7},  {2, 7},  {16, 1}, {17, 2}, {18, 2}, {19, 0}, {32, 5},
+                 {33, 5}, {34, 5}, {48, 4}, {49, 4}, {50, 4}, {68, 3}, {69, 3}};
+    for (const auto& t : table) {
+        if (t.posType == posType) return t.quality;
+    }
+    return -1;
+}
+
+static void checkNav(const UnicoreNav& nav, const SynthNav& want, bool bestnav, uint32_t epoch) {
+    const int quality = expectedFixQuality(want.posType);
+    const bool valid = quality >= 1 && quality <= 5 && (!bestnav || want.solStatus == 0);
+    expect(nav.latitude == want.latitude, "latitude", epoch);
+    expect(nav.longitude == want.longitude, "longitude", epoch);
+    // PVTSLN несёт высоту как float
+    expect(nav.altitude == (bestnav ? want.height : (double)(float)want.height), "height", epoch);
+    expect(nav.latAccuracy == want.latSigma, "lat sigma", epoch);
+    expect(nav.lonAccuracy == want.lonSigma, "lon sigma", epoch);
+    expect(nav.verticalAccuracy == want.heightSigma, "height sigma", epoch);
+    expect(nav.satellites == want.satellites, "satellites", epoch);
+    expect(nav.fixQuality == quality, "fix quality", epoch);
+    expect(nav.valid == valid, "valid", epoch);
+}
+
+static int runCheck() {
+    // CRC32 NovAtel/Unicore (отражённый 0xEDB88320, начальное 0, без XOR на выходе)
+    expect(unicoreCrc32((const uint8_t*)"123456789", 9) == 0x2DFD2D88u, "CRC32 check value", 0);
+
+    SynthConfig cfg;
+    cfg.epochHz = 10;
+    cfg.rtcmBytesPerSec = 4000;
+    cfg.unicoreBinary = true;
+    GnssSynth gen(cfg);
+    const uint32_t epochs = 5 * SYNTH_POS_TYPES;
+
+    std::vector<uint8_t> input;
+    size_t generated[3] = {0};  // NMEA, RTCM, Unicore
+    uint8_t rec[SYNTH_MAX_RECORD];
+    while (gen.epochIndex() < epochs) {
+        size_t n = gen.nextRecord(rec, sizeof(rec));
+        if (n == 0) continue;
+        generated[rec[0] == '$' ? 0 : rec[0] == 0xD3 ? 1 : 2]++;
+        input.insert(input.end(), rec, rec + n);
+    }
+
+    // Порции взаимно простых длин: кадры режутся в разных местах заголовка и тела
+    static const size_t chunks[] = {1, 7, 61, 256, 3, 509, 24, 131};
+    StreamFramer framer;
+    std::vector<uint8_t> output;
+    size_t framed[3] = {0}, other = 0;
+    uint32_t bestnavs = 0, pvtslns = 0;
+    std::vector<uint8_t> corrupt;
+    for (size_t pos = 0, k = 0; pos < input.size(); k++) {
+        size_t len = std::min(chunks[k % (sizeof(chunks) / sizeof(chunks[0]))], input.size() - pos);
+        framer.feed(input.data() + pos, len, [&](const uint8_t* r, size_t rlen, uint8_t type) {
+            output.insert(output.end(), r, r + rlen);
+            if (type == ST_RTCM) {
+                framed[1]++;
+            } else if (type == ST_UNIBIN) {
+                framed[2]++;
+                UnicoreHeader hdr;
+                UnicoreNav nav;
+                if (!unicoreDecodeNav(r, rlen, &hdr, &nav)) {
+                    expect(false, "binary frame not decoded", bestnavs);
+                    return;
+                }
+                if (hdr.messageId == UNICORE_MSG_BESTNAV) {
+                    expect(hdr.towMs == bestnavs * 1000 / cfg.epochHz, "BESTNAV tow", bestnavs);
+                    checkNav(nav, gen.binaryNav(bestnavs), true, bestnavs);
+                    if (corrupt.empty()) corrupt.assign(r, r + rlen);
+                    bestnavs++;
+                } else if (hdr.messageId == UNICORE_MSG_PVTSLN) {
+                    checkNav(nav, gen.binaryNav(pvtslns + 1), false, pvtslns);
+                    pvtslns++;
+                }
+            } else if (type <= ST_NMEA_OTHER) {
+                framed[0]++;
+            } else {
+                other++;
+            }
+        });
+        pos += len;
+    }
+
+    expect(output == input, "framer output differs from input", 0);
+    expect(framed[0] == generated[0] && framed[1] == generated[1] && framed[2] == generated[2] && other == 0,
+           "record counts by type", 0);
+    expect(bestnavs == epochs && pvtslns == epochs, "one BESTNAV and one PVTSLN per epoch", 0);
+
+    // Испорченный байт тела — кадр отвергается по CRC
+    UnicoreHeader hdr;
+    UnicoreNav nav;
+    if (!corrupt.empty()) {
+        corrupt[UNICORE_HEADER_LEN + 9] ^= 0x01;
+        expect(!unicoreDecodeNav(corrupt.data(), corrupt.size(), &hdr, &nav), "corrupted frame accepted", 0);
+    }
+
+    printf("unicore check: %zu B, %zu NMEA, %zu RTCM, %u BESTNAV, %u PVTSLN: %s\n", input.size(), framed[0],
+           framed[1], (unsigned)bestnavs, (unsigned)pvtslns, failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s capture.bin [repeat] | --check\n", argv[0]);
+        return 2;
+    }
+    if (strcmp(argv[1], "--check") == 0) return runCheck();
+    int repeat = (argc > 2) ? atoi(argv[2]) : 20;
+    if (repeat < 1) repeat = 1;
+
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 2;
+    }
+    std::vector<uint8_t> input;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) input.insert(input.end(), chunk, chunk + n);
+    fclose(f);
+
+    size_t records[ST_COUNT] = {0};
+    size_t bytes[ST_COUNT] = {0};
+    size_t navSolutions = 0, crcErrors = 0;
+    UnicoreNav last = {};
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        StreamFramer framer;
+        // Порции по 256 байт, как читает прошивка из UART
+        for (size_t pos = 0; pos < input.size(); pos += 256) {
+            size_t len = std::min<size_t>(256, input.size() - pos);
+            framer.feed(input.data() + pos, len, [&](const uint8_t* rec, size_t rlen, uint8_t type) {
+                if (r == 0) {
+                    records[type]++;
+                    bytes[type] += rlen;
+                }
+                if (type != ST_UNIBIN) return;
+                UnicoreHeader hdr;
+                UnicoreNav nav;
+                if (unicoreDecodeNav(rec, rlen, &hdr, &nav)) {
+                    if (r == 0) navSolutions++;
+                    last = nav;
+                } else if (r == 0 && unicoreFrameLength(rec, rlen) == rlen && !unicoreCheckFrame(rec, rlen, &hdr)) {
+                    crcErrors++;
+                }
+            });
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(t1 - t0).count();
+
+    for (int t = 0; t < ST_COUNT; t++) {
+        if (records[t]) printf("%-5s %8zu records %10zu bytes\n", sentenceTypeNames[t], records[t], bytes[t]);
+    }
+    printf("nav solutions: %zu, CRC errors: %zu\n", navSolutions, crcErrors);
+    if (navSolutions) {
+        printf("last fix: %.8f %.8f %.3f m, quality %d, %d sats, sigma %.3f/%.3f/%.3f m\n",
+               last.latitude, last.longitude, last.altitude, last.fixQuality, last.satellites,
+               last.latAccuracy, last.lonAccuracy, last.verticalAccuracy);
+    }
+    double total = (double)input.size() * repeat;
+    printf("throughput: %.1f MB/s (%.2f ns/byte)\n", total / sec / 1e6, sec * 1e9 / total);
+    return 0;
+}